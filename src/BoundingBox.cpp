@@ -0,0 +1,116 @@
+#include <cassert>
+#include <cfloat>
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+#include "Ray.h"
+#include "MathHelper.h"
+
+namespace Nxna
+{
+	void BoundingBox::GetCorners(Vector3* corners) const
+	{
+		assert(corners != nullptr);
+
+		// same order as XNA: the 4 corners facing +Z, then the 4 facing -Z
+		corners[0] = Vector3(Min.X, Max.Y, Max.Z);
+		corners[1] = Vector3(Max.X, Max.Y, Max.Z);
+		corners[2] = Vector3(Max.X, Min.Y, Max.Z);
+		corners[3] = Vector3(Min.X, Min.Y, Max.Z);
+		corners[4] = Vector3(Min.X, Max.Y, Min.Z);
+		corners[5] = Vector3(Max.X, Max.Y, Min.Z);
+		corners[6] = Vector3(Max.X, Min.Y, Min.Z);
+		corners[7] = Vector3(Min.X, Min.Y, Min.Z);
+	}
+
+	ContainmentType BoundingBox::Contains(const BoundingBox& box) const
+	{
+		if (Intersects(box) == false)
+			return ContainmentType::Disjoint;
+
+		if (box.Min.X >= Min.X && box.Max.X <= Max.X &&
+			box.Min.Y >= Min.Y && box.Max.Y <= Max.Y &&
+			box.Min.Z >= Min.Z && box.Max.Z <= Max.Z)
+			return ContainmentType::Contains;
+
+		return ContainmentType::Intersects;
+	}
+
+	ContainmentType BoundingBox::Contains(const BoundingSphere& sphere) const
+	{
+		if (Intersects(sphere) == false)
+			return ContainmentType::Disjoint;
+
+		const Vector3& c = sphere.Center;
+		float r = sphere.Radius;
+		if (c.X - r >= Min.X && c.X + r <= Max.X &&
+			c.Y - r >= Min.Y && c.Y + r <= Max.Y &&
+			c.Z - r >= Min.Z && c.Z + r <= Max.Z)
+			return ContainmentType::Contains;
+
+		return ContainmentType::Intersects;
+	}
+
+	ContainmentType BoundingBox::Contains(const Vector3& point) const
+	{
+		if (point.X >= Min.X && point.X <= Max.X &&
+			point.Y >= Min.Y && point.Y <= Max.Y &&
+			point.Z >= Min.Z && point.Z <= Max.Z)
+			return ContainmentType::Contains;
+
+		return ContainmentType::Disjoint;
+	}
+
+	bool BoundingBox::Intersects(const BoundingBox& box) const
+	{
+		return Max.X >= box.Min.X && Min.X <= box.Max.X &&
+			Max.Y >= box.Min.Y && Min.Y <= box.Max.Y &&
+			Max.Z >= box.Min.Z && Min.Z <= box.Max.Z;
+	}
+
+	bool BoundingBox::Intersects(const BoundingSphere& sphere) const
+	{
+		// find the point in the box closest to the center of the sphere
+		Vector3 closest(
+			MathHelper::Clamp(sphere.Center.X, Min.X, Max.X),
+			MathHelper::Clamp(sphere.Center.Y, Min.Y, Max.Y),
+			MathHelper::Clamp(sphere.Center.Z, Min.Z, Max.Z));
+
+		return Vector3::DistanceSquared(closest, sphere.Center) <= sphere.Radius * sphere.Radius;
+	}
+
+	bool BoundingBox::Intersects(const Ray& ray, float& distance) const
+	{
+		return ray.Intersects(*this, distance);
+	}
+
+	BoundingBox BoundingBox::CreateFromPoints(const Vector3* points, int count)
+	{
+		assert(points != nullptr && count > 0);
+
+		BoundingBox result(Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+		for (int i = 0; i < count; i++)
+		{
+			result.Min.X = Math::Min(result.Min.X, points[i].X);
+			result.Min.Y = Math::Min(result.Min.Y, points[i].Y);
+			result.Min.Z = Math::Min(result.Min.Z, points[i].Z);
+			result.Max.X = Math::Max(result.Max.X, points[i].X);
+			result.Max.Y = Math::Max(result.Max.Y, points[i].Y);
+			result.Max.Z = Math::Max(result.Max.Z, points[i].Z);
+		}
+
+		return result;
+	}
+
+	BoundingBox BoundingBox::CreateFromSphere(const BoundingSphere& sphere)
+	{
+		Vector3 extent(sphere.Radius, sphere.Radius, sphere.Radius);
+		return BoundingBox(sphere.Center - extent, sphere.Center + extent);
+	}
+
+	BoundingBox BoundingBox::CreateMerged(const BoundingBox& original, const BoundingBox& additional)
+	{
+		return BoundingBox(
+			Vector3(Math::Min(original.Min.X, additional.Min.X), Math::Min(original.Min.Y, additional.Min.Y), Math::Min(original.Min.Z, additional.Min.Z)),
+			Vector3(Math::Max(original.Max.X, additional.Max.X), Math::Max(original.Max.Y, additional.Max.Y), Math::Max(original.Max.Z, additional.Max.Z)));
+	}
+}
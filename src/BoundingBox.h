@@ -0,0 +1,47 @@
+#ifndef NXNA_BOUNDINGBOX_H
+#define NXNA_BOUNDINGBOX_H
+
+#include "Vector3.h"
+#include "ContainmentType.h"
+#include "Plane.h"
+
+namespace Nxna
+{
+	struct BoundingSphere;
+	struct Ray;
+
+	struct BoundingBox
+	{
+		static const int CornerCount = 8;
+
+		Vector3 Min;
+		Vector3 Max;
+
+		BoundingBox()
+		{
+		}
+
+		BoundingBox(const Vector3& min, const Vector3& max)
+			: Min(min), Max(max)
+		{
+		}
+
+		// corners must have room for CornerCount vectors
+		void GetCorners(Vector3* corners) const;
+
+		ContainmentType Contains(const BoundingBox& box) const;
+		ContainmentType Contains(const BoundingSphere& sphere) const;
+		ContainmentType Contains(const Vector3& point) const;
+
+		bool Intersects(const BoundingBox& box) const;
+		bool Intersects(const BoundingSphere& sphere) const;
+		PlaneIntersectionType Intersects(const Plane& plane) const { return plane.Intersects(*this); }
+		bool Intersects(const Ray& ray, float& distance) const;
+
+		static BoundingBox CreateFromPoints(const Vector3* points, int count);
+		static BoundingBox CreateFromSphere(const BoundingSphere& sphere);
+		static BoundingBox CreateMerged(const BoundingBox& original, const BoundingBox& additional);
+	};
+}
+
+#endif // NXNA_BOUNDINGBOX_H
@@ -0,0 +1,282 @@
+#include <cassert>
+#include <cstring>
+#include "BoundingFrustum.h"
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+#include "MathSimd.h"
+
+namespace Nxna
+{
+	static Vector3 intersectPlanes(const Plane& a, const Plane& b, const Plane& c)
+	{
+		Vector3 bc = Vector3::Cross(b.Normal, c.Normal);
+		Vector3 ca = Vector3::Cross(c.Normal, a.Normal);
+		Vector3 ab = Vector3::Cross(a.Normal, b.Normal);
+
+		return (bc * -a.D + ca * -b.D + ab * -c.D) / Vector3::Dot(a.Normal, bc);
+	}
+
+	BoundingFrustum::BoundingFrustum(const Matrix& viewProjection)
+	{
+		SetMatrix(viewProjection);
+	}
+
+	void BoundingFrustum::SetMatrix(const Matrix& viewProjection)
+	{
+		const Matrix& m = viewProjection;
+		m_matrix = m;
+
+		// Matrix::CreatePerspective() maps Z to -1..1, so the near plane is where z == -w.
+		// Projections that map Z to 0..1 end up with a near plane a little too far back,
+		// which is harmless for culling.
+		m_planes[0] = Plane(-m.M14 - m.M13, -m.M24 - m.M23, -m.M34 - m.M33, -m.M44 - m.M43);
+		m_planes[1] = Plane(m.M13 - m.M14, m.M23 - m.M24, m.M33 - m.M34, m.M43 - m.M44);
+		m_planes[2] = Plane(-m.M14 - m.M11, -m.M24 - m.M21, -m.M34 - m.M31, -m.M44 - m.M41);
+		m_planes[3] = Plane(m.M11 - m.M14, m.M21 - m.M24, m.M31 - m.M34, m.M41 - m.M44);
+		m_planes[4] = Plane(m.M12 - m.M14, m.M22 - m.M24, m.M32 - m.M34, m.M42 - m.M44);
+		m_planes[5] = Plane(-m.M14 - m.M12, -m.M24 - m.M22, -m.M34 - m.M32, -m.M44 - m.M42);
+
+		for (int i = 0; i < PlaneCount; i++)
+			m_planes[i].Normalize();
+
+		const Plane& nearPlane = m_planes[0];
+		const Plane& farPlane = m_planes[1];
+		const Plane& left = m_planes[2];
+		const Plane& right = m_planes[3];
+		const Plane& top = m_planes[4];
+		const Plane& bottom = m_planes[5];
+
+		m_corners[0] = intersectPlanes(nearPlane, left, top);
+		m_corners[1] = intersectPlanes(nearPlane, right, top);
+		m_corners[2] = intersectPlanes(nearPlane, right, bottom);
+		m_corners[3] = intersectPlanes(nearPlane, left, bottom);
+		m_corners[4] = intersectPlanes(farPlane, left, top);
+		m_corners[5] = intersectPlanes(farPlane, right, top);
+		m_corners[6] = intersectPlanes(farPlane, right, bottom);
+		m_corners[7] = intersectPlanes(farPlane, left, bottom);
+	}
+
+	void BoundingFrustum::GetCorners(Vector3* corners) const
+	{
+		assert(corners != nullptr);
+
+		for (int i = 0; i < CornerCount; i++)
+			corners[i] = m_corners[i];
+	}
+
+	ContainmentType BoundingFrustum::Contains(const BoundingBox& box) const
+	{
+		ContainmentType result = ContainmentType::Contains;
+		for (int i = 0; i < PlaneCount; i++)
+		{
+			PlaneIntersectionType type = m_planes[i].Intersects(box);
+			if (type == PlaneIntersectionType::Front)
+				return ContainmentType::Disjoint;
+			if (type == PlaneIntersectionType::Intersecting)
+				result = ContainmentType::Intersects;
+		}
+
+		return result;
+	}
+
+	ContainmentType BoundingFrustum::Contains(const BoundingSphere& sphere) const
+	{
+		ContainmentType result = ContainmentType::Contains;
+		for (int i = 0; i < PlaneCount; i++)
+		{
+			PlaneIntersectionType type = m_planes[i].Intersects(sphere);
+			if (type == PlaneIntersectionType::Front)
+				return ContainmentType::Disjoint;
+			if (type == PlaneIntersectionType::Intersecting)
+				result = ContainmentType::Intersects;
+		}
+
+		return result;
+	}
+
+	ContainmentType BoundingFrustum::Contains(const Vector3& point) const
+	{
+		for (int i = 0; i < PlaneCount; i++)
+		{
+			if (m_planes[i].DotCoordinate(point) > 0)
+				return ContainmentType::Disjoint;
+		}
+
+		return ContainmentType::Contains;
+	}
+
+	PlaneIntersectionType BoundingFrustum::Intersects(const Plane& plane) const
+	{
+		bool front = false, back = false;
+		for (int i = 0; i < CornerCount; i++)
+		{
+			if (plane.DotCoordinate(m_corners[i]) > 0)
+				front = true;
+			else
+				back = true;
+		}
+
+		if (front && back)
+			return PlaneIntersectionType::Intersecting;
+
+		return front ? PlaneIntersectionType::Front : PlaneIntersectionType::Back;
+	}
+
+	void BoundingFrustum::CullBoxes(const float* minX, const float* minY, const float* minZ,
+		const float* maxX, const float* maxY, const float* maxZ,
+		size_t count, unsigned int* visibility) const
+	{
+		assert(count == 0 || (minX != nullptr && minY != nullptr && minZ != nullptr && maxX != nullptr && maxY != nullptr && maxZ != nullptr && visibility != nullptr));
+
+		// A box is outside if the corner farthest inside a plane is still in front of it.
+		// The signs of the plane's normal pick that corner, and they're the same for every box,
+		// so each plane can just point at the right arrays.
+		const float* insideX[PlaneCount];
+		const float* insideY[PlaneCount];
+		const float* insideZ[PlaneCount];
+		for (int p = 0; p < PlaneCount; p++)
+		{
+			insideX[p] = m_planes[p].Normal.X >= 0 ? minX : maxX;
+			insideY[p] = m_planes[p].Normal.Y >= 0 ? minY : maxY;
+			insideZ[p] = m_planes[p].Normal.Z >= 0 ? minZ : maxZ;
+		}
+
+		memset(visibility, 0, (count + 31) / 32 * sizeof(unsigned int));
+
+		size_t i = 0;
+
+#if defined NXNA_SIMD_SSE2
+		__m128 planeX[PlaneCount], planeY[PlaneCount], planeZ[PlaneCount], planeD[PlaneCount];
+		for (int p = 0; p < PlaneCount; p++)
+		{
+			planeX[p] = _mm_set1_ps(m_planes[p].Normal.X);
+			planeY[p] = _mm_set1_ps(m_planes[p].Normal.Y);
+			planeZ[p] = _mm_set1_ps(m_planes[p].Normal.Z);
+			planeD[p] = _mm_set1_ps(m_planes[p].D);
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 outside = zero;
+			for (int p = 0; p < PlaneCount; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(insideX[p] + i), planeX[p]), _mm_mul_ps(_mm_loadu_ps(insideY[p] + i), planeY[p]));
+				distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(_mm_loadu_ps(insideZ[p] + i), planeZ[p])), planeD[p]);
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, zero));
+			}
+
+			visibility[i / 32] |= (~Simd::MoveMask(outside) & 0xf) << (i % 32);
+		}
+#elif defined NXNA_SIMD_NEON
+		const float32x4_t zero = vdupq_n_f32(0);
+		for (; i + 4 <= count; i += 4)
+		{
+			uint32x4_t outside = vdupq_n_u32(0);
+			for (int p = 0; p < PlaneCount; p++)
+			{
+				float32x4_t distance = vmulq_n_f32(vld1q_f32(insideX[p] + i), m_planes[p].Normal.X);
+				distance = vmlaq_n_f32(distance, vld1q_f32(insideY[p] + i), m_planes[p].Normal.Y);
+				distance = vmlaq_n_f32(distance, vld1q_f32(insideZ[p] + i), m_planes[p].Normal.Z);
+				distance = vaddq_f32(distance, vdupq_n_f32(m_planes[p].D));
+				outside = vorrq_u32(outside, vcgtq_f32(distance, zero));
+			}
+
+			visibility[i / 32] |= (~Simd::MoveMask(outside) & 0xf) << (i % 32);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			bool visible = true;
+			for (int p = 0; p < PlaneCount; p++)
+			{
+				const Plane& plane = m_planes[p];
+				if (plane.Normal.X * insideX[p][i] + plane.Normal.Y * insideY[p][i] + plane.Normal.Z * insideZ[p][i] + plane.D > 0)
+				{
+					visible = false;
+					break;
+				}
+			}
+
+			if (visible)
+				visibility[i / 32] |= 1u << (i % 32);
+		}
+	}
+
+	void BoundingFrustum::CullSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+		size_t count, unsigned int* visibility) const
+	{
+		assert(count == 0 || (centerX != nullptr && centerY != nullptr && centerZ != nullptr && radius != nullptr && visibility != nullptr));
+
+		memset(visibility, 0, (count + 31) / 32 * sizeof(unsigned int));
+
+		size_t i = 0;
+
+#if defined NXNA_SIMD_SSE2
+		__m128 planeX[PlaneCount], planeY[PlaneCount], planeZ[PlaneCount], planeD[PlaneCount];
+		for (int p = 0; p < PlaneCount; p++)
+		{
+			planeX[p] = _mm_set1_ps(m_planes[p].Normal.X);
+			planeY[p] = _mm_set1_ps(m_planes[p].Normal.Y);
+			planeZ[p] = _mm_set1_ps(m_planes[p].Normal.Z);
+			planeD[p] = _mm_set1_ps(m_planes[p].D);
+		}
+
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 x = _mm_loadu_ps(centerX + i);
+			__m128 y = _mm_loadu_ps(centerY + i);
+			__m128 z = _mm_loadu_ps(centerZ + i);
+			__m128 r = _mm_loadu_ps(radius + i);
+
+			__m128 outside = _mm_setzero_ps();
+			for (int p = 0; p < PlaneCount; p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p]));
+				distance = _mm_add_ps(_mm_add_ps(distance, _mm_mul_ps(z, planeZ[p])), planeD[p]);
+				outside = _mm_or_ps(outside, _mm_cmpgt_ps(distance, r));
+			}
+
+			visibility[i / 32] |= (~Simd::MoveMask(outside) & 0xf) << (i % 32);
+		}
+#elif defined NXNA_SIMD_NEON
+		for (; i + 4 <= count; i += 4)
+		{
+			float32x4_t x = vld1q_f32(centerX + i);
+			float32x4_t y = vld1q_f32(centerY + i);
+			float32x4_t z = vld1q_f32(centerZ + i);
+			float32x4_t r = vld1q_f32(radius + i);
+
+			uint32x4_t outside = vdupq_n_u32(0);
+			for (int p = 0; p < PlaneCount; p++)
+			{
+				float32x4_t distance = vmulq_n_f32(x, m_planes[p].Normal.X);
+				distance = vmlaq_n_f32(distance, y, m_planes[p].Normal.Y);
+				distance = vmlaq_n_f32(distance, z, m_planes[p].Normal.Z);
+				distance = vaddq_f32(distance, vdupq_n_f32(m_planes[p].D));
+				outside = vorrq_u32(outside, vcgtq_f32(distance, r));
+			}
+
+			visibility[i / 32] |= (~Simd::MoveMask(outside) & 0xf) << (i % 32);
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			bool visible = true;
+			for (int p = 0; p < PlaneCount; p++)
+			{
+				const Plane& plane = m_planes[p];
+				if (plane.Normal.X * centerX[i] + plane.Normal.Y * centerY[i] + plane.Normal.Z * centerZ[i] + plane.D > radius[i])
+				{
+					visible = false;
+					break;
+				}
+			}
+
+			if (visible)
+				visibility[i / 32] |= 1u << (i % 32);
+		}
+	}
+}
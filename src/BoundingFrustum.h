@@ -0,0 +1,61 @@
+#ifndef NXNA_BOUNDINGFRUSTUM_H
+#define NXNA_BOUNDINGFRUSTUM_H
+
+#include <cstddef>
+#include "Matrix.h"
+#include "Plane.h"
+#include "ContainmentType.h"
+
+namespace Nxna
+{
+	struct BoundingBox;
+	struct BoundingSphere;
+
+	class BoundingFrustum
+	{
+		static const int PlaneCount = 6;
+
+		Matrix m_matrix;
+		Plane m_planes[PlaneCount]; // the normals point out of the frustum
+		Vector3 m_corners[8];
+
+	public:
+		static const int CornerCount = 8;
+
+		BoundingFrustum(const Matrix& viewProjection);
+
+		const Matrix& GetMatrix() const { return m_matrix; }
+		void SetMatrix(const Matrix& viewProjection);
+
+		const Plane& GetNear() const { return m_planes[0]; }
+		const Plane& GetFar() const { return m_planes[1]; }
+		const Plane& GetLeft() const { return m_planes[2]; }
+		const Plane& GetRight() const { return m_planes[3]; }
+		const Plane& GetTop() const { return m_planes[4]; }
+		const Plane& GetBottom() const { return m_planes[5]; }
+
+		// corners must have room for CornerCount vectors.
+		// The near corners come first, in the same order as XNA.
+		void GetCorners(Vector3* corners) const;
+
+		ContainmentType Contains(const BoundingBox& box) const;
+		ContainmentType Contains(const BoundingSphere& sphere) const;
+		ContainmentType Contains(const Vector3& point) const;
+
+		bool Intersects(const BoundingBox& box) const { return Contains(box) != ContainmentType::Disjoint; }
+		bool Intersects(const BoundingSphere& sphere) const { return Contains(sphere) != ContainmentType::Disjoint; }
+		PlaneIntersectionType Intersects(const Plane& plane) const;
+
+		// These don't exist in XNA!
+		// They test lots of objects at once, stored as a structure of arrays (minX[i], minY[i], ... is box i).
+		// Bit (i % 32) of visibility[i / 32] is set if object i intersects the frustum, so visibility
+		// needs room for (count + 31) / 32 values. The results are the same as Intersects().
+		void CullBoxes(const float* minX, const float* minY, const float* minZ,
+			const float* maxX, const float* maxY, const float* maxZ,
+			size_t count, unsigned int* visibility) const;
+		void CullSpheres(const float* centerX, const float* centerY, const float* centerZ, const float* radius,
+			size_t count, unsigned int* visibility) const;
+	};
+}
+
+#endif // NXNA_BOUNDINGFRUSTUM_H
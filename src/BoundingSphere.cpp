@@ -0,0 +1,140 @@
+#include <cassert>
+#include <cmath>
+#include "BoundingSphere.h"
+#include "BoundingBox.h"
+#include "Matrix.h"
+#include "Ray.h"
+#include "MathHelper.h"
+
+namespace Nxna
+{
+	ContainmentType BoundingSphere::Contains(const BoundingBox& box) const
+	{
+		if (Intersects(box) == false)
+			return ContainmentType::Disjoint;
+
+		Vector3 corners[BoundingBox::CornerCount];
+		box.GetCorners(corners);
+
+		float radiusSquared = Radius * Radius;
+		for (int i = 0; i < BoundingBox::CornerCount; i++)
+		{
+			if (Vector3::DistanceSquared(corners[i], Center) > radiusSquared)
+				return ContainmentType::Intersects;
+		}
+
+		return ContainmentType::Contains;
+	}
+
+	ContainmentType BoundingSphere::Contains(const BoundingSphere& sphere) const
+	{
+		float distance = Vector3::Distance(Center, sphere.Center);
+
+		if (distance > Radius + sphere.Radius)
+			return ContainmentType::Disjoint;
+		if (distance + sphere.Radius <= Radius)
+			return ContainmentType::Contains;
+
+		return ContainmentType::Intersects;
+	}
+
+	ContainmentType BoundingSphere::Contains(const Vector3& point) const
+	{
+		if (Vector3::DistanceSquared(point, Center) <= Radius * Radius)
+			return ContainmentType::Contains;
+
+		return ContainmentType::Disjoint;
+	}
+
+	bool BoundingSphere::Intersects(const BoundingBox& box) const
+	{
+		return box.Intersects(*this);
+	}
+
+	bool BoundingSphere::Intersects(const BoundingSphere& sphere) const
+	{
+		float radius = Radius + sphere.Radius;
+		return Vector3::DistanceSquared(Center, sphere.Center) <= radius * radius;
+	}
+
+	bool BoundingSphere::Intersects(const Ray& ray, float& distance) const
+	{
+		return ray.Intersects(*this, distance);
+	}
+
+	BoundingSphere BoundingSphere::Transform(const Matrix& matrix) const
+	{
+		float scaleX = matrix.M11 * matrix.M11 + matrix.M12 * matrix.M12 + matrix.M13 * matrix.M13;
+		float scaleY = matrix.M21 * matrix.M21 + matrix.M22 * matrix.M22 + matrix.M23 * matrix.M23;
+		float scaleZ = matrix.M31 * matrix.M31 + matrix.M32 * matrix.M32 + matrix.M33 * matrix.M33;
+
+		BoundingSphere result;
+		Vector3::Transform(Center, matrix, result.Center);
+		result.Radius = Radius * sqrt(Math::Max(scaleX, Math::Max(scaleY, scaleZ)));
+
+		return result;
+	}
+
+	BoundingSphere BoundingSphere::CreateFromBoundingBox(const BoundingBox& box)
+	{
+		Vector3 center = (box.Min + box.Max) * 0.5f;
+		return BoundingSphere(center, Vector3::Distance(center, box.Max));
+	}
+
+	BoundingSphere BoundingSphere::CreateFromPoints(const Vector3* points, int count)
+	{
+		assert(points != nullptr && count > 0);
+
+		// Ritter's method: start with the two points farthest apart along X, Y, or Z...
+		int minIndex[3] = { 0, 0, 0 };
+		int maxIndex[3] = { 0, 0, 0 };
+		for (int i = 1; i < count; i++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (points[i].C[axis] < points[minIndex[axis]].C[axis]) minIndex[axis] = i;
+				if (points[i].C[axis] > points[maxIndex[axis]].C[axis]) maxIndex[axis] = i;
+			}
+		}
+
+		int widest = 0;
+		for (int axis = 1; axis < 3; axis++)
+		{
+			if (Vector3::DistanceSquared(points[minIndex[axis]], points[maxIndex[axis]]) >
+				Vector3::DistanceSquared(points[minIndex[widest]], points[maxIndex[widest]]))
+				widest = axis;
+		}
+
+		const Vector3& a = points[minIndex[widest]];
+		const Vector3& b = points[maxIndex[widest]];
+		BoundingSphere result((a + b) * 0.5f, Vector3::Distance(a, b) * 0.5f);
+
+		// ...then grow it just enough to include any point outside
+		for (int i = 0; i < count; i++)
+		{
+			float distance = Vector3::Distance(points[i], result.Center);
+			if (distance > result.Radius)
+			{
+				float radius = (result.Radius + distance) * 0.5f;
+				result.Center += (points[i] - result.Center) * ((radius - result.Radius) / distance);
+				result.Radius = radius;
+			}
+		}
+
+		return result;
+	}
+
+	BoundingSphere BoundingSphere::CreateMerged(const BoundingSphere& original, const BoundingSphere& additional)
+	{
+		Vector3 offset = additional.Center - original.Center;
+		float distance = offset.Length();
+
+		if (distance + additional.Radius <= original.Radius)
+			return original;
+		if (distance + original.Radius <= additional.Radius)
+			return additional;
+
+		float radius = (distance + original.Radius + additional.Radius) * 0.5f;
+		return BoundingSphere(original.Center + offset * ((radius - original.Radius) / distance), radius);
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef NXNA_BOUNDINGSPHERE_H
+#define NXNA_BOUNDINGSPHERE_H
+
+#include "Vector3.h"
+#include "ContainmentType.h"
+#include "Plane.h"
+
+namespace Nxna
+{
+	struct BoundingBox;
+	struct Matrix;
+	struct Ray;
+
+	struct BoundingSphere
+	{
+		Vector3 Center;
+		float Radius;
+
+		BoundingSphere()
+		{
+			Radius = 0;
+		}
+
+		BoundingSphere(const Vector3& center, float radius)
+			: Center(center), Radius(radius)
+		{
+		}
+
+		ContainmentType Contains(const BoundingBox& box) const;
+		ContainmentType Contains(const BoundingSphere& sphere) const;
+		ContainmentType Contains(const Vector3& point) const;
+
+		bool Intersects(const BoundingBox& box) const;
+		bool Intersects(const BoundingSphere& sphere) const;
+		PlaneIntersectionType Intersects(const Plane& plane) const { return plane.Intersects(*this); }
+		bool Intersects(const Ray& ray, float& distance) const;
+
+		// the radius is scaled by the largest scale in the matrix
+		BoundingSphere Transform(const Matrix& matrix) const;
+
+		static BoundingSphere CreateFromBoundingBox(const BoundingBox& box);
+
+		// This isn't the smallest possible sphere, but it's close and it's fast
+		static BoundingSphere CreateFromPoints(const Vector3* points, int count);
+		static BoundingSphere CreateMerged(const BoundingSphere& original, const BoundingSphere& additional);
+	};
+}
+
+#endif // NXNA_BOUNDINGSPHERE_H
@@ -0,0 +1,15 @@
+#ifndef NXNA_CONTAINMENTTYPE_H
+#define NXNA_CONTAINMENTTYPE_H
+
+#include "NxnaConfig.h"
+
+namespace Nxna
+{
+	NXNA_ENUM(ContainmentType)
+		Disjoint,
+		Contains,
+		Intersects
+	END_NXNA_ENUM(ContainmentType)
+}
+
+#endif // NXNA_CONTAINMENTTYPE_H
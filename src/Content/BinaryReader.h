@@ -0,0 +1,133 @@
+#ifndef NXNA_CONTENT_BINARYREADER_H
+#define NXNA_CONTENT_BINARYREADER_H
+
+#include <cstring>
+#include "../NxnaConfig.h"
+#include "ContentManager.h"
+#include "FileStream.h"
+
+namespace Nxna
+{
+namespace Content
+{
+	// this class doesn't exist in XNA!
+	// Reads little-endian values from memory without going through the virtual Stream
+	// methods one value at a time. Like the streams, this assumes a little-endian host,
+	// so arrays of plain structs (like Rectangle) are read with a single memcpy().
+	// Reading past the end throws a ContentException.
+	class BinaryReader
+	{
+		const byte* m_data;
+		int m_length;
+		int m_position;
+		MemoryStream* m_stream;
+
+	public:
+		BinaryReader(const byte* data, int length)
+		{
+			m_data = data;
+			m_length = length;
+			m_position = 0;
+			m_stream = nullptr;
+		}
+
+		// Starts at the stream's current position. The stream doesn't move until Finish() is called.
+		BinaryReader(MemoryStream* stream)
+		{
+			m_data = stream->GetBuffer();
+			m_length = stream->Length();
+			m_position = stream->Position();
+			m_stream = stream;
+		}
+
+		// moves the stream (if there is one) past everything that's been read
+		void Finish()
+		{
+			if (m_stream != nullptr)
+				m_stream->Seek(m_position, SeekOrigin::Begin);
+		}
+
+		int Position() { return m_position; }
+		int Length() { return m_length; }
+		int Remaining() { return m_length - m_position; }
+
+		void Skip(int bytes)
+		{
+			check(bytes);
+			m_position += bytes;
+		}
+
+		byte ReadByte()
+		{
+			check(1);
+			return m_data[m_position++];
+		}
+
+		short ReadInt16() { return read<short>(); }
+		int ReadInt32() { return read<int>(); }
+		float ReadFloat() { return read<float>(); }
+
+		int Read7BitEncodedInt()
+		{
+			int result = 0;
+			int bitsRead = 0;
+			byte value;
+
+			do
+			{
+				if (bitsRead >= 35)
+					throw ContentException("Invalid 7-bit encoded integer");
+
+				value = ReadByte();
+				result |= (value & 0x7f) << bitsRead;
+				bitsRead += 7;
+			}
+			while (value & 0x80);
+
+			return result;
+		}
+
+		// returns a pointer to the next length bytes and skips over them
+		const byte* ReadInPlace(int length)
+		{
+			check(length);
+
+			const byte* result = m_data + m_position;
+			m_position += length;
+
+			return result;
+		}
+
+		template<typename T>
+		void ReadArray(T* destination, int count)
+		{
+			if (count < 0 || (unsigned int)count > (unsigned int)Remaining() / sizeof(T))
+				throw ContentException("Unexpected end of content data");
+
+			memcpy(destination, m_data + m_position, sizeof(T) * count);
+			m_position += sizeof(T) * count;
+		}
+
+	private:
+		template<typename T>
+		T read()
+		{
+			check(sizeof(T));
+
+			T result;
+			memcpy(&result, m_data + m_position, sizeof(T));
+			m_position += sizeof(T);
+
+			return result;
+		}
+
+		void check(int bytes)
+		{
+			if (bytes < 0 || bytes > m_length - m_position)
+				throw ContentException("Unexpected end of content data");
+		}
+	};
+}
+}
+
+#endif // NXNA_CONTENT_BINARYREADER_H
@@ -4,7 +4,9 @@
 #include "MappedFileStream.h"
 #include "XnbReader.h"
 #include "../Graphics/Texture2D.h"
+#include "../Graphics/TextureAtlas.h"
 #include "../Graphics/SpriteFont.h"
+#include "../Graphics/Model.h"
 #include "../Audio/SoundEffect.h"
 #include "../Media/Song.h"
 
@@ -20,19 +22,29 @@ namespace Content
 	{
 		// add all the loaders
 		AddContentReader<Nxna::Graphics::Texture2DLoader>();
+		AddContentReader<Nxna::Graphics::AtlasRegionLoader>();
 		AddContentReader<Nxna::Graphics::SpriteFontLoader>();
+		AddContentReader<Nxna::Graphics::ModelLoader>();
 		AddContentReader<Nxna::Audio::SoundEffectLoader>();
 		AddContentReader<Nxna::Media::SongLoader>();
+
+		m_atlas = nullptr;
+		m_streamer = nullptr;
 	}
 
 	ContentManager::ContentManager(const char* rootDirectory)
 	{
 		// add all the loaders
 		AddContentReader<Nxna::Graphics::Texture2DLoader>();
+		AddContentReader<Nxna::Graphics::AtlasRegionLoader>();
 		AddContentReader<Nxna::Graphics::SpriteFontLoader>();
+		AddContentReader<Nxna::Graphics::ModelLoader>();
 		AddContentReader<Nxna::Audio::SoundEffectLoader>();
 		AddContentReader<Nxna::Media::SongLoader>();
 
+		m_atlas = nullptr;
+		m_streamer = nullptr;
+
 		SetRootDirectory(rootDirectory);
 	}
 
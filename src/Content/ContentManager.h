@@ -9,9 +9,16 @@
 #include "FileStream.h"
 #include "MappedFileStream.h"
 #include "../Exception.h"
+#include "../Utils/Profiler.h"
 
 namespace Nxna
 {
+namespace Graphics
+{
+	class TextureAtlas;
+	class TextureStreamer;
+}
+
 namespace Content
 {
 	class MemoryStream;
@@ -46,6 +53,9 @@ namespace Content
 		typedef std::map<std::string, std::pair<IContentReader*, void*> > ResourceMap;
 		ResourceMap m_resources;
 
+		Graphics::TextureAtlas* m_atlas;
+		Graphics::TextureStreamer* m_streamer;
+
 	public:
 
 		ContentManager();
@@ -62,6 +72,18 @@ namespace Content
 
 		const char* GetRootDirectory() { return m_rootDirectory.c_str(); }
 
+		// This is not part of the XNA API.
+		// Load<Graphics::AtlasRegion>() packs textures into this atlas. The ContentManager doesn't own
+		// the atlas, and the atlas needs to stay around until the content has been unloaded.
+		void SetTextureAtlas(Graphics::TextureAtlas* atlas) { m_atlas = atlas; }
+		Graphics::TextureAtlas* GetTextureAtlas() { return m_atlas; }
+
+		// This is not part of the XNA API.
+		// Load<Graphics::Texture2D>() hands mipmapped textures to this streamer, which keeps their XNBs
+		// mapped and only uploads the mip levels that get used. The streamer needs to outlive the content.
+		void SetTextureStreamer(Graphics::TextureStreamer* streamer) { m_streamer = streamer; }
+		Graphics::TextureStreamer* GetTextureStreamer() { return m_streamer; }
+
 		template<typename T>
 		T* Load(const char* name)
 		{
@@ -70,6 +92,8 @@ namespace Content
 			if (r != m_resources.end())
 				return static_cast<T*>((*r).second.second);
 
+			NXNA_PROFILE_SCOPE("ContentManager::Load");
+
 			// the resource hasn't been loaded yet, so load it
 			const char* typeName = typeid(T).name();
 			LoaderMap::iterator loader = m_loaders.find(typeName);
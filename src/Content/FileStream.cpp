@@ -269,6 +269,17 @@ namespace Content
 		return bytesToRead;
 	}
 
+	const byte* MemoryStream::ReadInPlace(unsigned int length)
+	{
+		if (length > m_length - m_position)
+			return nullptr;
+
+		const byte* result = &m_memory[m_position];
+		m_position += length;
+
+		return result;
+	}
+
 	byte MemoryStream::ReadByte()
 	{
 		byte r;
@@ -103,6 +103,13 @@ namespace Content
 
 		const byte* GetBuffer() { return m_memory; }
 
+		// These return pointers into the stream's memory instead of copying, so for a
+		// MappedFileStream they point straight at the file. They're only valid while the stream is.
+		const byte* GetCurrentPointer() { return m_memory + m_position; }
+
+		// Skips over the next length bytes and returns where they are, or nullptr if there aren't that many left
+		const byte* ReadInPlace(unsigned int length);
+
 	private:
 
 		void increaseSize(size_t amount);
@@ -123,6 +123,10 @@ namespace Content
 		}
 			
 		result->m_length = statInfo.st_size;
+
+		// content files are read once from start to finish, so tell the kernel to read ahead
+		madvise(result->m_memory, result->m_length, MADV_SEQUENTIAL);
+		madvise(result->m_memory, result->m_length, MADV_WILLNEED);
 #endif
 
 		result->m_position = 0;
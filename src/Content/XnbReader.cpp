@@ -1,6 +1,7 @@
 #include "XnbReader.h"
 #include "FileStream.h"
 #include "MappedFileStream.h"
+#include "BinaryReader.h"
 #include "ContentManager.h"
 #include "../MathHelper.h"
 
@@ -27,22 +28,30 @@ namespace Content
 	{
 		return read7BitEncodedInt();
 	}
+
+	const char* XnbReader::GetTypeReaderName(int typeID)
+	{
+		if (typeID <= 0 || typeID > (int)m_typeReaders.size())
+			return nullptr;
+
+		return m_typeReaders[typeID - 1].c_str();
+	}
 	
 	std::string XnbReader::ReadString()
 	{
-		int len = read7BitEncodedInt();
+		BinaryReader binary(m_stream);
+		int len = binary.Read7BitEncodedInt();
 
-		byte buffer[256];
-		int bytesToRead = Math::Min(255, len);
-		m_stream->Read(buffer, bytesToRead);
-		buffer[bytesToRead] = 0;
+		// type reader names can be long, so don't cut them off (that would also leave the rest in the stream)
+		const byte* characters = binary.ReadInPlace(len);
+		binary.Finish();
 
-		return std::string((char*)buffer);
+		return std::string((const char*)characters, len);
 	}
 
 	const byte* XnbReader::GetData()
 	{
-		return nullptr;
+		return m_stream->GetCurrentPointer();
 	}
 
 	void XnbReader::readHeader()
@@ -89,33 +98,25 @@ namespace Content
 		else
 			m_uncompressedSize = m_compressedSize;
 
-		// read the type readers
+		// read the type readers. Most content only has one, but things like models need to know them.
 		int typeReaderCount = read7BitEncodedInt();
 		for (int i = 0; i < typeReaderCount; i++)
 		{
-			skipString();
+			m_typeReaders.push_back(ReadString());
 			m_stream->ReadInt32();
 		}
 
 		// read the number of shared resources
-		int numSharedResources = read7BitEncodedInt();
+		m_numSharedResources = read7BitEncodedInt();
 
 		// at this point the object within the file is next...
 	}
 
 	int XnbReader::read7BitEncodedInt()
 	{
-		int result = 0;
-		int bitsRead = 0;
-		int value;
-
-		do
-		{
-			value = m_stream->ReadByte();
-			result |= (value & 0x7f) << bitsRead;
-			bitsRead += 7;
-		}
-		while (value & 0x80);
+		BinaryReader binary(m_stream);
+		int result = binary.Read7BitEncodedInt();
+		binary.Finish();
 
 		return result;
 	}
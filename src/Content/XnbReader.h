@@ -2,6 +2,7 @@
 #define CONTENT_XNBREADER_H
 
 #include <string>
+#include <vector>
 #include "../NxnaConfig.h"
 
 namespace Nxna
@@ -30,6 +31,9 @@ namespace Content
 		int m_compressedSize;
 		int m_uncompressedSize;
 
+		std::vector<std::string> m_typeReaders;
+		int m_numSharedResources;
+
 	public:
 		XnbReader(MemoryStream* stream, const char* name, const char* fullPath, ContentManager* contentManager);
 		~XnbReader();
@@ -44,11 +48,29 @@ namespace Content
 		const std::string& GetFullPath() { return m_fullPath; }
 		int ReadTypeID();
 
+		// Type IDs are 1 based, since 0 means null. Returns nullptr if the ID is invalid.
+		const char* GetTypeReaderName(int typeID);
+
+		// Shared resources are stored after the main object and referred to by index.
+		// Returns -1 for null.
+		int GetNumSharedResources() { return m_numSharedResources; }
+		int ReadSharedResourceIndex() { return read7BitEncodedInt() - 1; }
+
 		std::string ReadString();
 
-		// Returns a pointer to the uncompressed data within the XNB
+		// Returns a pointer to the uncompressed data within the XNB, at the current position.
+		// Loaders can hand this straight to the GPU instead of copying it out of the stream.
 		const byte* GetData();
 
+		// Takes ownership of the stream, so it stays open after the reader is destroyed.
+		// For loaders that keep pointing into the file after they're done.
+		MemoryStream* DetachStream()
+		{
+			MemoryStream* stream = m_stream;
+			m_stream = nullptr;
+			return stream;
+		}
+
 	private:
 		void readHeader();
 		int read7BitEncodedInt();
@@ -87,6 +87,25 @@ public:
 		{
 		}
 	};
+
+	class NotSupportedException : public Exception
+	{
+	public:
+		NotSupportedException()
+			: Exception("The operation isn't supported")
+		{
+		}
+
+		NotSupportedException(const char* message)
+			: Exception(message)
+		{
+		}
+
+		NotSupportedException(const char* message, const char* file, int line)
+			: Exception(message, file, line)
+		{
+		}
+	};
 }
 
 #endif // NXNA_EXCEPTION_H
\ No newline at end of file
@@ -3,8 +3,11 @@
 #include "IGraphicsDeviceManager.h"
 #include "Graphics/GraphicsDevice.h"
 #include "Graphics/SpriteBatch.h"
+#include "Graphics/BasicEffect.h"
 #include "Audio/AudioManager.h"
 #include "MathHelper.h"
+#include "Utils/Profiler.h"
+#include "Utils/Jobs.h"
 
 #if defined NXNA_PLATFORM_APPLE_IOS
 #include "Platform/iOS/IOSGame.h"
@@ -57,15 +60,20 @@ namespace Nxna
 
 		OnExiting();
 
+		Utils::Jobs::Shutdown();
+
 		UnloadContent();
 		if (m_content != nullptr)
 			m_content->Unload(); // maybe the user already did this, but we'll make sure.
 
 		Graphics::SpriteBatch::Internal_Shutdown();
+		Graphics::BasicEffect::Internal_Shutdown();
 
 		Audio::AudioManager::Shutdown();
 		delete m_device;
 
+		Utils::Profiler::Shutdown();
+
 		if (m_graphicsDeviceManager != nullptr)
 			m_graphicsDeviceManager->DestroyWindow();
 
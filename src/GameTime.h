@@ -8,10 +8,14 @@ namespace Nxna
 		float ElapsedGameTime;
 		float TotalGameTime;
 
+		// true when the game loop had to call Update() more than once this frame to keep up
+		bool IsRunningSlowly;
+
 		GameTime()
 		{
 			ElapsedGameTime = 0;
 			TotalGameTime = 0;
+			IsRunningSlowly = false;
 		}
 	};
 }
@@ -0,0 +1,329 @@
+#include <cmath>
+#include "AnimationSampler.h"
+#include "../MathSimd.h"
+#include "../Exception.h"
+#include "../Utils/Jobs.h"
+#include "../Utils/Profiler.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// rotation XYZW, translation XYZ and scale, 4 bones of each
+	static const int FloatsPerGroup = 32;
+	static const int MaxGroups = (AnimationSkeleton::MaxBones + 3) / 4;
+
+	// the local matrices only need 12 terms since the last column is always 0, 0, 0, 1.
+	// They're kept the same way as the poses, 4 bones of each term.
+	static const int TermsPerGroup = 48;
+
+	static int getNumGroups(int numBones)
+	{
+		return (numBones + 3) / 4;
+	}
+
+	// nlerps the rotations and lerps the rest, going the short way around
+	static void blend(const float* a, const float* b, float amount, int numGroups, float* result)
+	{
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 t = Simd::Splat(amount);
+
+		for (int i = 0; i < numGroups * FloatsPerGroup; i += FloatsPerGroup)
+		{
+			Simd::Float4 ax = Simd::Load(a + i + 0), bx = Simd::Load(b + i + 0);
+			Simd::Float4 ay = Simd::Load(a + i + 4), by = Simd::Load(b + i + 4);
+			Simd::Float4 az = Simd::Load(a + i + 8), bz = Simd::Load(b + i + 8);
+			Simd::Float4 aw = Simd::Load(a + i + 12), bw = Simd::Load(b + i + 12);
+
+			Simd::Float4 dot = Simd::MultiplyAdd(ax, bx, Simd::MultiplyAdd(ay, by, Simd::MultiplyAdd(az, bz, Simd::Multiply(aw, bw))));
+			bx = Simd::MultiplySign(bx, dot);
+			by = Simd::MultiplySign(by, dot);
+			bz = Simd::MultiplySign(bz, dot);
+			bw = Simd::MultiplySign(bw, dot);
+
+			Simd::Float4 x = Simd::MultiplyAdd(Simd::Subtract(bx, ax), t, ax);
+			Simd::Float4 y = Simd::MultiplyAdd(Simd::Subtract(by, ay), t, ay);
+			Simd::Float4 z = Simd::MultiplyAdd(Simd::Subtract(bz, az), t, az);
+			Simd::Float4 w = Simd::MultiplyAdd(Simd::Subtract(bw, aw), t, aw);
+
+			Simd::Float4 length = Simd::ReciprocalSqrt(Simd::MultiplyAdd(x, x, Simd::MultiplyAdd(y, y, Simd::MultiplyAdd(z, z, Simd::Multiply(w, w)))));
+			Simd::Store(Simd::Multiply(x, length), result + i + 0);
+			Simd::Store(Simd::Multiply(y, length), result + i + 4);
+			Simd::Store(Simd::Multiply(z, length), result + i + 8);
+			Simd::Store(Simd::Multiply(w, length), result + i + 12);
+
+			for (int j = 16; j < FloatsPerGroup; j += 4)
+			{
+				Simd::Float4 va = Simd::Load(a + i + j);
+				Simd::Store(Simd::MultiplyAdd(Simd::Subtract(Simd::Load(b + i + j), va), t, va), result + i + j);
+			}
+		}
+#else
+		for (int i = 0; i < numGroups * FloatsPerGroup; i += FloatsPerGroup)
+		{
+			for (int j = 0; j < 4; j++)
+			{
+				const float* qa = a + i + j;
+				const float* qb = b + i + j;
+				float* q = result + i + j;
+
+				float dot = qa[0] * qb[0] + qa[4] * qb[4] + qa[8] * qb[8] + qa[12] * qb[12];
+				float sign = dot < 0 ? -1.0f : 1.0f;
+
+				float x = qa[0] + (qb[0] * sign - qa[0]) * amount;
+				float y = qa[4] + (qb[4] * sign - qa[4]) * amount;
+				float z = qa[8] + (qb[8] * sign - qa[8]) * amount;
+				float w = qa[12] + (qb[12] * sign - qa[12]) * amount;
+
+				float length = 1.0f / sqrtf(x * x + y * y + z * z + w * w);
+				q[0] = x * length;
+				q[4] = y * length;
+				q[8] = z * length;
+				q[12] = w * length;
+			}
+
+			for (int j = 16; j < FloatsPerGroup; j++)
+				result[i + j] = a[i + j] + (b[i + j] - a[i + j]) * amount;
+		}
+#endif
+	}
+
+	static void buildLocalMatrices(const float* poses, int numGroups, float* terms)
+	{
+		for (int i = 0; i < numGroups; i++)
+		{
+			const float* p = poses + i * FloatsPerGroup;
+			float* m = terms + i * TermsPerGroup;
+
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+			Simd::Float4 x = Simd::Load(p + 0);
+			Simd::Float4 y = Simd::Load(p + 4);
+			Simd::Float4 z = Simd::Load(p + 8);
+			Simd::Float4 w = Simd::Load(p + 12);
+			Simd::Float4 s = Simd::Load(p + 28);
+			Simd::Float4 s2 = Simd::Add(s, s);
+
+			Simd::Float4 xx = Simd::Multiply(x, x), yy = Simd::Multiply(y, y), zz = Simd::Multiply(z, z);
+			Simd::Float4 xy = Simd::Multiply(x, y), xz = Simd::Multiply(x, z), yz = Simd::Multiply(y, z);
+			Simd::Float4 xw = Simd::Multiply(x, w), yw = Simd::Multiply(y, w), zw = Simd::Multiply(z, w);
+
+			// the rotation matrix times the scale
+			Simd::Store(Simd::Subtract(s, Simd::Multiply(Simd::Add(yy, zz), s2)), m + 0);
+			Simd::Store(Simd::Multiply(Simd::Add(xy, zw), s2), m + 4);
+			Simd::Store(Simd::Multiply(Simd::Subtract(xz, yw), s2), m + 8);
+			Simd::Store(Simd::Multiply(Simd::Subtract(xy, zw), s2), m + 12);
+			Simd::Store(Simd::Subtract(s, Simd::Multiply(Simd::Add(xx, zz), s2)), m + 16);
+			Simd::Store(Simd::Multiply(Simd::Add(yz, xw), s2), m + 20);
+			Simd::Store(Simd::Multiply(Simd::Add(xz, yw), s2), m + 24);
+			Simd::Store(Simd::Multiply(Simd::Subtract(yz, xw), s2), m + 28);
+			Simd::Store(Simd::Subtract(s, Simd::Multiply(Simd::Add(xx, yy), s2)), m + 32);
+
+			Simd::Store(Simd::Load(p + 16), m + 36);
+			Simd::Store(Simd::Load(p + 20), m + 40);
+			Simd::Store(Simd::Load(p + 24), m + 44);
+#else
+			for (int j = 0; j < 4; j++)
+			{
+				float x = p[j + 0], y = p[j + 4], z = p[j + 8], w = p[j + 12];
+				float s = p[j + 28];
+				float s2 = s + s;
+
+				m[j + 0] = s - (y * y + z * z) * s2;
+				m[j + 4] = (x * y + z * w) * s2;
+				m[j + 8] = (x * z - y * w) * s2;
+				m[j + 12] = (x * y - z * w) * s2;
+				m[j + 16] = s - (x * x + z * z) * s2;
+				m[j + 20] = (y * z + x * w) * s2;
+				m[j + 24] = (x * z + y * w) * s2;
+				m[j + 28] = (y * z - x * w) * s2;
+				m[j + 32] = s - (x * x + y * y) * s2;
+
+				m[j + 36] = p[j + 16];
+				m[j + 40] = p[j + 20];
+				m[j + 44] = p[j + 24];
+			}
+#endif
+		}
+	}
+
+	AnimationSkeleton::AnimationSkeleton(int numBones, const int* parents, const Matrix* inverseBindPose)
+	{
+		if (numBones < 1 || numBones > MaxBones)
+			throw ArgumentException("numBones");
+
+		for (int i = 0; i < numBones; i++)
+		{
+			if (parents[i] >= i || parents[i] < -1)
+				throw ArgumentException("Parents have to come before their children", "parents");
+		}
+
+		m_parents.assign(parents, parents + numBones);
+		m_inverseBindPose.assign(inverseBindPose, inverseBindPose + numBones);
+	}
+
+	AnimationClip::AnimationClip(int numBones, int numFrames, float framesPerSecond, const BonePose* poses)
+	{
+		if (numBones < 1 || numBones > AnimationSkeleton::MaxBones)
+			throw ArgumentException("numBones");
+		if (numFrames < 1)
+			throw ArgumentException("numFrames");
+		if (framesPerSecond <= 0)
+			throw ArgumentException("framesPerSecond");
+
+		m_numBones = numBones;
+		m_numFrames = numFrames;
+		m_framesPerSecond = framesPerSecond;
+
+		int numGroups = getNumGroups(numBones);
+		m_frames.resize(numFrames * numGroups * FloatsPerGroup);
+
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			float* f = &m_frames[frame * numGroups * FloatsPerGroup];
+
+			// the padding at the end of the last group is left as identity bones
+			for (int bone = 0; bone < numGroups * 4; bone++)
+			{
+				BonePose pose;
+				if (bone < numBones)
+					pose = poses[frame * numBones + bone];
+
+				float* b = f + (bone / 4) * FloatsPerGroup + (bone & 3);
+				b[0] = pose.Rotation.X;
+				b[4] = pose.Rotation.Y;
+				b[8] = pose.Rotation.Z;
+				b[12] = pose.Rotation.W;
+				b[16] = pose.Translation.X;
+				b[20] = pose.Translation.Y;
+				b[24] = pose.Translation.Z;
+				b[28] = pose.Scale;
+			}
+		}
+	}
+
+	const float* AnimationClip::getFrame(int frame) const
+	{
+		return &m_frames[frame * getNumGroups(m_numBones) * FloatsPerGroup];
+	}
+
+	void AnimationSampler::Evaluate(const AnimationSkeleton* skeleton, const AnimationInstance& instance)
+	{
+		Evaluate(skeleton, &instance, 1);
+	}
+
+	void AnimationSampler::Evaluate(const AnimationSkeleton* skeleton, const AnimationInstance* instances, int count)
+	{
+		NXNA_PROFILE_SCOPE("AnimationSampler::Evaluate");
+
+		// check everything first, since nothing can be thrown from the job threads
+		for (int i = 0; i < count; i++)
+		{
+			const AnimationInstance& instance = instances[i];
+
+			if (instance.Clip == nullptr || instance.Palette == nullptr)
+				throw ArgumentException("instances");
+			if (instance.Clip->GetNumBones() != skeleton->GetNumBones())
+				throw InvalidOperationException("The clip doesn't have the same number of bones as the skeleton");
+			if (instance.BlendClip != nullptr && instance.BlendClip->GetNumBones() != skeleton->GetNumBones())
+				throw InvalidOperationException("The clip doesn't have the same number of bones as the skeleton");
+		}
+
+		Utils::Jobs::ParallelFor(count, [skeleton, instances](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				evaluate(skeleton, instances[i]);
+		}, 8);
+	}
+
+	void AnimationSampler::evaluate(const AnimationSkeleton* skeleton, const AnimationInstance& instance)
+	{
+		int numBones = skeleton->GetNumBones();
+		int numGroups = getNumGroups(numBones);
+
+		float poses[MaxGroups * FloatsPerGroup];
+		sample(instance.Clip, instance.Time, instance.Loop, poses);
+
+		if (instance.BlendClip != nullptr && instance.BlendWeight > 0)
+		{
+			float blendPoses[MaxGroups * FloatsPerGroup];
+			sample(instance.BlendClip, instance.BlendTime, instance.BlendLoop, blendPoses);
+			blend(poses, blendPoses, instance.BlendWeight, numGroups, poses);
+		}
+
+		float terms[MaxGroups * TermsPerGroup];
+		buildLocalMatrices(poses, numGroups, terms);
+
+		// now go down the hierarchy. The world transforms are local * parent, and the
+		// palette is the inverse bind pose * world.
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 world[AnimationSkeleton::MaxBones * 4];
+		Simd::Float4 identity[4];
+		Simd::LoadRows(Matrix::Identity, identity);
+
+		for (int i = 0; i < numBones; i++)
+		{
+			const float* m = terms + (i / 4) * TermsPerGroup + (i & 3);
+			int parent = skeleton->GetParent(i);
+			const Simd::Float4* parentRows = parent < 0 ? identity : world + parent * 4;
+
+			Simd::Float4* rows = world + i * 4;
+			rows[0] = Simd::TransformNormal(m[0], m[4], m[8], parentRows);
+			rows[1] = Simd::TransformNormal(m[12], m[16], m[20], parentRows);
+			rows[2] = Simd::TransformNormal(m[24], m[28], m[32], parentRows);
+			rows[3] = Simd::TransformPoint(m[36], m[40], m[44], parentRows);
+
+			const Matrix& bind = skeleton->GetInverseBindPose(i);
+			float* result = instance.Palette[i].C;
+			Simd::Store4(Simd::Transform(bind.M11, bind.M12, bind.M13, bind.M14, rows), result + 0);
+			Simd::Store4(Simd::Transform(bind.M21, bind.M22, bind.M23, bind.M24, rows), result + 4);
+			Simd::Store4(Simd::Transform(bind.M31, bind.M32, bind.M33, bind.M34, rows), result + 8);
+			Simd::Store4(Simd::Transform(bind.M41, bind.M42, bind.M43, bind.M44, rows), result + 12);
+		}
+#else
+		Matrix world[AnimationSkeleton::MaxBones];
+
+		for (int i = 0; i < numBones; i++)
+		{
+			const float* m = terms + (i / 4) * TermsPerGroup + (i & 3);
+			Matrix local(m[0], m[4], m[8], 0,
+				m[12], m[16], m[20], 0,
+				m[24], m[28], m[32], 0,
+				m[36], m[40], m[44], 1.0f);
+
+			int parent = skeleton->GetParent(i);
+			if (parent < 0)
+				world[i] = local;
+			else
+				Matrix::Multiply(local, world[parent], world[i]);
+
+			Matrix::Multiply(skeleton->GetInverseBindPose(i), world[i], instance.Palette[i]);
+		}
+#endif
+	}
+
+	void AnimationSampler::sample(const AnimationClip* clip, float time, bool loop, float* poses)
+	{
+		int numGroups = getNumGroups(clip->m_numBones);
+		int lastFrame = clip->m_numFrames - 1;
+
+		float frame = time * clip->m_framesPerSecond;
+		if (loop && lastFrame > 0)
+		{
+			frame = fmodf(frame, (float)lastFrame);
+			if (frame < 0)
+				frame += lastFrame;
+		}
+		else if (frame < 0)
+			frame = 0;
+		else if (frame > lastFrame)
+			frame = (float)lastFrame;
+
+		int frame1 = (int)frame;
+		if (frame1 >= lastFrame)
+			frame1 = lastFrame > 0 ? lastFrame - 1 : 0;
+		int frame2 = frame1 < lastFrame ? frame1 + 1 : frame1;
+
+		blend(clip->getFrame(frame1), clip->getFrame(frame2), frame - frame1, numGroups, poses);
+	}
+}
+}
@@ -0,0 +1,121 @@
+#ifndef NXNA_GRAPHICS_ANIMATIONSAMPLER_H
+#define NXNA_GRAPHICS_ANIMATIONSAMPLER_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Matrix.h"
+#include "../Vector3.h"
+#include "../Quaternion.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// this class doesn't exist in XNA!
+	// A bone's pose relative to its parent
+	struct BonePose
+	{
+		Quaternion Rotation;
+		Vector3 Translation;
+		float Scale;
+
+		BonePose()
+			: Rotation(0, 0, 0, 1.0f), Translation(0, 0, 0), Scale(1.0f)
+		{
+		}
+	};
+
+	// this class doesn't exist in XNA!
+	// The bones' hierarchy. Parents have to come before their children, and the root's parent is -1.
+	class AnimationSkeleton
+	{
+	public:
+		static const int MaxBones = 128;
+
+	private:
+		std::vector<int> m_parents;
+		std::vector<Matrix> m_inverseBindPose;
+
+	public:
+		AnimationSkeleton(int numBones, const int* parents, const Matrix* inverseBindPose);
+
+		int GetNumBones() const { return (int)m_parents.size(); }
+		int GetParent(int bone) const { return m_parents[bone]; }
+		const Matrix& GetInverseBindPose(int bone) const { return m_inverseBindPose[bone]; }
+	};
+
+	// this class doesn't exist in XNA!
+	// A clip sampled at a fixed rate, so every bone has a key on every frame and finding
+	// the keys for a time is just a divide. Clips from a content pipeline should be resampled
+	// when they're imported. Looping clips should end on the same pose they start with.
+	class AnimationClip
+	{
+		friend class AnimationSampler;
+
+		int m_numBones;
+		int m_numFrames;
+		float m_framesPerSecond;
+
+		// each frame is groups of 4 bones: 4 rotation X, 4 rotation Y, ... 4 translation Z, 4 scales
+		std::vector<float> m_frames;
+
+	public:
+		// poses[frame * numBones + bone]
+		AnimationClip(int numBones, int numFrames, float framesPerSecond, const BonePose* poses);
+
+		int GetNumBones() const { return m_numBones; }
+		int GetNumFrames() const { return m_numFrames; }
+		float GetFramesPerSecond() const { return m_framesPerSecond; }
+		float GetDuration() const { return (m_numFrames - 1) / m_framesPerSecond; }
+
+	private:
+		const float* getFrame(int frame) const;
+	};
+
+	// this class doesn't exist in XNA!
+	// One animated character
+	struct AnimationInstance
+	{
+		const AnimationClip* Clip;
+		float Time;
+		bool Loop;
+
+		// another clip to blend into (a crossfade), which is ignored when BlendWeight is 0
+		const AnimationClip* BlendClip;
+		float BlendTime;
+		bool BlendLoop;
+		float BlendWeight;
+
+		// gets one matrix per bone, ready for SkinnedEffect::SetBoneTransforms()
+		Matrix* Palette;
+
+		AnimationInstance()
+		{
+			Clip = nullptr;
+			Time = 0;
+			Loop = true;
+			BlendClip = nullptr;
+			BlendTime = 0;
+			BlendLoop = true;
+			BlendWeight = 0;
+			Palette = nullptr;
+		}
+	};
+
+	// this class doesn't exist in XNA!
+	// Turns clips into bone palettes. Everything's done 4 bones at a time, and lots of
+	// instances get spread over the job threads.
+	class AnimationSampler
+	{
+	public:
+		static void Evaluate(const AnimationSkeleton* skeleton, const AnimationInstance& instance);
+		static void Evaluate(const AnimationSkeleton* skeleton, const AnimationInstance* instances, int count);
+
+	private:
+		static void evaluate(const AnimationSkeleton* skeleton, const AnimationInstance& instance);
+		static void sample(const AnimationClip* clip, float time, bool loop, float* poses);
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_ANIMATIONSAMPLER_H
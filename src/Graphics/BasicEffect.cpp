@@ -11,11 +11,15 @@ namespace Nxna
 {
 namespace Graphics
 {
+	VertexDeclaration* BasicEffect::m_instanceDeclaration = nullptr;
+
 	BasicEffect::BasicEffect(GraphicsDevice* device)
 		: Effect(device, (byte*)BasicEffect_bytecode, sizeof(BasicEffect_bytecode))
 	{
 		m_textureEnabled = false;
+		m_texture = nullptr;
 		m_vertexColorEnabled = false;
+		m_instancingEnabled = false;
 		m_finalTransformDirty = true;
 		m_colorDirty = true;
 
@@ -37,6 +41,31 @@ namespace Graphics
 		assert(m_diffuseParameter->GetType() == EffectParameterType::Texture2D);
 
 		m_diffuseParameter->SetValue(texture);
+		m_texture = texture;
+	}
+
+	const VertexDeclaration* BasicEffect::GetInstanceDeclaration()
+	{
+		if (m_instanceDeclaration == nullptr)
+		{
+			VertexElement elements[] = 
+			{
+				{0, VertexElementFormat::Vector4, VertexElementUsage::TextureCoordinate, 1},
+				{sizeof(float) * 4, VertexElementFormat::Vector4, VertexElementUsage::TextureCoordinate, 2},
+				{sizeof(float) * 8, VertexElementFormat::Vector4, VertexElementUsage::TextureCoordinate, 3},
+				{sizeof(float) * 12, VertexElementFormat::Vector4, VertexElementUsage::TextureCoordinate, 4}
+			};
+
+			m_instanceDeclaration = new VertexDeclaration(elements, 4);
+		}
+
+		return m_instanceDeclaration;
+	}
+
+	void BasicEffect::Internal_Shutdown()
+	{
+		delete m_instanceDeclaration;
+		m_instanceDeclaration = nullptr;
 	}
 
 	void BasicEffect::OnApply()
@@ -46,8 +75,14 @@ namespace Graphics
 			Matrix worldView;
 			Matrix worldViewProjection;
 
-			Matrix::Multiply(m_world, m_view, worldView);
-			Matrix::Multiply(worldView, m_projection, m_finalTransform);
+			// the shader applies each instance's world matrix itself
+			if (m_instancingEnabled)
+				Matrix::Multiply(m_view, m_projection, m_finalTransform);
+			else
+			{
+				Matrix::Multiply(m_world, m_view, worldView);
+				Matrix::Multiply(worldView, m_projection, m_finalTransform);
+			}
 
 			m_finalTransformDirty = false;
 		}
@@ -68,15 +103,16 @@ namespace Graphics
 		}
 
 
-		// determine which to apply
+		// determine which to apply. The instanced techniques come after the regular ones.
+		int technique = m_instancingEnabled ? 4 : 0;
 		if (m_vertexColorEnabled && m_textureEnabled)
-			m_pimpl->Apply(3);
+			m_pimpl->Apply(technique + 3);
 		else if (m_vertexColorEnabled)
-			m_pimpl->Apply(2);
+			m_pimpl->Apply(technique + 2);
 		else if (m_textureEnabled)
-			m_pimpl->Apply(1);
+			m_pimpl->Apply(technique + 1);
 		else
-			m_pimpl->Apply(0);
+			m_pimpl->Apply(technique);
 	}
 }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "Effect.h"
 #include "GraphicsDevice.h"
+#include "VertexDeclaration.h"
 #include "../Matrix.h"
 
 NXNA_DISABLE_OVERRIDE_WARNING
@@ -17,7 +18,11 @@ namespace Graphics
 	class BasicEffect : public Effect
 	{
 		bool m_textureEnabled;
+		Texture2D* m_texture;
 		bool m_vertexColorEnabled;
+		bool m_instancingEnabled;
+
+		static VertexDeclaration* m_instanceDeclaration;
 
 		Matrix m_world;
 		Matrix m_view;
@@ -44,6 +49,20 @@ namespace Graphics
 		bool IsVertexColorEnabled() { return m_vertexColorEnabled; }
 		void IsVertexColorEnabled(bool enabled) { m_vertexColorEnabled = enabled; }
 
+		// When instancing is enabled the world matrix is ignored. Instead each instance's world
+		// matrix comes from a second vertex stream using GetInstanceDeclaration() (one row per element).
+		// Only available with OpenGL.
+		bool IsInstancingEnabled() { return m_instancingEnabled; }
+		void IsInstancingEnabled(bool enabled)
+		{
+			m_instancingEnabled = enabled;
+			m_finalTransformDirty = true;
+		}
+
+		static const VertexDeclaration* GetInstanceDeclaration();
+
+		static void Internal_Shutdown();
+
 		void SetWorld(const Matrix& matrix)
 		{
 			m_world = matrix;
@@ -63,6 +82,7 @@ namespace Graphics
 		}
 
 		void SetTexture(Texture2D* texture);
+		Texture2D* GetTexture() { return m_texture; }
 
 		void SetDiffuse(const Nxna::Vector3& color)
 		{
@@ -2,6 +2,7 @@
 
 #if !defined NXNA_DISABLE_D3D11
 
+#include <cassert>
 #include "Direct3D11Device.h"
 #include "D3D11IndexBuffer.h"
 #include "../GraphicsDevice.h"
@@ -23,19 +24,25 @@ namespace Direct3D11
 
 	D3D11IndexBuffer::~D3D11IndexBuffer()
 	{
-		static_cast<ID3D11Buffer*>(m_indexBuffer)->Release();
+		if (m_indexBuffer != nullptr)
+			static_cast<ID3D11Buffer*>(m_indexBuffer)->Release();
 	}
 
 	void D3D11IndexBuffer::SetData(int offsetInBytes, void* data, int indexCount)
 	{
-		D3D11_BUFFER_DESC desc;
-		ZeroMemory(&desc, sizeof(desc));
-		desc.ByteWidth = (int)m_elementSize * indexCount;
-		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		desc.CPUAccessFlags = 0;
+		int totalIndexCount = indexCount + offsetInBytes / (int)m_elementSize;
 
-		if (FAILED(static_cast<ID3D11Device*>(m_d3d11Device->GetDevice())->CreateBuffer(&desc, nullptr, (ID3D11Buffer**)&m_indexBuffer)))
-			throw GraphicsException("Unable to create Direct3D index buffer");
+		// only create a new buffer when the old one is too small
+		if (m_indexBuffer == nullptr || totalIndexCount > m_capacity)
+		{
+			// growing the buffer throws away what was in it, so Reserve() should have been called first
+			assert(offsetInBytes == 0);
+
+			Reserve(totalIndexCount);
+		}
+
+		if (totalIndexCount > m_indexCount)
+			m_indexCount = totalIndexCount;
 
 		ID3D11DeviceContext* deviceContext = static_cast<ID3D11DeviceContext*>(m_d3d11Device->GetDeviceContext());
 
@@ -49,6 +56,27 @@ namespace Direct3D11
 
 		deviceContext->UpdateSubresource(static_cast<ID3D11Buffer*>(m_indexBuffer), 0, &box, data, 1, 0);
 	}
+
+	void D3D11IndexBuffer::Reserve(int indexCount)
+	{
+		if (m_indexBuffer != nullptr)
+		{
+			static_cast<ID3D11Buffer*>(m_indexBuffer)->Release();
+			m_indexBuffer = nullptr;
+		}
+
+		D3D11_BUFFER_DESC desc;
+		ZeroMemory(&desc, sizeof(desc));
+		desc.ByteWidth = (int)m_elementSize * indexCount;
+		desc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		desc.CPUAccessFlags = 0;
+
+		if (FAILED(static_cast<ID3D11Device*>(m_d3d11Device->GetDevice())->CreateBuffer(&desc, nullptr, (ID3D11Buffer**)&m_indexBuffer)))
+			throw GraphicsException("Unable to create Direct3D index buffer");
+
+		m_capacity = indexCount;
+		m_indexCount = 0;
+	}
 }
 }
 }
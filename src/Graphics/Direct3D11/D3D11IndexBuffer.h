@@ -23,6 +23,7 @@ namespace Direct3D11
 		virtual ~D3D11IndexBuffer();
 
 		virtual void SetData(int offsetInBytes, void* data, int indexCount) override;
+		virtual void Reserve(int indexCount) override;
 
 		void* GetInternalBuffer() const { return m_indexBuffer; };
 	};
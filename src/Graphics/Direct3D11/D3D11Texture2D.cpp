@@ -48,7 +48,56 @@ namespace Direct3D11
 		int mipWidth = m_width >> level;
 		int mipHeight = m_height >> level;
 
-		createTexture(false, pixels, length);
+		// Direct3D 11 doesn't do ETC, so it gets decoded, same as GL does without the extensions
+		byte* converted = decompress(pixels, mipWidth, mipHeight);
+		if (converted != nullptr)
+		{
+			createTexture(false, converted, mipWidth * mipHeight * 4);
+			delete[] converted;
+		}
+		else
+		{
+			createTexture(false, pixels, length);
+		}
+	}
+
+	void D3D11Texture2D::SetData(int level, const Rectangle& rect, byte* pixels, int length)
+	{
+		// the textures only have level 0 (see createTexture()), so there's nothing to update
+		if (level > 0)
+			throw NotSupportedException("Direct3D 11 textures don't support mipmaps yet");
+
+		// the texture doesn't exist until the first full SetData()
+		if (m_texture == nullptr)
+			createTexture(false, nullptr, 0);
+
+		ID3D11DeviceContext* deviceContext = static_cast<ID3D11DeviceContext*>(static_cast<Direct3D11Device*>(m_device)->GetDeviceContext());
+
+		D3D11_BOX box;
+		box.left = rect.X;
+		box.right = rect.X + rect.Width;
+		box.top = rect.Y;
+		box.bottom = rect.Y + rect.Height;
+		box.front = 0;
+		box.back = 1;
+
+		byte* converted = decompress(pixels, rect.Width, rect.Height);
+		if (converted != nullptr)
+		{
+			deviceContext->UpdateSubresource(m_texture, 0, &box, converted, rect.Width * 4, 0);
+			delete[] converted;
+		}
+		else
+		{
+			deviceContext->UpdateSubresource(m_texture, 0, &box, pixels, rect.Width * 4, 0);
+		}
+	}
+
+	void D3D11Texture2D::GenerateMipmaps()
+	{
+		// The textures only have one level so far (see SetData()), so there's nowhere to put them.
+		// SupportsGenerateMipmaps is false, so Texture2D shouldn't get here anyway.
+		throw NotSupportedException("Direct3D 11 textures don't support mipmaps yet");
 	}
 
 	void D3D11Texture2D::MakeRenderTarget()
@@ -61,8 +110,11 @@ namespace Direct3D11
 		D3D11_TEXTURE2D_DESC desc;
 		ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
 
+		// ETC textures are stored decoded (see SetData())
+		SurfaceFormat format = isEtc() ? SurfaceFormat::Color : m_format;
+
 		desc.ArraySize = 1;
-		desc.Format = D3D11Utils::ConvertSurfaceFormat(m_format);
+		desc.Format = D3D11Utils::ConvertSurfaceFormat(format);
 		desc.Width = m_width;
 		desc.Height = m_height;
 		desc.MipLevels = 1;
@@ -77,12 +129,12 @@ namespace Direct3D11
 		{
 			D3D11_SUBRESOURCE_DATA initData;
 			initData.pSysMem = pixels;
-			if (m_format == SurfaceFormat::Color)
+			if (format == SurfaceFormat::Color)
 				initData.SysMemPitch = 4 * m_width;
 			else
 			{
 				int numBlocks = Math::Max(1, m_width / 4);
-				initData.SysMemPitch = numBlocks * (m_format == SurfaceFormat::Dxt1 ? 8 : 16);
+				initData.SysMemPitch = numBlocks * (format == SurfaceFormat::Dxt1 ? 8 : 16);
 			}
 			
 			if (FAILED(static_cast<ID3D11Device*>(static_cast<Direct3D11Device*>(m_device)->GetDevice())->CreateTexture2D(&desc, &initData, &m_texture)) || m_texture == nullptr)
@@ -103,6 +155,22 @@ namespace Direct3D11
 		if (FAILED(static_cast<ID3D11Device*>(static_cast<Direct3D11Device*>(m_device)->GetDevice())->CreateShaderResourceView(m_texture, &srvDesc, &m_shaderResourceView)))
 			throw GraphicsException("Unable to create texture");
 	}
+
+	bool D3D11Texture2D::isEtc()
+	{
+		return m_format == SurfaceFormat::Etc1 || m_format == SurfaceFormat::Etc2Rgb || m_format == SurfaceFormat::Etc2Rgba;
+	}
+
+	byte* D3D11Texture2D::decompress(const byte* pixels, int width, int height)
+	{
+		if (isEtc() == false || pixels == nullptr)
+			return nullptr;
+
+		if (m_format == SurfaceFormat::Etc2Rgba)
+			return DecompressEtc2Rgba(pixels, width, height);
+
+		return DecompressEtc2Rgb(pixels, width, height);
+	}
 }
 }
 }
@@ -33,6 +33,8 @@ namespace Direct3D11
 		virtual ~D3D11Texture2D();
 
 		virtual void SetData(int level, byte* pixels, int length) override;
+		virtual void SetData(int level, const Rectangle& rect, byte* pixels, int length) override;
+		virtual void GenerateMipmaps() override;
 
 		void MakeRenderTarget();
 
@@ -41,6 +43,10 @@ namespace Direct3D11
 
 	private:
 		void createTexture(bool isRenderTarget, byte* pixels, int length);
+		bool isEtc();
+
+		// returns the pixels decoded to Color if the format is ETC (delete[] them when done), or null if it isn't
+		byte* decompress(const byte* pixels, int width, int height);
 
 		static int convertAddressMode(TextureAddressMode mode);
 	};
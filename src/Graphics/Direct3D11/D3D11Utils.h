@@ -155,6 +155,7 @@ namespace Direct3D11
 				return DXGI_FORMAT_BC2_UNORM;
 			case SurfaceFormat::Dxt5:
 				return DXGI_FORMAT_BC3_UNORM;
+			// there's no DXGI format for ETC, so D3D11Texture2D decodes it to Color before it gets here
 			default:
 				throw ArgumentException("Unknown SurfaceFormat value", "format");
 			}
@@ -39,6 +39,8 @@ namespace Direct3D11
 		m_currentRenderTarget = nullptr;
 
 		m_caps->SupportsShaders = true;
+		m_caps->SupportsNonPowerOfTwoMipmaps = true;
+		m_caps->MaxTextureUnits = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
 	}
 
 	void Direct3D11Device::OnWindowCreated(void* window, const PresentationParameters& pp)
@@ -344,6 +346,11 @@ namespace Direct3D11
 			indexCount = primitiveCount * 3; // FIXME
 			m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
 		}
+		else
+		{
+			indexCount = primitiveCount * 2;
+			m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+		}
 
 		m_deviceContext->DrawIndexed(indexCount, startIndex, baseVertex);
 	}
@@ -691,6 +698,12 @@ namespace Direct3D11
 				case VertexElementUsage::Color:
 					desc[i].SemanticName = "COLOR";
 					break;
+				case VertexElementUsage::BlendIndices:
+					desc[i].SemanticName = "BLENDINDICES";
+					break;
+				case VertexElementUsage::BlendWeight:
+					desc[i].SemanticName = "BLENDWEIGHT";
+					break;
 				}
 
 				desc[i].SemanticIndex = e[i].UsageIndex;
@@ -712,6 +725,15 @@ namespace Direct3D11
 				case VertexElementFormat::Color:
 					desc[i].Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 					break;
+				case VertexElementFormat::Short2:
+					desc[i].Format = DXGI_FORMAT_R16G16_SINT;
+					break;
+				case VertexElementFormat::Short4:
+					desc[i].Format = DXGI_FORMAT_R16G16B16A16_SINT;
+					break;
+				case VertexElementFormat::Byte4:
+					desc[i].Format = DXGI_FORMAT_R8G8B8A8_UINT;
+					break;
 				}
 
 				desc[i].InputSlot = 0;
@@ -52,10 +52,10 @@ namespace Direct3D11
 		hlslEffect->AddConstantBuffer(true, true, 32 * sizeof(float), 4);
 
 		// create the parameters
-		hlslEffect->AddParameter("ModelViewProjection", EffectParameterType::Single, 16, 0, 0, 0);
-		hlslEffect->AddParameter("Diffuse", EffectParameterType::Texture2D, 1, 0, 0, 0);
-		hlslEffect->AddParameter("AlphaTest", EffectParameterType::Single, 4, 0, 1, 80);
-		hlslEffect->AddParameter("DiffuseColor", EffectParameterType::Single, 4, 0, 2, 64);
+		hlslEffect->AddParameter("ModelViewProjection", EffectParameterType::Single, 16, 1, 0, 0, 0);
+		hlslEffect->AddParameter("Diffuse", EffectParameterType::Texture2D, 1, 1, 0, 0, 0);
+		hlslEffect->AddParameter("AlphaTest", EffectParameterType::Single, 4, 1, 0, 1, 80);
+		hlslEffect->AddParameter("DiffuseColor", EffectParameterType::Single, 4, 1, 0, 2, 64);
 	}
 
 	void HlslAlphaTestEffect::Apply(int programIndex)
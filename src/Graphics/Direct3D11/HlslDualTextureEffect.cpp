@@ -37,9 +37,9 @@ namespace Direct3D11
 		hlslEffect->AddConstantBuffer(true, false, 16 * sizeof(float), 1);
 
 		// create the parameters
-		hlslEffect->AddParameter("ModelViewProjection", EffectParameterType::Single, 16, 0, 0, 0);
-		hlslEffect->AddParameter("Diffuse", EffectParameterType::Texture2D, 1, 0, 0, 0);
-		hlslEffect->AddParameter("Diffuse2", EffectParameterType::Texture2D, 1, 0, 0, 0);
+		hlslEffect->AddParameter("ModelViewProjection", EffectParameterType::Single, 16, 1, 0, 0, 0);
+		hlslEffect->AddParameter("Diffuse", EffectParameterType::Texture2D, 1, 1, 0, 0, 0);
+		hlslEffect->AddParameter("Diffuse2", EffectParameterType::Texture2D, 1, 1, 0, 0, 0);
 	}
 
 	void HlslDualTextureEffect::Apply(int programIndex)
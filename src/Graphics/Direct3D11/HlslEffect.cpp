@@ -67,9 +67,9 @@ namespace Direct3D11
 		GetConstantBuffers().push_back(cbuffer);
 	}
 
-	EffectParameter* HlslEffect::AddParameter(const char* name, EffectParameterType type, int numElements, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset)
+	EffectParameter* HlslEffect::AddParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset)
 	{
-		EffectParameter* parameter = CreateParameter(m_parent, type, numElements, nullptr, name, constantBufferIndex, constantBufferOffset);
+		EffectParameter* parameter = CreateParameter(m_parent, type, numElements, nullptr, name, constantBufferIndex, constantBufferOffset, count);
 
 		m_parameters.insert(ParamMap::value_type(parameter->Name.c_str(), parameter));
 
@@ -140,6 +140,10 @@ namespace Direct3D11
 
 	void HlslEffect::Apply(int techniqueIndex)
 	{
+		// some techniques (like BasicEffect's instanced ones) only have GLSL versions
+		if (techniqueIndex >= (int)m_permutations.size())
+			throw GraphicsException("This technique isn't available with Direct3D", __FILE__, __LINE__);
+
 		m_device->SetCurrentEffect(this, techniqueIndex);
 	}
 }
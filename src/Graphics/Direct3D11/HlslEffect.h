@@ -93,7 +93,7 @@ namespace Direct3D11
 		}
 
 		virtual void AddConstantBuffer(bool vertex, bool pixel, int sizeInBytes, int numParameters) override;
-		virtual EffectParameter* AddParameter(const char* name, EffectParameterType type, int numElements, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset) override;
+		virtual EffectParameter* AddParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset) override;
 
 		virtual int ScoreProfile(ShaderProfile profile) override;
 
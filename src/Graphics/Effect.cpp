@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include "Effect.h"
 #include "GraphicsDevice.h"
 #include "IEffectPimpl.h"
@@ -55,7 +56,8 @@ namespace Graphics
 	{
 		std::string Name;
 		EffectParameterType Type;
-		int NumElements;
+		int NumElements; // for the whole array
+		int Count;
 	};
 
 	struct CBuffer
@@ -75,6 +77,7 @@ namespace Graphics
 	{
 		m_device = device;
 		m_currentTechniqueIndex = -1;
+		initParameterData();
 		m_pimpl = device->CreateEffectPimpl(this);
 
 		Content::MemoryStream code(effectCode, effectCodeLength);
@@ -133,6 +136,9 @@ namespace Graphics
 				e.Type = (EffectParameterType)code.ReadByte();
 				e.NumElements = code.ReadByte();
 
+				// version 1 didn't have arrays
+				e.Count = version >= 2 ? code.ReadByte() : 1;
+
 				b.Elements.push_back(e);
 			}
 
@@ -184,14 +190,14 @@ namespace Graphics
 			int offset = 0;
 			for (unsigned int j = 0; j < cbuffers[i].Elements.size(); j++)
 			{
-				m_pimpl->AddParameter(cbuffers[i].Elements[j].Name.c_str(), EffectParameterType::Single, cbuffers[i].Elements[j].NumElements, i, j, offset);
+				m_pimpl->AddParameter(cbuffers[i].Elements[j].Name.c_str(), cbuffers[i].Elements[j].Type, cbuffers[i].Elements[j].NumElements, cbuffers[i].Elements[j].Count, i, j, offset);
 				offset += cbuffers[i].Elements[j].NumElements * sizeof(float);
 			}
 		}
 
 		for (unsigned int i = 0; i < textures.size(); i++)
 		{
-			m_pimpl->AddParameter(textures[i].c_str(), EffectParameterType::Texture2D, 1, 0, 0, 0);
+			m_pimpl->AddParameter(textures[i].c_str(), EffectParameterType::Texture2D, 1, 1, 0, 0, 0);
 		}
 
 		// create a program for each technique
@@ -241,6 +247,7 @@ namespace Graphics
 	{
 		m_device = device;
 		m_currentTechniqueIndex = -1;
+		initParameterData();
 		m_pimpl = device->CreateEffectPimpl(this);
 	}
 
@@ -248,6 +255,7 @@ namespace Graphics
 	{
 		m_device = device;
 		m_currentTechniqueIndex = -1;
+		initParameterData();
 		m_pimpl = pimpl;
 	}
 
@@ -266,6 +274,8 @@ namespace Graphics
 		}
 
 		delete m_pimpl;
+
+		free(m_parameterMemory);
 	}
 
 	EffectParameter* Effect::GetParameter(int index)
@@ -353,6 +363,46 @@ namespace Graphics
 		return technique;
 	}
 
+	void Effect::initParameterData()
+	{
+		m_parameterMemory = nullptr;
+		m_parameterData = nullptr;
+		m_parameterDataSize = 0;
+		m_parameterDataCapacity = 0;
+	}
+
+	int Effect::allocateParameterData(int numBytes)
+	{
+		// 16 bytes apiece so vectors and matrices can be loaded with SIMD
+		int offset = (m_parameterDataSize + 15) & ~15;
+
+		if (offset + numBytes > m_parameterDataCapacity)
+		{
+			// parameters are added one at a time while the effect loads, so leave room for more
+			int capacity = m_parameterDataCapacity > 0 ? m_parameterDataCapacity * 2 : 1024;
+			while (capacity < offset + numBytes)
+				capacity *= 2;
+
+			byte* memory = (byte*)malloc(capacity + ParameterDataAlignment - 1);
+			if (memory == nullptr)
+				throw Exception("Unable to allocate effect parameters");
+
+			byte* data = (byte*)(((size_t)memory + ParameterDataAlignment - 1) & ~(size_t)(ParameterDataAlignment - 1));
+			if (m_parameterDataSize > 0)
+				memcpy(data, m_parameterData, m_parameterDataSize);
+
+			free(m_parameterMemory);
+			m_parameterMemory = memory;
+			m_parameterData = data;
+			m_parameterDataCapacity = capacity;
+		}
+
+		memset(m_parameterData + offset, 0, numBytes);
+		m_parameterDataSize = offset + numBytes;
+
+		return offset;
+	}
+
 	void EffectTechnique::Apply()
 	{
 		if (m_parentEffect->GetCurrentTechnique() != this)
@@ -45,12 +45,22 @@ namespace Graphics
 	class Effect
 	{
 		friend class EffectTechnique;
+		friend class EffectParameter;
 		friend class Pvt::IEffectPimpl;
 
 		std::vector<EffectTechnique*> m_techniques;
 		std::vector<EffectTechnique*> m_hiddenTechniques;
 
 		int m_currentTechniqueIndex;
+
+		// All the parameters' values are in here, one after another, so they stay together in cache
+		// when they're set and copied into constant buffers. Parameters keep offsets into it, since
+		// it moves when it grows.
+		static const int ParameterDataAlignment = 64;
+		byte* m_parameterMemory;
+		byte* m_parameterData;
+		int m_parameterDataSize;
+		int m_parameterDataCapacity;
 	
 	public:
 
@@ -84,6 +94,10 @@ namespace Graphics
 
 		GraphicsDevice* m_device;
 		Pvt::IEffectPimpl* m_pimpl;
+
+	private:
+		void initParameterData();
+		int allocateParameterData(int numBytes);
 	};
 
 	class EffectParameter
@@ -93,33 +107,45 @@ namespace Graphics
 		Effect* m_parent;
 		EffectParameterType m_type;
 		int m_numElements;
+		int m_count;
 		void* m_handle;
 		int m_constantBufferIndex;
 		int m_constantBufferOffset;
 
-		int m_value[16];
+		// where the value is in the parent's parameter data
+		int m_valueOffset;
 		Texture2D* m_textureValue;
 
-		EffectParameter(Effect* parent, EffectParameterType type, int numElements, void* handle, const char* name, int constantBufferIndex, int constantBufferOffset)
+		EffectParameter(Effect* parent, EffectParameterType type, int numElements, int count, void* handle, const char* name, int constantBufferIndex, int constantBufferOffset)
 		{
 			m_parent = parent;
 			m_type = type;
 			m_numElements = numElements;
+			m_count = count;
 			m_handle = handle;
 			Name = name;
 			m_constantBufferIndex = constantBufferIndex;
 			m_constantBufferOffset = constantBufferOffset;
 
-			memset(m_value, 0, sizeof(m_value));
+			// there's always room for a matrix, since any parameter can be set to one
+			int size = numElements * sizeof(float);
+			m_valueOffset = parent->allocateParameterData(size < (int)sizeof(float) * 16 ? (int)sizeof(float) * 16 : size);
 			m_textureValue = nullptr;
 		}
 
+		int* data() { return (int*)(m_parent->m_parameterData + m_valueOffset); }
+
 	public:
 
 		std::string Name;
 
 		EffectParameterType GetType() { return m_type; }
+
+		// the number of floats (or ints) in the whole thing, so 16 for a matrix and 16 * 72 for 72 matrices
 		int GetNumElements() { return m_numElements; }
+
+		// the length of the array, or 1 if it isn't one
+		int GetCount() { return m_count; }
 		
 		void SetValue(Texture2D* texture)
 		{
@@ -128,68 +154,94 @@ namespace Graphics
 
 		void SetValue(float value)
 		{
-			memcpy(m_value, &value, sizeof(float));
+			memcpy(data(), &value, sizeof(float));
 		}
 
 		void SetValue(const Vector2& value)
 		{
-			memcpy(m_value, &value, sizeof(value));
+			memcpy(data(), &value, sizeof(value));
 		}
 
 		void SetValue(const Vector3& value)
 		{
-			memcpy(m_value, &value, sizeof(value));
+			memcpy(data(), &value, sizeof(value));
 		}
 
 		void SetValue(const Vector4& value) 
 		{
-			memcpy(m_value, &value, sizeof(value));
+			memcpy(data(), &value, sizeof(value));
 		}
 
 		void SetValue(float matrix4x4[])
 		{
-			memcpy(m_value, matrix4x4, sizeof(float) * 16);
+			memcpy(data(), matrix4x4, sizeof(float) * 16);
 		}
 
 		void SetValue(const Matrix& matrix)
 		{
-			memcpy(m_value, matrix.C, sizeof(float) * 16);
+			memcpy(data(), matrix.C, sizeof(float) * 16);
+		}
+
+		// for arrays
+		void SetValue(const float* values, int count)
+		{
+			assert(count <= m_numElements);
+			memcpy(data(), values, sizeof(float) * count);
+		}
+
+		void SetValue(const Vector4* values, int count)
+		{
+			assert(count * 4 <= m_numElements);
+			memcpy(data(), values, sizeof(Vector4) * count);
+		}
+
+		void SetValue(const Matrix* matrices, int count)
+		{
+			assert(count * 16 <= m_numElements);
+			memcpy(data(), matrices, sizeof(Matrix) * count);
 		}
 
 		float GetValueSingle()
 		{
 			float r;
-			memcpy(&r, m_value, sizeof(float));
+			memcpy(&r, data(), sizeof(float));
 			return r;
 		}
 		
 		void GetValueSingleArray(float* destination, int count)
 		{
-			memcpy(destination, m_value, sizeof(float) * count);
+			memcpy(destination, data(), sizeof(float) * count);
 		}
 
 		Vector2 GetValueVector2()
 		{
 			Vector2 v;
-			memcpy(&v, m_value, sizeof(float) * 2);
+			memcpy(&v.X, data(), sizeof(float) * 2);
 			return v;
 		}
 
 		Vector3 GetValueVector3()
 		{
 			Vector3 v;
-			memcpy(&v, m_value, sizeof(float) * 3);
+			memcpy(&v.X, data(), sizeof(float) * 3);
 			return v;
 		}
 
 		Vector4 GetValueVector4()
 		{
 			Vector4 v;
-			memcpy(&v, m_value, sizeof(float) * 4);
+			memcpy(&v.X, data(), sizeof(float) * 4);
 			return v;
 		}
 
-		int GetValueInt32() { return m_value[0]; }
+		void GetValueMatrixArray(Matrix* destination, int count)
+		{
+			assert(count * 16 <= m_numElements);
+			for (int i = 0; i < count; i++)
+				memcpy(destination[i].C, data() + i * 16, sizeof(float) * 16);
+		}
+
+		int GetValueInt32() { return data()[0]; }
 
 		Texture2D* GetValueTexture2D() { return m_textureValue; }
 
@@ -7,6 +7,10 @@ rem build the full shaders
 %et% -h -hn DualTextureEffect_bytecodeDualTextureEffect.nxfx" DualTextureEffect.inc
 %et% -h -hn SpriteEffect_bytecode SpriteEffect.nxfx" SpriteEffect.inc
 
+rem GLSL-only effects don't need a separate HLSL-free version
+%et% -h -hn SpriteInstancedEffect_bytecode SpriteInstancedEffect.nxfx SpriteInstancedEffect.inc
+%et% -h -hn SkinnedEffect_bytecode SkinnedEffect.nxfx SkinnedEffect.inc
+
 rem build the shaders without HLSL (for pretty much every platform except Windows)
 %et% -ip ANY_HLSL -h -hn AlphaTestEffect_bytecode AlphaTestEffect.nxfx AlphaTestEffect_nohlsl.inc
 %et% -ip ANY_HLSL -h -hn BasicEffect_bytecode BasicEffect.nxfx BasicEffect_nohlsl.inc
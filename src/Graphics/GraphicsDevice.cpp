@@ -67,5 +67,24 @@ namespace Graphics
 	{
 		delete m_caps;
 	}
+
+	void GraphicsDevice::SetVertexBuffers(const VertexBufferBinding* bindings, int numBindings)
+	{
+		if (numBindings == 0)
+		{
+			SetVertexBuffer(nullptr);
+			return;
+		}
+
+		if (numBindings > 1 || bindings[0].VertexOffset != 0 || bindings[0].InstanceFrequency != 0)
+			throw InvalidOperationException("This device only supports a single vertex buffer");
+
+		SetVertexBuffer(bindings[0].Buffer);
+	}
+
+	void GraphicsDevice::DrawInstancedPrimitives(PrimitiveType primitiveType, int baseVertex, int minVertexIndex, int numVertices, int startIndex, int primitiveCount, int instanceCount)
+	{
+		throw InvalidOperationException("This device does not support instancing");
+	}
 }
 }
\ No newline at end of file
@@ -59,7 +59,8 @@ namespace Graphics
 
 	NXNA_ENUM(PrimitiveType)
 		TriangleList,
-		TriangleStrip
+		TriangleStrip,
+		LineList
 	END_NXNA_ENUM(PrimitiveType)
 
 	NXNA_ENUM(ClearOptions)
@@ -174,6 +175,11 @@ namespace Graphics
 		virtual void SetVertexBuffer(const VertexBuffer* vertexBuffer) = 0;
 		virtual void SetBlendState(const BlendState* blendState) = 0;
 
+		// Hardware instancing is only available when GetCaps()->SupportsInstancing is true.
+		// The OpenGL device falls back to one draw per instance otherwise.
+		virtual void SetVertexBuffers(const VertexBufferBinding* bindings, int numBindings);
+		virtual void DrawInstancedPrimitives(PrimitiveType primitiveType, int baseVertex, int minVertexIndex, int numVertices, int startIndex, int primitiveCount, int instanceCount);
+
 		virtual void SetRenderTarget(RenderTarget2D* renderTarget) = 0;
 
 		virtual void Present() = 0;
@@ -11,11 +11,30 @@ namespace Graphics
 		GraphicsDeviceCapabilities()
 		{
 			SupportsS3tcTextureCompression = false;
+			SupportsEtc1TextureCompression = false;
+			SupportsEtc2TextureCompression = false;
 			SupportsShaders = false;
+			SupportsInstancing = false;
+			SupportsGenerateMipmaps = false;
+			SupportsNonPowerOfTwoMipmaps = false;
+			MaxTextureUnits = 1;
 		}
 
 		bool SupportsS3tcTextureCompression;
+		bool SupportsEtc1TextureCompression;
+		bool SupportsEtc2TextureCompression;
 		bool SupportsShaders;
+		bool SupportsInstancing;
+
+		// Texture2D::GenerateMipmaps() only works when this is true
+		bool SupportsGenerateMipmaps;
+
+		// Textures whose sizes aren't powers of 2 can only have mipmaps when this is true.
+		// GLES 2 needs GL_OES_texture_npot for it.
+		bool SupportsNonPowerOfTwoMipmaps;
+
+		// the number of textures a pixel shader can sample from at once
+		int MaxTextureUnits;
 	};
 }
 }
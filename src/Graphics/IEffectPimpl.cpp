@@ -8,14 +8,14 @@ namespace Graphics
 {
 namespace Pvt
 {
-	EffectParameter* IEffectPimpl::CreateParameter(Effect* parent, EffectParameterType type, int numElements, void* handle, const char* name, int constantBufferIndex, int constantBufferOffset)
+	EffectParameter* IEffectPimpl::CreateParameter(Effect* parent, EffectParameterType type, int numElements, void* handle, const char* name, int constantBufferIndex, int constantBufferOffset, int count)
 	{
-		return new EffectParameter(parent, type, numElements, handle, name, constantBufferIndex, constantBufferOffset);
+		return new EffectParameter(parent, type, numElements, count, handle, name, constantBufferIndex, constantBufferOffset);
 	}
 
 	int* IEffectPimpl::GetRawValue(EffectParameter* parameter)
 	{
-		return parameter->m_value;
+		return parameter->data();
 	}
 
 	EffectTechnique* IEffectPimpl::CreateTechnique(const char* name, bool hidden)
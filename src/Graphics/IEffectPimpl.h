@@ -28,14 +28,15 @@ namespace Pvt
 		virtual int GetNumParameters() = 0;
 
 		virtual void AddConstantBuffer(bool vertex, bool pixel, int sizeInBytes, int numParameters) = 0;
-		virtual EffectParameter* AddParameter(const char* name, EffectParameterType type, int numElements, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset) = 0;
+		virtual EffectParameter* AddParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset) = 0;
 
 		virtual EffectTechnique* CreateProgram(const char* name, bool hidden, const byte* vertexSource, int vertexSourceLength, const byte* pixelSource, int pixelSourceLength) = 0;
 		virtual void AddAttributeToProgram(int programIndex, const char* name, EffectParameterType type, int numElements, Semantic semantic, int usageIndex) = 0;
 		
 		virtual int ScoreProfile(ShaderProfile profile) = 0;
 
-		static EffectParameter* CreateParameter(Effect* parent, EffectParameterType type, int numElements, void* handle, const char* name, int constantBufferIndex, int constantBufferOffset);
+		// count is the length of the array, and numElements is for the whole array
+		static EffectParameter* CreateParameter(Effect* parent, EffectParameterType type, int numElements, void* handle, const char* name, int constantBufferIndex, int constantBufferOffset, int count = 1);
 	
 	protected:
 		int* GetRawValue(EffectParameter* parameter);
@@ -12,18 +12,23 @@ namespace Pvt
 	protected:
 		IndexElementSize m_elementSize;
 		int m_indexCount;
+		int m_capacity;
 
 	public:
 		IIndexBufferPimpl(IndexElementSize size)
 		{
 			m_elementSize = size;
 			m_indexCount = 0;
+			m_capacity = 0;
 		}
 
 		virtual ~IIndexBufferPimpl() { }
 
 		virtual void SetData(int offsetInBytes, void* indices, int indexCount) = 0;
 
+		// makes room for indexCount indices, so the buffer can be filled in pieces
+		virtual void Reserve(int indexCount) = 0;
+
 		IndexElementSize GetElementSize() const { return m_elementSize; }
 		int GetIndexCount() const { return m_indexCount; }
 	};
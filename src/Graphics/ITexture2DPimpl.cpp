@@ -1,4 +1,6 @@
+#include <cstring>
 #include "ITexture2DPimpl.h"
+#include "../Utils/Jobs.h"
 #include "libsquish/squish.h"
 
 namespace Nxna
@@ -7,33 +9,272 @@ namespace Graphics
 {
 namespace Pvt
 {
-	byte* ITexture2DPimpl::DecompressDxtc1(const byte* pixels, int width, int height)
+	static byte* decompressDxtc(const byte* pixels, int width, int height, int flags)
 	{
 		byte* output = new byte[width * height * 4];
 
-		squish::DecompressImage(output, width, height, pixels, squish::kDxt1);
+		// each row of 4x4 blocks decompresses independently, so split them up between the workers
+		const int blockSize = (flags & squish::kDxt1) ? 8 : 16;
+		const int blocksPerRow = (width + 3) / 4;
+		const int numBlockRows = (height + 3) / 4;
+
+		Utils::Jobs::ParallelFor(numBlockRows, [=](size_t begin, size_t end)
+		{
+			int y = (int)begin * 4;
+			int rows = (int)end * 4 < height ? (int)end * 4 - y : height - y;
+
+			squish::DecompressImage(output + y * width * 4, width, rows,
+				pixels + begin * blocksPerRow * blockSize, flags);
+		}, 16);
 
 		return output;
 	}
 
-	byte* ITexture2DPimpl::DecompressDxtc3(const byte* pixels, int width, int height)
+	static inline int clamp255(int value)
 	{
-		byte* output = new byte[width * height * 4];
+		return value < 0 ? 0 : (value > 255 ? 255 : value);
+	}
 
-		squish::DecompressImage(output, width, height, pixels, squish::kDxt3);
+	static inline int extend4(int value) { return (value << 4) | value; }
+	static inline int extend5(int value) { return (value << 3) | (value >> 2); }
+	static inline int extend6(int value) { return (value << 2) | (value >> 4); }
+	static inline int extend7(int value) { return (value << 1) | (value >> 6); }
 
-		return output;
+	// Decodes one 64 bit ETC2 RGB block into 4x4 RGBA pixels. The alpha channel isn't touched.
+	static void decodeEtc2Block(const byte* block, byte* output)
+	{
+		static const int modifiers[8][2] = {
+			{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+		};
+		static const int distances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+		unsigned int high = (block[0] << 24) | (block[1] << 16) | (block[2] << 8) | block[3];
+		unsigned int low = (block[4] << 24) | (block[5] << 16) | (block[6] << 8) | block[7];
+
+		bool diff = (high & 0x02) != 0;
+		bool flip = (high & 0x01) != 0;
+
+		int paint[4][3];
+		bool usePaint = false;
+
+		int r1, g1, b1, r2, g2, b2;
+		if (diff)
+		{
+			int r = (high >> 27) & 0x1f, dr = ((int)(high << 5) >> 29);
+			int g = (high >> 19) & 0x1f, dg = ((int)(high << 13) >> 29);
+			int b = (high >> 11) & 0x1f, db = ((int)(high << 21) >> 29);
+
+			if (r + dr < 0 || r + dr > 31)
+			{
+				// T mode
+				r1 = extend4((((high >> 27) & 0x3) << 2) | ((high >> 24) & 0x3));
+				g1 = extend4((high >> 20) & 0xf);
+				b1 = extend4((high >> 16) & 0xf);
+				r2 = extend4((high >> 12) & 0xf);
+				g2 = extend4((high >> 8) & 0xf);
+				b2 = extend4((high >> 4) & 0xf);
+				int d = distances[(((high >> 2) & 0x3) << 1) | (high & 0x1)];
+
+				int c1[3] = { r1, g1, b1 }, c2[3] = { r2, g2, b2 };
+				for (int i = 0; i < 3; i++)
+				{
+					paint[0][i] = c1[i];
+					paint[1][i] = clamp255(c2[i] + d);
+					paint[2][i] = c2[i];
+					paint[3][i] = clamp255(c2[i] - d);
+				}
+				usePaint = true;
+			}
+			else if (g + dg < 0 || g + dg > 31)
+			{
+				// H mode
+				int r1b = (high >> 27) & 0xf;
+				int g1b = (((high >> 24) & 0x7) << 1) | ((high >> 20) & 0x1);
+				int b1b = (((high >> 19) & 0x1) << 3) | ((high >> 15) & 0x7);
+				int r2b = (high >> 11) & 0xf;
+				int g2b = (high >> 7) & 0xf;
+				int b2b = (high >> 3) & 0xf;
+				int order = ((r1b << 8) | (g1b << 4) | b1b) >= ((r2b << 8) | (g2b << 4) | b2b) ? 1 : 0;
+				int d = distances[(((high >> 2) & 0x1) << 2) | ((high & 0x1) << 1) | order];
+
+				int c1[3] = { extend4(r1b), extend4(g1b), extend4(b1b) }, c2[3] = { extend4(r2b), extend4(g2b), extend4(b2b) };
+				for (int i = 0; i < 3; i++)
+				{
+					paint[0][i] = clamp255(c1[i] + d);
+					paint[1][i] = clamp255(c1[i] - d);
+					paint[2][i] = clamp255(c2[i] + d);
+					paint[3][i] = clamp255(c2[i] - d);
+				}
+				usePaint = true;
+			}
+			else if (b + db < 0 || b + db > 31)
+			{
+				// planar mode. The colors are interpolated across the block.
+				int ro = extend6((high >> 25) & 0x3f);
+				int go = extend7((((high >> 24) & 0x1) << 6) | ((high >> 17) & 0x3f));
+				int bo = extend6((((high >> 16) & 0x1) << 5) | (((high >> 11) & 0x3) << 3) | ((high >> 7) & 0x7));
+				int rh = extend6((((high >> 2) & 0x1f) << 1) | (high & 0x1));
+				int gh = extend7((low >> 25) & 0x7f);
+				int bh = extend6((low >> 19) & 0x3f);
+				int rv = extend6((low >> 13) & 0x3f);
+				int gv = extend7((low >> 6) & 0x7f);
+				int bv = extend6(low & 0x3f);
+
+				for (int y = 0; y < 4; y++)
+				{
+					for (int x = 0; x < 4; x++)
+					{
+						byte* p = output + (y * 4 + x) * 4;
+						p[0] = (byte)clamp255((x * (rh - ro) + y * (rv - ro) + 4 * ro + 2) >> 2);
+						p[1] = (byte)clamp255((x * (gh - go) + y * (gv - go) + 4 * go + 2) >> 2);
+						p[2] = (byte)clamp255((x * (bh - bo) + y * (bv - bo) + 4 * bo + 2) >> 2);
+					}
+				}
+
+				return;
+			}
+			else
+			{
+				r1 = extend5(r); r2 = extend5(r + dr);
+				g1 = extend5(g); g2 = extend5(g + dg);
+				b1 = extend5(b); b2 = extend5(b + db);
+			}
+		}
+		else
+		{
+			r1 = extend4((high >> 28) & 0xf); r2 = extend4((high >> 24) & 0xf);
+			g1 = extend4((high >> 20) & 0xf); g2 = extend4((high >> 16) & 0xf);
+			b1 = extend4((high >> 12) & 0xf); b2 = extend4((high >> 8) & 0xf);
+		}
+
+		int table1 = (high >> 5) & 0x7;
+		int table2 = (high >> 2) & 0x7;
+
+		// the pixel indices are stored column by column
+		for (int x = 0; x < 4; x++)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				int i = x * 4 + y;
+				int index = (((low >> (i + 16)) & 1) << 1) | ((low >> i) & 1);
+				byte* p = output + (y * 4 + x) * 4;
+
+				if (usePaint)
+				{
+					p[0] = (byte)paint[index][0];
+					p[1] = (byte)paint[index][1];
+					p[2] = (byte)paint[index][2];
+					continue;
+				}
+
+				bool second = flip ? y >= 2 : x >= 2;
+				const int* modifier = modifiers[second ? table2 : table1];
+				int delta = (index & 1) ? modifier[1] : modifier[0];
+				if (index & 2) delta = -delta;
+
+				p[0] = (byte)clamp255((second ? r2 : r1) + delta);
+				p[1] = (byte)clamp255((second ? g2 : g1) + delta);
+				p[2] = (byte)clamp255((second ? b2 : b1) + delta);
+			}
+		}
 	}
 
-	byte* ITexture2DPimpl::DecompressDxtc5(const byte* pixels, int width, int height)
+	// Decodes one 64 bit EAC alpha block into the alpha channel of 4x4 RGBA pixels
+	static void decodeEacAlphaBlock(const byte* block, byte* output)
+	{
+		static const int modifiers[16][8] = {
+			{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+			{ -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+			{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+			{ -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+			{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+			{ -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+			{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+			{ -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+		};
+
+		int base = block[0];
+		int multiplier = block[1] >> 4;
+		const int* modifier = modifiers[block[1] & 0xf];
+
+		unsigned long long indices = 0;
+		for (int i = 2; i < 8; i++)
+			indices = (indices << 8) | block[i];
+
+		for (int i = 0; i < 16; i++)
+		{
+			int x = i / 4, y = i % 4;
+			int index = (int)(indices >> (45 - i * 3)) & 0x7;
+			output[(y * 4 + x) * 4 + 3] = (byte)clamp255(base + modifier[index] * multiplier);
+		}
+	}
+
+	static byte* decompressEtc2(const byte* pixels, int width, int height, bool alpha)
 	{
 		byte* output = new byte[width * height * 4];
 
-		squish::DecompressImage(output, width, height, pixels, squish::kDxt5);
+		const int blockSize = alpha ? 16 : 8;
+		const int blocksPerRow = (width + 3) / 4;
+		const int numBlockRows = (height + 3) / 4;
+
+		Utils::Jobs::ParallelFor(numBlockRows, [=](size_t begin, size_t end)
+		{
+			byte decoded[4 * 4 * 4];
+
+			for (int by = (int)begin; by < (int)end; by++)
+			{
+				for (int bx = 0; bx < blocksPerRow; bx++)
+				{
+					const byte* block = pixels + (by * blocksPerRow + bx) * blockSize;
+
+					if (alpha)
+					{
+						decodeEacAlphaBlock(block, decoded);
+						decodeEtc2Block(block + 8, decoded);
+					}
+					else
+					{
+						memset(decoded, 255, sizeof(decoded));
+						decodeEtc2Block(block, decoded);
+					}
+
+					// blocks on the edges of odd sized mips hang off the end
+					for (int y = 0; y < 4 && by * 4 + y < height; y++)
+					{
+						int columns = width - bx * 4 < 4 ? width - bx * 4 : 4;
+						memcpy(output + ((by * 4 + y) * width + bx * 4) * 4, decoded + y * 16, columns * 4);
+					}
+				}
+			}
+		}, 16);
 
 		return output;
 	}
+
+	byte* ITexture2DPimpl::DecompressEtc2Rgb(const byte* pixels, int width, int height)
+	{
+		return decompressEtc2(pixels, width, height, false);
+	}
+
+	byte* ITexture2DPimpl::DecompressEtc2Rgba(const byte* pixels, int width, int height)
+	{
+		return decompressEtc2(pixels, width, height, true);
+	}
+
+	byte* ITexture2DPimpl::DecompressDxtc1(const byte* pixels, int width, int height)
+	{
+		return decompressDxtc(pixels, width, height, squish::kDxt1);
+	}
+
+	byte* ITexture2DPimpl::DecompressDxtc3(const byte* pixels, int width, int height)
+	{
+		return decompressDxtc(pixels, width, height, squish::kDxt3);
+	}
+
+	byte* ITexture2DPimpl::DecompressDxtc5(const byte* pixels, int width, int height)
+	{
+		return decompressDxtc(pixels, width, height, squish::kDxt5);
+	}
 }
 }
 }
-
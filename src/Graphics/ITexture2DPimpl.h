@@ -5,6 +5,8 @@
 
 namespace Nxna
 {
+	struct Rectangle;
+
 namespace Graphics
 {
 namespace Pvt
@@ -15,11 +17,19 @@ namespace Pvt
 		virtual ~ITexture2DPimpl() { }
 
 		virtual void SetData(int level, byte* pixels, int length) = 0;
+		virtual void SetData(int level, const Rectangle& rect, byte* pixels, int length) = 0;
+
+		// fills in the rest of the mip chain from level 0
+		virtual void GenerateMipmaps() = 0;
 
 	protected:
 		static byte* DecompressDxtc3(const byte* pixels, int width, int height);
 		static byte* DecompressDxtc1(const byte* pixels, int width, int height);
 		static byte* DecompressDxtc5(const byte* pixels, int width, int height);
+
+		// ETC1 is a subset of ETC2, so DecompressEtc2Rgb() handles both
+		static byte* DecompressEtc2Rgb(const byte* pixels, int width, int height);
+		static byte* DecompressEtc2Rgba(const byte* pixels, int width, int height);
 	};
 }
 }
@@ -0,0 +1,982 @@
+#include <cstring>
+#include <climits>
+#include <cstdint>
+#include "ImageDecoder.h"
+#include "../Content/ContentManager.h"
+#include "../MemoryAllocator.h"
+#include "../Utils/Jobs.h"
+
+#if defined NXNA_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Nxna
+{
+namespace Graphics
+{
+	static void throwCorrupt()
+	{
+		throw Content::ContentException("Corrupt image data");
+	}
+
+	// temp memory for a decoded image. The size comes from the file, so it's checked instead of trusted.
+	static byte* getImageMemory(uint64_t size)
+	{
+		if (size > (uint64_t)SIZE_MAX)
+			throw Content::ContentException("The image is too large");
+
+		byte* memory = (byte*)NxnaTempMemoryPool::GetMemory((size_t)size);
+		if (memory == nullptr)
+		{
+			NxnaTempMemoryPool::ReleaseMemory();
+			throw Content::ContentException("Not enough memory to decode the image");
+		}
+
+		return memory;
+	}
+
+	static inline byte premultiply(int color, int alpha)
+	{
+		// same as color * alpha / 255, rounded
+		int t = color * alpha + 128;
+		return (byte)((t + (t >> 8)) >> 8);
+	}
+
+	static inline void writePixel(byte* destination, int r, int g, int b, int a, bool premultiplyAlpha)
+	{
+		if (premultiplyAlpha && a != 255)
+		{
+			r = premultiply(r, a);
+			g = premultiply(g, a);
+			b = premultiply(b, a);
+		}
+
+		destination[0] = (byte)r;
+		destination[1] = (byte)g;
+		destination[2] = (byte)b;
+		destination[3] = (byte)a;
+	}
+
+	static inline unsigned int readBigEndian32(const byte* data)
+	{
+		return ((unsigned int)data[0] << 24) | ((unsigned int)data[1] << 16) | ((unsigned int)data[2] << 8) | data[3];
+	}
+
+	static inline int readBigEndian16(const byte* data)
+	{
+		return (data[0] << 8) | data[1];
+	}
+
+	//
+	// inflate
+	//
+	// PNG data is a zlib stream split across one or more IDAT chunks. The bit reader
+	// walks from chunk to chunk itself, so the compressed data is never copied.
+
+	static const int HuffmanFastBits = 9;
+
+	struct PngHuffman
+	{
+		// indexed by the next 9 bits of input. (length << 9) | symbol, or 0 for longer codes.
+		unsigned short Fast[1 << HuffmanFastBits];
+
+		unsigned short FirstCode[16];
+		unsigned short FirstSymbol[16];
+		int MaxCode[17];
+		unsigned short Symbols[288];
+	};
+
+	struct PngBitReader
+	{
+		const byte* Current;
+		const byte* End; // end of the current IDAT chunk
+		const byte* FileEnd;
+		unsigned int Bits;
+		int Count;
+		int Overrun;
+	};
+
+	static int reverseBits(int value, int bits)
+	{
+		int result = 0;
+		for (int i = 0; i < bits; i++)
+		{
+			result = (result << 1) | (value & 1);
+			value >>= 1;
+		}
+
+		return result;
+	}
+
+	static int nextByte(PngBitReader* reader)
+	{
+		while (reader->Current == reader->End)
+		{
+			// move on to the next chunk if it's another IDAT
+			const byte* next = reader->End + 4; // skip the CRC
+			if (reader->FileEnd - next < 8 || memcmp(next + 4, "IDAT", 4) != 0)
+				return -1;
+
+			unsigned int length = readBigEndian32(next);
+			if (length > (unsigned int)(reader->FileEnd - next - 8))
+				return -1;
+
+			reader->Current = next + 8;
+			reader->End = reader->Current + length;
+		}
+
+		return *reader->Current++;
+	}
+
+	static void refill(PngBitReader* reader)
+	{
+		while (reader->Count <= 24)
+		{
+			int b = nextByte(reader);
+
+			// a valid stream ends before running out, but the buffer is filled a few bytes ahead
+			if (b < 0)
+			{
+				if (++reader->Overrun > 4)
+					throwCorrupt();
+				b = 0;
+			}
+
+			reader->Bits |= (unsigned int)b << reader->Count;
+			reader->Count += 8;
+		}
+	}
+
+	static inline int getBits(PngBitReader* reader, int count)
+	{
+		if (reader->Count < count)
+			refill(reader);
+
+		int result = (int)(reader->Bits & ((1u << count) - 1));
+		reader->Bits >>= count;
+		reader->Count -= count;
+
+		return result;
+	}
+
+	static void buildHuffman(PngHuffman* huffman, const byte* lengths, int count)
+	{
+		int counts[16] = { 0 };
+		int nextCode[16];
+
+		memset(huffman->Fast, 0, sizeof(huffman->Fast));
+
+		for (int i = 0; i < count; i++)
+			counts[lengths[i]]++;
+		counts[0] = 0;
+
+		int code = 0;
+		int symbol = 0;
+		for (int i = 1; i < 16; i++)
+		{
+			nextCode[i] = code;
+			huffman->FirstCode[i] = (unsigned short)code;
+			huffman->FirstSymbol[i] = (unsigned short)symbol;
+			code += counts[i];
+			if (counts[i] > 0 && code - 1 >= (1 << i))
+				throwCorrupt();
+
+			// the first code that's too big for this length, lined up to 16 bits
+			huffman->MaxCode[i] = code << (16 - i);
+			code <<= 1;
+			symbol += counts[i];
+		}
+		huffman->MaxCode[16] = 0x10000;
+
+		for (int i = 0; i < count; i++)
+		{
+			int length = lengths[i];
+			if (length == 0)
+				continue;
+
+			int index = nextCode[length] - huffman->FirstCode[length] + huffman->FirstSymbol[length];
+			huffman->Symbols[index] = (unsigned short)i;
+
+			// deflate stores codes starting with the most significant bit, so the table index is reversed
+			if (length <= HuffmanFastBits)
+			{
+				for (int j = reverseBits(nextCode[length], length); j < (1 << HuffmanFastBits); j += 1 << length)
+					huffman->Fast[j] = (unsigned short)((length << 9) | i);
+			}
+
+			nextCode[length]++;
+		}
+	}
+
+	static inline int decodeSymbol(PngBitReader* reader, const PngHuffman* huffman)
+	{
+		if (reader->Count < 16)
+			refill(reader);
+
+		int fast = huffman->Fast[reader->Bits & ((1 << HuffmanFastBits) - 1)];
+		if (fast != 0)
+		{
+			int length = fast >> 9;
+			reader->Bits >>= length;
+			reader->Count -= length;
+
+			return fast & 511;
+		}
+
+		int code = reverseBits(reader->Bits & 0xffff, 16);
+		int length;
+		for (length = HuffmanFastBits + 1; length < 16; length++)
+		{
+			if (code < huffman->MaxCode[length])
+				break;
+		}
+
+		if (length == 16)
+			throwCorrupt();
+
+		int index = (code >> (16 - length)) - huffman->FirstCode[length] + huffman->FirstSymbol[length];
+		if (index >= 288)
+			throwCorrupt();
+
+		reader->Bits >>= length;
+		reader->Count -= length;
+
+		return huffman->Symbols[index];
+	}
+
+	static void buildFixedHuffman(PngHuffman* lengths, PngHuffman* distances)
+	{
+		byte sizes[288];
+		memset(sizes, 8, 144);
+		memset(sizes + 144, 9, 112);
+		memset(sizes + 256, 7, 24);
+		memset(sizes + 280, 8, 8);
+		buildHuffman(lengths, sizes, 288);
+
+		memset(sizes, 5, 30);
+		buildHuffman(distances, sizes, 30);
+	}
+
+	static void readDynamicHuffman(PngBitReader* reader, PngHuffman* lengths, PngHuffman* distances)
+	{
+		static const byte order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		int numLengths = getBits(reader, 5) + 257;
+		int numDistances = getBits(reader, 5) + 1;
+		int numCodeLengths = getBits(reader, 4) + 4;
+
+		if (numLengths > 286 || numDistances > 30)
+			throwCorrupt();
+
+		byte codeLengthSizes[19] = { 0 };
+		for (int i = 0; i < numCodeLengths; i++)
+			codeLengthSizes[order[i]] = (byte)getBits(reader, 3);
+
+		PngHuffman codeLengths;
+		buildHuffman(&codeLengths, codeLengthSizes, 19);
+
+		byte sizes[286 + 30];
+		int total = numLengths + numDistances;
+		int count = 0;
+		while (count < total)
+		{
+			int symbol = decodeSymbol(reader, &codeLengths);
+			if (symbol < 16)
+			{
+				sizes[count++] = (byte)symbol;
+				continue;
+			}
+
+			int repeat;
+			byte value = 0;
+			if (symbol == 16)
+			{
+				if (count == 0)
+					throwCorrupt();
+				value = sizes[count - 1];
+				repeat = 3 + getBits(reader, 2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + getBits(reader, 3);
+			else
+				repeat = 11 + getBits(reader, 7);
+
+			if (repeat > total - count)
+				throwCorrupt();
+
+			memset(sizes + count, value, repeat);
+			count += repeat;
+		}
+
+		buildHuffman(lengths, sizes, numLengths);
+		buildHuffman(distances, sizes + numLengths, numDistances);
+	}
+
+	static void inflate(PngBitReader* reader, byte* output, int outputLength)
+	{
+		static const unsigned short lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+		static const byte lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+		static const unsigned short distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+		static const byte distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+		// zlib header
+		int cmf = getBits(reader, 8);
+		int flags = getBits(reader, 8);
+		if ((cmf & 15) != 8 || ((cmf << 8) | flags) % 31 != 0 || (flags & 32) != 0)
+			throwCorrupt();
+
+		PngHuffman lengths, distances;
+		int position = 0;
+		int final;
+
+		do
+		{
+			final = getBits(reader, 1);
+			int type = getBits(reader, 2);
+
+			if (type == 0)
+			{
+				// stored block, which starts on a byte boundary
+				getBits(reader, reader->Count & 7);
+				int length = getBits(reader, 16);
+				int lengthComplement = getBits(reader, 16);
+				if ((length ^ 0xffff) != lengthComplement || length > outputLength - position)
+					throwCorrupt();
+
+				for (int i = 0; i < length; i++)
+					output[position++] = (byte)getBits(reader, 8);
+
+				continue;
+			}
+			else if (type == 1)
+				buildFixedHuffman(&lengths, &distances);
+			else if (type == 2)
+				readDynamicHuffman(reader, &lengths, &distances);
+			else
+				throwCorrupt();
+
+			while (true)
+			{
+				int symbol = decodeSymbol(reader, &lengths);
+				if (symbol < 256)
+				{
+					if (position >= outputLength)
+						throwCorrupt();
+
+					output[position++] = (byte)symbol;
+				}
+				else if (symbol == 256)
+				{
+					break;
+				}
+				else
+				{
+					symbol -= 257;
+					if (symbol >= 29)
+						throwCorrupt();
+
+					int length = lengthBase[symbol] + getBits(reader, lengthExtra[symbol]);
+
+					int distanceSymbol = decodeSymbol(reader, &distances);
+					if (distanceSymbol >= 30)
+						throwCorrupt();
+
+					int distance = distanceBase[distanceSymbol] + getBits(reader, distanceExtra[distanceSymbol]);
+					if (distance > position || length > outputLength - position)
+						throwCorrupt();
+
+					byte* destination = output + position;
+					const byte* source = destination - distance;
+					if (distance == 1)
+						memset(destination, *source, length);
+					else if (distance >= length)
+						memcpy(destination, source, length);
+					else
+					{
+						for (int i = 0; i < length; i++)
+							destination[i] = source[i];
+					}
+
+					position += length;
+				}
+			}
+		}
+		while (final == 0);
+
+		if (position != outputLength)
+			throwCorrupt();
+	}
+
+	//
+	// PNG filters
+	//
+
+#if defined NXNA_SIMD_SSE2
+	// The filters of 3 and 4 byte pixels are done a pixel at a time, with each channel in a 16 bit lane.
+	// Each pixel depends on the one to its left, so that's as wide as they go.
+
+	template<int Bpp>
+	static inline __m128i loadPixel(const byte* source)
+	{
+		int value = 0;
+		memcpy(&value, source, Bpp);
+		return _mm_unpacklo_epi8(_mm_cvtsi32_si128(value), _mm_setzero_si128());
+	}
+
+	template<int Bpp>
+	static inline void storePixel(byte* destination, __m128i pixel)
+	{
+		int value = _mm_cvtsi128_si32(_mm_packus_epi16(pixel, pixel));
+		memcpy(destination, &value, Bpp);
+	}
+
+	static inline __m128i abs16(__m128i value)
+	{
+		return _mm_max_epi16(value, _mm_sub_epi16(_mm_setzero_si128(), value));
+	}
+
+	static inline __m128i selectBits(__m128i mask, __m128i a, __m128i b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+
+	template<int Bpp>
+	static void unfilterSub(byte* row, int length)
+	{
+		const __m128i mask = _mm_set1_epi16(0xff);
+		__m128i a = _mm_setzero_si128();
+
+		for (int i = 0; i < length; i += Bpp)
+		{
+			a = _mm_and_si128(_mm_add_epi16(loadPixel<Bpp>(row + i), a), mask);
+			storePixel<Bpp>(row + i, a);
+		}
+	}
+
+	template<int Bpp>
+	static void unfilterAverage(byte* row, const byte* prior, int length)
+	{
+		const __m128i mask = _mm_set1_epi16(0xff);
+		__m128i a = _mm_setzero_si128();
+
+		for (int i = 0; i < length; i += Bpp)
+		{
+			__m128i b = loadPixel<Bpp>(prior + i);
+			__m128i average = _mm_srli_epi16(_mm_add_epi16(a, b), 1);
+
+			a = _mm_and_si128(_mm_add_epi16(loadPixel<Bpp>(row + i), average), mask);
+			storePixel<Bpp>(row + i, a);
+		}
+	}
+
+	template<int Bpp>
+	static void unfilterPaeth(byte* row, const byte* prior, int length)
+	{
+		const __m128i mask = _mm_set1_epi16(0xff);
+		__m128i a = _mm_setzero_si128();
+		__m128i c = _mm_setzero_si128();
+
+		for (int i = 0; i < length; i += Bpp)
+		{
+			__m128i b = loadPixel<Bpp>(prior + i);
+
+			// p = a + b - c, so |p - a| = |b - c|, |p - b| = |a - c| and |p - c| = |(b - c) + (a - c)|
+			__m128i bc = _mm_sub_epi16(b, c);
+			__m128i ac = _mm_sub_epi16(a, c);
+			__m128i pa = abs16(bc);
+			__m128i pb = abs16(ac);
+			__m128i pc = abs16(_mm_add_epi16(bc, ac));
+
+			__m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+			__m128i predictor = selectBits(_mm_cmpeq_epi16(smallest, pb), b, c);
+			predictor = selectBits(_mm_cmpeq_epi16(smallest, pa), a, predictor);
+
+			a = _mm_and_si128(_mm_add_epi16(loadPixel<Bpp>(row + i), predictor), mask);
+			storePixel<Bpp>(row + i, a);
+			c = b;
+		}
+	}
+#endif
+
+	static inline int paeth(int a, int b, int c)
+	{
+		int pa = b - c; if (pa < 0) pa = -pa;
+		int pb = a - c; if (pb < 0) pb = -pb;
+		int pc = a + b - c - c; if (pc < 0) pc = -pc;
+
+		if (pa <= pb && pa <= pc) return a;
+		if (pb <= pc) return b;
+		return c;
+	}
+
+	static void unfilterRow(int filter, byte* row, const byte* prior, int length, int bpp)
+	{
+		switch(filter)
+		{
+		case 0:
+			break;
+		case 1: // sub
+#if defined NXNA_SIMD_SSE2
+			if (bpp == 4) { unfilterSub<4>(row, length); break; }
+			if (bpp == 3) { unfilterSub<3>(row, length); break; }
+#endif
+			for (int i = bpp; i < length; i++)
+				row[i] = (byte)(row[i] + row[i - bpp]);
+			break;
+		case 2: // up
+			for (int i = 0; i < length; i++)
+				row[i] = (byte)(row[i] + prior[i]);
+			break;
+		case 3: // average
+#if defined NXNA_SIMD_SSE2
+			if (bpp == 4) { unfilterAverage<4>(row, prior, length); break; }
+			if (bpp == 3) { unfilterAverage<3>(row, prior, length); break; }
+#endif
+			for (int i = 0; i < bpp; i++)
+				row[i] = (byte)(row[i] + (prior[i] >> 1));
+			for (int i = bpp; i < length; i++)
+				row[i] = (byte)(row[i] + ((row[i - bpp] + prior[i]) >> 1));
+			break;
+		case 4: // paeth
+#if defined NXNA_SIMD_SSE2
+			if (bpp == 4) { unfilterPaeth<4>(row, prior, length); break; }
+			if (bpp == 3) { unfilterPaeth<3>(row, prior, length); break; }
+#endif
+			for (int i = 0; i < bpp; i++)
+				row[i] = (byte)(row[i] + prior[i]);
+			for (int i = bpp; i < length; i++)
+				row[i] = (byte)(row[i] + paeth(row[i - bpp], prior[i], prior[i - bpp]));
+			break;
+		default:
+			throwCorrupt();
+		}
+	}
+
+	//
+	// PNG
+	//
+
+	struct PngImage
+	{
+		int Width;
+		int Height;
+		int Depth;
+		int ColorType;
+
+		// RGBA, already premultiplied if that was asked for
+		byte Palette[256 * 4];
+
+		// the color that's transparent in gray and RGB images that have a tRNS chunk
+		bool HasKey;
+		int Key[3];
+	};
+
+	static inline int getSample(const byte* row, int index, int depth)
+	{
+		if (depth == 8)
+			return row[index];
+		if (depth == 16)
+			return readBigEndian16(row + index * 2);
+
+		int bit = index * depth;
+		return (row[bit >> 3] >> (8 - depth - (bit & 7))) & ((1 << depth) - 1);
+	}
+
+	// Turns an unfiltered row into RGBA. This is where the alpha gets premultiplied,
+	// while the row is still in the cache.
+	static void expandRow(const PngImage& image, const byte* row, byte* destination, bool premultiplyAlpha)
+	{
+		const int width = image.Width;
+
+		if (image.ColorType == 6 && image.Depth == 8)
+		{
+			if (premultiplyAlpha == false)
+			{
+				memcpy(destination, row, width * 4);
+				return;
+			}
+
+			for (int x = 0; x < width; x++)
+			{
+				int a = row[x * 4 + 3];
+				destination[x * 4 + 0] = premultiply(row[x * 4 + 0], a);
+				destination[x * 4 + 1] = premultiply(row[x * 4 + 1], a);
+				destination[x * 4 + 2] = premultiply(row[x * 4 + 2], a);
+				destination[x * 4 + 3] = (byte)a;
+			}
+		}
+		else if (image.ColorType == 2 && image.Depth == 8 && image.HasKey == false)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				destination[x * 4 + 0] = row[x * 3 + 0];
+				destination[x * 4 + 1] = row[x * 3 + 1];
+				destination[x * 4 + 2] = row[x * 3 + 2];
+				destination[x * 4 + 3] = 255;
+			}
+		}
+		else if (image.ColorType == 3)
+		{
+			for (int x = 0; x < width; x++)
+				memcpy(destination + x * 4, &image.Palette[getSample(row, x, image.Depth) * 4], 4);
+		}
+		else
+		{
+			// everything else is rare enough to go through the general path.
+			// 16 bit samples are cut down to their top 8 bits.
+			const int shift = image.Depth == 16 ? 8 : 0;
+			const int scale = image.Depth < 8 ? 255 / ((1 << image.Depth) - 1) : 1;
+
+			for (int x = 0; x < width; x++)
+			{
+				int r, g, b, a = 255;
+
+				if (image.ColorType == 0 || image.ColorType == 4)
+				{
+					int channels = image.ColorType == 0 ? 1 : 2;
+					int gray = getSample(row, x * channels, image.Depth);
+
+					if (image.ColorType == 4)
+						a = getSample(row, x * 2 + 1, image.Depth) >> shift;
+					else if (image.HasKey && gray == image.Key[0])
+						a = 0;
+
+					r = g = b = (gray >> shift) * scale;
+				}
+				else
+				{
+					int channels = image.ColorType == 2 ? 3 : 4;
+					r = getSample(row, x * channels + 0, image.Depth);
+					g = getSample(row, x * channels + 1, image.Depth);
+					b = getSample(row, x * channels + 2, image.Depth);
+
+					if (image.ColorType == 6)
+						a = getSample(row, x * 4 + 3, image.Depth) >> shift;
+					else if (image.HasKey && r == image.Key[0] && g == image.Key[1] && b == image.Key[2])
+						a = 0;
+
+					r >>= shift;
+					g >>= shift;
+					b >>= shift;
+				}
+
+				writePixel(destination + x * 4, r, g, b, a, premultiplyAlpha);
+			}
+		}
+	}
+
+	byte* ImageDecoder::DecodePng(const byte* data, int length, bool premultiplyAlpha, int* width, int* height)
+	{
+		static const byte signature[8] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+
+		if (length < 8 || memcmp(data, signature, 8) != 0)
+			return nullptr;
+
+		const byte* end = data + length;
+		const byte* chunk = data + 8;
+		const byte* imageData = nullptr;
+
+		PngImage image;
+		image.Width = 0;
+		image.HasKey = false;
+		for (int i = 0; i < 256; i++)
+		{
+			image.Palette[i * 4 + 0] = 0;
+			image.Palette[i * 4 + 1] = 0;
+			image.Palette[i * 4 + 2] = 0;
+			image.Palette[i * 4 + 3] = 255;
+		}
+
+		// read everything up to the first IDAT. PLTE and tRNS have to come before it.
+		while (imageData == nullptr)
+		{
+			if (end - chunk < 12)
+				throwCorrupt();
+
+			unsigned int chunkLength = readBigEndian32(chunk);
+			if (chunkLength > (unsigned int)(end - chunk - 12))
+				throwCorrupt();
+
+			const byte* type = chunk + 4;
+			const byte* chunkData = chunk + 8;
+
+			if (memcmp(type, "IHDR", 4) == 0)
+			{
+				if (chunkLength != 13)
+					throwCorrupt();
+
+				image.Width = (int)readBigEndian32(chunkData);
+				image.Height = (int)readBigEndian32(chunkData + 4);
+				image.Depth = chunkData[8];
+				image.ColorType = chunkData[9];
+
+				if (image.Width <= 0 || image.Height <= 0 || image.Width > 16384 || image.Height > 16384)
+					throw Content::ContentException("Unsupported PNG dimensions");
+				if (chunkData[10] != 0 || chunkData[11] != 0)
+					throwCorrupt();
+				if (chunkData[12] != 0)
+					throw Content::ContentException("Interlaced PNG files aren't supported");
+
+				int depth = image.Depth;
+				bool valid;
+				switch(image.ColorType)
+				{
+				case 0: valid = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+				case 3: valid = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+				case 2: case 4: case 6: valid = depth == 8 || depth == 16; break;
+				default: valid = false;
+				}
+
+				if (valid == false)
+					throwCorrupt();
+			}
+			else if (memcmp(type, "PLTE", 4) == 0)
+			{
+				for (unsigned int i = 0; i < chunkLength / 3 && i < 256; i++)
+				{
+					image.Palette[i * 4 + 0] = chunkData[i * 3 + 0];
+					image.Palette[i * 4 + 1] = chunkData[i * 3 + 1];
+					image.Palette[i * 4 + 2] = chunkData[i * 3 + 2];
+				}
+			}
+			else if (memcmp(type, "tRNS", 4) == 0 && image.Width > 0)
+			{
+				if (image.ColorType == 3)
+				{
+					for (unsigned int i = 0; i < chunkLength && i < 256; i++)
+						image.Palette[i * 4 + 3] = chunkData[i];
+				}
+				else if (image.ColorType == 0 && chunkLength >= 2)
+				{
+					image.HasKey = true;
+					image.Key[0] = readBigEndian16(chunkData);
+				}
+				else if (image.ColorType == 2 && chunkLength >= 6)
+				{
+					image.HasKey = true;
+					image.Key[0] = readBigEndian16(chunkData);
+					image.Key[1] = readBigEndian16(chunkData + 2);
+					image.Key[2] = readBigEndian16(chunkData + 4);
+				}
+			}
+			else if (memcmp(type, "IDAT", 4) == 0)
+			{
+				imageData = chunk;
+			}
+			else if (memcmp(type, "IEND", 4) == 0)
+			{
+				throwCorrupt();
+			}
+			else if ((type[0] & 32) == 0)
+			{
+				throw Content::ContentException("Unsupported PNG chunk");
+			}
+
+			chunk = chunkData + chunkLength + 4;
+		}
+
+		if (image.Width == 0)
+			throwCorrupt();
+
+		// the whole palette is premultiplied up front, so palette images don't need to do anything per pixel
+		if (premultiplyAlpha)
+		{
+			for (int i = 0; i < 256; i++)
+				writePixel(&image.Palette[i * 4], image.Palette[i * 4 + 0], image.Palette[i * 4 + 1], image.Palette[i * 4 + 2], image.Palette[i * 4 + 3], true);
+		}
+
+		const int channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+		const int bitsPerPixel = channels[image.ColorType] * image.Depth;
+		const int bpp = bitsPerPixel >= 8 ? bitsPerPixel / 8 : 1;
+
+		// the biggest images don't fit in an int, so the sizes are worked out in 64 bits first.
+		// inflate() still works in ints, so the inflated rows have to fit in one.
+		const uint64_t rowLength64 = ((uint64_t)image.Width * bitsPerPixel + 7) / 8;
+		const uint64_t rawLength64 = (uint64_t)image.Height * (rowLength64 + 1);
+		const uint64_t pixelsLength64 = (uint64_t)image.Width * image.Height * 4;
+		if (rawLength64 > INT_MAX)
+			throw Content::ContentException("Unsupported PNG dimensions");
+
+		const int rowLength = (int)rowLength64;
+		const int rawLength = (int)rawLength64;
+
+		// one block of temp memory: the finished pixels, then the inflated rows, then a row of zeros
+		// that stands in for the row above the first one
+		byte* pixels = getImageMemory(pixelsLength64 + rawLength64 + rowLength64);
+		byte* raw = pixels + pixelsLength64;
+		byte* zeros = raw + rawLength;
+		memset(zeros, 0, rowLength);
+
+		try
+		{
+			PngBitReader reader;
+			reader.Current = imageData + 8;
+			reader.End = reader.Current + readBigEndian32(imageData);
+			reader.FileEnd = end;
+			reader.Bits = 0;
+			reader.Count = 0;
+			reader.Overrun = 0;
+
+			inflate(&reader, raw, rawLength);
+
+			const byte* prior = zeros;
+			for (int y = 0; y < image.Height; y++)
+			{
+				byte* row = raw + y * (rowLength + 1);
+
+				unfilterRow(row[0], row + 1, prior, rowLength, bpp);
+				expandRow(image, row + 1, pixels + y * image.Width * 4, premultiplyAlpha);
+
+				prior = row + 1;
+			}
+		}
+		catch(...)
+		{
+			NxnaTempMemoryPool::ReleaseMemory();
+			throw;
+		}
+
+		*width = image.Width;
+		*height = image.Height;
+
+		return pixels;
+	}
+
+	//
+	// TGA
+	//
+
+	// the same limit as PNG files, which keeps all the pixel offsets inside an int
+	static const uint64_t MaxTgaPixels = 16384 * 16384;
+
+	static void convertTgaPixels(const byte* source, byte* destination, int count, int bytesPerPixel, bool premultiplyAlpha)
+	{
+		if (bytesPerPixel == 4)
+		{
+			for (int i = 0; i < count; i++)
+				writePixel(destination + i * 4, source[i * 4 + 2], source[i * 4 + 1], source[i * 4 + 0], source[i * 4 + 3], premultiplyAlpha);
+		}
+		else if (bytesPerPixel == 3)
+		{
+			for (int i = 0; i < count; i++)
+			{
+				destination[i * 4 + 0] = source[i * 3 + 2];
+				destination[i * 4 + 1] = source[i * 3 + 1];
+				destination[i * 4 + 2] = source[i * 3 + 0];
+				destination[i * 4 + 3] = 255;
+			}
+		}
+		else
+		{
+			for (int i = 0; i < count; i++)
+			{
+				destination[i * 4 + 0] = source[i];
+				destination[i * 4 + 1] = source[i];
+				destination[i * 4 + 2] = source[i];
+				destination[i * 4 + 3] = 255;
+			}
+		}
+	}
+
+	byte* ImageDecoder::DecodeTga(const byte* data, int length, bool premultiplyAlpha, int* width, int* height)
+	{
+		if (length < 18)
+			return nullptr;
+
+		int idLength = data[0];
+		int colorMapType = data[1];
+		int imageType = data[2];
+		int colorMapLength = data[5] | (data[6] << 8);
+		int colorMapEntrySize = data[7];
+		int w = data[12] | (data[13] << 8);
+		int h = data[14] | (data[15] << 8);
+		int depth = data[16];
+		int descriptor = data[17];
+
+		bool knownType = imageType == 1 || imageType == 2 || imageType == 3 || imageType == 9 || imageType == 10 || imageType == 11;
+		if (colorMapType > 1 || knownType == false || w == 0 || h == 0 ||
+			(depth != 8 && depth != 15 && depth != 16 && depth != 24 && depth != 32))
+			return nullptr;
+
+		if ((uint64_t)w * h > MaxTgaPixels)
+			throw Content::ContentException("Unsupported TGA dimensions");
+
+		bool grayscale = (imageType & 3) == 3;
+		if (colorMapType != 0 || (imageType & 3) == 1)
+			throw Content::ContentException("Color-mapped TGA files aren't supported");
+		if ((grayscale && depth != 8) || (grayscale == false && depth != 24 && depth != 32))
+			throw Content::ContentException("Unsupported TGA pixel format");
+
+		const int bytesPerPixel = depth / 8;
+		const bool compressed = imageType >= 9;
+		const bool topDown = (descriptor & 0x20) != 0;
+
+		const byte* dataEnd = data + length;
+		const byte* source = data + 18 + idLength + colorMapLength * ((colorMapEntrySize + 7) / 8);
+		if (source > dataEnd)
+			throwCorrupt();
+
+		byte* pixels = getImageMemory((uint64_t)w * h * 4);
+
+		if (compressed == false)
+		{
+			if ((uint64_t)(dataEnd - source) < (uint64_t)w * h * bytesPerPixel)
+			{
+				NxnaTempMemoryPool::ReleaseMemory();
+				throwCorrupt();
+			}
+
+			Utils::Jobs::ParallelFor(h, [=](size_t begin, size_t end)
+			{
+				for (int y = (int)begin; y < (int)end; y++)
+				{
+					int destinationRow = topDown ? y : h - 1 - y;
+					convertTgaPixels(source + y * w * bytesPerPixel, pixels + destinationRow * w * 4, w, bytesPerPixel, premultiplyAlpha);
+				}
+			}, 64);
+		}
+		else
+		{
+			// RLE packets can cross rows, so this part goes one packet at a time
+			int x = 0, y = 0;
+			while (y < h)
+			{
+				if (source >= dataEnd)
+				{
+					NxnaTempMemoryPool::ReleaseMemory();
+					throwCorrupt();
+				}
+
+				int header = *source++;
+				int count = (header & 0x7f) + 1;
+				bool repeat = (header & 0x80) != 0;
+
+				if (dataEnd - source < (repeat ? 1 : count) * bytesPerPixel)
+				{
+					NxnaTempMemoryPool::ReleaseMemory();
+					throwCorrupt();
+				}
+
+				for (int i = 0; i < count && y < h; i++)
+				{
+					int destinationRow = topDown ? y : h - 1 - y;
+					convertTgaPixels(repeat ? source : source + i * bytesPerPixel, pixels + (destinationRow * w + x) * 4, 1, bytesPerPixel, premultiplyAlpha);
+
+					if (++x == w)
+					{
+						x = 0;
+						y++;
+					}
+				}
+
+				source += (repeat ? 1 : count) * bytesPerPixel;
+			}
+		}
+
+		*width = w;
+		*height = h;
+
+		return pixels;
+	}
+}
+}
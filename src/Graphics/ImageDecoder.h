@@ -0,0 +1,31 @@
+#ifndef NXNA_GRAPHICS_IMAGEDECODER_H
+#define NXNA_GRAPHICS_IMAGEDECODER_H
+
+#include "../NxnaConfig.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// this class doesn't exist in XNA!
+	// Decodes PNG and TGA files into Color pixels (RGBA, 8 bits per channel).
+	// The pixels are written into NxnaTempMemoryPool, ready to be handed to Texture2D::SetData(),
+	// so call NxnaTempMemoryPool::ReleaseMemory() once you're done with them.
+	// When premultiplyAlpha is true the colors are multiplied by alpha during the decode,
+	// which is what XNA's content pipeline does and what BlendState::GetAlphaBlend() expects.
+	// Corrupt or unsupported files throw a ContentException.
+	class ImageDecoder
+	{
+	public:
+		// returns nullptr if the data isn't a PNG file.
+		// Interlaced PNGs aren't supported.
+		static byte* DecodePng(const byte* data, int length, bool premultiplyAlpha, int* width, int* height);
+
+		// TGA files don't have a signature, so this returns nullptr if the header doesn't look like one.
+		// Supports 24 and 32 bit color and 8 bit grayscale, compressed or not.
+		static byte* DecodeTga(const byte* data, int length, bool premultiplyAlpha, int* width, int* height);
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_IMAGEDECODER_H
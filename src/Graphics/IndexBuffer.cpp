@@ -10,6 +10,16 @@ namespace Graphics
 	{
 		m_pimpl = device->CreateIndexBufferPimpl(indexElementSize);
 		m_elementSize = indexElementSize;
+		m_indexCount = 0;
+	}
+
+	IndexBuffer::IndexBuffer(GraphicsDevice* device, IndexElementSize indexElementSize, int indexCount, BufferUsage /* usage */)
+	{
+		m_pimpl = device->CreateIndexBufferPimpl(indexElementSize);
+		m_elementSize = indexElementSize;
+		m_indexCount = indexCount;
+
+		m_pimpl->Reserve(indexCount);
 	}
 
 	IndexBuffer::~IndexBuffer()
@@ -25,7 +35,10 @@ namespace Graphics
 
 	void IndexBuffer::SetData(int offsetInBytes, void* indices, int indexCount)
 	{
-		m_indexCount = indexCount;
+		int totalIndexCount = offsetInBytes / (int)m_elementSize + indexCount;
+		if (totalIndexCount > m_indexCount)
+			m_indexCount = totalIndexCount;
+
 		m_pimpl->SetData(offsetInBytes, indices, indexCount);
 	}
 }
@@ -30,6 +30,10 @@ namespace Graphics
 	public:
 
 		IndexBuffer(GraphicsDevice* device, IndexElementSize indexElementSize); 
+
+		// Makes room for indexCount indices up front, so the buffer can be filled in pieces
+		// with SetData(offsetInBytes, ...).
+		IndexBuffer(GraphicsDevice* device, IndexElementSize indexElementSize, int indexCount, BufferUsage usage);
 		virtual ~IndexBuffer();
 
 		void SetData(void* indices, int indexCount);
@@ -0,0 +1,349 @@
+#include <cmath>
+#include <vector>
+#include "MipmapGenerator.h"
+#include "../MathSimd.h"
+#include "../Utils/Jobs.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	static const int MaxTaps = 12;
+
+	// The weights for turning source pixels 2x + FirstOffset ... 2x + FirstOffset + Taps - 1 into output pixel x.
+	// Both directions use the same weights.
+	struct MipmapKernel
+	{
+		int Taps;
+		int FirstOffset;
+		float Weights[MaxTaps];
+	};
+
+	// the tables for converting between bytes and floats
+	struct MipmapTables
+	{
+		float ToFloat[256];
+		float SrgbToLinear[256];
+		byte LinearToSrgb[4096];
+
+		MipmapTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				ToFloat[i] = c;
+				SrgbToLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+
+			for (int i = 0; i < 4096; i++)
+			{
+				float c = i / 4095.0f;
+				float srgb = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+				LinearToSrgb[i] = (byte)(srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	static const MipmapTables& getTables()
+	{
+		static const MipmapTables tables;
+		return tables;
+	}
+
+	static float besselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 20; k++)
+		{
+			float t = x / (2.0f * k);
+			term *= t * t;
+			sum += term;
+		}
+
+		return sum;
+	}
+
+	static void createKernel(MipmapFilter filter, MipmapKernel* kernel)
+	{
+		if (filter == MipmapFilter::Kaiser)
+		{
+			// a sinc windowed by a Kaiser window 3 output pixels wide on each side (alpha = 4),
+			// which is 12 source pixels
+			const float width = 3.0f;
+			const float alpha = 4.0f;
+			const float pi = 3.14159265f;
+
+			kernel->Taps = MaxTaps;
+			kernel->FirstOffset = -5;
+
+			float sum = 0;
+			for (int i = 0; i < MaxTaps; i++)
+			{
+				// distance from the output pixel's center, in output pixels
+				float d = (kernel->FirstOffset + i - 0.5f) * 0.5f;
+				float sinc = sinf(pi * d) / (pi * d);
+				float t = d / width;
+				float window = besselI0(alpha * sqrtf(1.0f - t * t)) / besselI0(alpha);
+
+				kernel->Weights[i] = sinc * window;
+				sum += kernel->Weights[i];
+			}
+
+			for (int i = 0; i < MaxTaps; i++)
+				kernel->Weights[i] /= sum;
+		}
+		else
+		{
+			kernel->Taps = 2;
+			kernel->FirstOffset = 0;
+			kernel->Weights[0] = 0.5f;
+			kernel->Weights[1] = 0.5f;
+		}
+	}
+
+	static inline int clampIndex(int index, int size)
+	{
+		return index < 0 ? 0 : (index >= size ? size - 1 : index);
+	}
+
+	static void loadRow(const byte* source, int width, const float* colorTable, const float* alphaTable, float* destination)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			destination[x * 4 + 0] = colorTable[source[x * 4 + 0]];
+			destination[x * 4 + 1] = colorTable[source[x * 4 + 1]];
+			destination[x * 4 + 2] = colorTable[source[x * 4 + 2]];
+			destination[x * 4 + 3] = alphaTable[source[x * 4 + 3]];
+		}
+	}
+
+	// each pixel is one 4-wide vector, so the filters work on all 4 channels at once
+	static void filterRow(const float* source, int width, const MipmapKernel& kernel, int outputWidth, float* destination)
+	{
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 weights[MaxTaps];
+		for (int t = 0; t < kernel.Taps; t++)
+			weights[t] = Simd::Splat(kernel.Weights[t]);
+
+		for (int x = 0; x < outputWidth; x++)
+		{
+			Simd::Float4 sum = Simd::Splat(0);
+			for (int t = 0; t < kernel.Taps; t++)
+			{
+				int sx = clampIndex(x * 2 + kernel.FirstOffset + t, width);
+				sum = Simd::MultiplyAdd(Simd::Load(source + sx * 4), weights[t], sum);
+			}
+
+			Simd::Store(sum, destination + x * 4);
+		}
+#else
+		for (int x = 0; x < outputWidth; x++)
+		{
+			float sum[4] = { 0, 0, 0, 0 };
+			for (int t = 0; t < kernel.Taps; t++)
+			{
+				const float* pixel = source + clampIndex(x * 2 + kernel.FirstOffset + t, width) * 4;
+				for (int c = 0; c < 4; c++)
+					sum[c] += pixel[c] * kernel.Weights[t];
+			}
+
+			for (int c = 0; c < 4; c++)
+				destination[x * 4 + c] = sum[c];
+		}
+#endif
+	}
+
+	static void combineRows(const float** rows, const MipmapKernel& kernel, int width, bool srgb, byte* destination)
+	{
+		const MipmapTables& tables = getTables();
+
+		for (int x = 0; x < width; x++)
+		{
+			float sum[4];
+
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+			Simd::Float4 sum4 = Simd::Splat(0);
+			for (int t = 0; t < kernel.Taps; t++)
+				sum4 = Simd::MultiplyAdd(Simd::Load(rows[t] + x * 4), Simd::Splat(kernel.Weights[t]), sum4);
+			Simd::Store(sum4, sum);
+#else
+			sum[0] = sum[1] = sum[2] = sum[3] = 0;
+			for (int t = 0; t < kernel.Taps; t++)
+			{
+				for (int c = 0; c < 4; c++)
+					sum[c] += rows[t][x * 4 + c] * kernel.Weights[t];
+			}
+#endif
+
+			// the Kaiser filter has negative lobes, so it can overshoot
+			for (int c = 0; c < 4; c++)
+				sum[c] = sum[c] < 0 ? 0 : (sum[c] > 1.0f ? 1.0f : sum[c]);
+
+			if (srgb)
+			{
+				destination[x * 4 + 0] = tables.LinearToSrgb[(int)(sum[0] * 4095.0f + 0.5f)];
+				destination[x * 4 + 1] = tables.LinearToSrgb[(int)(sum[1] * 4095.0f + 0.5f)];
+				destination[x * 4 + 2] = tables.LinearToSrgb[(int)(sum[2] * 4095.0f + 0.5f)];
+			}
+			else
+			{
+				destination[x * 4 + 0] = (byte)(sum[0] * 255.0f + 0.5f);
+				destination[x * 4 + 1] = (byte)(sum[1] * 255.0f + 0.5f);
+				destination[x * 4 + 2] = (byte)(sum[2] * 255.0f + 0.5f);
+			}
+
+			destination[x * 4 + 3] = (byte)(sum[3] * 255.0f + 0.5f);
+		}
+	}
+
+	static void downsample(const byte* source, int width, int height, const MipmapKernel& kernel, bool srgb,
+		byte* destination, int outputWidth, int outputHeight)
+	{
+		const MipmapTables& tables = getTables();
+		const float* colorTable = srgb ? tables.SrgbToLinear : tables.ToFloat;
+
+		Utils::Jobs::ParallelFor(outputHeight, [=, &kernel](size_t begin, size_t end)
+		{
+			// Each output row needs Taps source rows, filtered horizontally. Those are kept in a ring
+			// so the rows shared by neighboring output rows are only filtered once. The rows needed
+			// at any one time are all within Taps of each other, so row % Taps never collides.
+			std::vector<float> scratch((width + kernel.Taps * outputWidth) * 4);
+			float* sourceRow = &scratch[0];
+			float* ring = sourceRow + width * 4;
+
+			int ringRows[MaxTaps];
+			for (int t = 0; t < kernel.Taps; t++)
+				ringRows[t] = -1;
+
+			const float* rows[MaxTaps];
+
+			for (int y = (int)begin; y < (int)end; y++)
+			{
+				for (int t = 0; t < kernel.Taps; t++)
+				{
+					int sy = clampIndex(y * 2 + kernel.FirstOffset + t, height);
+					int slot = sy % kernel.Taps;
+					float* filtered = ring + slot * outputWidth * 4;
+
+					if (ringRows[slot] != sy)
+					{
+						loadRow(source + sy * width * 4, width, colorTable, tables.ToFloat, sourceRow);
+						filterRow(sourceRow, width, kernel, outputWidth, filtered);
+						ringRows[slot] = sy;
+					}
+
+					rows[t] = filtered;
+				}
+
+				combineRows(rows, kernel, outputWidth, srgb, destination + y * outputWidth * 4);
+			}
+		}, 8);
+	}
+
+	static void alphaHistogram(const byte* pixels, int count, int* histogram)
+	{
+		for (int i = 0; i < 256; i++)
+			histogram[i] = 0;
+
+		for (int i = 0; i < count; i++)
+			histogram[pixels[i * 4 + 3]]++;
+	}
+
+	// the fraction of pixels whose alpha * scale is over the reference
+	static float alphaCoverage(const int* histogram, int count, float reference, float scale)
+	{
+		int covered = 0;
+		for (int i = 1; i < 256; i++)
+		{
+			if (i * scale > reference * 255.0f)
+				covered += histogram[i];
+		}
+
+		return (float)covered / count;
+	}
+
+	static void scaleAlphaToCoverage(byte* pixels, int count, float reference, float coverage)
+	{
+		int histogram[256];
+		alphaHistogram(pixels, count, histogram);
+
+		// the coverage only goes up as the scale goes up, so a binary search finds the best one
+		float low = 0, high = 8.0f;
+		for (int i = 0; i < 20; i++)
+		{
+			float middle = (low + high) * 0.5f;
+			if (alphaCoverage(histogram, count, reference, middle) < coverage)
+				low = middle;
+			else
+				high = middle;
+		}
+
+		float scale = (low + high) * 0.5f;
+
+		for (int i = 0; i < count; i++)
+		{
+			float a = pixels[i * 4 + 3] * scale + 0.5f;
+			pixels[i * 4 + 3] = a > 255.0f ? 255 : (byte)a;
+		}
+	}
+
+	int MipmapGenerator::GetLevelCount(int width, int height)
+	{
+		int levels = 1;
+		while (width > 1 || height > 1)
+		{
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			levels++;
+		}
+
+		return levels;
+	}
+
+	int MipmapGenerator::GetChainLength(int width, int height)
+	{
+		int length = 0;
+		while (width > 1 || height > 1)
+		{
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+			length += width * height * 4;
+		}
+
+		return length;
+	}
+
+	void MipmapGenerator::Generate(const byte* pixels, int width, int height, const MipmapOptions& options, byte* destination)
+	{
+		MipmapKernel kernel;
+		createKernel(options.Filter, &kernel);
+
+		float coverage = 0;
+		if (options.PreserveAlphaCoverage)
+		{
+			int histogram[256];
+			alphaHistogram(pixels, width * height, histogram);
+			coverage = alphaCoverage(histogram, width * height, options.AlphaReference, 1.0f);
+		}
+
+		// each level is made from the one before it
+		const byte* source = pixels;
+		while (width > 1 || height > 1)
+		{
+			int outputWidth = width > 1 ? width / 2 : 1;
+			int outputHeight = height > 1 ? height / 2 : 1;
+
+			downsample(source, width, height, kernel, options.Srgb, destination, outputWidth, outputHeight);
+
+			if (options.PreserveAlphaCoverage)
+				scaleAlphaToCoverage(destination, outputWidth * outputHeight, options.AlphaReference, coverage);
+
+			source = destination;
+			destination += outputWidth * outputHeight * 4;
+			width = outputWidth;
+			height = outputHeight;
+		}
+	}
+}
+}
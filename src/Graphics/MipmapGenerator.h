@@ -0,0 +1,62 @@
+#ifndef NXNA_GRAPHICS_MIPMAPGENERATOR_H
+#define NXNA_GRAPHICS_MIPMAPGENERATOR_H
+
+#include "../NxnaConfig.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// this doesn't exist in XNA!
+	NXNA_ENUM(MipmapFilter)
+		// averages each 2x2 block. Fast, and what the hardware does.
+		Box,
+
+		// a wider windowed sinc filter. Sharper, slower.
+		Kaiser
+	END_NXNA_ENUM(MipmapFilter)
+
+	// this struct doesn't exist in XNA!
+	struct MipmapOptions
+	{
+		MipmapOptions()
+		{
+			Filter = MipmapFilter::Box;
+			Srgb = false;
+			PreserveAlphaCoverage = false;
+			AlphaReference = 0.5f;
+		}
+
+		MipmapFilter Filter;
+
+		// the colors are sRGB, so they're filtered in linear space. Alpha is always linear.
+		bool Srgb;
+
+		// Scales the alpha of each mip so the same fraction of pixels passes an alpha test against
+		// AlphaReference as in level 0. Keeps foliage and fences from fading away in the distance.
+		// Only the alpha changes, so this is meant for textures that aren't premultiplied.
+		bool PreserveAlphaCoverage;
+		float AlphaReference;
+	};
+
+	// this class doesn't exist in XNA!
+	// Builds mip chains on the CPU from Color (RGBA, 8 bits per channel) pixels.
+	// It doesn't touch the graphics device, so it's safe to use from worker threads while loading.
+	// The rows of each level are spread across threads with Jobs::ParallelFor().
+	class MipmapGenerator
+	{
+	public:
+		// the number of levels in a full chain, including level 0
+		static int GetLevelCount(int width, int height);
+
+		// the number of bytes Generate() writes
+		static int GetChainLength(int width, int height);
+
+		// Writes level 1 and down to 1x1 into destination, one level after another.
+		// Each level is half the size of the one before (rounded down, but at least 1).
+		static void Generate(const byte* pixels, int width, int height, const MipmapOptions& options, byte* destination);
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_MIPMAPGENERATOR_H
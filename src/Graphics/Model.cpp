@@ -0,0 +1,602 @@
+#include <cassert>
+#include <cstring>
+#include <algorithm>
+#include "Model.h"
+#include "GraphicsDevice.h"
+#include "BasicEffect.h"
+#include "Texture2D.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "VertexDeclaration.h"
+#include "../Content/XnbReader.h"
+#include "../Content/FileStream.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	void ModelMesh::Draw()
+	{
+		GraphicsDevice* device = GraphicsDevice::GetDevice();
+
+		for (std::vector<ModelMeshPart>::size_type i = 0; i < m_parts.size(); i++)
+		{
+			ModelMeshPart& part = m_parts[i];
+			if (part.m_effect == nullptr || part.m_primitiveCount == 0)
+				continue;
+
+			device->SetVertexBuffer(part.m_vertexBuffer);
+			device->SetIndices(part.m_indexBuffer);
+			part.m_effect->GetCurrentTechnique()->Apply();
+
+			device->DrawIndexedPrimitives(PrimitiveType::TriangleList, part.m_vertexOffset, 0, part.m_numVertices, part.m_startIndex, part.m_primitiveCount);
+		}
+	}
+
+	Model::~Model()
+	{
+		for (std::vector<Effect*>::size_type i = 0; i < m_effects.size(); i++)
+			delete m_effects[i];
+		for (std::vector<VertexBuffer*>::size_type i = 0; i < m_vertexBuffers.size(); i++)
+			delete m_vertexBuffers[i];
+		for (std::vector<IndexBuffer*>::size_type i = 0; i < m_indexBuffers.size(); i++)
+			delete m_indexBuffers[i];
+	}
+
+	ModelBone* Model::GetBone(const char* name)
+	{
+		for (std::vector<ModelBone>::size_type i = 0; i < m_bones.size(); i++)
+		{
+			if (m_bones[i].m_name == name)
+				return &m_bones[i];
+		}
+
+		return nullptr;
+	}
+
+	ModelMesh* Model::GetMesh(const char* name)
+	{
+		for (std::vector<ModelMesh>::size_type i = 0; i < m_meshes.size(); i++)
+		{
+			if (m_meshes[i].m_name == name)
+				return &m_meshes[i];
+		}
+
+		return nullptr;
+	}
+
+	void Model::CopyAbsoluteBoneTransformsTo(Matrix* destination)
+	{
+		assert(destination != nullptr);
+
+		// parents always come before their children
+		for (std::vector<ModelBone>::size_type i = 0; i < m_bones.size(); i++)
+		{
+			ModelBone& bone = m_bones[i];
+
+			if (bone.m_parent == nullptr)
+				destination[i] = bone.m_transform;
+			else
+				Matrix::Multiply(bone.m_transform, destination[bone.m_parent->m_index], destination[i]);
+		}
+	}
+
+	void Model::Draw(const Matrix& world, const Matrix& view, const Matrix& projection)
+	{
+		if (m_bones.empty() == false)
+		{
+			m_absoluteTransforms.resize(m_bones.size());
+			CopyAbsoluteBoneTransformsTo(&m_absoluteTransforms[0]);
+		}
+
+		// the effects can be changed at any time, so sort every time. Models don't have many parts.
+		m_drawOrder.clear();
+		for (std::vector<ModelMesh>::size_type i = 0; i < m_meshes.size(); i++)
+		{
+			for (std::vector<ModelMeshPart>::size_type j = 0; j < m_meshes[i].m_parts.size(); j++)
+			{
+				ModelMeshPart& part = m_meshes[i].m_parts[j];
+				if (part.m_effect == nullptr || part.m_primitiveCount == 0)
+					continue;
+
+				BasicEffect* basicEffect = dynamic_cast<BasicEffect*>(part.m_effect);
+
+				DrawItem item;
+				item.Mesh = &m_meshes[i];
+				item.Part = &part;
+				item.PartEffect = part.m_effect;
+				item.Texture = basicEffect != nullptr ? basicEffect->GetTexture() : nullptr;
+				m_drawOrder.push_back(item);
+			}
+		}
+
+		std::sort(m_drawOrder.begin(), m_drawOrder.end(), [](const DrawItem& a, const DrawItem& b) {
+			if (a.PartEffect != b.PartEffect) return a.PartEffect < b.PartEffect;
+			if (a.Texture != b.Texture) return a.Texture < b.Texture;
+			if (a.Part->m_vertexBuffer != b.Part->m_vertexBuffer) return a.Part->m_vertexBuffer < b.Part->m_vertexBuffer;
+			return a.Part->m_indexBuffer < b.Part->m_indexBuffer;
+		});
+
+		GraphicsDevice* device = GraphicsDevice::GetDevice();
+
+		Effect* lastEffect = nullptr;
+		ModelMesh* lastMesh = nullptr;
+		VertexBuffer* lastVertexBuffer = nullptr;
+		IndexBuffer* lastIndexBuffer = nullptr;
+
+		for (std::vector<DrawItem>::size_type i = 0; i < m_drawOrder.size(); i++)
+		{
+			const DrawItem& item = m_drawOrder[i];
+			ModelMeshPart* part = item.Part;
+
+			// the parts share a few big buffers, so these rarely change
+			if (part->m_vertexBuffer != lastVertexBuffer)
+			{
+				device->SetVertexBuffer(part->m_vertexBuffer);
+				lastVertexBuffer = part->m_vertexBuffer;
+			}
+			if (part->m_indexBuffer != lastIndexBuffer)
+			{
+				device->SetIndices(part->m_indexBuffer);
+				lastIndexBuffer = part->m_indexBuffer;
+			}
+
+			// an effect only needs to be applied again when it's a different effect or a different mesh (so a different world)
+			if (item.PartEffect != lastEffect || item.Mesh != lastMesh)
+			{
+				BasicEffect* basicEffect = dynamic_cast<BasicEffect*>(item.PartEffect);
+				if (basicEffect != nullptr)
+				{
+					Matrix meshWorld;
+					if (item.Mesh->m_parentBone != nullptr)
+						Matrix::Multiply(m_absoluteTransforms[item.Mesh->m_parentBone->m_index], world, meshWorld);
+					else
+						meshWorld = world;
+
+					basicEffect->SetWorld(meshWorld);
+					basicEffect->SetView(view);
+					basicEffect->SetProjection(projection);
+				}
+
+				item.PartEffect->GetCurrentTechnique()->Apply();
+
+				lastEffect = item.PartEffect;
+				lastMesh = item.Mesh;
+			}
+
+			// the base vertex is how parts find their vertices within the shared buffer
+			device->DrawIndexedPrimitives(PrimitiveType::TriangleList, part->m_vertexOffset, 0, part->m_numVertices, part->m_startIndex, part->m_primitiveCount);
+		}
+	}
+
+	namespace
+	{
+		// a vertex buffer, index buffer, or effect stored after the model in the XNB
+		struct SharedResource
+		{
+			enum ResourceType
+			{
+				Vertices,
+				Indices,
+				Material
+			};
+
+			ResourceType Type;
+
+			std::vector<VertexElement> Elements;
+			int Stride;
+			bool SixteenBitIndices;
+			int Count;
+			const byte* Data;
+
+			Effect* ResourceEffect;
+
+			// where the data ended up
+			VertexBuffer* VertexPage;
+			IndexBuffer* IndexPage;
+			int Base;
+		};
+
+		bool typeIs(Content::XnbReader* reader, int typeID, const char* readerName)
+		{
+			const char* name = reader->GetTypeReaderName(typeID);
+			return name != nullptr && strstr(name, readerName) != nullptr;
+		}
+
+		std::string readStringObject(Content::XnbReader* reader)
+		{
+			int typeID = reader->ReadTypeID();
+			if (typeID == 0)
+				return std::string();
+
+			if (typeIs(reader, typeID, "StringReader") == false)
+				throw Content::ContentException("Expected a string in the model");
+
+			return reader->ReadString();
+		}
+
+		void skipTag(Content::XnbReader* reader)
+		{
+			int typeID = reader->ReadTypeID();
+			if (typeID == 0)
+				return;
+
+			// there's no way to skip an object without knowing how to read it
+			if (typeIs(reader, typeID, "StringReader"))
+				reader->ReadString();
+			else
+				throw Content::ContentException("Model tags can only be strings");
+		}
+
+		ModelBone* readBoneReference(Content::Stream* stream, std::vector<ModelBone>& bones)
+		{
+			int index;
+			if (bones.size() < 255)
+				index = stream->ReadByte();
+			else
+				index = stream->ReadInt32();
+
+			if (index == 0)
+				return nullptr;
+			if (index > (int)bones.size())
+				throw Content::ContentException("Invalid bone reference");
+
+			return &bones[index - 1];
+		}
+
+		const byte* readInPlace(Content::MemoryStream* stream, int size)
+		{
+			// the file is mapped, so the data can go straight from the file to the GPU
+			const byte* data = size >= 0 ? stream->ReadInPlace(size) : nullptr;
+			if (data == nullptr)
+				throw Content::ContentException("Unexpected end of model data");
+
+			return data;
+		}
+
+		void readVertexElements(Content::Stream* stream, SharedResource& resource)
+		{
+			resource.Stride = stream->ReadInt32();
+
+			int numElements = stream->ReadInt32();
+			if (numElements <= 0 || numElements > 16)
+				throw Content::ContentException("Invalid vertex declaration");
+
+			for (int i = 0; i < numElements; i++)
+			{
+				VertexElement element;
+				element.Offset = stream->ReadInt32();
+				int format = stream->ReadInt32();
+				int usage = stream->ReadInt32();
+				element.UsageIndex = stream->ReadInt32();
+
+				// the XNA enums are numbered differently
+				switch (format)
+				{
+				case 0: element.ElementFormat = VertexElementFormat::Single; break;
+				case 1: element.ElementFormat = VertexElementFormat::Vector2; break;
+				case 2: element.ElementFormat = VertexElementFormat::Vector3; break;
+				case 3: element.ElementFormat = VertexElementFormat::Vector4; break;
+				case 4: element.ElementFormat = VertexElementFormat::Color; break;
+				case 5: element.ElementFormat = VertexElementFormat::Byte4; break;
+				case 6: element.ElementFormat = VertexElementFormat::Short2; break;
+				case 7: element.ElementFormat = VertexElementFormat::Short4; break;
+				default:
+					throw Content::ContentException("Unsupported vertex element format");
+				}
+
+				switch (usage)
+				{
+				case 0: element.ElementUsage = VertexElementUsage::Position; break;
+				case 1: element.ElementUsage = VertexElementUsage::Color; break;
+				case 2: element.ElementUsage = VertexElementUsage::TextureCoordinate; break;
+				case 3: element.ElementUsage = VertexElementUsage::Normal; break;
+				case 6: element.ElementUsage = VertexElementUsage::BlendIndices; break;
+				case 7: element.ElementUsage = VertexElementUsage::BlendWeight; break;
+				default:
+					throw Content::ContentException("Unsupported vertex element usage");
+				}
+
+				resource.Elements.push_back(element);
+			}
+
+			// VertexDeclaration works out the stride from the last element, so padding isn't possible
+			VertexDeclaration declaration(&resource.Elements[0], numElements);
+			if (declaration.GetStride() != resource.Stride)
+				throw Content::ContentException("Vertex declarations with padding aren't supported");
+		}
+
+		Effect* readBasicEffect(Content::XnbReader* reader)
+		{
+			Content::Stream* stream = reader->GetStream();
+
+			BasicEffect* effect = new BasicEffect(GraphicsDevice::GetDevice());
+
+			try
+			{
+				// the texture is an external reference, relative to the model
+				std::string texture = reader->ReadString();
+				if (texture.empty() == false)
+				{
+					std::string path = reader->GetName();
+					std::string::size_type slash = path.find_last_of("/\\");
+					path = (slash == std::string::npos ? std::string() : path.substr(0, slash + 1)) + texture;
+
+					effect->SetTexture(reader->GetContentManager()->Load<Texture2D>(path.c_str()));
+					effect->IsTextureEnabled(true);
+				}
+
+				Vector3 diffuse;
+				diffuse.X = stream->ReadFloat();
+				diffuse.Y = stream->ReadFloat();
+				diffuse.Z = stream->ReadFloat();
+				effect->SetDiffuse(diffuse);
+
+				// no lighting yet, so the emissive color, specular color and specular power are ignored
+				for (int i = 0; i < 7; i++)
+					stream->ReadFloat();
+
+				effect->SetAlpha(stream->ReadFloat());
+				effect->IsVertexColorEnabled(stream->ReadByte() != 0);
+			}
+			catch (...)
+			{
+				delete effect;
+				throw;
+			}
+
+			return effect;
+		}
+
+		bool sameDeclaration(const SharedResource& a, const SharedResource& b)
+		{
+			if (a.Stride != b.Stride || a.Elements.size() != b.Elements.size())
+				return false;
+
+			for (std::vector<VertexElement>::size_type i = 0; i < a.Elements.size(); i++)
+			{
+				const VertexElement& e1 = a.Elements[i];
+				const VertexElement& e2 = b.Elements[i];
+				if (e1.Offset != e2.Offset || e1.ElementFormat != e2.ElementFormat ||
+					e1.ElementUsage != e2.ElementUsage || e1.UsageIndex != e2.UsageIndex)
+					return false;
+			}
+
+			return true;
+		}
+
+		// Copies every vertex buffer with the same declaration (and every index buffer with the same
+		// index size) into one big buffer, so drawing the model doesn't have to keep switching buffers.
+		void createPages(Model* model, std::vector<SharedResource>& resources,
+			std::vector<VertexBuffer*>& vertexBuffers, std::vector<IndexBuffer*>& indexBuffers)
+		{
+			GraphicsDevice* device = GraphicsDevice::GetDevice();
+
+			for (std::vector<SharedResource>::size_type i = 0; i < resources.size(); i++)
+			{
+				SharedResource& first = resources[i];
+				if (first.Type != SharedResource::Vertices || first.VertexPage != nullptr)
+					continue;
+
+				int total = 0;
+				for (std::vector<SharedResource>::size_type j = i; j < resources.size(); j++)
+				{
+					if (resources[j].Type == SharedResource::Vertices && resources[j].VertexPage == nullptr && sameDeclaration(first, resources[j]))
+						total += resources[j].Count;
+				}
+
+				VertexDeclaration declaration(&first.Elements[0], (int)first.Elements.size());
+				VertexBuffer* page = new VertexBuffer(device, &declaration, total, BufferUsage::WriteOnly);
+				vertexBuffers.push_back(page);
+
+				int base = 0;
+				for (std::vector<SharedResource>::size_type j = i; j < resources.size(); j++)
+				{
+					SharedResource& r = resources[j];
+					if (r.Type == SharedResource::Vertices && r.VertexPage == nullptr && sameDeclaration(first, r))
+					{
+						page->SetData(base * r.Stride, const_cast<byte*>(r.Data), r.Count, r.Stride, r.Stride);
+						r.VertexPage = page;
+						r.Base = base;
+						base += r.Count;
+					}
+				}
+			}
+
+			for (int sixteenBits = 0; sixteenBits < 2; sixteenBits++)
+			{
+				int total = 0;
+				for (std::vector<SharedResource>::size_type i = 0; i < resources.size(); i++)
+				{
+					if (resources[i].Type == SharedResource::Indices && resources[i].SixteenBitIndices == (sixteenBits == 1))
+						total += resources[i].Count;
+				}
+
+				if (total == 0)
+					continue;
+
+				IndexElementSize elementSize = sixteenBits == 1 ? IndexElementSize::SixteenBits : IndexElementSize::ThirtyTwoBits;
+				IndexBuffer* page = new IndexBuffer(device, elementSize, total, BufferUsage::WriteOnly);
+				indexBuffers.push_back(page);
+
+				int base = 0;
+				for (std::vector<SharedResource>::size_type i = 0; i < resources.size(); i++)
+				{
+					SharedResource& r = resources[i];
+					if (r.Type == SharedResource::Indices && r.SixteenBitIndices == (sixteenBits == 1))
+					{
+						page->SetData(base * (int)elementSize, const_cast<byte*>(r.Data), r.Count);
+						r.IndexPage = page;
+						r.Base = base;
+						base += r.Count;
+					}
+				}
+			}
+		}
+	}
+
+	void* ModelLoader::Read(Content::XnbReader* reader)
+	{
+		assert(reader != nullptr);
+
+		Content::MemoryStream* stream = reader->GetStream();
+
+		reader->ReadTypeID();
+
+		Model* model = new Model();
+
+		try
+		{
+			// bones
+			int numBones = stream->ReadInt32();
+			model->m_bones.resize(numBones);
+			for (int i = 0; i < numBones; i++)
+			{
+				ModelBone& bone = model->m_bones[i];
+				bone.m_index = i;
+				bone.m_name = readStringObject(reader);
+				for (int j = 0; j < 16; j++)
+					bone.m_transform.C[j] = stream->ReadFloat();
+				bone.m_parent = nullptr;
+			}
+
+			for (int i = 0; i < numBones; i++)
+			{
+				ModelBone& bone = model->m_bones[i];
+				bone.m_parent = readBoneReference(stream, model->m_bones);
+
+				int numChildren = stream->ReadInt32();
+				for (int j = 0; j < numChildren; j++)
+					bone.m_children.push_back(readBoneReference(stream, model->m_bones));
+			}
+
+			// meshes. The parts refer to the shared resources, which haven't been read yet.
+			struct PartResources
+			{
+				int VertexBuffer, IndexBuffer, Effect;
+			};
+			std::vector<PartResources> partResources;
+
+			int numMeshes = stream->ReadInt32();
+			model->m_meshes.resize(numMeshes);
+			for (int i = 0; i < numMeshes; i++)
+			{
+				ModelMesh& mesh = model->m_meshes[i];
+				mesh.m_name = readStringObject(reader);
+				mesh.m_parentBone = readBoneReference(stream, model->m_bones);
+				mesh.m_boundingSphere.Center.X = stream->ReadFloat();
+				mesh.m_boundingSphere.Center.Y = stream->ReadFloat();
+				mesh.m_boundingSphere.Center.Z = stream->ReadFloat();
+				mesh.m_boundingSphere.Radius = stream->ReadFloat();
+				skipTag(reader);
+
+				int numParts = stream->ReadInt32();
+				mesh.m_parts.resize(numParts);
+				for (int j = 0; j < numParts; j++)
+				{
+					ModelMeshPart& part = mesh.m_parts[j];
+					part.m_mesh = &mesh;
+					part.m_vertexOffset = stream->ReadInt32();
+					part.m_numVertices = stream->ReadInt32();
+					part.m_startIndex = stream->ReadInt32();
+					part.m_primitiveCount = stream->ReadInt32();
+					skipTag(reader);
+
+					PartResources resources;
+					resources.VertexBuffer = reader->ReadSharedResourceIndex();
+					resources.IndexBuffer = reader->ReadSharedResourceIndex();
+					resources.Effect = reader->ReadSharedResourceIndex();
+					partResources.push_back(resources);
+				}
+			}
+
+			model->m_root = readBoneReference(stream, model->m_bones);
+			skipTag(reader);
+
+			// now the shared resources
+			std::vector<SharedResource> resources(reader->GetNumSharedResources());
+			for (std::vector<SharedResource>::size_type i = 0; i < resources.size(); i++)
+			{
+				SharedResource& r = resources[i];
+				r.ResourceEffect = nullptr;
+				r.VertexPage = nullptr;
+				r.IndexPage = nullptr;
+				r.Base = 0;
+				r.Count = 0;
+				r.Stride = 0;
+				r.SixteenBitIndices = false;
+				r.Data = nullptr;
+
+				int typeID = reader->ReadTypeID();
+				if (typeIs(reader, typeID, "VertexBufferReader"))
+				{
+					r.Type = SharedResource::Vertices;
+					readVertexElements(stream, r);
+					r.Count = stream->ReadInt32();
+					r.Data = readInPlace(stream, r.Count * r.Stride);
+				}
+				else if (typeIs(reader, typeID, "IndexBufferReader"))
+				{
+					r.Type = SharedResource::Indices;
+					r.SixteenBitIndices = stream->ReadByte() != 0;
+					int size = stream->ReadInt32();
+					r.Count = size / (r.SixteenBitIndices ? 2 : 4);
+					r.Data = readInPlace(stream, size);
+				}
+				else if (typeIs(reader, typeID, "BasicEffectReader"))
+				{
+					r.Type = SharedResource::Material;
+					r.ResourceEffect = readBasicEffect(reader);
+					model->m_effects.push_back(r.ResourceEffect);
+				}
+				else
+				{
+					const char* name = reader->GetTypeReaderName(typeID);
+					throw Content::ContentException(std::string("Unsupported model resource: ") + (name != nullptr ? name : "null"));
+				}
+			}
+
+			createPages(model, resources, model->m_vertexBuffers, model->m_indexBuffers);
+
+			// hook the parts up to their pages
+			int partIndex = 0;
+			for (int i = 0; i < numMeshes; i++)
+			{
+				ModelMesh& mesh = model->m_meshes[i];
+				for (std::vector<ModelMeshPart>::size_type j = 0; j < mesh.m_parts.size(); j++, partIndex++)
+				{
+					ModelMeshPart& part = mesh.m_parts[j];
+					const PartResources& indices = partResources[partIndex];
+
+					int numResources = (int)resources.size();
+					if (indices.VertexBuffer < 0 || indices.VertexBuffer >= numResources || resources[indices.VertexBuffer].Type != SharedResource::Vertices ||
+						indices.IndexBuffer < 0 || indices.IndexBuffer >= numResources || resources[indices.IndexBuffer].Type != SharedResource::Indices ||
+						indices.Effect >= numResources || (indices.Effect >= 0 && resources[indices.Effect].Type != SharedResource::Material))
+						throw Content::ContentException("Invalid model part");
+
+					const SharedResource& vertices = resources[indices.VertexBuffer];
+					const SharedResource& triangles = resources[indices.IndexBuffer];
+
+					part.m_vertexBuffer = vertices.VertexPage;
+					part.m_vertexOffset += vertices.Base;
+					part.m_indexBuffer = triangles.IndexPage;
+					part.m_startIndex += triangles.Base;
+					part.m_effect = indices.Effect >= 0 ? resources[indices.Effect].ResourceEffect : nullptr;
+				}
+			}
+		}
+		catch (...)
+		{
+			delete model;
+			throw;
+		}
+
+		return model;
+	}
+
+	void ModelLoader::Destroy(void* resource)
+	{
+		delete static_cast<Model*>(resource);
+	}
+}
+}
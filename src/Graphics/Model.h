@@ -0,0 +1,158 @@
+#ifndef NXNA_GRAPHICS_MODEL_H
+#define NXNA_GRAPHICS_MODEL_H
+
+#include <vector>
+#include <string>
+#include "../NxnaConfig.h"
+#include "../Matrix.h"
+#include "../BoundingSphere.h"
+#include "../Content/ContentManager.h"
+
+NXNA_DISABLE_OVERRIDE_WARNING
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class Effect;
+	class Texture2D;
+	class VertexBuffer;
+	class IndexBuffer;
+	class ModelMesh;
+	class Model;
+
+	class ModelBone
+	{
+		friend class ModelLoader;
+		friend class Model;
+
+		std::string m_name;
+		int m_index;
+		Matrix m_transform;
+		ModelBone* m_parent;
+		std::vector<ModelBone*> m_children;
+
+	public:
+		const char* GetName() { return m_name.c_str(); }
+		int GetIndex() { return m_index; }
+		ModelBone* GetParent() { return m_parent; }
+		int GetNumChildren() { return (int)m_children.size(); }
+		ModelBone* GetChild(int index) { return m_children[index]; }
+
+		// relative to the parent bone
+		const Matrix& GetTransform() { return m_transform; }
+		void SetTransform(const Matrix& transform) { m_transform = transform; }
+	};
+
+	class ModelMeshPart
+	{
+		friend class ModelLoader;
+		friend class ModelMesh;
+		friend class Model;
+
+		ModelMesh* m_mesh;
+		Effect* m_effect;
+
+		// The loader packs the buffers of the whole model into a few big ones, so these
+		// usually point into the middle of buffers shared with other parts.
+		VertexBuffer* m_vertexBuffer;
+		IndexBuffer* m_indexBuffer;
+		int m_vertexOffset;
+		int m_numVertices;
+		int m_startIndex;
+		int m_primitiveCount;
+
+	public:
+		Effect* GetEffect() { return m_effect; }
+		void SetEffect(Effect* effect) { m_effect = effect; }
+
+		VertexBuffer* GetVertexBuffer() { return m_vertexBuffer; }
+		IndexBuffer* GetIndexBuffer() { return m_indexBuffer; }
+		int GetVertexOffset() { return m_vertexOffset; }
+		int GetNumVertices() { return m_numVertices; }
+		int GetStartIndex() { return m_startIndex; }
+		int GetPrimitiveCount() { return m_primitiveCount; }
+	};
+
+	class ModelMesh
+	{
+		friend class ModelLoader;
+		friend class Model;
+
+		std::string m_name;
+		ModelBone* m_parentBone;
+		BoundingSphere m_boundingSphere;
+		std::vector<ModelMeshPart> m_parts;
+
+	public:
+		const char* GetName() { return m_name.c_str(); }
+		ModelBone* GetParentBone() { return m_parentBone; }
+		const BoundingSphere& GetBoundingSphere() { return m_boundingSphere; }
+
+		int GetNumMeshParts() { return (int)m_parts.size(); }
+		ModelMeshPart* GetMeshPart(int index) { return &m_parts[index]; }
+
+		// Draws each part with its current effect. The effects' parameters need to be set first.
+		void Draw();
+	};
+
+	class Model
+	{
+		friend class ModelLoader;
+
+		std::vector<ModelBone> m_bones;
+		std::vector<ModelMesh> m_meshes;
+		ModelBone* m_root;
+
+		// everything the model owns. The textures belong to the ContentManager.
+		std::vector<Effect*> m_effects;
+		std::vector<VertexBuffer*> m_vertexBuffers;
+		std::vector<IndexBuffer*> m_indexBuffers;
+
+		struct DrawItem
+		{
+			ModelMesh* Mesh;
+			ModelMeshPart* Part;
+			Effect* PartEffect;
+			Texture2D* Texture;
+		};
+
+		std::vector<DrawItem> m_drawOrder;
+		std::vector<Matrix> m_absoluteTransforms;
+
+	public:
+		~Model();
+
+		ModelBone* GetRoot() { return m_root; }
+		int GetNumBones() { return (int)m_bones.size(); }
+		ModelBone* GetBone(int index) { return &m_bones[index]; }
+		ModelBone* GetBone(const char* name);
+
+		int GetNumMeshes() { return (int)m_meshes.size(); }
+		ModelMesh* GetMesh(int index) { return &m_meshes[index]; }
+		ModelMesh* GetMesh(const char* name);
+
+		// destination needs room for GetNumBones() matrices
+		void CopyAbsoluteBoneTransformsTo(Matrix* destination);
+
+		// Draws every part, sorted so that parts with the same effect, texture and buffers are
+		// drawn together. BasicEffects get their world, view and projection set automatically.
+		void Draw(const Matrix& world, const Matrix& view, const Matrix& projection);
+
+	private:
+		Model() { }
+	};
+
+	class ModelLoader : public Content::IContentReader
+	{
+	public:
+		virtual const char* GetTypeName() override { return typeid(Model).name(); }
+		virtual void* Read(Content::XnbReader* reader) override;
+		virtual void Destroy(void* resource) override;
+	};
+}
+}
+
+NXNA_ENABLE_OVERRIDE_WARNING
+
+#endif // NXNA_GRAPHICS_MODEL_H
@@ -0,0 +1,103 @@
+#include "OpenGL.h"
+#include "GlGpuTimer.h"
+
+#ifndef USING_OPENGLES
+
+namespace Nxna
+{
+namespace Graphics
+{
+namespace OpenGl
+{
+	GlGpuTimer::GlGpuTimer()
+	{
+		glGenQueries(FrameLatency * MaxScopesPerFrame * 2, &m_queries[0][0]);
+
+		for (int i = 0; i < FrameLatency; i++)
+		{
+			m_numScopes[i] = 0;
+			m_frameNumbers[i] = 0;
+		}
+
+		m_currentFrame = 0;
+		m_depth = 0;
+	}
+
+	GlGpuTimer::~GlGpuTimer()
+	{
+		glDeleteQueries(FrameLatency * MaxScopesPerFrame * 2, &m_queries[0][0]);
+	}
+
+	bool GlGpuTimer::Begin(const char* name, uint64_t issueTicks)
+	{
+		int index = m_numScopes[m_currentFrame];
+		if (index >= MaxScopesPerFrame || m_depth >= MaxDepth)
+			return false;
+
+		m_pending[m_currentFrame][index].Name = name;
+		m_pending[m_currentFrame][index].IssueTicks = issueTicks;
+		m_numScopes[m_currentFrame]++;
+
+		m_open[m_depth++] = index;
+
+		glQueryCounter(m_queries[m_currentFrame][index * 2], GL_TIMESTAMP);
+
+		return true;
+	}
+
+	void GlGpuTimer::End()
+	{
+		if (m_depth == 0)
+			return;
+
+		int index = m_open[--m_depth];
+		glQueryCounter(m_queries[m_currentFrame][index * 2 + 1], GL_TIMESTAMP);
+	}
+
+	void GlGpuTimer::EndFrame(unsigned int frameNumber, std::vector<Utils::GpuProfileEvent>& results)
+	{
+		// a scope that's still open when the frame ends can't be matched up, so it's dropped
+		int numScopes = m_numScopes[m_currentFrame];
+		while (m_depth > 0)
+		{
+			int index = m_open[--m_depth];
+			if (index < numScopes)
+				numScopes = index;
+		}
+		m_numScopes[m_currentFrame] = numScopes;
+
+		m_frameNumbers[m_currentFrame] = frameNumber;
+		m_currentFrame = (m_currentFrame + 1) % FrameLatency;
+
+		// the queries in this slot were issued FrameLatency - 1 frames ago, so they should be done.
+		// If they aren't then skip them rather than stall. The end query is always issued after
+		// the begin query, so if it's done then they both are.
+		for (int i = 0; i < m_numScopes[m_currentFrame]; i++)
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(m_queries[m_currentFrame][i * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (available == GL_FALSE)
+				continue;
+
+			GLuint64 begin, end;
+			glGetQueryObjectui64v(m_queries[m_currentFrame][i * 2], GL_QUERY_RESULT, &begin);
+			glGetQueryObjectui64v(m_queries[m_currentFrame][i * 2 + 1], GL_QUERY_RESULT, &end);
+
+			Utils::GpuProfileEvent e;
+			e.Name = m_pending[m_currentFrame][i].Name;
+			e.IssueTicks = m_pending[m_currentFrame][i].IssueTicks;
+			e.StartNanoseconds = begin;
+			e.Nanoseconds = end > begin ? end - begin : 0;
+			e.FrameNumber = m_frameNumbers[m_currentFrame];
+
+			results.push_back(e);
+		}
+
+		m_numScopes[m_currentFrame] = 0;
+	}
+}
+}
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef NXNA_GRAPHICS_OPENGL_GLGPUTIMER_H
+#define NXNA_GRAPHICS_OPENGL_GLGPUTIMER_H
+
+#include "../../NxnaConfig.h"
+#include "../../Utils/Profiler.h"
+
+NXNA_DISABLE_OVERRIDE_WARNING
+
+namespace Nxna
+{
+namespace Graphics
+{
+namespace OpenGl
+{
+	// Times GPU work with a pair of GL_TIMESTAMP queries for each scope. GL_TIME_ELAPSED
+	// queries can't be nested, but timestamps can. Results are read back
+	// a few frames later so that we never stall waiting on the GPU.
+	class GlGpuTimer : public Utils::IGpuTimer
+	{
+		static const int FrameLatency = 4;
+		static const int MaxScopesPerFrame = 32;
+		static const int MaxDepth = 8;
+
+		struct PendingQuery
+		{
+			const char* Name;
+			uint64_t IssueTicks;
+		};
+
+		// each scope has a begin query and then an end query
+		unsigned int m_queries[FrameLatency][MaxScopesPerFrame * 2];
+		PendingQuery m_pending[FrameLatency][MaxScopesPerFrame];
+		int m_numScopes[FrameLatency];
+		unsigned int m_frameNumbers[FrameLatency];
+		int m_currentFrame;
+
+		// the scopes that have begun but not ended yet
+		int m_open[MaxDepth];
+		int m_depth;
+
+	public:
+		GlGpuTimer();
+		virtual ~GlGpuTimer();
+
+		virtual bool Begin(const char* name, uint64_t issueTicks) override;
+		virtual void End() override;
+		virtual void EndFrame(unsigned int frameNumber, std::vector<Utils::GpuProfileEvent>& results) override;
+	};
+}
+}
+}
+
+NXNA_ENABLE_OVERRIDE_WARNING
+
+#endif // NXNA_GRAPHICS_OPENGL_GLGPUTIMER_H
@@ -30,21 +30,31 @@ namespace OpenGl
 
 	void GlIndexBuffer::SetData(int offsetInBytes, void* data, int indexCount)
 	{
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer);
+		int totalIndexCount = indexCount + offsetInBytes / (int)m_elementSize;
+
+		if (totalIndexCount > m_capacity)
+		{
+			// growing the buffer throws away what was in it, so Reserve() should have been called first
+			assert(offsetInBytes == 0);
 
-		if (offsetInBytes == 0)
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer);
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * (int)m_elementSize, data, GL_STATIC_DRAW);
-		else
-			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offsetInBytes, indexCount * (int)m_elementSize, data);
 
-		int totalIndexCount = indexCount + offsetInBytes / (int)m_elementSize;
+			m_capacity = totalIndexCount;
+			m_indexCount = 0;
 
 #ifndef NDEBUG
-		if (m_indices == nullptr)
+			delete[] m_indices;
 			m_indices = new int[totalIndexCount];
+#endif
+		}
 		else
-			assert(totalIndexCount <= m_indexCount);
+		{
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer);
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offsetInBytes, indexCount * (int)m_elementSize, data);
+		}
 
+#ifndef NDEBUG
 		for (int i = 0; i < indexCount; i++)
 		{
 			if (m_elementSize == IndexElementSize::SixteenBits)
@@ -54,7 +64,22 @@ namespace OpenGl
 		}
 #endif
 
-		m_indexCount = totalIndexCount;
+		if (totalIndexCount > m_indexCount)
+			m_indexCount = totalIndexCount;
+	}
+
+	void GlIndexBuffer::Reserve(int indexCount)
+	{
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_buffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * (int)m_elementSize, nullptr, GL_STATIC_DRAW);
+
+		m_capacity = indexCount;
+		m_indexCount = 0;
+
+#ifndef NDEBUG
+		delete[] m_indices;
+		m_indices = new int[indexCount];
+#endif
 	}
 
 	void GlIndexBuffer::Bind() const
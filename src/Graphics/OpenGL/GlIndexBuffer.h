@@ -27,6 +27,7 @@ namespace OpenGl
 		virtual ~GlIndexBuffer();
 
 		virtual void SetData(int offsetInBytes, void* data, int indexCount) override;
+		virtual void Reserve(int indexCount) override;
 
 		void Bind() const;
 
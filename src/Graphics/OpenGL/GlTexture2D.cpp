@@ -35,6 +35,8 @@ namespace OpenGl
 	{
 		int mipWidth = m_width >> level;
 		int mipHeight = m_height >> level;
+		if (mipWidth < 1) mipWidth = 1;
+		if (mipHeight < 1) mipHeight = 1;
 
 		glBindTexture(GL_TEXTURE_2D, m_glTex);
 
@@ -81,6 +83,40 @@ namespace OpenGl
 #endif
 			glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG, mipWidth, mipHeight, 0, length, pixels);
 		}
+		else if (m_format == SurfaceFormat::Etc1 || m_format == SurfaceFormat::Etc2Rgb || m_format == SurfaceFormat::Etc2Rgba)
+		{
+#ifndef GL_ETC1_RGB8_OES
+#define GL_ETC1_RGB8_OES 0x8D64
+#endif
+
+#ifndef GL_COMPRESSED_RGB8_ETC2
+#define GL_COMPRESSED_RGB8_ETC2 0x9274
+#endif
+
+#ifndef GL_COMPRESSED_RGBA8_ETC2_EAC
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#endif
+
+			const GraphicsDeviceCapabilities* caps = m_device->GetCaps();
+
+			// ETC2 decoders can read ETC1 data, so that's used when there's no ETC1 extension
+			if (m_format == SurfaceFormat::Etc1 && caps->SupportsEtc1TextureCompression && caps->SupportsEtc2TextureCompression == false)
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_ETC1_RGB8_OES, mipWidth, mipHeight, 0, length, pixels);
+			else if (m_format != SurfaceFormat::Etc2Rgba && caps->SupportsEtc2TextureCompression)
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGB8_ETC2, mipWidth, mipHeight, 0, length, pixels);
+			else if (m_format == SurfaceFormat::Etc2Rgba && caps->SupportsEtc2TextureCompression)
+				glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGBA8_ETC2_EAC, mipWidth, mipHeight, 0, length, pixels);
+			else
+			{
+				byte* converted;
+				if (m_format == SurfaceFormat::Etc2Rgba)
+					converted = DecompressEtc2Rgba(pixels, mipWidth, mipHeight);
+				else
+					converted = DecompressEtc2Rgb(pixels, mipWidth, mipHeight);
+				glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mipWidth, mipHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, converted);
+				delete[] converted;
+			}
+		}
 		else
 		{
 			glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, mipWidth, mipHeight, 0,
@@ -98,6 +134,33 @@ namespace OpenGl
 		GlException::ThrowIfError(__FILE__, __LINE__);
 	}
 
+	void GlTexture2D::SetData(int level, const Rectangle& rect, byte* pixels, int length)
+	{
+		glBindTexture(GL_TEXTURE_2D, m_glTex);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexSubImage2D(GL_TEXTURE_2D, level, rect.X, rect.Y, rect.Width, rect.Height,
+			GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	void GlTexture2D::GenerateMipmaps()
+	{
+		glBindTexture(GL_TEXTURE_2D, m_glTex);
+		glGenerateMipmap(GL_TEXTURE_2D);
+
+		if (m_hasMipmaps == false)
+		{
+			m_hasMipmaps = true;
+
+			// reapply the sampler state to turn on mipmapping
+			SetSamplerState(&m_samplerState);
+		}
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
 	void GlTexture2D::SetSamplerState(const SamplerState* state)
 	{
 		glBindTexture(GL_TEXTURE_2D, m_glTex);
@@ -31,6 +31,8 @@ namespace OpenGl
 		virtual ~GlTexture2D();
 
 		virtual void SetData(int level, byte* pixels, int length) override;
+		virtual void SetData(int level, const Rectangle& rect, byte* pixels, int length) override;
+		virtual void GenerateMipmaps() override;
 
 		unsigned int GetGlTexture() { return m_glTex; }
 
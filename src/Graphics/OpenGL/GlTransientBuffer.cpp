@@ -0,0 +1,217 @@
+#include <cassert>
+#include <cstring>
+#include "OpenGL.h"
+#include "OpenGLDevice.h"
+#include "GlTransientBuffer.h"
+#include "../../MemoryAllocator.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+namespace OpenGl
+{
+	GlTransientBuffer::GlTransientBuffer(unsigned int target, int size)
+	{
+		m_target = target;
+		m_size = 0;
+		m_position = 0;
+		m_used = 0;
+		m_numFrames = 0;
+		m_frameBytes = 0;
+		m_uploadedThisFrame = 0;
+		m_uploadedLastFrame = 0;
+		m_generation = 0;
+		m_mappedOffset = 0;
+		m_mappedBytes = 0;
+		m_mapped = nullptr;
+
+#ifndef USING_OPENGLES
+		m_useFences = GLEW_VERSION_3_2 || GLEW_ARB_sync;
+		m_useMapping = GLEW_VERSION_3_0 || GLEW_ARB_map_buffer_range;
+#else
+		m_useFences = false;
+		m_useMapping = false;
+#endif
+
+		glGenBuffers(1, &m_buffer);
+		orphan(size);
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	GlTransientBuffer::~GlTransientBuffer()
+	{
+#ifndef USING_OPENGLES
+		for (int i = 0; i < m_numFrames; i++)
+			glDeleteSync((GLsync)m_frames[i].Fence);
+#endif
+
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	int GlTransientBuffer::Upload(const void* data, int numBytes, int alignment)
+	{
+		if (m_useMapping)
+		{
+			int offset;
+			void* destination = Map(numBytes, alignment, &offset);
+			memcpy(destination, data, numBytes);
+			Unmap();
+
+			return offset;
+		}
+
+		int offset = allocate(numBytes, alignment);
+		glBufferSubData(m_target, offset, numBytes, data);
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+
+		return offset;
+	}
+
+	void* GlTransientBuffer::Map(int numBytes, int alignment, int* offset)
+	{
+		assert(m_mapped == nullptr);
+
+		m_mappedOffset = allocate(numBytes, alignment);
+		m_mappedBytes = numBytes;
+		*offset = m_mappedOffset;
+
+#ifndef USING_OPENGLES
+		if (m_useMapping)
+		{
+			// nothing the GPU is using gets handed out again, so there's no need for GL to check.
+			// Without fences it's only sure of that after an orphan, so it has to check.
+			GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+			if (m_useFences)
+				access |= GL_MAP_UNSYNCHRONIZED_BIT;
+
+			m_mapped = glMapBufferRange(m_target, m_mappedOffset, numBytes, access);
+			if (m_mapped == nullptr)
+				throw GlException(glGetError(), __FILE__, __LINE__);
+
+			return m_mapped;
+		}
+#endif
+
+		m_mapped = NxnaTempMemoryPool::GetMemory(numBytes);
+		return m_mapped;
+	}
+
+	void GlTransientBuffer::Unmap()
+	{
+		assert(m_mapped != nullptr);
+
+#ifndef USING_OPENGLES
+		if (m_useMapping)
+		{
+			glUnmapBuffer(m_target);
+			m_mapped = nullptr;
+
+			GlException::ThrowIfError(__FILE__, __LINE__);
+			return;
+		}
+#endif
+
+		glBufferSubData(m_target, m_mappedOffset, m_mappedBytes, m_mapped);
+		NxnaTempMemoryPool::ReleaseMemory();
+		m_mapped = nullptr;
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	void GlTransientBuffer::EndFrame()
+	{
+		m_uploadedLastFrame = m_uploadedThisFrame;
+		m_uploadedThisFrame = 0;
+		m_generation++;
+
+#ifndef USING_OPENGLES
+		if (m_useFences && m_frameBytes > 0)
+		{
+			if (m_numFrames == MaxFramesInFlight)
+				waitForOldestFrame();
+
+			m_frames[m_numFrames].Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_frames[m_numFrames].Bytes = m_frameBytes;
+			m_numFrames++;
+			m_frameBytes = 0;
+		}
+#endif
+	}
+
+	int GlTransientBuffer::allocate(int numBytes, int alignment)
+	{
+		glBindBuffer(m_target, m_buffer);
+
+		// anything that doesn't fit before the end goes at the start, and the space left over is skipped
+		// (an offset of 0 doesn't mean it wrapped, since that's also where a fresh buffer starts)
+		int offset = (m_position + alignment - 1) / alignment * alignment;
+		bool wrapped = offset + numBytes > m_size;
+		if (wrapped)
+			offset = 0;
+
+		int needed = (wrapped ? m_size - m_position : offset - m_position) + numBytes;
+
+		while (m_used + needed > m_size && m_numFrames > 0)
+			waitForOldestFrame();
+
+		if (m_used + needed > m_size)
+		{
+			// This frame has used the whole buffer by itself (or there's no way to tell when the GPU
+			// is done with it). Anything already drawn keeps the old memory.
+			int size = m_size;
+			while (size < numBytes)
+				size *= 2;
+
+			orphan(size);
+			offset = 0;
+			needed = numBytes;
+		}
+
+		m_position = offset + numBytes;
+		m_used += needed;
+		m_frameBytes += needed;
+		m_uploadedThisFrame += numBytes;
+
+		return offset;
+	}
+
+	void GlTransientBuffer::waitForOldestFrame()
+	{
+#ifndef USING_OPENGLES
+		GLsync fence = (GLsync)m_frames[0].Fence;
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+		{ }
+		glDeleteSync(fence);
+
+		m_used -= m_frames[0].Bytes;
+
+		for (int i = 1; i < m_numFrames; i++)
+			m_frames[i - 1] = m_frames[i];
+		m_numFrames--;
+#endif
+	}
+
+	void GlTransientBuffer::orphan(int size)
+	{
+#ifndef USING_OPENGLES
+		// the old fences are for the old memory
+		for (int i = 0; i < m_numFrames; i++)
+			glDeleteSync((GLsync)m_frames[i].Fence);
+#endif
+		m_numFrames = 0;
+
+		glBindBuffer(m_target, m_buffer);
+		glBufferData(m_target, size, nullptr, GL_STREAM_DRAW);
+
+		m_size = size;
+		m_position = 0;
+		m_used = 0;
+		m_frameBytes = 0;
+		m_generation++;
+	}
+}
+}
+}
@@ -0,0 +1,86 @@
+#ifndef GRAPHICS_OPENGL_GLTRANSIENTBUFFER_H
+#define GRAPHICS_OPENGL_GLTRANSIENTBUFFER_H
+
+#include "../../NxnaConfig.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+namespace OpenGl
+{
+	// A big buffer that data only used for one draw is appended to, like the vertices and
+	// indices passed to DrawUserPrimitives(). The space is handed out in order and reused once
+	// the GPU is done with the frame that used it, which is checked with fences when they're
+	// available. Without fences (GLES 2) the buffer is orphaned whenever it fills up instead,
+	// which the driver handles by giving it new memory.
+	class GlTransientBuffer
+	{
+		static const int MaxFramesInFlight = 3;
+
+		struct Frame
+		{
+			void* Fence;
+			int Bytes;
+		};
+
+		unsigned int m_target;
+		unsigned int m_buffer;
+		int m_size;
+		int m_position;
+
+		// bytes still in use by frames the GPU might not be done with, including this one
+		int m_used;
+
+		// the oldest frame is first
+		Frame m_frames[MaxFramesInFlight];
+		int m_numFrames;
+		int m_frameBytes;
+
+		bool m_useFences;
+		bool m_useMapping;
+
+		int m_uploadedThisFrame;
+		int m_uploadedLastFrame;
+
+		// changes whenever space that was handed out might be handed out again
+		int m_generation;
+
+		// the space handed out by Map(), waiting for Unmap()
+		int m_mappedOffset;
+		int m_mappedBytes;
+		void* m_mapped;
+
+	public:
+		// target is GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER
+		GlTransientBuffer(unsigned int target, int size);
+		~GlTransientBuffer();
+
+		// Copies the data into the buffer and returns where it went. The buffer is left bound.
+		int Upload(const void* data, int numBytes, int alignment);
+
+		// For data that needs converting on the way in. Write numBytes to the returned pointer,
+		// then call Unmap(), which leaves the buffer bound.
+		void* Map(int numBytes, int alignment, int* offset);
+		void Unmap();
+
+		// Call once the frame's draws have all been submitted
+		void EndFrame();
+
+		int GetUploadedBytesLastFrame() { return m_uploadedLastFrame; }
+
+		// Anything uploaded is only good until this changes, which is at the end of
+		// the frame or when the buffer gets orphaned.
+		int GetGeneration() { return m_generation; }
+		unsigned int GetBuffer() { return m_buffer; }
+
+	private:
+		int allocate(int numBytes, int alignment);
+		void waitForOldestFrame();
+		void orphan(int size);
+	};
+}
+}
+}
+
+#endif // GRAPHICS_OPENGL_GLTRANSIENTBUFFER_H
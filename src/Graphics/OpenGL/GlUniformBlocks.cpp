@@ -0,0 +1,123 @@
+#include <cstring>
+#include "OpenGL.h"
+#include "OpenGLDevice.h"
+#include "GlUniformBlocks.h"
+#include "GlTransientBuffer.h"
+
+#ifndef USING_OPENGLES
+
+namespace Nxna
+{
+namespace Graphics
+{
+namespace OpenGl
+{
+	GlUniformBlocks::GlUniformBlocks()
+	{
+		GLint alignment, maxBindings;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		glGetIntegerv(GL_MAX_UNIFORM_BUFFER_BINDINGS, &maxBindings);
+
+		m_alignment = alignment > 0 ? alignment : 256;
+		m_maxBindings = maxBindings;
+
+		// most blocks are a few matrices, so this is a few thousand draws
+		m_ring = new GlTransientBuffer(GL_UNIFORM_BUFFER, 1024 * 1024);
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	GlUniformBlocks::~GlUniformBlocks()
+	{
+		delete m_ring;
+	}
+
+	int GlUniformBlocks::GetBinding(const std::string& signature, int sizeInBytes)
+	{
+		for (std::vector<Layout>::size_type i = 0; i < m_layouts.size(); i++)
+		{
+			if (m_layouts[i].Signature == signature)
+				return (int)i;
+		}
+
+		if ((int)m_layouts.size() >= m_maxBindings)
+			return -1;
+
+		Layout layout;
+		layout.Signature = signature;
+		layout.Size = sizeInBytes;
+		layout.Last.Generation = -1;
+		layout.Last.Offset = 0;
+		layout.Last.Data.resize(sizeInBytes);
+
+		m_layouts.push_back(layout);
+		m_boundOffsets.push_back(-1);
+
+		return (int)m_layouts.size() - 1;
+	}
+
+	void GlUniformBlocks::Set(int binding, const byte* data, Upload* last)
+	{
+		Layout& layout = m_layouts[binding];
+		int generation = m_ring->GetGeneration();
+
+		if (last->Data.size() != (size_t)layout.Size)
+		{
+			last->Data.resize(layout.Size);
+			last->Generation = -1;
+		}
+
+		// whoever used this layout last might have had the same data (most likely a shared block),
+		// and if not then maybe this effect uploaded it earlier in the frame
+		int offset;
+		if (layout.Last.Generation == generation && memcmp(&layout.Last.Data[0], data, layout.Size) == 0)
+		{
+			offset = layout.Last.Offset;
+		}
+		else if (last->Generation == generation && memcmp(&last->Data[0], data, layout.Size) == 0)
+		{
+			offset = last->Offset;
+		}
+		else
+		{
+			offset = m_ring->Upload(data, layout.Size, m_alignment);
+			generation = m_ring->GetGeneration();
+
+			// the old ranges aren't any good after an orphan, so the binding has to be set again
+			m_boundOffsets[binding] = -1;
+		}
+
+		layout.Last.Generation = generation;
+		layout.Last.Offset = offset;
+		memcpy(&layout.Last.Data[0], data, layout.Size);
+
+		last->Generation = generation;
+		last->Offset = offset;
+		memcpy(&last->Data[0], data, layout.Size);
+
+		if (m_boundOffsets[binding] != offset)
+		{
+			glBindBufferRange(GL_UNIFORM_BUFFER, binding, m_ring->GetBuffer(), offset, layout.Size);
+			m_boundOffsets[binding] = offset;
+		}
+	}
+
+	int GlUniformBlocks::GetGeneration()
+	{
+		return m_ring->GetGeneration();
+	}
+
+	void GlUniformBlocks::EndFrame()
+	{
+		m_ring->EndFrame();
+	}
+
+	int GlUniformBlocks::GetUploadedBytesLastFrame()
+	{
+		return m_ring->GetUploadedBytesLastFrame();
+	}
+}
+}
+}
+
+#endif
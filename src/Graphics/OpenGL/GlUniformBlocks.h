@@ -0,0 +1,73 @@
+#ifndef NXNA_GRAPHICS_OPENGL_GLUNIFORMBLOCKS_H
+#define NXNA_GRAPHICS_OPENGL_GLUNIFORMBLOCKS_H
+
+#include <vector>
+#include <string>
+#include "../../NxnaConfig.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+namespace OpenGl
+{
+	class GlTransientBuffer;
+
+	// Keeps the uniform buffers for effects' cbuffers (GL 3.1 and up). Each cbuffer is a std140
+	// uniform block, and its data is appended to a ring buffer whenever it changes, then the
+	// block's binding point is bound to that range.
+	//
+	// Every block with the same layout uses the same binding point, which remembers the last data
+	// uploaded for it. So a block like a camera block, which most effects have with the same values,
+	// is only written once a frame no matter how many effects use it.
+	class GlUniformBlocks
+	{
+	public:
+		// what an effect last uploaded for one of its blocks
+		struct Upload
+		{
+			int Generation;
+			int Offset;
+			std::vector<byte> Data;
+		};
+
+	private:
+		struct Layout
+		{
+			std::string Signature;
+			int Size;
+			Upload Last;
+		};
+
+		GlTransientBuffer* m_ring;
+		int m_alignment;
+		int m_maxBindings;
+
+		// indexed by binding point
+		std::vector<Layout> m_layouts;
+		std::vector<int> m_boundOffsets;
+
+	public:
+		GlUniformBlocks();
+		~GlUniformBlocks();
+
+		// Returns the binding point for blocks with this layout, or -1 if they've all been used.
+		// The signature is anything that's the same for the same layout, like the declaration.
+		int GetBinding(const std::string& signature, int sizeInBytes);
+
+		// Makes the block at the binding point hold the data, uploading it if needed.
+		// If it has to upload the buffer may get orphaned, which invalidates blocks that were set
+		// before, so check GetGeneration() before and after setting them all and set them again if
+		// it changed.
+		void Set(int binding, const byte* data, Upload* last);
+
+		int GetGeneration();
+
+		void EndFrame();
+		int GetUploadedBytesLastFrame();
+	};
+}
+}
+}
+
+#endif // NXNA_GRAPHICS_OPENGL_GLUNIFORMBLOCKS_H
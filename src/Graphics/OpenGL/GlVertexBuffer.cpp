@@ -1,8 +1,10 @@
 #include <cassert>
+#include <cstring>
 #include "OpenGL.h"
 #include "OpenGLDevice.h"
 #include "GlVertexBuffer.h"
 #include "../VertexDeclaration.h"
+#include "../GraphicsDeviceCapabilities.h"
 
 namespace Nxna
 {
@@ -15,6 +17,8 @@ namespace OpenGl
 	{
 		m_dynamic = dynamic;
 		m_vertexCount = vertexCount;
+		m_allocatedBytes = 0;
+		m_keepCopy = dynamic && device->GetCaps()->SupportsInstancing == false;
 
 		glGenBuffers(1, &m_buffer);
 
@@ -25,12 +29,35 @@ namespace OpenGl
 	{
 		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
 
-		if (offsetInBytes == 0)
+		int capacity = m_declaration.GetStride() * m_vertexCount;
+
+		// dynamic buffers are replaced every time they're filled, so they only need to be as big as the data
+		if (offsetInBytes == 0 && (m_dynamic || numBytes >= capacity))
+		{
 			glBufferData(GL_ARRAY_BUFFER, numBytes, data, GL_STATIC_DRAW);
+			m_allocatedBytes = numBytes;
+		}
 		else
+		{
+			// Make room for the whole buffer before writing part of it. Otherwise the
+			// first write would decide how big the buffer is.
+			if (offsetInBytes + numBytes > m_allocatedBytes)
+			{
+				m_allocatedBytes = offsetInBytes + numBytes > capacity ? offsetInBytes + numBytes : capacity;
+				glBufferData(GL_ARRAY_BUFFER, m_allocatedBytes, nullptr, GL_STATIC_DRAW);
+			}
+
 			glBufferSubData(GL_ARRAY_BUFFER, offsetInBytes, numBytes, data);
+		}
 
 		GlException::ThrowIfError(__FILE__, __LINE__);
+
+		if (m_keepCopy)
+		{
+			if ((int)m_copy.size() < offsetInBytes + numBytes)
+				m_copy.resize(offsetInBytes + numBytes);
+			memcpy(&m_copy[offsetInBytes], data, numBytes);
+		}
 	}
 
 	void GlVertexBuffer::Bind() const
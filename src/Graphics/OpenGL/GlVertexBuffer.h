@@ -1,6 +1,7 @@
 #ifndef GRAPHICS_OPENGL_GLVERTEXBUFFER_H
 #define GRAPHICS_OPENGL_GLVERTEXBUFFER_H
 
+#include <vector>
 #include "../VertexBuffer.h"
 #include "../VertexDeclaration.h"
 #include "../IVertexBufferPimpl.h"
@@ -19,12 +20,23 @@ namespace OpenGl
 		unsigned int m_buffer;
 		VertexDeclaration m_declaration;
 		int m_vertexCount;
+		int m_allocatedBytes;
+
+		// Without hardware instancing, instance data has to be fed to OpenGL one instance
+		// at a time, so dynamic buffers keep a copy of their data on that kind of device.
+		bool m_keepCopy;
+		std::vector<byte> m_copy;
 
 	public:
 		GlVertexBuffer(bool dynamic, OpenGlDevice* device, const VertexDeclaration* vertexDeclaration, int vertexCount, BufferUsage usage);
 
 		void Bind() const;
 
+		const VertexDeclaration* GetDeclaration() const { return &m_declaration; }
+
+		// returns nullptr unless the buffer keeps a copy of its data
+		const byte* GetCopy() const { return m_keepCopy && m_copy.empty() == false ? &m_copy[0] : nullptr; }
+
 	protected:
 		virtual void SetData(int offsetInBytes, void* data, int numBytes) override;
 	};
@@ -22,6 +22,9 @@ namespace OpenGl
 		: Pvt::IEffectPimpl(parent)
 	{
 		m_device = device;
+		m_pendingConstants = 0;
+		m_blocksChecked = false;
+		m_useBlocks = false;
 
 		std::string vertexResult, fragResult;
 		ProcessSource(vertexSource, fragmentSource, vertexResult, fragResult);
@@ -34,6 +37,9 @@ namespace OpenGl
 	{
 		assert(device != nullptr);
 		m_device = device;
+		m_pendingConstants = 0;
+		m_blocksChecked = false;
+		m_useBlocks = false;
 	}
 
 	GlslEffect::~GlslEffect()
@@ -70,21 +76,64 @@ namespace OpenGl
 		{
 			glGetError();
 
-			GlslSource source((const char*)vertexSource, (const char*)fragSource, m_device->GetGlslVersion());
+			if (m_blocksChecked == false)
+				setupBlocks();
+
+			const char* vertex = (const char*)vertexSource;
+			const char* frag = (const char*)fragSource;
+
+			// the cbuffers' uniforms are declared in their blocks instead
+			std::string vertexText, fragText, blockDeclarations;
+			if (m_useBlocks)
+			{
+				vertexText = vertex;
+				fragText = frag;
+
+				for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+				{
+					for (std::vector<BlockConstant>::size_type j = 0; j < m_cbuffers[i].Constants.size(); j++)
+					{
+						removeUniformDeclaration(vertexText, m_cbuffers[i].Constants[j].Param->Name);
+						removeUniformDeclaration(fragText, m_cbuffers[i].Constants[j].Param->Name);
+					}
+
+					blockDeclarations += m_cbuffers[i].Declaration;
+				}
+
+				vertex = vertexText.c_str();
+				frag = fragText.c_str();
+			}
+
+			GlslSource source(vertex, frag, m_device->GetGlslVersion());
 
 			// HACK: We *should* be able to send each piece as a separate element in an array,
 			// but to get this to work with AMD hardware we have to concatenate beforehand.
 			// Otherwise we get shader compiler errors.
 			char buffer[256];
 #ifdef NXNA_PLATFORM_WIN32
-			_snprintf_s(buffer, 256, "#define %s \n", name);
+			_snprintf_s(buffer, 256, "#define %s \n#define NXNA_MAX_VERTEX_UNIFORM_VECTORS %d\n", name, m_device->GetMaxVertexUniformVectors());
 #else
-			snprintf(buffer, 256, "#define %s \n", name);
+			snprintf(buffer, 256, "#define %s \n#define NXNA_MAX_VERTEX_UNIFORM_VECTORS %d\n", name, m_device->GetMaxVertexUniformVectors());
 #endif
-			const char* defines[] = { buffer };
+			const char* defines[] = { buffer, blockDeclarations.c_str() };
 
 			GlslProgram program;
-			program.Program = source.Build(defines, 1);
+			program.Program = source.Build(defines, m_useBlocks ? 2 : 1);
+
+#ifndef USING_OPENGLES
+			if (m_useBlocks)
+			{
+				// a technique that doesn't use a block won't have it
+				for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+				{
+					GLuint index = glGetUniformBlockIndex(program.Program, m_cbuffers[i].Name.c_str());
+					if (index != GL_INVALID_INDEX)
+						glUniformBlockBinding(program.Program, index, m_cbuffers[i].Binding);
+				}
+
+				GlException::ThrowIfError(__FILE__, __LINE__);
+			}
+#endif
 
 			loadUniformInfo(program);
 			loadAttributeInfo(program);
@@ -118,6 +167,13 @@ namespace OpenGl
 			break;
 		case Semantic::Color:
 			attrib.Usage = VertexElementUsage::Color;
+			break;
+		case Semantic::BlendIndices:
+			attrib.Usage = VertexElementUsage::BlendIndices;
+			break;
+		case Semantic::BlendWeights:
+			attrib.Usage = VertexElementUsage::BlendWeight;
+			break;
 		}
 
 		m_programs[programIndex].Attributes.push_back(attrib);
@@ -193,6 +249,9 @@ namespace OpenGl
 		m_device->SetCurrentEffect(this);
 		m_boundProgramIndex = programIndex;
 
+		if (m_useBlocks)
+			applyBlocks();
+
 		int usedTextureUnits = 0;
 
 		// go through the cached values and send them to OpenGL
@@ -202,6 +261,7 @@ namespace OpenGl
 			EffectParameter* param = (*itr).Param;
 			EffectParameterType type = param->GetType();
 			int numElements = param->GetNumElements();
+			int count = (*itr).Count;
 
 			if (type == EffectParameterType::Int32)
 			{
@@ -209,16 +269,18 @@ namespace OpenGl
 			}
 			else if (type == EffectParameterType::Single)
 			{
-				if (numElements == 1)
-					glUniform1fv((*itr).Uniform, 1, (float*)GetRawValue((*itr).Param));
-				else if (numElements == 2)
-					glUniform2fv((*itr).Uniform, 1, (float*)GetRawValue((*itr).Param));
-				else if (numElements == 3)
-					glUniform3fv((*itr).Uniform, 1, (float*)GetRawValue((*itr).Param));
-				else if (numElements == 4)
-					glUniform4fv((*itr).Uniform, 1, (float*)GetRawValue((*itr).Param));
-				else if (numElements == 16)
-					glUniformMatrix4fv((*itr).Uniform, 1, GL_FALSE, (float*)GetRawValue(param));
+				// arrays go all at once
+				int elementSize = numElements / count;
+				if (elementSize == 1)
+					glUniform1fv((*itr).Uniform, count, (float*)GetRawValue((*itr).Param));
+				else if (elementSize == 2)
+					glUniform2fv((*itr).Uniform, count, (float*)GetRawValue((*itr).Param));
+				else if (elementSize == 3)
+					glUniform3fv((*itr).Uniform, count, (float*)GetRawValue((*itr).Param));
+				else if (elementSize == 4)
+					glUniform4fv((*itr).Uniform, count, (float*)GetRawValue((*itr).Param));
+				else if (elementSize == 16)
+					glUniformMatrix4fv((*itr).Uniform, count, GL_FALSE, (float*)GetRawValue(param));
 			}
 			else if (type == EffectParameterType::Texture2D)
 			{
@@ -294,12 +356,64 @@ namespace OpenGl
 
 	void GlslEffect::AddConstantBuffer(bool vertex, bool pixel, int sizeInBytes, int numParameters)
 	{
-		// nothing... not using cbuffers (yet)
+		// The next numParameters parameters are what's in it. The size is worked out from
+		// those, since uniform blocks are packed differently.
+		ConstantBuffer cbuffer;
+		cbuffer.Size = 0;
+		cbuffer.Binding = -1;
+		cbuffer.Supported = true;
+		cbuffer.Last.Generation = -1;
+		cbuffer.Last.Offset = 0;
+
+		m_cbuffers.push_back(cbuffer);
+		m_pendingConstants = numParameters;
+	}
+
+	EffectParameter* GlslEffect::AddParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset)
+	{
+		EffectParameter* param = addParameter(name, type, numElements, count, constantBufferIndex, constantBufferOffset);
+
+		if (m_pendingConstants > 0)
+		{
+			m_pendingConstants--;
+
+			// std140 packing. Anything else would have to be stored differently than the parameter
+			// has it, so that cbuffer stays as plain uniforms. That includes arrays, since std140 pads
+			// every element out to 16 bytes while the parameter keeps them packed.
+			ConstantBuffer& cbuffer = m_cbuffers.back();
+			int alignment = 0, size = 0;
+			const char* glslType = nullptr;
+			if (count == 1)
+			{
+				if (numElements == 1) { alignment = 4; size = 4; glslType = "float"; }
+				else if (numElements == 2) { alignment = 8; size = 8; glslType = "vec2"; }
+				else if (numElements == 3) { alignment = 16; size = 12; glslType = "vec3"; }
+				else if (numElements == 4) { alignment = 16; size = 16; glslType = "vec4"; }
+				else if (numElements == 16) { alignment = 16; size = 64; glslType = "mat4"; }
+			}
+
+			if (glslType == nullptr || type != EffectParameterType::Single)
+			{
+				cbuffer.Supported = false;
+			}
+			else
+			{
+				BlockConstant constant;
+				constant.Param = param;
+				constant.Offset = (cbuffer.Size + alignment - 1) / alignment * alignment;
+				cbuffer.Constants.push_back(constant);
+
+				cbuffer.Size = constant.Offset + size;
+				cbuffer.Declaration += std::string("\t") + glslType + " " + param->Name + ";\n";
+			}
+		}
+
+		return param;
 	}
 
-	EffectParameter* GlslEffect::AddParameter(const char* name, EffectParameterType type, int numElements, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset)
+	EffectParameter* GlslEffect::addParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferOffset)
 	{
-		EffectParameter* param = CreateParameter(m_parent, type, numElements, nullptr, name, constantBufferIndex, constantBufferOffset);
+		EffectParameter* param = CreateParameter(m_parent, type, numElements, nullptr, name, constantBufferIndex, constantBufferOffset, count);
 
 		m_parameters.insert(ParamMap::value_type(param->Name.c_str(), param));
 
@@ -381,8 +495,17 @@ namespace OpenGl
 			glGetActiveUniform(program.Program, i, 255, nullptr, &size, &type, nameBuffer);
 			nameBuffer[255] = 0;
 
+			// arrays are called "name[0]", and size is how long they are
+			char* bracket = strchr(nameBuffer, '[');
+			if (bracket != nullptr)
+				*bracket = 0;
+
 			int location = glGetUniformLocation(program.Program, nameBuffer);
 
+			// block members don't have locations, applyBlocks() sets them
+			if (location < 0 && m_useBlocks)
+				continue;
+
 			EffectParameter* param = GetParameter(nameBuffer);
 
 			if (param == nullptr)
@@ -439,7 +562,7 @@ namespace OpenGl
 					numElements = 16;
 
 				// add the parameter, with the handle being the index of this parameter
-				param = this->AddParameter(nameBuffer, pType, numElements, 0, 0, 0);
+				param = addParameter(nameBuffer, pType, numElements * size, size, 0, 0);
 
 				// if this is a texture param then add it to the list of
 				// texture parameters
@@ -457,11 +580,106 @@ namespace OpenGl
 			uniform.Param = param;
 			uniform.Program = program.Program;
 			uniform.Uniform = location;
+			uniform.Count = size;
 
 			program.Uniforms.push_back(uniform);
 		}
 	}
 
+	void GlslEffect::setupBlocks()
+	{
+		m_blocksChecked = true;
+
+#ifndef USING_OPENGLES
+		GlUniformBlocks* blocks = m_device->GetUniformBlocks();
+		if (blocks == nullptr || m_cbuffers.empty())
+			return;
+
+		for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+		{
+			if (m_cbuffers[i].Supported == false)
+				return;
+		}
+
+		// the members are enough to tell layouts apart, so they're the signature
+		for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+		{
+			ConstantBuffer& cbuffer = m_cbuffers[i];
+			cbuffer.Size = (cbuffer.Size + 15) / 16 * 16;
+			cbuffer.Binding = blocks->GetBinding(cbuffer.Declaration, cbuffer.Size);
+
+			if (cbuffer.Binding < 0)
+				return;
+		}
+
+		for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+		{
+			ConstantBuffer& cbuffer = m_cbuffers[i];
+
+			std::ostringstream name;
+			name << "NxnaBlock" << cbuffer.Binding;
+			cbuffer.Name = name.str();
+			cbuffer.Declaration = "layout(std140) uniform " + cbuffer.Name + "\n{\n" + cbuffer.Declaration + "};\n";
+			cbuffer.Data.resize(cbuffer.Size, 0);
+		}
+
+		m_useBlocks = true;
+#endif
+	}
+
+	void GlslEffect::applyBlocks()
+	{
+#ifndef USING_OPENGLES
+		GlUniformBlocks* blocks = m_device->GetUniformBlocks();
+
+		for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+		{
+			ConstantBuffer& cbuffer = m_cbuffers[i];
+			for (std::vector<BlockConstant>::size_type j = 0; j < cbuffer.Constants.size(); j++)
+			{
+				EffectParameter* param = cbuffer.Constants[j].Param;
+				memcpy(&cbuffer.Data[cbuffer.Constants[j].Offset], GetRawValue(param), param->GetNumElements() * sizeof(float));
+			}
+		}
+
+		// if the ring gets orphaned partway through, the blocks set before that are gone
+		int generation;
+		do
+		{
+			generation = blocks->GetGeneration();
+
+			for (std::vector<ConstantBuffer>::size_type i = 0; i < m_cbuffers.size(); i++)
+				blocks->Set(m_cbuffers[i].Binding, &m_cbuffers[i].Data[0], &m_cbuffers[i].Last);
+		} while (generation != blocks->GetGeneration());
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+#endif
+	}
+
+	void GlslEffect::removeUniformDeclaration(std::string& source, const std::string& name)
+	{
+		std::string::size_type position = 0;
+		while ((position = source.find("uniform", position)) != std::string::npos)
+		{
+			std::string::size_type end = source.find(';', position);
+			if (end == std::string::npos)
+				return;
+
+			// make sure it's the whole word
+			bool keyword = (position == 0 || strchr(" \t\r\n", source[position - 1]) != nullptr) &&
+				strchr(" \t", source[position + 7]) != nullptr;
+
+			// the name is the last word before the semicolon
+			std::string::size_type nameEnd = source.find_last_not_of(" \t\r\n", end - 1);
+			std::string::size_type nameStart = source.find_last_of(" \t\r\n", nameEnd) + 1;
+
+			if (keyword && source.compare(nameStart, nameEnd - nameStart + 1, name) == 0)
+				source.erase(position, end - position + 1);
+			else
+				position = end;
+		}
+	}
+
 	void GlslEffect::loadAttributeInfo(GlslProgram& program)
 	{
 		int numAttributes;
@@ -547,6 +765,10 @@ namespace OpenGl
 				attrib.Usage = VertexElementUsage::Color;
 			else if (strncmp(usageBuffer, "NORMAL", 6) == 0)
 				attrib.Usage = VertexElementUsage::Normal;
+			else if (strncmp(usageBuffer, "BLENDINDICES", 12) == 0)
+				attrib.Usage = VertexElementUsage::BlendIndices;
+			else if (strncmp(usageBuffer, "BLENDWEIGHT", 11) == 0)
+				attrib.Usage = VertexElementUsage::BlendWeight;
 
 			result.append(cursor, colon - cursor);
 
@@ -7,6 +7,7 @@
 #include "../Effect.h"
 #include "../IEffectPimpl.h"
 #include "../VertexDeclaration.h"
+#include "GlUniformBlocks.h"
 
 NXNA_DISABLE_OVERRIDE_WARNING
 
@@ -38,6 +39,7 @@ namespace OpenGl
 			EffectParameter* Param;
 			unsigned int Program;
 			unsigned int Uniform;
+			int Count;
 		};
 
 		struct GlslProgram
@@ -47,6 +49,25 @@ namespace OpenGl
 			std::vector<GlslUniform> Uniforms;
 		};
 
+		struct BlockConstant
+		{
+			EffectParameter* Param;
+			int Offset;
+		};
+
+		// a cbuffer, which is a uniform block if the device has them
+		struct ConstantBuffer
+		{
+			std::vector<BlockConstant> Constants;
+			int Size;
+			int Binding;
+			bool Supported;
+			std::string Name;
+			std::string Declaration;
+			std::vector<byte> Data;
+			GlUniformBlocks::Upload Last;
+		};
+
 		NXNA_ENUM(CacheType)
 			CacheType_Float,
 			CacheType_Int
@@ -74,6 +95,11 @@ namespace OpenGl
 		std::vector<GlslAttribute> m_attributes;
 		std::vector<EffectParameter*> m_parameterList;
 		OpenGlDevice* m_device;
+
+		std::vector<ConstantBuffer> m_cbuffers;
+		int m_pendingConstants;
+		bool m_blocksChecked;
+		bool m_useBlocks;
 		
 	protected:
 		std::vector<EffectParameter*> m_textureParams;
@@ -111,7 +137,7 @@ namespace OpenGl
 		}
 
 		virtual void AddConstantBuffer(bool vertex, bool pixel, int sizeInBytes, int numParameters) override;
-		virtual EffectParameter* AddParameter(const char* name, EffectParameterType type, int numElements, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset) override;
+		virtual EffectParameter* AddParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferConstantIndex, int constantBufferOffset) override;
 
 		const GlslAttribute* GetAttribute(VertexElementUsage usage, int index);
 
@@ -133,7 +159,11 @@ namespace OpenGl
 	private:
 		int compile(const char* source[], int numSource, bool vertex);
 		void processSource(std::string& source, bool vertex);
+		EffectParameter* addParameter(const char* name, EffectParameterType type, int numElements, int count, int constantBufferIndex, int constantBufferOffset);
 		void loadUniformInfo(GlslProgram& program);
+		void setupBlocks();
+		void applyBlocks();
+		static void removeUniformDeclaration(std::string& source, const std::string& name);
 		void loadAttributeInfo(GlslProgram& program);
 		std::string extractAttribInfo(const char* vertexShaderSource);
 		void replaceAll(std::string& original, const std::string& toRemove, const std::string& toPut);
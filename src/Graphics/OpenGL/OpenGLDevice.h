@@ -14,9 +14,14 @@ namespace OpenGl
 {
 	class GlslEffect;
 	class GlIndexBuffer;
+	class GlGpuTimer;
+	class GlTransientBuffer;
+	class GlUniformBlocks;
 
 	class OpenGlDevice : public GraphicsDevice
 	{
+		static const int MAX_VERTEX_BUFFER_BINDINGS = 4;
+
 		Viewport m_viewport;
 		Color m_clearColor;
 		float m_clearDepth;
@@ -26,11 +31,22 @@ namespace OpenGl
 		GlslEffect* m_effect;
 		const VertexBuffer* m_vertices;
 		const GlIndexBuffer* m_indices;
+		VertexBufferBinding m_bindings[MAX_VERTEX_BUFFER_BINDINGS];
+		int m_numBindings;
 		int m_version;
 		int m_glslVersion;
+		int m_maxVertexUniformVectors;
 		BlendState m_cachedBlendState;
 		DepthStencilState m_cachedDepthStencilState;
 		Rectangle m_scissorRectangle;
+		GlGpuTimer* m_gpuTimer;
+
+		// where the DrawUser*Primitives() data goes
+		GlTransientBuffer* m_userVertices;
+		GlTransientBuffer* m_userIndices;
+
+		// null if there aren't uniform buffers
+		GlUniformBlocks* m_uniformBlocks;
 		
 #ifdef USING_OPENGLES
 		bool m_defaultFboSet;
@@ -43,6 +59,7 @@ namespace OpenGl
 
 	public:
 		OpenGlDevice();
+		virtual ~OpenGlDevice();
 		void OnContextCreated();
 		void UpdatePresentationParameters(const PresentationParameters& pp);
 
@@ -73,6 +90,9 @@ namespace OpenGl
 		virtual void SetVertexBuffer(const VertexBuffer* vertexBuffer) override;
 		virtual void SetBlendState(const BlendState* blendState) override;
 
+		virtual void SetVertexBuffers(const VertexBufferBinding* bindings, int numBindings) override;
+		virtual void DrawInstancedPrimitives(PrimitiveType primitiveType, int baseVertex, int minVertexIndex, int numVertices, int startIndex, int primitiveCount, int instanceCount) override;
+
 		virtual void SetRenderTarget(RenderTarget2D* renderTarget) override;
 
 		virtual void Present() override;
@@ -87,6 +107,19 @@ namespace OpenGl
 		int GetVersion() { return m_version; }
 		int GetGlslVersion() { return m_glslVersion; }
 
+		// Not part of XNA. Shaders get it as NXNA_MAX_VERTEX_UNIFORM_VECTORS, so big uniform
+		// arrays (like SkinnedEffect's bones) can shrink to fit.
+		int GetMaxVertexUniformVectors() { return m_maxVertexUniformVectors; }
+
+		// Not part of XNA. How much DrawUser*Primitives() data was uploaded last frame,
+		// vertices and indices together. Frames end with Present().
+		int GetUserPrimitiveBytesLastFrame();
+
+		// Not part of XNA. How much effect constant data was uploaded to uniform buffers last frame.
+		int GetUniformBlockBytesLastFrame();
+
+		GlUniformBlocks* GetUniformBlocks() { return m_uniformBlocks; }
+
 	protected:
 		virtual void SetSamplers() override;
 
@@ -107,6 +140,10 @@ namespace OpenGl
 		void setClearDepth(float depth);
 		void setClearStencil(int s);
 		void setupVertexBufferPointers(void* verts);
+		void setupVertexAttributes(const VertexDeclaration* declaration, void* verts, int divisor);
+		void setInstanceAttributes(const VertexBufferBinding& binding, int instance);
+		void drawInstancedFallback(int glPrimitiveType, int baseVertex, int startIndex, int primitiveCount, int instanceCount);
+		void setupUserVertices(void* data, int numVertices, const VertexDeclaration* vertexDeclaration);
 		
 		static int convertCompareFunction(CompareFunction func);
 		static CompareFunction convertCompareFunction(int func);
@@ -114,6 +151,8 @@ namespace OpenGl
 		static StencilOperation convertStencilOperation(int op);
 		static int convertBlendMode(Blend mode);
 		static int convertBlendFunc(BlendFunction func);
+		static int convertPrimitiveType(PrimitiveType type);
+		static int getElementCount(PrimitiveType type, int primitiveCount);
 	};
 
 	class GlException : public GraphicsException
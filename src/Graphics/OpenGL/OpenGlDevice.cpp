@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstring>
 #include "OpenGL.h"
 #include "../VertexDeclaration.h"
 #include "../GraphicsDeviceCapabilities.h"
@@ -12,6 +13,9 @@
 #include "GlRenderTarget2D.h"
 #include "GlVertexBuffer.h"
 #include "GlIndexBuffer.h"
+#include "GlGpuTimer.h"
+#include "GlTransientBuffer.h"
+#include "GlUniformBlocks.h"
 
 namespace Nxna
 {
@@ -25,6 +29,13 @@ namespace OpenGl
 		m_vertexPointersNeedSetup = true;
 		m_declaration = nullptr;
 		m_effect = nullptr;
+		m_vertices = nullptr;
+		m_numBindings = 0;
+		m_maxVertexUniformVectors = 128;
+		m_gpuTimer = nullptr;
+		m_userVertices = nullptr;
+		m_userIndices = nullptr;
+		m_uniformBlocks = nullptr;
 		m_caps = new GraphicsDeviceCapabilities();
 		
 #ifdef USING_OPENGLES
@@ -35,6 +46,22 @@ namespace OpenGl
 		m_renderTargetWidth = m_renderTargetHeight = 0;
 	}
 
+	OpenGlDevice::~OpenGlDevice()
+	{
+		delete m_userVertices;
+		delete m_userIndices;
+
+#ifndef USING_OPENGLES
+		delete m_uniformBlocks;
+
+		if (m_gpuTimer != nullptr)
+		{
+			Utils::Profiler::SetGpuTimer(nullptr);
+			delete m_gpuTimer;
+		}
+#endif
+	}
+
 #ifndef USING_OPENGLES
 
 	void GLEWAPIENTRY errorCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* param)
@@ -58,9 +85,24 @@ namespace OpenGl
 
 		if (GLEW_EXT_texture_compression_s3tc)
 		{
-			//m_caps->SupportsS3tcTextureCompression = true;
+			m_caps->SupportsS3tcTextureCompression = true;
+		}
+
+		// ETC2 is part of GL 4.3, and ETC2 decoders can read ETC1 too
+		if (GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility)
+		{
+			m_caps->SupportsEtc1TextureCompression = true;
+			m_caps->SupportsEtc2TextureCompression = true;
+		}
+
+		if (GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object)
+		{
+			m_caps->SupportsGenerateMipmaps = true;
 		}
 
+		// part of GL 2.0
+		m_caps->SupportsNonPowerOfTwoMipmaps = GLEW_VERSION_2_0 || GLEW_ARB_texture_non_power_of_two;
+
 		if (GLEW_ARB_debug_output)
 		{
 			glDebugMessageCallbackARB(errorCallback, nullptr);
@@ -75,6 +117,12 @@ namespace OpenGl
 				true);
 		}
 
+		if (GLEW_ARB_timer_query)
+		{
+			m_gpuTimer = new GlGpuTimer();
+			Utils::Profiler::SetGpuTimer(m_gpuTimer);
+		}
+
 #endif
 
 		glEnable(GL_BLEND);
@@ -102,14 +150,50 @@ namespace OpenGl
 			m_glslVersion = (glslVersion[0] - '0') * 100 + (glslVersion[2] - '0') * 10;
 		}
 
+		// the built-in instanced effects need GLSL 1.30
+		if (m_caps->SupportsShaders && m_glslVersion >= 130 && (GLEW_VERSION_3_3 || (GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced)))
+			m_caps->SupportsInstancing = true;
+
+		// The effects' cbuffers become uniform blocks. GLSL 1.40 is needed for the block
+		// declarations, otherwise they stay as separate uniforms.
+		if (m_caps->SupportsShaders && m_glslVersion >= 140 && (GLEW_VERSION_3_1 || GLEW_ARB_uniform_buffer_object))
+			m_uniformBlocks = new GlUniformBlocks();
+
 #else
         m_version = 200;
         m_glslVersion = 100;
 
 		m_caps->SupportsShaders = true;
+		m_caps->SupportsGenerateMipmaps = true;
+
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		if (extensions != nullptr)
+		{
+			m_caps->SupportsS3tcTextureCompression = strstr(extensions, "GL_EXT_texture_compression_s3tc") != nullptr;
+			m_caps->SupportsEtc1TextureCompression = strstr(extensions, "GL_OES_compressed_ETC1_RGB8_texture") != nullptr;
+
+			// without this GLES 2 only allows mipmaps (and glGenerateMipmap()) on power of 2 textures
+			m_caps->SupportsNonPowerOfTwoMipmaps = strstr(extensions, "GL_OES_texture_npot") != nullptr;
+		}
 		
 		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &m_defaultFbo);
 #endif
+
+		if (m_caps->SupportsShaders)
+		{
+			GLint maxTextureUnits;
+			glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &maxTextureUnits);
+			m_caps->MaxTextureUnits = maxTextureUnits;
+
+			// GLES only has it in vectors, and desktop GL only has it in components until 4.1
+#ifdef USING_OPENGLES
+			glGetIntegerv(GL_MAX_VERTEX_UNIFORM_VECTORS, &m_maxVertexUniformVectors);
+#else
+			GLint maxVertexUniformComponents;
+			glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &maxVertexUniformComponents);
+			m_maxVertexUniformVectors = maxVertexUniformComponents / 4;
+#endif
+		}
 	}
 
 	void OpenGlDevice::UpdatePresentationParameters(const PresentationParameters& pp)
@@ -312,13 +396,12 @@ namespace OpenGl
 #endif
 
 #ifndef USING_OPENGLES
-		if (GLEW_ARB_draw_elements_base_vertex == false)
-			if (baseVertex != 0)
-				setupVertexBufferPointers((void*)(baseVertex * m_vertices->GetDeclaration()->GetStride()));
+		bool emulateBaseVertex = baseVertex != 0 && GLEW_ARB_draw_elements_base_vertex == false;
 #else
-		if (baseVertex != 0)
-			setupVertexBufferPointers((void*)(baseVertex * m_vertices->GetDeclaration()->GetStride()));
+		bool emulateBaseVertex = baseVertex != 0;
 #endif
+		if (emulateBaseVertex)
+			setupVertexBufferPointers((void*)(baseVertex * m_vertices->GetDeclaration()->GetStride()));
 
 		applyDirtyStates();
 
@@ -328,30 +411,83 @@ namespace OpenGl
 		if (elementSize == IndexElementSize::ThirtyTwoBits)
 			size = GL_UNSIGNED_INT;
 
-		GLenum glPrimitiveType;
-		if (primitiveType == PrimitiveType::TriangleStrip)
-			glPrimitiveType = GL_TRIANGLE_STRIP;
-		else
-			glPrimitiveType = GL_TRIANGLES;
+		GLenum glPrimitiveType = convertPrimitiveType(primitiveType);
+		int numIndices = getElementCount(primitiveType, primitiveCount);
 
 #ifndef USING_OPENGLES
 		if (GLEW_ARB_draw_elements_base_vertex)
-			glDrawElementsBaseVertex(glPrimitiveType, primitiveCount * 3, size, (void*)(startIndex * (int)elementSize), baseVertex);
+			glDrawElementsBaseVertex(glPrimitiveType, numIndices, size, (void*)(startIndex * (int)elementSize), baseVertex);
 		else
-			glDrawElements(glPrimitiveType, primitiveCount * 3, size, (void*)(startIndex * (int)elementSize));
+			glDrawElements(glPrimitiveType, numIndices, size, (void*)(startIndex * (int)elementSize));
 #else
-		glDrawElements(glPrimitiveType, primitiveCount * 3, size, (void*)(startIndex * (int)elementSize));
+		glDrawElements(glPrimitiveType, numIndices, size, (void*)(startIndex * (int)elementSize));
 #endif
+
+		// the pointers are offset by the base vertex now, so the next draw
+		// has to set them up again even if the vertex buffer doesn't change
+		if (emulateBaseVertex)
+			m_vertexPointersNeedSetup = true;
 		
 		GlException::ThrowIfError(__FILE__, __LINE__);
 	}
 
-	void OpenGlDevice::DrawPrimitives(PrimitiveType primitiveType, int startVertex, int primitiveCount) {}
-	void OpenGlDevice::DrawUserIndexedPrimitives(PrimitiveType primitiveType, void* data, int numVertices, int* indices, int primitiveCount, const VertexDeclaration* vertexDeclaration) {}
+	void OpenGlDevice::DrawPrimitives(PrimitiveType primitiveType, int startVertex, int primitiveCount)
+	{
+		assert(m_vertices != nullptr);
+		assert(startVertex + getElementCount(primitiveType, primitiveCount) <= m_vertices->GetVertexCount());
+
+		applyDirtyStates();
+
+		glDrawArrays(convertPrimitiveType(primitiveType), startVertex, getElementCount(primitiveType, primitiveCount));
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	void OpenGlDevice::DrawUserIndexedPrimitives(PrimitiveType primitiveType, void* data, int numVertices, int* indices, int primitiveCount, const VertexDeclaration* vertexDeclaration)
+	{
+		int numIndices = getElementCount(primitiveType, primitiveCount);
+
+#ifndef NDEBUG
+		for (int i = 0; i < numIndices; i++)
+		{
+			assert(indices[i] < numVertices);
+			assert(indices[i] >= 0);
+		}
+#endif
+
+		setupUserVertices(data, numVertices, vertexDeclaration);
+
+		if (numVertices <= 65536)
+		{
+			// 16 bit indices are half the size, and they're all GLES 2 has
+			int offset;
+			unsigned short* shortIndices = (unsigned short*)m_userIndices->Map(numIndices * sizeof(unsigned short), 4, &offset);
+			for (int i = 0; i < numIndices; i++)
+				shortIndices[i] = (unsigned short)indices[i];
+			m_userIndices->Unmap();
+
+			glDrawElements(convertPrimitiveType(primitiveType), numIndices, GL_UNSIGNED_SHORT, (byte*)nullptr + offset);
+		}
+		else
+		{
+#ifdef USING_OPENGLES
+			throw InvalidOperationException("32 bit indices aren't supported by OpenGL ES 2");
+#else
+			int offset = m_userIndices->Upload(indices, numIndices * sizeof(int), 4);
+
+			glDrawElements(convertPrimitiveType(primitiveType), numIndices, GL_UNSIGNED_INT, (byte*)nullptr + offset);
+#endif
+		}
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
 	void OpenGlDevice::DrawUserIndexedPrimitives(PrimitiveType primitiveType, void* data, int numVertices, short* indices, int primitiveCount, const VertexDeclaration* vertexDeclaration)
 	{
+		int numIndices = getElementCount(primitiveType, primitiveCount);
+
 #ifndef NDEBUG
-		for (int i = 0; i < primitiveCount * 3; i++)
+		for (int i = 0; i < numIndices; i++)
 		{
 			int index = indices[i];
             
@@ -359,29 +495,186 @@ namespace OpenGl
             assert(index >= 0);
 		}
 #endif
+
+		setupUserVertices(data, numVertices, vertexDeclaration);
+
+		int offset = m_userIndices->Upload(indices, numIndices * sizeof(short), 4);
+
+		glDrawElements(convertPrimitiveType(primitiveType), numIndices, GL_UNSIGNED_SHORT, (byte*)nullptr + offset);
         
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-		GlException::ThrowIfError(__FILE__, __LINE__);
+        GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	void OpenGlDevice::setupUserVertices(void* data, int numVertices, const VertexDeclaration* vertexDeclaration)
+	{
+		// Client-side arrays are slow, and core profiles don't have them, so the data is copied into
+		// buffers that are reused every few frames. These are big enough for most frames' debug lines
+		// and UI, and grow if they aren't.
+		if (m_userVertices == nullptr)
+		{
+			m_userVertices = new GlTransientBuffer(GL_ARRAY_BUFFER, 4 * 1024 * 1024);
+			m_userIndices = new GlTransientBuffer(GL_ELEMENT_ARRAY_BUFFER, 1024 * 1024);
+		}
+
+		int offset = m_userVertices->Upload(data, numVertices * vertexDeclaration->GetStride(), 4);
 
 		m_indices = nullptr;
 		m_vertices = nullptr;
+		m_numBindings = 0;
 		m_declaration = vertexDeclaration;
-		setupVertexBufferPointers(data);
+		setupVertexBufferPointers((byte*)nullptr + offset);
 		SetSamplers();
 
+		// the pointers point into the transient buffer now
+		m_vertexPointersNeedSetup = true;
+	}
+
+	void OpenGlDevice::DrawInstancedPrimitives(PrimitiveType primitiveType, int baseVertex, int minVertexIndex, int numVertices, int startIndex, int primitiveCount, int instanceCount)
+	{
+		assert(m_indices != nullptr);
+		assert(startIndex + primitiveCount < m_indices->GetIndexCount());
+
 		GLenum glPrimitiveType;
 		if (primitiveType == PrimitiveType::TriangleStrip)
 			glPrimitiveType = GL_TRIANGLE_STRIP;
 		else
 			glPrimitiveType = GL_TRIANGLES;
 
-		glDrawElements(glPrimitiveType, primitiveCount * 3, GL_UNSIGNED_SHORT, indices);
-        
-        GlException::ThrowIfError(__FILE__, __LINE__);
+		if (m_caps->SupportsInstancing == false)
+		{
+			drawInstancedFallback(glPrimitiveType, baseVertex, startIndex, primitiveCount, instanceCount);
+			return;
+		}
+
+#ifndef USING_OPENGLES
+		// not bothering with glDrawElementsInstancedBaseVertex() since it needs GL 3.2
+		if (baseVertex != 0)
+			setupVertexBufferPointers((byte*)nullptr + baseVertex * m_declaration->GetStride());
+
+		applyDirtyStates();
+
+		int size = GL_UNSIGNED_SHORT;
+		if (m_indices->GetElementSize() == IndexElementSize::ThirtyTwoBits)
+			size = GL_UNSIGNED_INT;
+
+		void* indexOffset = (byte*)nullptr + startIndex * (int)m_indices->GetElementSize();
+		if (glDrawElementsInstanced != nullptr)
+			glDrawElementsInstanced(glPrimitiveType, primitiveCount * 3, size, indexOffset, instanceCount);
+		else
+			glDrawElementsInstancedARB(glPrimitiveType, primitiveCount * 3, size, indexOffset, instanceCount);
+
+		// the pointers were offset by the base vertex, so the next draw needs to reset them
+		if (baseVertex != 0)
+			m_vertexPointersNeedSetup = true;
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+#endif
+	}
+
+	void OpenGlDevice::drawInstancedFallback(int glPrimitiveType, int baseVertex, int startIndex, int primitiveCount, int instanceCount)
+	{
+		// The per-vertex streams are set up like a normal draw, and the per-instance
+		// streams are replaced with constant attribute values before each instance is drawn.
+		if (baseVertex != 0)
+			setupVertexBufferPointers((byte*)nullptr + baseVertex * m_declaration->GetStride());
+
+		applyDirtyStates();
+
+		int size = GL_UNSIGNED_SHORT;
+		if (m_indices->GetElementSize() == IndexElementSize::ThirtyTwoBits)
+			size = GL_UNSIGNED_INT;
+
+		void* indexOffset = (byte*)nullptr + startIndex * (int)m_indices->GetElementSize();
+
+		for (int i = 0; i < instanceCount; i++)
+		{
+			for (int j = 0; j < m_numBindings; j++)
+			{
+				if (m_bindings[j].InstanceFrequency != 0)
+					setInstanceAttributes(m_bindings[j], i);
+			}
+
+			glDrawElements(glPrimitiveType, primitiveCount * 3, size, indexOffset);
+		}
+
+		if (baseVertex != 0)
+			m_vertexPointersNeedSetup = true;
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	void OpenGlDevice::setInstanceAttributes(const VertexBufferBinding& binding, int instance)
+	{
+		const GlVertexBuffer* buffer = static_cast<const GlVertexBuffer*>(const_cast<VertexBuffer*>(binding.Buffer)->GetPimpl());
+		const VertexDeclaration* declaration = buffer->GetDeclaration();
+
+		const byte* vertex = buffer->GetCopy() + (binding.VertexOffset + instance / binding.InstanceFrequency) * declaration->GetStride();
+
+		for (int i = 0; i < declaration->GetNumElements(); i++)
+		{
+			const VertexElement& element = declaration->GetElements()[i];
+			const GlslAttribute* attrib = m_effect->GetAttribute(element.ElementUsage, element.UsageIndex);
+			if (attrib == nullptr)
+				continue;
+
+			// a disabled array means every vertex gets the same value
+			glDisableVertexAttribArray(attrib->GlHandle);
+
+			float value[4] = { 0, 0, 0, 1.0f };
+			const byte* data = vertex + element.Offset;
+
+			// these have to be read the same way setupVertexBufferPointers() tells GL to read them
+			switch(element.ElementFormat)
+			{
+			case VertexElementFormat::Single:
+				memcpy(value, data, sizeof(float) * 1);
+				break;
+			case VertexElementFormat::Vector2:
+				memcpy(value, data, sizeof(float) * 2);
+				break;
+			case VertexElementFormat::Vector3:
+				memcpy(value, data, sizeof(float) * 3);
+				break;
+			case VertexElementFormat::Vector4:
+				memcpy(value, data, sizeof(float) * 4);
+				break;
+			case VertexElementFormat::Color:
+				for (int j = 0; j < 4; j++)
+					value[j] = data[j] / 255.0f;
+				break;
+			case VertexElementFormat::Short2:
+			case VertexElementFormat::Short4:
+				for (int j = 0; j < (element.ElementFormat == VertexElementFormat::Short2 ? 2 : 4); j++)
+				{
+					short s;
+					memcpy(&s, data + j * sizeof(short), sizeof(short));
+					value[j] = (float)s;
+				}
+				break;
+			case VertexElementFormat::Byte4:
+				// not normalized, same as the blend indices in setupVertexBufferPointers()
+				for (int j = 0; j < 4; j++)
+					value[j] = (float)data[j];
+				break;
+			default:
+				assert(false && "Unknown VertexElementFormat");
+				continue;
+			}
+
+			glVertexAttrib4fv(attrib->GlHandle, value);
+		}
 	}
 
-	void OpenGlDevice::DrawUserPrimitives(PrimitiveType primitiveType, void* data, int primitiveCount, const VertexDeclaration* vertexDeclaration) {}
+	void OpenGlDevice::DrawUserPrimitives(PrimitiveType primitiveType, void* data, int primitiveCount, const VertexDeclaration* vertexDeclaration)
+	{
+		int numVertices = getElementCount(primitiveType, primitiveCount);
+
+		setupUserVertices(data, numVertices, vertexDeclaration);
+
+		glDrawArrays(convertPrimitiveType(primitiveType), 0, numVertices);
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
 
 	void OpenGlDevice::SetVertexBuffer(const VertexBuffer* vertexBuffer)
 	{
@@ -391,12 +684,45 @@ namespace OpenGl
 
 			m_vertices = vertexBuffer;
 			m_declaration = vertexBuffer->GetDeclaration();
+			m_bindings[0] = VertexBufferBinding(vertexBuffer, 0, 0);
+			m_numBindings = 1;
 		}
 		else
 		{
 			m_vertices = nullptr;
 			m_declaration = nullptr;
+			m_numBindings = 0;
+		}
+
+		m_vertexPointersNeedSetup = true;
+	}
+
+	void OpenGlDevice::SetVertexBuffers(const VertexBufferBinding* bindings, int numBindings)
+	{
+		if (numBindings == 0)
+		{
+			SetVertexBuffer(nullptr);
+			return;
+		}
+
+		if (numBindings > MAX_VERTEX_BUFFER_BINDINGS)
+			throw ArgumentException("numBindings");
+
+		for (int i = 0; i < numBindings; i++)
+		{
+			// the fallback reads the instance data from the CPU
+			if (bindings[i].InstanceFrequency != 0 && m_caps->SupportsInstancing == false &&
+				static_cast<const GlVertexBuffer*>(const_cast<VertexBuffer*>(bindings[i].Buffer)->GetPimpl())->GetCopy() == nullptr)
+				throw InvalidOperationException("Without hardware instancing the instance data has to be in a DynamicVertexBuffer");
+
+			m_bindings[i] = bindings[i];
 		}
+		m_numBindings = numBindings;
+
+		static_cast<const GlVertexBuffer*>(const_cast<VertexBuffer*>(bindings[0].Buffer)->GetPimpl())->Bind();
+
+		m_vertices = bindings[0].Buffer;
+		m_declaration = m_vertices->GetDeclaration();
 
 		m_vertexPointersNeedSetup = true;
 	}
@@ -476,7 +802,38 @@ namespace OpenGl
 		m_renderTargetHeight = m_scissorRectangle.Height;
 	}
 
-	void OpenGlDevice::Present() {}
+	void OpenGlDevice::Present()
+	{
+		// the windows swap the buffers, this just ends the frame
+		if (m_userVertices != nullptr)
+		{
+			m_userVertices->EndFrame();
+			m_userIndices->EndFrame();
+		}
+
+#ifndef USING_OPENGLES
+		if (m_uniformBlocks != nullptr)
+			m_uniformBlocks->EndFrame();
+#endif
+	}
+
+	int OpenGlDevice::GetUserPrimitiveBytesLastFrame()
+	{
+		if (m_userVertices == nullptr)
+			return 0;
+
+		return m_userVertices->GetUploadedBytesLastFrame() + m_userIndices->GetUploadedBytesLastFrame();
+	}
+
+	int OpenGlDevice::GetUniformBlockBytesLastFrame()
+	{
+#ifndef USING_OPENGLES
+		if (m_uniformBlocks != nullptr)
+			return m_uniformBlocks->GetUploadedBytesLastFrame();
+#endif
+
+		return 0;
+	}
 
 	void OpenGlDevice::GetBackBufferData(void* data)
 	{
@@ -588,10 +945,39 @@ namespace OpenGl
 		assert(m_declaration != nullptr);
 		assert(m_effect != nullptr);
 
+		if (m_numBindings > 1)
+		{
+			// the extra streams have to bind their own buffers, so do them first
+			for (int i = 1; i < m_numBindings; i++)
+			{
+				// without hardware instancing these are set for each instance instead
+				if (m_bindings[i].InstanceFrequency != 0 && m_caps->SupportsInstancing == false)
+					continue;
+
+				const VertexBuffer* buffer = m_bindings[i].Buffer;
+				static_cast<const GlVertexBuffer*>(const_cast<VertexBuffer*>(buffer)->GetPimpl())->Bind();
+
+				setupVertexAttributes(buffer->GetDeclaration(), (byte*)nullptr + m_bindings[i].VertexOffset * buffer->GetDeclaration()->GetStride(), m_bindings[i].InstanceFrequency);
+			}
+
+			static_cast<const GlVertexBuffer*>(const_cast<VertexBuffer*>(m_vertices)->GetPimpl())->Bind();
+		}
+
+		if (m_numBindings > 0)
+			setupVertexAttributes(m_declaration, (byte*)verts + m_bindings[0].VertexOffset * m_declaration->GetStride(), m_bindings[0].InstanceFrequency);
+		else
+			setupVertexAttributes(m_declaration, verts, 0);
 
-		for (int i = 0; i < m_declaration->GetNumElements(); i++)
+		m_vertexPointersNeedSetup = false;
+
+		GlException::ThrowIfError(__FILE__, __LINE__);
+	}
+
+	void OpenGlDevice::setupVertexAttributes(const VertexDeclaration* declaration, void* verts, int divisor)
+	{
+		for (int i = 0; i < declaration->GetNumElements(); i++)
 		{
-			const GlslAttribute* attrib = m_effect->GetAttribute(m_declaration->GetElements()[i].ElementUsage, m_declaration->GetElements()[i].UsageIndex);
+			const GlslAttribute* attrib = m_effect->GetAttribute(declaration->GetElements()[i].ElementUsage, declaration->GetElements()[i].UsageIndex);
 			if (attrib == nullptr)
 				continue;
 
@@ -601,13 +987,26 @@ namespace OpenGl
 			GLenum type;
 			GLboolean normalize;
 
-			VertexElementFormat format = m_declaration->GetElements()[i].ElementFormat;
+			VertexElementFormat format = declaration->GetElements()[i].ElementFormat;
 			if (format == VertexElementFormat::Color)
 			{
 				sizeOfElement = 4;
 				type = GL_UNSIGNED_BYTE;
 				normalize = GL_TRUE;
 			}
+			else if (format == VertexElementFormat::Short2 || format == VertexElementFormat::Short4)
+			{
+				sizeOfElement = format == VertexElementFormat::Short2 ? 2 : 4;
+				type = GL_SHORT;
+				normalize = GL_FALSE;
+			}
+			else if (format == VertexElementFormat::Byte4)
+			{
+				// blend indices. Shaders get them as floats, and turn them back into ints.
+				sizeOfElement = 4;
+				type = GL_UNSIGNED_BYTE;
+				normalize = GL_FALSE;
+			}
 			else
 			{
 				sizeOfElement = (int)format;
@@ -616,12 +1015,19 @@ namespace OpenGl
 			}
 
 			glVertexAttribPointer(attrib->GlHandle, sizeOfElement, type, normalize, 
-				m_declaration->GetStride(), (byte*)verts + m_declaration->GetElements()[i].Offset);
-		}
+				declaration->GetStride(), (byte*)verts + declaration->GetElements()[i].Offset);
 
-		m_vertexPointersNeedSetup = false;
-
-		GlException::ThrowIfError(__FILE__, __LINE__);
+#ifndef USING_OPENGLES
+			// the divisor sticks to the attribute, so it has to be reset even when not instancing
+			if (m_caps->SupportsInstancing)
+			{
+				if (glVertexAttribDivisor != nullptr)
+					glVertexAttribDivisor(attrib->GlHandle, divisor);
+				else
+					glVertexAttribDivisorARB(attrib->GlHandle, divisor);
+			}
+#endif
+		}
 	}
 
 	int OpenGlDevice::convertCompareFunction(CompareFunction func)
@@ -752,6 +1158,26 @@ namespace OpenGl
             return GL_MAX;
 	}
 
+	int OpenGlDevice::convertPrimitiveType(PrimitiveType type)
+	{
+		if (type == PrimitiveType::TriangleStrip)
+			return GL_TRIANGLE_STRIP;
+		else if (type == PrimitiveType::LineList)
+			return GL_LINES;
+		else
+			return GL_TRIANGLES;
+	}
+
+	int OpenGlDevice::getElementCount(PrimitiveType type, int primitiveCount)
+	{
+		if (type == PrimitiveType::TriangleStrip)
+			return primitiveCount + 2;
+		else if (type == PrimitiveType::LineList)
+			return primitiveCount * 2;
+		else
+			return primitiveCount * 3;
+	}
+
 	GlException::GlException(int glError, const char* file, int line)
 		: GraphicsException("GlException")
 	{
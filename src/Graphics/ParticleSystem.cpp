@@ -0,0 +1,381 @@
+#include <cassert>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "ParticleSystem.h"
+#include "GraphicsDevice.h"
+#include "Texture2D.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "VertexDeclaration.h"
+#include "SpriteEffect.h"
+#include "../MathHelper.h"
+#include "../MathSimd.h"
+#include "../MemoryAllocator.h"
+#include "../Exception.h"
+#include "../Utils/Jobs.h"
+#include "../Utils/Profiler.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// same layout as the SpriteBatch vertices, so the SpriteEffect can draw them
+	static const int FloatsPerVertex = 6;
+	static const int FloatsPerQuad = FloatsPerVertex * 4;
+
+	// the most quads a 16 bit index buffer can reach
+	static const int MaxQuadsPerDraw = 16384;
+
+	void ParticleCurve::Set(float value)
+	{
+		m_keys.clear();
+		AddKey(0, value);
+	}
+
+	void ParticleCurve::Set(float start, float end)
+	{
+		m_keys.clear();
+		AddKey(0, start);
+		AddKey(1.0f, end);
+	}
+
+	void ParticleCurve::AddKey(float time, float value)
+	{
+		Key key;
+		key.Time = MathHelper::Clamp(time, 0, 1.0f);
+		key.Value = value;
+
+		std::vector<Key>::iterator itr = m_keys.begin();
+		while (itr != m_keys.end() && (*itr).Time <= key.Time)
+			++itr;
+		m_keys.insert(itr, key);
+
+		bake();
+	}
+
+	float ParticleCurve::Evaluate(float time) const
+	{
+		if (time <= m_keys.front().Time)
+			return m_keys.front().Value;
+		if (time >= m_keys.back().Time)
+			return m_keys.back().Value;
+
+		std::vector<Key>::size_type i = 1;
+		while (m_keys[i].Time < time)
+			i++;
+
+		const Key& a = m_keys[i - 1];
+		const Key& b = m_keys[i];
+		if (b.Time == a.Time)
+			return b.Value;
+
+		return MathHelper::Lerp(a.Value, b.Value, (time - a.Time) / (b.Time - a.Time));
+	}
+
+	void ParticleCurve::bake()
+	{
+		for (int i = 0; i < TableSize; i++)
+			m_table[i] = Evaluate((float)i / (TableSize - 1));
+	}
+
+	ParticleSystem::ParticleSystem(GraphicsDevice* device, Texture2D* texture, int capacity)
+	{
+		assert(device != nullptr);
+		assert(texture != nullptr);
+
+		if (capacity <= 0)
+			throw ArgumentException("capacity");
+
+		m_device = device;
+		m_texture = texture;
+		m_source = Rectangle(0, 0, texture->GetWidth(), texture->GetHeight());
+		m_capacity = capacity;
+		m_count = 0;
+		m_random = 0x9e3779b9;
+
+		// padded so the update never has to handle a partial group of 4
+		size_t padded = (capacity + 3) & ~3;
+		m_positionX.resize(padded);
+		m_positionY.resize(padded);
+		m_velocityX.resize(padded);
+		m_velocityY.resize(padded);
+		m_rotation.resize(padded);
+		m_angularVelocity.resize(padded);
+		m_age.resize(padded);
+		m_ageRate.resize(padded);
+		m_scale.resize(padded);
+		m_color.resize(padded);
+
+		VertexElement elements[] = {
+			{ 0, VertexElementFormat::Vector3, VertexElementUsage::Position, 0 },
+			{ sizeof(float) * 3, VertexElementFormat::Vector2, VertexElementUsage::TextureCoordinate, 0},
+			{ sizeof(float) * 5, VertexElementFormat::Color, VertexElementUsage::Color, 0}
+		};
+		m_declaration = new VertexDeclaration(elements, 3);
+		m_vertexBuffer = new DynamicVertexBuffer(device, m_declaration, capacity * 4, BufferUsage::WriteOnly);
+
+		createIndexBuffer();
+
+		m_effect = new SpriteEffect(device);
+	}
+
+	ParticleSystem::~ParticleSystem()
+	{
+		delete m_effect;
+		delete m_indexBuffer;
+		delete m_vertexBuffer;
+		delete m_declaration;
+	}
+
+	void ParticleSystem::Emit(const Vector2& position, int count)
+	{
+		if (count < 0)
+			throw ArgumentException("count");
+
+		count = std::min(count, m_capacity - m_count);
+
+		const ParticleSettings& s = m_settings;
+		for (int i = m_count; i < m_count + count; i++)
+		{
+			m_positionX[i] = position.X;
+			m_positionY[i] = position.Y;
+			m_velocityX[i] = random(s.MinVelocity.X, s.MaxVelocity.X);
+			m_velocityY[i] = random(s.MinVelocity.Y, s.MaxVelocity.Y);
+			m_rotation[i] = random(s.MinRotation, s.MaxRotation);
+			m_angularVelocity[i] = random(s.MinAngularVelocity, s.MaxAngularVelocity);
+			m_age[i] = 0;
+			m_ageRate[i] = 1.0f / std::max(random(s.MinLifetime, s.MaxLifetime), 0.001f);
+			m_scale[i] = random(s.MinScale, s.MaxScale);
+			m_color[i] = Color::Lerp(s.MinColor, s.MaxColor, random(0, 1.0f)).GetPackedValue();
+		}
+
+		m_count += count;
+	}
+
+	void ParticleSystem::Update(float elapsedSeconds)
+	{
+		NXNA_PROFILE_SCOPE("ParticleSystem::Update");
+
+		integrate(elapsedSeconds);
+		removeDead();
+	}
+
+	void ParticleSystem::integrate(float elapsedSeconds)
+	{
+		float drag = std::max(0.0f, 1.0f - m_settings.Drag * elapsedSeconds);
+		float gravityX = m_settings.Gravity.X * elapsedSeconds;
+		float gravityY = m_settings.Gravity.Y * elapsedSeconds;
+
+		float* x = &m_positionX[0];
+		float* y = &m_positionY[0];
+		float* vx = &m_velocityX[0];
+		float* vy = &m_velocityY[0];
+		float* rotation = &m_rotation[0];
+		const float* angularVelocity = &m_angularVelocity[0];
+		float* age = &m_age[0];
+		const float* ageRate = &m_ageRate[0];
+
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 dt4 = Simd::Splat(elapsedSeconds);
+		Simd::Float4 drag4 = Simd::Splat(drag);
+		Simd::Float4 gravityX4 = Simd::Splat(gravityX);
+		Simd::Float4 gravityY4 = Simd::Splat(gravityY);
+
+		// the arrays are padded, so the last group can run past m_count
+		for (int i = 0; i < m_count; i += 4)
+		{
+			Simd::Float4 newVX = Simd::Multiply(Simd::Add(Simd::Load(vx + i), gravityX4), drag4);
+			Simd::Float4 newVY = Simd::Multiply(Simd::Add(Simd::Load(vy + i), gravityY4), drag4);
+			Simd::Store(newVX, vx + i);
+			Simd::Store(newVY, vy + i);
+			Simd::Store(Simd::MultiplyAdd(newVX, dt4, Simd::Load(x + i)), x + i);
+			Simd::Store(Simd::MultiplyAdd(newVY, dt4, Simd::Load(y + i)), y + i);
+			Simd::Store(Simd::MultiplyAdd(Simd::Load(angularVelocity + i), dt4, Simd::Load(rotation + i)), rotation + i);
+			Simd::Store(Simd::MultiplyAdd(Simd::Load(ageRate + i), dt4, Simd::Load(age + i)), age + i);
+		}
+#else
+		for (int i = 0; i < m_count; i++)
+		{
+			vx[i] = (vx[i] + gravityX) * drag;
+			vy[i] = (vy[i] + gravityY) * drag;
+			x[i] += vx[i] * elapsedSeconds;
+			y[i] += vy[i] * elapsedSeconds;
+			rotation[i] += angularVelocity[i] * elapsedSeconds;
+			age[i] += ageRate[i] * elapsedSeconds;
+		}
+#endif
+	}
+
+	void ParticleSystem::removeDead()
+	{
+		// move the last particle into the dead one's place, so nothing else has to move
+		for (int i = 0; i < m_count;)
+		{
+			if (m_age[i] < 1.0f)
+			{
+				i++;
+				continue;
+			}
+
+			int last = --m_count;
+			m_positionX[i] = m_positionX[last];
+			m_positionY[i] = m_positionY[last];
+			m_velocityX[i] = m_velocityX[last];
+			m_velocityY[i] = m_velocityY[last];
+			m_rotation[i] = m_rotation[last];
+			m_angularVelocity[i] = m_angularVelocity[last];
+			m_age[i] = m_age[last];
+			m_ageRate[i] = m_ageRate[last];
+			m_scale[i] = m_scale[last];
+			m_color[i] = m_color[last];
+		}
+	}
+
+	void ParticleSystem::Draw(const BlendState* blendState)
+	{
+		Draw(blendState, Matrix::Identity);
+	}
+
+	void ParticleSystem::Draw(const BlendState* blendState, const Matrix& transform)
+	{
+		if (m_count == 0)
+			return;
+
+		NXNA_PROFILE_SCOPE("ParticleSystem::Draw");
+
+		float* verts = (float*)NxnaTempMemoryPool::GetMemory(m_count * FloatsPerQuad * sizeof(float));
+
+		Utils::Jobs::ParallelFor(m_count, [this, verts](size_t begin, size_t end)
+		{
+			writeVertices(verts, (int)begin, (int)end);
+		}, 1024);
+
+		m_vertexBuffer->SetData(verts, m_count * 4);
+
+		NxnaTempMemoryPool::ReleaseMemory();
+
+		m_device->SetBlendState(blendState != nullptr ? blendState : BlendState::GetAlphaBlend());
+		m_device->SetRasterizerState(RasterizerState::GetCullNone());
+		m_device->SetDepthStencilState(DepthStencilState::GetNone());
+		m_device->GetSamplerStates().Set(0, SamplerState::GetLinearClamp());
+
+		// pixels to clip space, the same as SpriteBatch
+		Viewport vp = m_device->GetViewport();
+		Matrix projection;
+		Matrix::GetIdentity(projection);
+		projection.M11 = vp.Width > 0 ? 2.0f / vp.Width : 0;
+		projection.M22 = vp.Height > 0 ? -2.0f / vp.Height : 0;
+		projection.M41 = -1.0f;
+		projection.M42 = 1.0f;
+
+		Matrix final;
+		Matrix::Multiply(transform, projection, final);
+
+		m_effect->GetParameter("ModelViewProjection")->SetValue(final);
+		m_effect->GetParameter("Diffuse")->SetValue(m_texture);
+		m_effect->GetCurrentTechnique()->Apply();
+
+		m_device->SetVertexBuffer(m_vertexBuffer);
+		m_device->SetIndices(m_indexBuffer);
+
+		for (int start = 0; start < m_count; start += MaxQuadsPerDraw)
+		{
+			int numQuads = std::min(m_count - start, MaxQuadsPerDraw);
+			m_device->DrawIndexedPrimitives(PrimitiveType::TriangleList, start * 4, 0, numQuads * 4, 0, numQuads * 2);
+		}
+	}
+
+	void ParticleSystem::writeVertices(float* verts, int start, int end)
+	{
+		const float* sizeTable = m_settings.Size.GetTable();
+		const float* alphaTable = m_settings.Alpha.GetTable();
+
+		float inverseTextureWidth = 1.0f / m_texture->GetWidth();
+		float inverseTextureHeight = 1.0f / m_texture->GetHeight();
+		float u1 = m_source.X * inverseTextureWidth;
+		float v1 = m_source.Y * inverseTextureHeight;
+		float u2 = (m_source.X + m_source.Width) * inverseTextureWidth;
+		float v2 = (m_source.Y + m_source.Height) * inverseTextureHeight;
+		float halfWidth = m_source.Width * 0.5f;
+		float halfHeight = m_source.Height * 0.5f;
+
+		for (int i = start; i < end; i++)
+		{
+			int t = (int)(std::min(m_age[i], 1.0f) * (ParticleCurve::TableSize - 1));
+			float size = sizeTable[t] * m_scale[i];
+			float alpha = MathHelper::Clamp(alphaTable[t], 0, 1.0f);
+
+			// premultiply
+			unsigned int c = m_color[i];
+			unsigned int packedColor =
+				(unsigned int)((c & 0xff) * alpha) |
+				(unsigned int)(((c >> 8) & 0xff) * alpha) << 8 |
+				(unsigned int)(((c >> 16) & 0xff) * alpha) << 16 |
+				(unsigned int)((c >> 24) * alpha) << 24;
+
+			float cosine = cos(m_rotation[i]);
+			float sine = sin(m_rotation[i]);
+			float w = halfWidth * size;
+			float h = halfHeight * size;
+
+			// the corners relative to the center, rotated. The other two are these negated.
+			float ax = -w * cosine + h * sine;
+			float ay = -w * sine - h * cosine;
+			float bx = w * cosine + h * sine;
+			float by = w * sine - h * cosine;
+
+			float x = m_positionX[i];
+			float y = m_positionY[i];
+
+			// same corner order as SpriteBatch
+			const float corners[4][4] = {
+				{ x + ax, y + ay, u1, v1 },
+				{ x + bx, y + by, u2, v1 },
+				{ x - ax, y - ay, u2, v2 },
+				{ x - bx, y - by, u1, v2 }
+			};
+
+			float* v = verts + i * FloatsPerQuad;
+			for (int j = 0; j < 4; j++, v += FloatsPerVertex)
+			{
+				v[0] = corners[j][0];
+				v[1] = corners[j][1];
+				v[2] = 0;
+				v[3] = corners[j][2];
+				v[4] = corners[j][3];
+				memcpy(&v[5], &packedColor, sizeof(unsigned int));
+			}
+		}
+	}
+
+	float ParticleSystem::random(float min, float max)
+	{
+		// xorshift. It only needs to look random.
+		m_random ^= m_random << 13;
+		m_random ^= m_random >> 17;
+		m_random ^= m_random << 5;
+
+		return min + (max - min) * ((m_random >> 8) * (1.0f / 16777216.0f));
+	}
+
+	void ParticleSystem::createIndexBuffer()
+	{
+		int numQuads = std::min(m_capacity, MaxQuadsPerDraw);
+
+		std::vector<unsigned short> indices(numQuads * 6);
+		for (int i = 0; i < numQuads; i++)
+		{
+			indices[i * 6 + 0] = (unsigned short)(i * 4);
+			indices[i * 6 + 1] = (unsigned short)(i * 4 + 1);
+			indices[i * 6 + 2] = (unsigned short)(i * 4 + 2);
+			indices[i * 6 + 3] = (unsigned short)(i * 4);
+			indices[i * 6 + 4] = (unsigned short)(i * 4 + 2);
+			indices[i * 6 + 5] = (unsigned short)(i * 4 + 3);
+		}
+
+		m_indexBuffer = new IndexBuffer(m_device, IndexElementSize::SixteenBits);
+		m_indexBuffer->SetData(&indices[0], numQuads * 6);
+	}
+}
+}
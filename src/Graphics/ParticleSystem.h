@@ -0,0 +1,153 @@
+#ifndef NXNA_GRAPHICS_PARTICLESYSTEM_H
+#define NXNA_GRAPHICS_PARTICLESYSTEM_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Vector2.h"
+#include "../Matrix.h"
+#include "../Color.h"
+#include "../Rectangle.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class GraphicsDevice;
+	class Texture2D;
+	class BlendState;
+	class DynamicVertexBuffer;
+	class VertexDeclaration;
+	class IndexBuffer;
+	class SpriteEffect;
+
+	// this class doesn't exist in XNA!
+	// A value that changes over a particle's life. Time goes from 0 (just emitted) to 1 (dead).
+	// The curve is baked into a small table, so evaluating it is just a lookup.
+	class ParticleCurve
+	{
+	public:
+		static const int TableSize = 32;
+
+	private:
+		struct Key
+		{
+			float Time;
+			float Value;
+		};
+
+		std::vector<Key> m_keys;
+		float m_table[TableSize];
+
+	public:
+		ParticleCurve() { Set(1.0f); }
+		ParticleCurve(float start, float end) { Set(start, end); }
+
+		void Set(float value);
+		void Set(float start, float end);
+
+		// keys can be added in any order
+		void AddKey(float time, float value);
+
+		float Evaluate(float time) const;
+		const float* GetTable() const { return m_table; }
+
+	private:
+		void bake();
+	};
+
+	// this class doesn't exist in XNA!
+	// Describes the particles an emitter creates. The Min/Max pairs are picked randomly between for each particle.
+	struct ParticleSettings
+	{
+		float MinLifetime, MaxLifetime;
+		Vector2 MinVelocity, MaxVelocity;
+		float MinRotation, MaxRotation;
+		float MinAngularVelocity, MaxAngularVelocity;
+		float MinScale, MaxScale;
+		Color MinColor, MaxColor;
+
+		// added to the velocity every second
+		Vector2 Gravity;
+
+		// the fraction of the velocity lost every second
+		float Drag;
+
+		// multiplied by the particle's scale and color over its life
+		ParticleCurve Size;
+		ParticleCurve Alpha;
+
+		ParticleSettings()
+		{
+			MinLifetime = MaxLifetime = 1.0f;
+			MinRotation = MaxRotation = 0;
+			MinAngularVelocity = MaxAngularVelocity = 0;
+			MinScale = MaxScale = 1.0f;
+			MinColor = MaxColor = Color(255, 255, 255, 255);
+			Drag = 0;
+			Alpha.Set(1.0f, 0);
+		}
+	};
+
+	// this class doesn't exist in XNA!
+	// Simulates and draws lots of 2D particles that share a texture. The particles are stored
+	// as separate arrays for each property so the update can work on 4 of them at a time,
+	// and they're drawn straight into a vertex buffer instead of going through SpriteBatch.
+	// Nothing is allocated after the constructor. When the system is full, new particles are dropped.
+	class ParticleSystem
+	{
+		GraphicsDevice* m_device;
+		Texture2D* m_texture;
+		Rectangle m_source;
+		ParticleSettings m_settings;
+
+		int m_capacity;
+		int m_count;
+
+		// one array per property, each padded to a multiple of 4
+		std::vector<float> m_positionX, m_positionY;
+		std::vector<float> m_velocityX, m_velocityY;
+		std::vector<float> m_rotation, m_angularVelocity;
+		std::vector<float> m_age, m_ageRate;
+		std::vector<float> m_scale;
+		std::vector<unsigned int> m_color;
+
+		unsigned int m_random;
+
+		VertexDeclaration* m_declaration;
+		DynamicVertexBuffer* m_vertexBuffer;
+		IndexBuffer* m_indexBuffer;
+		SpriteEffect* m_effect;
+
+	public:
+		ParticleSystem(GraphicsDevice* device, Texture2D* texture, int capacity);
+		~ParticleSystem();
+
+		// the part of the texture to draw. Defaults to the whole thing.
+		void SetSourceRectangle(const Rectangle& source) { m_source = source; }
+
+		ParticleSettings& GetSettings() { return m_settings; }
+		void SetSettings(const ParticleSettings& settings) { m_settings = settings; }
+
+		void Emit(const Vector2& position, int count);
+		void Update(float elapsedSeconds);
+		void Clear() { m_count = 0; }
+
+		int GetCount() { return m_count; }
+		int GetCapacity() { return m_capacity; }
+
+		// Positions are in pixels, like SpriteBatch. transform is applied before the projection.
+		// Colors are premultiplied, so use BlendState::GetAdditive() or GetAlphaBlend().
+		void Draw(const BlendState* blendState);
+		void Draw(const BlendState* blendState, const Matrix& transform);
+
+	private:
+		float random(float min, float max);
+		void integrate(float elapsedSeconds);
+		void removeDead();
+		void writeVertices(float* verts, int start, int end);
+		void createIndexBuffer();
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_PARTICLESYSTEM_H
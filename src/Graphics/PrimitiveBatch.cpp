@@ -0,0 +1,618 @@
+#include <cmath>
+#include <algorithm>
+#include "PrimitiveBatch.h"
+#include "BasicEffect.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "../MathSimd.h"
+#include "../MemoryAllocator.h"
+#include "../Exception.h"
+#include "../Utils/Profiler.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	static inline void setVertex(VertexPositionColor* vertex, float x, float y, float z, Color color)
+	{
+		vertex->Position.X = x;
+		vertex->Position.Y = y;
+		vertex->Position.Z = z;
+		vertex->Color = color;
+	}
+
+	// two triangles for each quad of 4 vertices
+	static void writeQuadIndices(unsigned short* indices, int base, int numQuads)
+	{
+		for (int i = 0; i < numQuads; i++)
+		{
+			unsigned short first = (unsigned short)(base + i * 4);
+			indices[i * 6 + 0] = first;
+			indices[i * 6 + 1] = first + 1;
+			indices[i * 6 + 2] = first + 2;
+			indices[i * 6 + 3] = first;
+			indices[i * 6 + 4] = first + 2;
+			indices[i * 6 + 5] = first + 3;
+		}
+	}
+
+	PrimitiveBatch::PrimitiveBatch(GraphicsDevice* device)
+	{
+		m_device = device;
+		m_vertexBuffer = nullptr;
+		m_indexBuffer = nullptr;
+		m_indexBufferSize = 0;
+		m_begun = false;
+		m_pixels = true;
+		m_blend = nullptr;
+		m_depthStencilState = nullptr;
+
+		m_lines.NumVertices = m_lines.NumIndices = 0;
+		m_triangles.NumVertices = m_triangles.NumIndices = 0;
+
+		m_effect = new BasicEffect(device);
+		m_effect->IsVertexColorEnabled(true);
+	}
+
+	PrimitiveBatch::~PrimitiveBatch()
+	{
+		delete m_effect;
+		delete m_vertexBuffer;
+		delete m_indexBuffer;
+	}
+
+	void PrimitiveBatch::Begin()
+	{
+		Begin(nullptr, Matrix::Identity);
+	}
+
+	void PrimitiveBatch::Begin(const BlendState* blendState, const Matrix& transform)
+	{
+		if (m_begun)
+			throw InvalidOperationException("End() must be called before Begin() can be called again");
+
+		m_begun = true;
+		m_pixels = true;
+		m_blend = blendState != nullptr ? blendState : BlendState::GetAlphaBlend();
+		m_depthStencilState = DepthStencilState::GetNone();
+		m_view = transform;
+	}
+
+	void PrimitiveBatch::Begin(const BlendState* blendState, const DepthStencilState* depthStencilState, const Matrix& view, const Matrix& projection)
+	{
+		if (m_begun)
+			throw InvalidOperationException("End() must be called before Begin() can be called again");
+
+		m_begun = true;
+		m_pixels = false;
+		m_blend = blendState != nullptr ? blendState : BlendState::GetAlphaBlend();
+		m_depthStencilState = depthStencilState != nullptr ? depthStencilState : DepthStencilState::GetDefault();
+		m_view = view;
+		m_projection = projection;
+	}
+
+	void PrimitiveBatch::End()
+	{
+		if (m_begun == false)
+			throw InvalidOperationException("Begin() must be called before End()");
+
+		m_begun = false;
+
+		if (m_lines.NumVertices == 0 && m_triangles.NumVertices == 0)
+			return;
+
+		NXNA_PROFILE_SCOPE("PrimitiveBatch::End");
+
+		m_device->SetBlendState(m_blend);
+		m_device->SetDepthStencilState(m_depthStencilState);
+		m_device->SetRasterizerState(RasterizerState::GetCullNone());
+
+		if (m_pixels)
+		{
+			// pixels to clip space, the same as SpriteBatch
+			Viewport vp = m_device->GetViewport();
+			Matrix projection;
+			Matrix::GetIdentity(projection);
+			projection.M11 = vp.Width > 0 ? 2.0f / vp.Width : 0;
+			projection.M22 = vp.Height > 0 ? -2.0f / vp.Height : 0;
+			projection.M41 = -1.0f;
+			projection.M42 = 1.0f;
+
+			m_effect->SetProjection(projection);
+		}
+		else
+		{
+			m_effect->SetProjection(m_projection);
+		}
+
+		m_effect->SetView(m_view);
+		m_effect->GetCurrentTechnique()->Apply();
+
+		flush(&m_triangles, PrimitiveType::TriangleList, 3);
+		flush(&m_lines, PrimitiveType::LineList, 2);
+	}
+
+	void PrimitiveBatch::DrawLine(const Vector3& start, const Vector3& end, Color color)
+	{
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_lines, 2, 2, &vertices, &indices);
+
+		setVertex(&vertices[0], start.X, start.Y, start.Z, color);
+		setVertex(&vertices[1], end.X, end.Y, end.Z, color);
+		indices[0] = (unsigned short)base;
+		indices[1] = (unsigned short)(base + 1);
+	}
+
+	void PrimitiveBatch::DrawLine(const Vector2& start, const Vector2& end, Color color)
+	{
+		DrawLine(Vector3(start.X, start.Y, 0), Vector3(end.X, end.Y, 0), color);
+	}
+
+	void PrimitiveBatch::DrawLine(const Vector2& start, const Vector2& end, Color color, float thickness)
+	{
+		Vector2 points[] = { start, end };
+		DrawLines(points, 2, color, thickness);
+	}
+
+	void PrimitiveBatch::DrawLines(const Vector3* points, int numPoints, Color color)
+	{
+		const int maxLinesPerReserve = MaxVerticesPerDraw / 2;
+
+		int numLines = numPoints / 2;
+		for (int start = 0; start < numLines; start += maxLinesPerReserve)
+		{
+			int count = std::min(numLines - start, maxLinesPerReserve);
+
+			VertexPositionColor* vertices;
+			unsigned short* indices;
+			int base = reserve(&m_lines, count * 2, count * 2, &vertices, &indices);
+
+			const Vector3* p = points + start * 2;
+			for (int i = 0; i < count * 2; i++)
+			{
+				setVertex(&vertices[i], p[i].X, p[i].Y, p[i].Z, color);
+				indices[i] = (unsigned short)(base + i);
+			}
+		}
+	}
+
+	void PrimitiveBatch::DrawLines(const Vector2* points, int numPoints, Color color, float thickness)
+	{
+		const int maxLinesPerReserve = MaxVerticesPerDraw / 4;
+		float halfThickness = thickness * 0.5f;
+
+		int numLines = numPoints / 2;
+		for (int start = 0; start < numLines; start += maxLinesPerReserve)
+		{
+			int count = std::min(numLines - start, maxLinesPerReserve);
+
+			VertexPositionColor* vertices;
+			unsigned short* indices;
+			int base = reserve(&m_triangles, count * 4, count * 6, &vertices, &indices);
+
+			const Vector2* p = points + start * 2;
+
+			// Each line is a quad around it, pushed out along its normal. The normals of 4 lines
+			// are worked out at once, which is most of the work.
+			int i = 0;
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+			Simd::Float4 half = Simd::Splat(halfThickness);
+
+			// keeps zero length lines from dividing by zero. They end up as empty quads.
+			Simd::Float4 tiny = Simd::Splat(1e-20f);
+
+			for (; i + 4 <= count; i += 4)
+			{
+				float ax[4], ay[4], bx[4], by[4];
+				for (int j = 0; j < 4; j++)
+				{
+					ax[j] = p[(i + j) * 2].X;
+					ay[j] = p[(i + j) * 2].Y;
+					bx[j] = p[(i + j) * 2 + 1].X;
+					by[j] = p[(i + j) * 2 + 1].Y;
+				}
+
+				Simd::Float4 x0 = Simd::Load(ax);
+				Simd::Float4 y0 = Simd::Load(ay);
+				Simd::Float4 x1 = Simd::Load(bx);
+				Simd::Float4 y1 = Simd::Load(by);
+
+				Simd::Float4 dx = Simd::Subtract(x1, x0);
+				Simd::Float4 dy = Simd::Subtract(y1, y0);
+				Simd::Float4 lengthSquared = Simd::MultiplyAdd(dx, dx, Simd::MultiplyAdd(dy, dy, tiny));
+				Simd::Float4 scale = Simd::Multiply(Simd::ReciprocalSqrt(lengthSquared), half);
+
+				// the normal is (ny, -nx)
+				Simd::Float4 nx = Simd::Multiply(dx, scale);
+				Simd::Float4 ny = Simd::Multiply(dy, scale);
+
+				float cx[4][4], cy[4][4];
+				Simd::Store(Simd::Add(x0, ny), cx[0]);
+				Simd::Store(Simd::Subtract(y0, nx), cy[0]);
+				Simd::Store(Simd::Subtract(x0, ny), cx[1]);
+				Simd::Store(Simd::Add(y0, nx), cy[1]);
+				Simd::Store(Simd::Subtract(x1, ny), cx[2]);
+				Simd::Store(Simd::Add(y1, nx), cy[2]);
+				Simd::Store(Simd::Add(x1, ny), cx[3]);
+				Simd::Store(Simd::Subtract(y1, nx), cy[3]);
+
+				for (int j = 0; j < 4; j++)
+				{
+					VertexPositionColor* v = vertices + (i + j) * 4;
+					for (int k = 0; k < 4; k++)
+						setVertex(&v[k], cx[k][j], cy[k][j], 0, color);
+				}
+			}
+#endif
+
+			for (; i < count; i++)
+			{
+				const Vector2& a = p[i * 2];
+				const Vector2& b = p[i * 2 + 1];
+
+				float dx = b.X - a.X;
+				float dy = b.Y - a.Y;
+				float length = sqrtf(dx * dx + dy * dy);
+				float scale = length > 0 ? halfThickness / length : 0;
+				float nx = dx * scale;
+				float ny = dy * scale;
+
+				VertexPositionColor* v = vertices + i * 4;
+				setVertex(&v[0], a.X + ny, a.Y - nx, 0, color);
+				setVertex(&v[1], a.X - ny, a.Y + nx, 0, color);
+				setVertex(&v[2], b.X - ny, b.Y + nx, 0, color);
+				setVertex(&v[3], b.X + ny, b.Y - nx, 0, color);
+			}
+
+			writeQuadIndices(indices, base, count);
+		}
+	}
+
+	void PrimitiveBatch::DrawRectangle(const Rectangle& rectangle, Color color)
+	{
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_lines, 4, 8, &vertices, &indices);
+
+		float left = (float)rectangle.X;
+		float top = (float)rectangle.Y;
+		float right = (float)(rectangle.X + rectangle.Width);
+		float bottom = (float)(rectangle.Y + rectangle.Height);
+
+		setVertex(&vertices[0], left, top, 0, color);
+		setVertex(&vertices[1], right, top, 0, color);
+		setVertex(&vertices[2], right, bottom, 0, color);
+		setVertex(&vertices[3], left, bottom, 0, color);
+
+		for (int i = 0; i < 4; i++)
+		{
+			indices[i * 2] = (unsigned short)(base + i);
+			indices[i * 2 + 1] = (unsigned short)(base + (i + 1) % 4);
+		}
+	}
+
+	void PrimitiveBatch::DrawRectangle(const Rectangle& rectangle, Color color, float thickness)
+	{
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_triangles, 8, 24, &vertices, &indices);
+
+		// the border is centered on the edges, and made of a quad for each side
+		float half = thickness * 0.5f;
+		float left = (float)rectangle.X;
+		float top = (float)rectangle.Y;
+		float right = (float)(rectangle.X + rectangle.Width);
+		float bottom = (float)(rectangle.Y + rectangle.Height);
+
+		setVertex(&vertices[0], left - half, top - half, 0, color);
+		setVertex(&vertices[1], right + half, top - half, 0, color);
+		setVertex(&vertices[2], right + half, bottom + half, 0, color);
+		setVertex(&vertices[3], left - half, bottom + half, 0, color);
+		setVertex(&vertices[4], left + half, top + half, 0, color);
+		setVertex(&vertices[5], right - half, top + half, 0, color);
+		setVertex(&vertices[6], right - half, bottom - half, 0, color);
+		setVertex(&vertices[7], left + half, bottom - half, 0, color);
+
+		for (int i = 0; i < 4; i++)
+		{
+			unsigned short outer = (unsigned short)(base + i);
+			unsigned short nextOuter = (unsigned short)(base + (i + 1) % 4);
+			unsigned short inner = outer + 4;
+			unsigned short nextInner = nextOuter + 4;
+
+			indices[i * 6 + 0] = outer;
+			indices[i * 6 + 1] = nextOuter;
+			indices[i * 6 + 2] = nextInner;
+			indices[i * 6 + 3] = outer;
+			indices[i * 6 + 4] = nextInner;
+			indices[i * 6 + 5] = inner;
+		}
+	}
+
+	void PrimitiveBatch::FillRectangle(const Rectangle& rectangle, Color color)
+	{
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_triangles, 4, 6, &vertices, &indices);
+
+		float left = (float)rectangle.X;
+		float top = (float)rectangle.Y;
+		float right = (float)(rectangle.X + rectangle.Width);
+		float bottom = (float)(rectangle.Y + rectangle.Height);
+
+		setVertex(&vertices[0], left, top, 0, color);
+		setVertex(&vertices[1], right, top, 0, color);
+		setVertex(&vertices[2], right, bottom, 0, color);
+		setVertex(&vertices[3], left, bottom, 0, color);
+
+		writeQuadIndices(indices, base, 1);
+	}
+
+	void PrimitiveBatch::DrawCircle(const Vector2& center, float radius, Color color, int segments)
+	{
+		if (segments < 3)
+			segments = 3;
+
+		float* directions = (float*)NxnaTempMemoryPool::GetMemory(sizeof(float) * 2 * segments);
+		float* cosines = directions;
+		float* sines = directions + segments;
+		getDirections(0, 6.28318531f / segments, segments, cosines, sines);
+
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_lines, segments, segments * 2, &vertices, &indices);
+
+		for (int i = 0; i < segments; i++)
+		{
+			setVertex(&vertices[i], center.X + cosines[i] * radius, center.Y + sines[i] * radius, 0, color);
+
+			indices[i * 2] = (unsigned short)(base + i);
+			indices[i * 2 + 1] = (unsigned short)(base + (i + 1) % segments);
+		}
+
+		NxnaTempMemoryPool::ReleaseMemory();
+	}
+
+	void PrimitiveBatch::FillCircle(const Vector2& center, float radius, Color color, int segments)
+	{
+		if (segments < 3)
+			segments = 3;
+
+		float* directions = (float*)NxnaTempMemoryPool::GetMemory(sizeof(float) * 2 * segments);
+		float* cosines = directions;
+		float* sines = directions + segments;
+		getDirections(0, 6.28318531f / segments, segments, cosines, sines);
+
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_triangles, segments + 1, segments * 3, &vertices, &indices);
+
+		// a fan around the center
+		setVertex(&vertices[0], center.X, center.Y, 0, color);
+		for (int i = 0; i < segments; i++)
+		{
+			setVertex(&vertices[i + 1], center.X + cosines[i] * radius, center.Y + sines[i] * radius, 0, color);
+
+			indices[i * 3 + 0] = (unsigned short)base;
+			indices[i * 3 + 1] = (unsigned short)(base + 1 + i);
+			indices[i * 3 + 2] = (unsigned short)(base + 1 + (i + 1) % segments);
+		}
+
+		NxnaTempMemoryPool::ReleaseMemory();
+	}
+
+	void PrimitiveBatch::DrawArc(const Vector2& center, float radius, float startAngle, float sweep, Color color, float thickness, int segments)
+	{
+		if (segments < 1)
+			segments = 1;
+
+		int numPoints = segments + 1;
+		float* directions = (float*)NxnaTempMemoryPool::GetMemory(sizeof(float) * 2 * numPoints);
+		float* cosines = directions;
+		float* sines = directions + numPoints;
+		getDirections(startAngle, sweep / segments, numPoints, cosines, sines);
+
+		addRing(center, cosines, sines, numPoints, radius - thickness * 0.5f, radius + thickness * 0.5f, false, color);
+
+		NxnaTempMemoryPool::ReleaseMemory();
+	}
+
+	void PrimitiveBatch::DrawPolygon(const Vector2* points, int numPoints, Color color)
+	{
+		if (numPoints < 2)
+			return;
+
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_lines, numPoints, numPoints * 2, &vertices, &indices);
+
+		for (int i = 0; i < numPoints; i++)
+		{
+			setVertex(&vertices[i], points[i].X, points[i].Y, 0, color);
+
+			indices[i * 2] = (unsigned short)(base + i);
+			indices[i * 2 + 1] = (unsigned short)(base + (i + 1) % numPoints);
+		}
+	}
+
+	void PrimitiveBatch::FillPolygon(const Vector2* points, int numPoints, Color color)
+	{
+		if (numPoints < 3)
+			return;
+
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_triangles, numPoints, (numPoints - 2) * 3, &vertices, &indices);
+
+		for (int i = 0; i < numPoints; i++)
+			setVertex(&vertices[i], points[i].X, points[i].Y, 0, color);
+
+		// a fan from the first point, which is why it has to be convex
+		for (int i = 0; i < numPoints - 2; i++)
+		{
+			indices[i * 3 + 0] = (unsigned short)base;
+			indices[i * 3 + 1] = (unsigned short)(base + i + 1);
+			indices[i * 3 + 2] = (unsigned short)(base + i + 2);
+		}
+	}
+
+	void PrimitiveBatch::FillTriangle(const Vector3& a, const Vector3& b, const Vector3& c, Color color)
+	{
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_triangles, 3, 3, &vertices, &indices);
+
+		setVertex(&vertices[0], a.X, a.Y, a.Z, color);
+		setVertex(&vertices[1], b.X, b.Y, b.Z, color);
+		setVertex(&vertices[2], c.X, c.Y, c.Z, color);
+
+		for (int i = 0; i < 3; i++)
+			indices[i] = (unsigned short)(base + i);
+	}
+
+	int PrimitiveBatch::reserve(Bucket* bucket, int numVertices, int numIndices, VertexPositionColor** vertices, unsigned short** indices)
+	{
+		if (m_begun == false)
+			throw InvalidOperationException("Begin() must be called before drawing");
+		if (numVertices > MaxVerticesPerDraw)
+			throw ArgumentException("Too many vertices for one shape");
+
+		// a new draw is started when the indices wouldn't fit in 16 bits anymore
+		if (bucket->Draws.empty() || bucket->NumVertices + numVertices - bucket->Draws.back().FirstVertex > MaxVerticesPerDraw)
+		{
+			DrawRange draw;
+			draw.FirstVertex = bucket->NumVertices;
+			draw.FirstIndex = bucket->NumIndices;
+			bucket->Draws.push_back(draw);
+		}
+
+		if (bucket->NumVertices + numVertices > (int)bucket->Vertices.size())
+			bucket->Vertices.resize(std::max(bucket->Vertices.size() * 2, (size_t)std::max(bucket->NumVertices + numVertices, 1024)));
+		if (bucket->NumIndices + numIndices > (int)bucket->Indices.size())
+			bucket->Indices.resize(std::max(bucket->Indices.size() * 2, (size_t)std::max(bucket->NumIndices + numIndices, 2048)));
+
+		*vertices = &bucket->Vertices[bucket->NumVertices];
+		*indices = &bucket->Indices[bucket->NumIndices];
+
+		int base = bucket->NumVertices - bucket->Draws.back().FirstVertex;
+
+		bucket->NumVertices += numVertices;
+		bucket->NumIndices += numIndices;
+
+		return base;
+	}
+
+	void PrimitiveBatch::addRing(const Vector2& center, const float* cosines, const float* sines, int numPoints,
+		float innerRadius, float outerRadius, bool closed, Color color)
+	{
+		int numQuads = closed ? numPoints : numPoints - 1;
+
+		VertexPositionColor* vertices;
+		unsigned short* indices;
+		int base = reserve(&m_triangles, numPoints * 2, numQuads * 6, &vertices, &indices);
+
+		for (int i = 0; i < numPoints; i++)
+		{
+			setVertex(&vertices[i * 2], center.X + cosines[i] * outerRadius, center.Y + sines[i] * outerRadius, 0, color);
+			setVertex(&vertices[i * 2 + 1], center.X + cosines[i] * innerRadius, center.Y + sines[i] * innerRadius, 0, color);
+		}
+
+		for (int i = 0; i < numQuads; i++)
+		{
+			unsigned short outer = (unsigned short)(base + i * 2);
+			unsigned short nextOuter = (unsigned short)(base + ((i + 1) % numPoints) * 2);
+
+			indices[i * 6 + 0] = outer;
+			indices[i * 6 + 1] = nextOuter;
+			indices[i * 6 + 2] = nextOuter + 1;
+			indices[i * 6 + 3] = outer;
+			indices[i * 6 + 4] = nextOuter + 1;
+			indices[i * 6 + 5] = outer + 1;
+		}
+	}
+
+	void PrimitiveBatch::getDirections(float startAngle, float step, int count, float* cosines, float* sines)
+	{
+		int i = 0;
+
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		// The first 4 directions are worked out directly, and each group of 4 after that is the one
+		// before it rotated by 4 steps. That's only a few multiplies per point instead of a sin() and
+		// cos(), and the error after a few hundred rotations is still far below a pixel.
+		if (count >= 4)
+		{
+			float c[4], s[4];
+			for (int j = 0; j < 4; j++)
+			{
+				c[j] = cosf(startAngle + step * j);
+				s[j] = sinf(startAngle + step * j);
+			}
+
+			Simd::Float4 cos4 = Simd::Load(c);
+			Simd::Float4 sin4 = Simd::Load(s);
+			Simd::Float4 rotateCos = Simd::Splat(cosf(step * 4));
+			Simd::Float4 rotateSin = Simd::Splat(sinf(step * 4));
+			Simd::Float4 negativeRotateSin = Simd::Splat(-sinf(step * 4));
+
+			for (; i + 4 <= count; i += 4)
+			{
+				Simd::Store(cos4, cosines + i);
+				Simd::Store(sin4, sines + i);
+
+				Simd::Float4 nextCos = Simd::MultiplyAdd(sin4, negativeRotateSin, Simd::Multiply(cos4, rotateCos));
+				sin4 = Simd::MultiplyAdd(cos4, rotateSin, Simd::Multiply(sin4, rotateCos));
+				cos4 = nextCos;
+			}
+		}
+#endif
+
+		for (; i < count; i++)
+		{
+			cosines[i] = cosf(startAngle + step * i);
+			sines[i] = sinf(startAngle + step * i);
+		}
+	}
+
+	void PrimitiveBatch::flush(Bucket* bucket, PrimitiveType primitiveType, int indicesPerPrimitive)
+	{
+		if (bucket->NumVertices == 0)
+			return;
+
+		if (m_vertexBuffer == nullptr || m_vertexBuffer->GetVertexCount() < bucket->NumVertices)
+		{
+			delete m_vertexBuffer;
+			m_vertexBuffer = new DynamicVertexBuffer(m_device, VertexPositionColor::GetVertexDeclaration(), bucket->NumVertices * 2, BufferUsage::WriteOnly);
+		}
+
+		if (m_indexBufferSize < bucket->NumIndices)
+		{
+			delete m_indexBuffer;
+			m_indexBufferSize = bucket->NumIndices * 2;
+			m_indexBuffer = new IndexBuffer(m_device, IndexElementSize::SixteenBits, m_indexBufferSize, BufferUsage::WriteOnly);
+		}
+
+		m_vertexBuffer->SetData(&bucket->Vertices[0], bucket->NumVertices);
+		m_indexBuffer->SetData(&bucket->Indices[0], bucket->NumIndices);
+
+		m_device->SetVertexBuffer(m_vertexBuffer);
+		m_device->SetIndices(m_indexBuffer);
+
+		for (std::vector<DrawRange>::size_type i = 0; i < bucket->Draws.size(); i++)
+		{
+			const DrawRange& draw = bucket->Draws[i];
+
+			bool last = i + 1 == bucket->Draws.size();
+			int endVertex = last ? bucket->NumVertices : bucket->Draws[i + 1].FirstVertex;
+			int endIndex = last ? bucket->NumIndices : bucket->Draws[i + 1].FirstIndex;
+
+			m_device->DrawIndexedPrimitives(primitiveType, draw.FirstVertex, 0, endVertex - draw.FirstVertex,
+				draw.FirstIndex, (endIndex - draw.FirstIndex) / indicesPerPrimitive);
+		}
+
+		bucket->NumVertices = 0;
+		bucket->NumIndices = 0;
+		bucket->Draws.clear();
+	}
+}
+}
@@ -0,0 +1,116 @@
+#ifndef NXNA_GRAPHICS_PRIMITIVEBATCH_H
+#define NXNA_GRAPHICS_PRIMITIVEBATCH_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Vector2.h"
+#include "../Vector3.h"
+#include "../Matrix.h"
+#include "../Color.h"
+#include "../Rectangle.h"
+#include "GraphicsDevice.h"
+#include "VertexPositionColor.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class DynamicVertexBuffer;
+	class IndexBuffer;
+	class BasicEffect;
+
+	// this class doesn't exist in XNA!
+	// Draws lines and untextured shapes, like debug overlays and UI outlines, without a sprite for each one.
+	// Everything between Begin() and End() goes into two lists, one of lines and one of triangles, which
+	// End() draws with one DrawIndexedPrimitives() each (or one per 65536 vertices, since the indices are
+	// 16 bits). The triangles are drawn first, so lines go on top of shapes from the same batch.
+	//
+	// The Vector2 methods work in pixels, like SpriteBatch, unless Begin() was given a view and projection.
+	// "Draw" methods draw outlines and "Fill" methods fill the shape in. Outlines without a thickness
+	// use hardware lines (1 pixel wide), and ones with a thickness are made of triangles.
+	// Colors are premultiplied, like everywhere else.
+	class PrimitiveBatch
+	{
+		static const int MaxVerticesPerDraw = 65536;
+
+		struct DrawRange
+		{
+			int FirstVertex;
+			int FirstIndex;
+		};
+
+		// the vectors only ever grow, so filling them doesn't allocate once they're big enough
+		struct Bucket
+		{
+			std::vector<VertexPositionColor> Vertices;
+			std::vector<unsigned short> Indices;
+			std::vector<DrawRange> Draws;
+			int NumVertices;
+			int NumIndices;
+		};
+
+		GraphicsDevice* m_device;
+		BasicEffect* m_effect;
+		DynamicVertexBuffer* m_vertexBuffer;
+		IndexBuffer* m_indexBuffer;
+		int m_indexBufferSize;
+
+		Bucket m_lines;
+		Bucket m_triangles;
+
+		bool m_begun;
+		bool m_pixels;
+		const BlendState* m_blend;
+		const DepthStencilState* m_depthStencilState;
+		Matrix m_view;
+		Matrix m_projection;
+
+	public:
+		PrimitiveBatch(GraphicsDevice* device);
+		~PrimitiveBatch();
+
+		void Begin();
+
+		// transform is applied before the pixels are projected, like SpriteBatch's
+		void Begin(const BlendState* blendState, const Matrix& transform);
+
+		// for 3D debug geometry
+		void Begin(const BlendState* blendState, const DepthStencilState* depthStencilState, const Matrix& view, const Matrix& projection);
+
+		void End();
+
+		void DrawLine(const Vector3& start, const Vector3& end, Color color);
+		void DrawLine(const Vector2& start, const Vector2& end, Color color);
+		void DrawLine(const Vector2& start, const Vector2& end, Color color, float thickness);
+
+		// each pair of points is a line
+		void DrawLines(const Vector3* points, int numPoints, Color color);
+		void DrawLines(const Vector2* points, int numPoints, Color color, float thickness);
+
+		void DrawRectangle(const Rectangle& rectangle, Color color);
+		void DrawRectangle(const Rectangle& rectangle, Color color, float thickness);
+		void FillRectangle(const Rectangle& rectangle, Color color);
+
+		void DrawCircle(const Vector2& center, float radius, Color color, int segments = 32);
+		void FillCircle(const Vector2& center, float radius, Color color, int segments = 32);
+
+		// angles are in radians, clockwise on screen from +X. The thickness is centered on the radius.
+		void DrawArc(const Vector2& center, float radius, float startAngle, float sweep, Color color, float thickness, int segments = 32);
+
+		// The outline is closed. Filled polygons have to be convex.
+		void DrawPolygon(const Vector2* points, int numPoints, Color color);
+		void FillPolygon(const Vector2* points, int numPoints, Color color);
+
+		void FillTriangle(const Vector3& a, const Vector3& b, const Vector3& c, Color color);
+
+	private:
+		int reserve(Bucket* bucket, int numVertices, int numIndices, VertexPositionColor** vertices, unsigned short** indices);
+		void addRing(const Vector2& center, const float* cosines, const float* sines, int numPoints,
+			float innerRadius, float outerRadius, bool closed, Color color);
+		void flush(Bucket* bucket, PrimitiveType primitiveType, int indicesPerPrimitive);
+		static void getDirections(float startAngle, float step, int count, float* cosines, float* sines);
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_PRIMITIVEBATCH_H
@@ -0,0 +1,140 @@
+#include <cstring>
+#include "SkinnedEffect.h"
+#include "IEffectPimpl.h"
+
+// there's no HLSL version, so it's the same everywhere
+#include "Effects/SkinnedEffect.inc"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// this has to happen before Effect tries to load the shaders
+	static GraphicsDevice* checkDevice(GraphicsDevice* device)
+	{
+		if (strcmp(device->GetRendererName(), "OpenGL") != 0)
+			throw NotSupportedException("SkinnedEffect is only supported with OpenGL");
+
+		return device;
+	}
+
+	SkinnedEffect::SkinnedEffect(GraphicsDevice* device)
+		: Effect(checkDevice(device), (byte*)SkinnedEffect_bytecode, sizeof(SkinnedEffect_bytecode))
+	{
+		m_texture = nullptr;
+		m_weightsPerVertex = 4;
+		m_finalTransformDirty = true;
+		m_colorDirty = true;
+
+		m_world = Matrix::Identity;
+		m_view = Matrix::Identity;
+		m_projection = Matrix::Identity;
+
+		m_diffuse.X = m_diffuse.Y = m_diffuse.Z = 1.0f;
+		m_alpha = 1.0f;
+
+		m_transformParameter = GetParameter("ModelViewProjection");
+		m_diffuseParameter = GetParameter("Diffuse");
+		m_diffuseColorParameter = GetParameter("DiffuseColor");
+		m_bonesParameter = GetParameter("Bones");
+
+		// the shader has fewer bones when the device doesn't have room for all of them
+		m_maxBones = MaxBones;
+		if (m_bonesParameter != nullptr && m_bonesParameter->GetCount() / 3 < MaxBones)
+			m_maxBones = m_bonesParameter->GetCount() / 3;
+
+		// XNA starts them all as the identity
+		Matrix identity[MaxBones];
+		for (int i = 0; i < MaxBones; i++)
+			identity[i] = Matrix::Identity;
+		SetBoneTransforms(identity, MaxBones);
+	}
+
+	void SkinnedEffect::SetWeightsPerVertex(int weights)
+	{
+		if (weights != 1 && weights != 2 && weights != 4)
+			throw ArgumentException("weights");
+
+		m_weightsPerVertex = weights;
+	}
+
+	void SkinnedEffect::SetBoneTransforms(const Matrix* transforms, int count)
+	{
+		if (count > MaxBones)
+			throw ArgumentException("count");
+
+		// the columns, since the shader does each of x, y and z with a dot product
+		for (int i = 0; i < count; i++)
+		{
+			const Matrix& m = transforms[i];
+			m_bones[i * 3 + 0] = Vector4(m.M11, m.M21, m.M31, m.M41);
+			m_bones[i * 3 + 1] = Vector4(m.M12, m.M22, m.M32, m.M42);
+			m_bones[i * 3 + 2] = Vector4(m.M13, m.M23, m.M33, m.M43);
+		}
+
+		if (m_bonesParameter != nullptr)
+			m_bonesParameter->SetValue(m_bones, (count < m_maxBones ? count : m_maxBones) * 3);
+	}
+
+	void SkinnedEffect::GetBoneTransforms(Matrix* transforms, int count)
+	{
+		if (count > MaxBones)
+			throw ArgumentException("count");
+
+		for (int i = 0; i < count; i++)
+		{
+			const Vector4& c0 = m_bones[i * 3 + 0];
+			const Vector4& c1 = m_bones[i * 3 + 1];
+			const Vector4& c2 = m_bones[i * 3 + 2];
+
+			transforms[i] = Matrix(c0.X, c1.X, c2.X, 0,
+				c0.Y, c1.Y, c2.Y, 0,
+				c0.Z, c1.Z, c2.Z, 0,
+				c0.W, c1.W, c2.W, 1.0f);
+		}
+	}
+
+	void SkinnedEffect::SetTexture(Texture2D* texture)
+	{
+		assert(m_diffuseParameter != nullptr);
+		assert(m_diffuseParameter->GetType() == EffectParameterType::Texture2D);
+
+		m_diffuseParameter->SetValue(texture);
+		m_texture = texture;
+	}
+
+	void SkinnedEffect::OnApply()
+	{
+		if (m_finalTransformDirty)
+		{
+			Matrix worldView;
+			Matrix::Multiply(m_world, m_view, worldView);
+			Matrix::Multiply(worldView, m_projection, m_finalTransform);
+
+			m_finalTransformDirty = false;
+		}
+
+		m_transformParameter->SetValue(m_finalTransform.C);
+
+		if (m_colorDirty)
+		{
+			Nxna::Vector4 color;
+			color.X = m_diffuse.X * m_alpha;
+			color.Y = m_diffuse.Y * m_alpha;
+			color.Z = m_diffuse.Z * m_alpha;
+			color.W = m_alpha;
+
+			m_diffuseColorParameter->SetValue(color);
+
+			m_colorDirty = false;
+		}
+
+		if (m_weightsPerVertex == 1)
+			m_pimpl->Apply(0);
+		else if (m_weightsPerVertex == 2)
+			m_pimpl->Apply(1);
+		else
+			m_pimpl->Apply(2);
+	}
+}
+}
@@ -0,0 +1,108 @@
+#ifndef GRAPHICS_SKINNEDEFFECT_H
+#define GRAPHICS_SKINNEDEFFECT_H
+
+#include "Effect.h"
+#include "GraphicsDevice.h"
+#include "../Matrix.h"
+#include "../Vector4.h"
+
+NXNA_DISABLE_OVERRIDE_WARNING
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class GraphicsDevice;
+	class Texture2D;
+
+	// Only available with OpenGL (it throws NotSupportedException on anything else).
+	// There's no lighting, same as BasicEffect.
+	// The vertices need BlendIndices (usually Byte4) and BlendWeight elements.
+	class SkinnedEffect : public Effect
+	{
+	public:
+		static const int MaxBones = 72;
+
+	private:
+		Texture2D* m_texture;
+		int m_weightsPerVertex;
+		int m_maxBones;
+
+		Matrix m_world;
+		Matrix m_view;
+		Matrix m_projection;
+		Matrix m_finalTransform;
+		bool m_finalTransformDirty;
+
+		Vector3 m_diffuse;
+		float m_alpha;
+		bool m_colorDirty;
+
+		// the shader only needs the first 3 columns of each bone, so that's what's kept
+		Vector4 m_bones[MaxBones * 3];
+
+		EffectParameter* m_transformParameter;
+		EffectParameter* m_diffuseParameter;
+		EffectParameter* m_diffuseColorParameter;
+		EffectParameter* m_bonesParameter;
+
+	public:
+
+		SkinnedEffect(GraphicsDevice* device);
+		virtual ~SkinnedEffect() {}
+
+		// 1, 2 or 4
+		int GetWeightsPerVertex() { return m_weightsPerVertex; }
+		void SetWeightsPerVertex(int weights);
+
+		void SetBoneTransforms(const Matrix* transforms, int count);
+		void GetBoneTransforms(Matrix* transforms, int count);
+
+		// Not part of XNA. How many bones the shader really has, which is less than MaxBones
+		// when the device doesn't have enough vertex uniforms (GL 2 and GLES 2 often don't).
+		// Bones past this are kept, but vertices can't use them.
+		int GetMaxBones() { return m_maxBones; }
+
+		void SetWorld(const Matrix& matrix)
+		{
+			m_world = matrix;
+			m_finalTransformDirty = true;
+		}
+
+		void SetView(const Matrix& matrix)
+		{
+			m_view = matrix;
+			m_finalTransformDirty = true;
+		}
+
+		void SetProjection(const Matrix& matrix)
+		{
+			m_projection = matrix;
+			m_finalTransformDirty = true;
+		}
+
+		void SetTexture(Texture2D* texture);
+		Texture2D* GetTexture() { return m_texture; }
+
+		void SetDiffuse(const Nxna::Vector3& color)
+		{
+			m_diffuse = color;
+			m_colorDirty = true;
+		}
+
+		void SetAlpha(float alpha)
+		{
+			m_alpha = alpha;
+			m_colorDirty = true;
+		}
+
+	protected:
+
+		virtual void OnApply() override;
+	};
+}
+}
+
+NXNA_ENABLE_OVERRIDE_WARNING
+
+#endif // GRAPHICS_SKINNEDEFFECT_H
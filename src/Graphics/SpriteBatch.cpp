@@ -1,8 +1,13 @@
 #include <cassert>
+#include <algorithm>
+#include <cmath>
 #include "SpriteBatch.h"
 #include "SpriteFont.h"
 #include "SpriteEffect.h"
 #include "Texture2D.h"
+#include "TextureAtlas.h"
+#include "TextLayout.h"
+#include "TextureStreamer.h"
 #include "Effect.h"
 #include "VertexBuffer.h"
 #include "IndexBuffer.h"
@@ -10,6 +15,11 @@
 #include "../MathHelper.h"
 #include "../Utils.h"
 #include "../MemoryAllocator.h"
+#include "../Utils/Profiler.h"
+#include "../Utils/Jobs.h"
+#include "GraphicsDeviceCapabilities.h"
+
+#include "Effects/SpriteInstancedEffect.inc"
 
 namespace Nxna
 {
@@ -19,7 +29,12 @@ namespace Graphics
 	DynamicVertexBuffer* SpriteBatch::m_vertexBuffer = nullptr;
 	IndexBuffer* SpriteBatch::m_indexBuffer = nullptr;
 	VertexDeclaration* SpriteBatch::m_declaration = nullptr;
-
+	Effect* SpriteBatch::m_instancedEffect = nullptr;
+	VertexDeclaration* SpriteBatch::m_instanceDeclaration = nullptr;
+	VertexDeclaration* SpriteBatch::m_cornerDeclaration = nullptr;
+	DynamicVertexBuffer* SpriteBatch::m_instanceBuffer = nullptr;
+	VertexBuffer* SpriteBatch::m_cornerBuffer = nullptr;
+	EffectParameter* SpriteBatch::m_instancedTextures[SpriteBatch::MAX_INSTANCED_TEXTURES];
 
 	SpriteBatch::SpriteBatch(GraphicsDevice* device)
 	{
@@ -45,11 +60,16 @@ namespace Graphics
 		{
 			m_effect = new SpriteEffect(device);
 		}
+
+		if (m_instancedEffect == nullptr && device->GetCaps()->SupportsInstancing)
+		{
+			createInstancingResources();
+		}
 	}
 
 	void SpriteBatch::Begin()
 	{
-		Begin(SpriteSortMode::Texture, nullptr, nullptr, 
+		Begin(SpriteSortMode::Deferred, nullptr, nullptr, 
 			nullptr, nullptr, Nxna::Matrix::Identity);
 	}
 
@@ -83,6 +103,11 @@ namespace Graphics
 		m_customTransform = transform;
 		m_customEffect = effect;
 
+		// one stream for the main thread and one for each worker
+		size_t numStreams = (size_t)Utils::Jobs::GetNumWorkers() + 1;
+		if (m_streams.size() < numStreams)
+			m_streams.resize(numStreams);
+
 		if (depthStencilState == nullptr)
 			m_depthStencilState = DepthStencilState::GetNone();
 		else
@@ -106,6 +131,9 @@ namespace Graphics
 			setRenderStates();
 		}
 
+		mergeStreams();
+		sortSprites();
+
         flush();
 	}
 
@@ -174,7 +202,7 @@ namespace Graphics
 			s.Source.W = (float)texture->GetHeight();
 		}
 
-		m_sprites.push_back(s);
+		getStream().Sprites.push_back(s);
 	}
 
 	void SpriteBatch::Draw(Texture2D* texture, const Rectangle& destinationRectangle, Color color)
@@ -198,7 +226,7 @@ namespace Graphics
 		s.Source.Z = (float)texture->GetWidth();
 		s.Source.W = (float)texture->GetHeight();
 
-		m_sprites.push_back(s);
+		getStream().Sprites.push_back(s);
 	}
 
 	void SpriteBatch::Draw(Texture2D* texture, const Vector2& position, const Rectangle* sourceRectangle, Color color,
@@ -278,7 +306,29 @@ namespace Graphics
 			s.Source.W = (float)texture->GetHeight();
 		}
 
-		m_sprites.push_back(s);
+		getStream().Sprites.push_back(s);
+	}
+
+	void SpriteBatch::Draw(AtlasRegion* region, const Vector2& position, Color color)
+	{
+		assert(region != nullptr);
+
+		Draw(region->GetTexture(), position, &region->GetSourceRectangle(), color);
+	}
+
+	void SpriteBatch::Draw(AtlasRegion* region, const Rectangle& destinationRectangle, Color color)
+	{
+		assert(region != nullptr);
+
+		Draw(region->GetTexture(), destinationRectangle, &region->GetSourceRectangle(), color);
+	}
+
+	void SpriteBatch::Draw(AtlasRegion* region, const Vector2& position, Color color,
+		float rotation, const Vector2& origin, const Vector2& scale, SpriteEffects effects, float layerDepth)
+	{
+		assert(region != nullptr);
+
+		Draw(region->GetTexture(), position, &region->GetSourceRectangle(), color, rotation, origin, scale, effects, layerDepth);
 	}
 
 	void SpriteBatch::DrawString(SpriteFont* spriteFont, const char* text, const Vector2& position, Color color)
@@ -299,75 +349,19 @@ namespace Graphics
 	void SpriteBatch::DrawString(SpriteFont* spriteFont, const char* text, const Vector2& position, Color color,
 		float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth)
 	{
-		Matrix rotationMatrix;
-		Matrix::CreateRotationZ(rotation, rotationMatrix);
-		Matrix translationMatrix;
-		Matrix::CreateTranslation(-origin.X * scale, -origin.Y * scale, 0, translationMatrix);
-		Matrix transform;
-		Matrix::Multiply(translationMatrix, rotationMatrix, transform);
-
-		// TODO: do the sprite effects
-
-		Vector2 cursor;
+		std::vector<int>& glyphIndices = getStream().GlyphIndices;
+		spriteFont->getCharacterIndices(text, strlen(text), glyphIndices);
 
-		size_t len = strlen(text);
-		for (size_t i = 0; i < len; i++)
-		{
-			char c = text[i];
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			spriteFont->GetCharacterInfo(c, &glyph, &cropping, &kerning);
-
-			cursor.X += kerning.X * scale;
-
-			Vector2 transformedPosition = cursor;
-			transformedPosition.X += cropping.X * scale;
-			transformedPosition.Y += cropping.Y * scale;
-			Nxna::Vector2::Transform(transformedPosition, transform, transformedPosition);
-
-			Draw(spriteFont->m_texture, transformedPosition + position, &glyph, color, rotation, Vector2(0,0), scale, effects, layerDepth); 
-
-			cursor.X += (kerning.Y + kerning.Z) * scale;
-		}
+		addGlyphs(spriteFont, glyphIndices, false, position, color, rotation, origin, Vector2(scale, scale), effects, layerDepth);
 	}
 
 	void SpriteBatch::DrawString(SpriteFont* spriteFont, const char* text, size_t numCharacters, const Vector2& position, Color color,
 		float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth)
 	{
-		Matrix rotationMatrix;
-		Matrix::CreateRotationZ(rotation, rotationMatrix);
-		Matrix translationMatrix;
-		Matrix::CreateTranslation(-origin.X * scale, -origin.Y * scale, 0, translationMatrix);
-		Matrix transform;
-		Matrix::Multiply(translationMatrix, rotationMatrix, transform);
-
-		// TODO: do the sprite effects
-
-		Vector2 cursor;
+		std::vector<int>& glyphIndices = getStream().GlyphIndices;
+		spriteFont->getCharacterIndices(text, numCharacters, glyphIndices);
 
-		size_t len = strlen(text);
-		if (numCharacters > len)
-			numCharacters = len;
-		for (size_t i = 0; i < numCharacters; i++)
-		{
-			char c = text[i];
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			spriteFont->GetCharacterInfo(c, &glyph, &cropping, &kerning);
-
-			cursor.X += kerning.X * scale;
-
-			Vector2 transformedPosition = cursor;
-			transformedPosition.X += cropping.X * scale;
-			transformedPosition.Y += cropping.Y * scale;
-			Nxna::Vector2::Transform(transformedPosition, transform, transformedPosition);
-
-			Draw(spriteFont->m_texture, transformedPosition + position, &glyph, color, rotation, Vector2(0, 0), scale, effects, layerDepth);
-
-			cursor.X += (kerning.Y + kerning.Z) * scale;
-		}
+		addGlyphs(spriteFont, glyphIndices, false, position, color, rotation, origin, Vector2(scale, scale), effects, layerDepth);
 	}
 
 	void SpriteBatch::DrawString(SpriteFont* spriteFont, const wchar_t* text, const Vector2& position, Color color,
@@ -379,125 +373,102 @@ namespace Graphics
 	void SpriteBatch::DrawString(SpriteFont* spriteFont, const wchar_t* text, const Vector2& position, Color color,
 		float rotation, const Vector2& origin, const Nxna::Vector2& scale, SpriteEffects effects, float layerDepth)
 	{
-		Matrix rotationMatrix;
-		Matrix::CreateRotationZ(rotation, rotationMatrix);
-		Matrix translationMatrix;
-		Matrix::CreateTranslation(-origin.X * scale.X, -origin.Y * scale.Y, 0, translationMatrix);
-		Matrix transform;
-		Matrix::Multiply(translationMatrix, rotationMatrix, transform);
-
-		// TODO: do the sprite effects
-
-		Vector2 cursor;
-
-		size_t len = wcslen(text);
-		bool ignoreSpacing = true;
-		for (size_t i = 0; i < len; i++)
-		{
-			wchar_t c = text[i];
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			spriteFont->GetCharacterInfo(c, &glyph, &cropping, &kerning);
-
-			if (!ignoreSpacing)
-				cursor.X += spriteFont->GetSpacing() * scale.X;
-
-			cursor.X += kerning.X * scale.X;
-
-			Vector2 transformedPosition = cursor;
-			transformedPosition.X += cropping.X * scale.X;
-			transformedPosition.Y += cropping.Y * scale.Y;
-			Nxna::Vector2::Transform(transformedPosition, transform, transformedPosition);
+		std::vector<int>& glyphIndices = getStream().GlyphIndices;
+		spriteFont->getCharacterIndices(text, wcslen(text), glyphIndices);
 
-			Draw(spriteFont->m_texture, transformedPosition + position, &glyph, color, rotation, Vector2(0, 0), scale, effects, layerDepth);
-
-			cursor.X += (kerning.Y + kerning.Z) * scale.X;
-
-			ignoreSpacing = false;
-		}
+		addGlyphs(spriteFont, glyphIndices, true, position, color, rotation, origin, scale, effects, layerDepth);
 	}
 
 	void SpriteBatch::DrawString(SpriteFont* spriteFont, const wchar_t* text, size_t numCharacters, const Vector2& position, Color color,
 		float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth)
 	{
-		Matrix rotationMatrix;
-		Matrix::CreateRotationZ(rotation, rotationMatrix);
-		Matrix translationMatrix;
-		Matrix::CreateTranslation(-origin.X * scale, -origin.Y * scale, 0, translationMatrix);
-		Matrix transform;
-		Matrix::Multiply(translationMatrix, rotationMatrix, transform);
-
-		// TODO: do the sprite effects
-
-		Vector2 cursor;
-
-		size_t len = wcslen(text);
-		if (numCharacters > len)
-			numCharacters = len;
-		bool ignoreSpacing = true; 
-		for (size_t i = 0; i < numCharacters; i++)
-		{
-			wchar_t c = text[i];
-			Rectangle glyph, cropping;
-			Vector3 kerning;
+		std::vector<int>& glyphIndices = getStream().GlyphIndices;
+		spriteFont->getCharacterIndices(text, numCharacters, glyphIndices);
 
-			spriteFont->GetCharacterInfo(c, &glyph, &cropping, &kerning);
+		addGlyphs(spriteFont, glyphIndices, true, position, color, rotation, origin, Vector2(scale, scale), effects, layerDepth);
+	}
 
-			if (!ignoreSpacing)
-				cursor.X += spriteFont->GetSpacing() * scale;
+	void SpriteBatch::DrawStringUTF8(SpriteFont* spriteFont, const char* text, const Vector2& position, Color color,
+		float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth)
+	{
+		std::vector<int>& glyphIndices = getStream().GlyphIndices;
+		spriteFont->getCharacterIndicesUTF8(text, (size_t)-1, glyphIndices);
 
-			cursor.X += kerning.X * scale;
+		addGlyphs(spriteFont, glyphIndices, false, position, color, rotation, origin, Vector2(scale, scale), effects, layerDepth);
+	}
 
-			Vector2 transformedPosition = cursor;
-			transformedPosition.X += cropping.X * scale;
-			transformedPosition.Y += cropping.Y * scale;
-			Nxna::Vector2::Transform(transformedPosition, transform, transformedPosition);
+	void SpriteBatch::DrawString(TextLayout* layout, const Vector2& position, Color color)
+	{
+		DrawString(layout, position, color, 0, Vector2(0, 0), SpriteEffects::None, 0);
+	}
 
-			Draw(spriteFont->m_texture, transformedPosition + position, &glyph, color, rotation, Vector2(0,0), scale, effects, layerDepth); 
+	void SpriteBatch::DrawString(TextLayout* layout, const Vector2& position, Color color,
+		float rotation, const Vector2& origin, SpriteEffects effects, float layerDepth)
+	{
+		assert(layout != nullptr);
 
-			cursor.X += (kerning.Y + kerning.Z) * scale;
+		layout->updateSprites(position, color, rotation, origin, effects, layerDepth);
 
-			ignoreSpacing = false;
-		}
+		std::vector<Sprite>& sprites = getStream().Sprites;
+		sprites.insert(sprites.end(), layout->m_sprites.begin(), layout->m_sprites.end());
 	}
 
-	void SpriteBatch::DrawStringUTF8(SpriteFont* spriteFont, const char* text, const Vector2& position, Color color,
-		float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth)
+	void SpriteBatch::addGlyphs(SpriteFont* spriteFont, const std::vector<int>& glyphIndices, bool addSpacing, const Vector2& position, Color color,
+		float rotation, const Vector2& origin, const Vector2& scale, SpriteEffects effects, float layerDepth)
 	{
-		Matrix rotationMatrix;
-		Matrix::CreateRotationZ(rotation, rotationMatrix);
-		Matrix translationMatrix;
-		Matrix::CreateTranslation(-origin.X * scale, -origin.Y * scale, 0, translationMatrix);
-		Matrix transform;
-		Matrix::Multiply(translationMatrix, rotationMatrix, transform);
+		// this is the same as calling Draw() for each glyph, but the rotation
+		// is only calculated once and the sprites are added directly
 
 		// TODO: do the sprite effects
 
-		Vector2 cursor;
+		float cosine = cos(rotation);
+		float sine = sin(rotation);
 
-		int pos = 0;
-		int charsRead;
-		unsigned int c;
-		while ((charsRead = Utils::GetUTF8Character(text, pos, &c)) != 0)
+		Sprite s;
+		s.Texture = spriteFont->m_texture;
+		s.SpriteColor = color;
+		s.Origin = Vector2(0, 0);
+		s.Rotation = rotation;
+		s.Depth = layerDepth;
+		s.Effects = effects;
+
+		std::vector<Sprite>& sprites = getStream().Sprites;
+		sprites.reserve(sprites.size() + glyphIndices.size());
+
+		float cursor = 0;
+		bool ignoreSpacing = true;
+		for (std::vector<int>::size_type i = 0; i < glyphIndices.size(); i++)
 		{
-			pos += charsRead;
+			int index = glyphIndices[i];
+			if (index < 0)
+				continue;
+
+			const Rectangle& glyph = spriteFont->m_glyphs[index];
+			const Rectangle& cropping = spriteFont->m_cropping[index];
+			const float* kerning = &spriteFont->m_kerning[index * 3];
+
+			if (addSpacing && !ignoreSpacing)
+				cursor += spriteFont->GetSpacing() * scale.X;
 
-			Rectangle glyph, cropping;
-			Vector3 kerning;
+			cursor += kerning[0] * scale.X;
 
-			spriteFont->GetCharacterInfo(c, &glyph, &cropping, &kerning);
+			float x = cursor + (cropping.X - origin.X) * scale.X;
+			float y = (cropping.Y - origin.Y) * scale.Y;
 
-			cursor.X += kerning.X * scale;
+			s.Destination.X = position.X + x * cosine - y * sine;
+			s.Destination.Y = position.Y + x * sine + y * cosine;
+			s.Destination.Z = glyph.Width * scale.X;
+			s.Destination.W = glyph.Height * scale.Y;
+			s.Source.X = (float)glyph.X;
+			s.Source.Y = (float)glyph.Y;
+			s.Source.Z = (float)glyph.Width;
+			s.Source.W = (float)glyph.Height;
 
-			Vector2 transformedPosition = cursor;
-			transformedPosition.X += cropping.X * scale;
-			transformedPosition.Y += cropping.Y * scale;
-			Nxna::Vector2::Transform(transformedPosition, transform, transformedPosition);
+			sprites.push_back(s);
 
-			Draw(spriteFont->m_texture, transformedPosition + position, &glyph, color, rotation, Vector2(0,0), scale, effects, layerDepth); 
+			cursor += (kerning[1] + kerning[2]) * scale.X;
 
-			cursor.X += (kerning.Y + kerning.Z) * scale;
+			ignoreSpacing = false;
 		}
 	}
 
@@ -515,7 +486,44 @@ namespace Graphics
 		s.Origin = origin;
 		s.Effects = effects;
 
-		m_sprites.push_back(s);
+		getStream().Sprites.push_back(s);
+	}
+
+	SpriteBatch::SpriteStream& SpriteBatch::getStream()
+	{
+		int index = Utils::Jobs::GetThreadIndex();
+		assert(index < (int)m_streams.size() && "Begin() must be called before drawing");
+
+		return m_streams[index];
+	}
+
+	void SpriteBatch::mergeStreams()
+	{
+		for (std::vector<SpriteStream>::size_type i = 0; i < m_streams.size(); i++)
+		{
+			std::vector<Sprite>& sprites = m_streams[i].Sprites;
+			if (sprites.empty())
+				continue;
+
+			// usually everything was drawn on one thread, so there's nothing to copy
+			if (m_sprites.empty())
+				m_sprites.swap(sprites);
+			else
+				m_sprites.insert(m_sprites.end(), sprites.begin(), sprites.end());
+
+			sprites.clear();
+		}
+	}
+
+	void SpriteBatch::sortSprites()
+	{
+		// stable so sprites with the same key stay in the order they were drawn
+		if (m_sortMode == SpriteSortMode::BackToFront)
+			std::stable_sort(m_sprites.begin(), m_sprites.end(), [](const Sprite& a, const Sprite& b) { return a.Depth > b.Depth; });
+		else if (m_sortMode == SpriteSortMode::FrontToBack)
+			std::stable_sort(m_sprites.begin(), m_sprites.end(), [](const Sprite& a, const Sprite& b) { return a.Depth < b.Depth; });
+		else if (m_sortMode == SpriteSortMode::Texture)
+			std::stable_sort(m_sprites.begin(), m_sprites.end(), [](const Sprite& a, const Sprite& b) { return a.Texture < b.Texture; });
 	}
 
 	void SpriteBatch::flush()
@@ -525,6 +533,36 @@ namespace Graphics
 		int numSprites = m_sprites.size();
 		if (numSprites == 0) return;
 
+		NXNA_PROFILE_SCOPE("SpriteBatch::flush");
+		NXNA_PROFILE_GPU_SCOPE("SpriteBatch::flush");
+
+		// let streamed textures know how big they're being drawn. This ignores the transform matrix.
+		for (int i = 0; i < numSprites; i++)
+		{
+			const Sprite& sprite = m_sprites[i];
+			if (sprite.Texture->IsStreamed() == false)
+				continue;
+
+			float width = fabsf(sprite.Destination.Z);
+			float height = fabsf(sprite.Destination.W);
+			if (width <= 0 || height <= 0)
+				continue;
+
+			float scale = std::max(fabsf(sprite.Source.Z) / width, fabsf(sprite.Source.W) / height);
+			sprite.Texture->RequestMipLevel(TextureStreamer::GetLevelForScale(scale));
+		}
+
+		// custom effects expect the regular vertex layout, so they can't use the instanced path
+		if (m_instancedEffect != nullptr && m_customEffect == nullptr)
+			flushInstanced(numSprites);
+		else
+			flushVertices(numSprites);
+
+		m_sprites.clear();
+	}
+
+	void SpriteBatch::flushVertices(int numSprites)
+	{
 		const int stride = 6;
 		const int vertsPerSprite = 4;
 
@@ -542,13 +580,12 @@ namespace Graphics
 		void* workingMemory = NxnaTempMemoryPool::GetMemory(sizeOfVertices);
 		float* workingVerts = (float*)workingMemory;
 
-		auto itr = m_sprites.begin();
-		for (int i = 0; i < numSprites; i++, ++itr)
+		// each sprite's vertices only depend on the sprite, so big batches are split up between the workers
+		Utils::Jobs::ParallelFor(numSprites, [&](size_t begin, size_t end)
 		{
-			float* verts = &workingVerts[i * stride * vertsPerSprite];
-
-			copyIntoVerts((*itr), verts);
-		}
+			for (size_t i = begin; i < end; i++)
+				copyIntoVerts(m_sprites[i], &workingVerts[i * stride * vertsPerSprite]);
+		}, 1024);
 
 		m_vertexBuffer->SetData(workingVerts, numSprites * vertsPerSprite);
 
@@ -559,19 +596,8 @@ namespace Graphics
 		Texture2D* lastTexture = nullptr;
 		if (m_customEffect == nullptr)
 		{
-			Viewport vp = m_device->GetViewport();
-			float n1 = vp.Width > 0 ? (1.0f / (float)vp.Width) : 0;
-			float n2 = vp.Height > 0 ? (-1.0f / (float)vp.Height) : 0;
-
-			Matrix transform;
-			Matrix::GetIdentity(transform);
-			transform.M11 = n1 * 2.0f;
-			transform.M22 = n2 * 2.0f;
-			transform.M41 = -1.0f;// - n1; // these are pixel offsets (I think)
-			transform.M42 = 1.0f;// - n2;
-
 			Matrix final;
-			Matrix::Multiply(m_customTransform, transform, final);
+			calcTransform(final);
 
 			diffuse = m_effect->GetParameter("Diffuse");
 			m_effect->GetParameter("ModelViewProjection")->SetValue(final);
@@ -640,8 +666,122 @@ namespace Graphics
 		{
 			m_device->DrawIndexedPrimitives(PrimitiveType::TriangleList, vertexBufferStartIndex, 0, batchSize * vertsPerSprite, indexBufferStartIndex, batchSize * 2);
 		}
+	}
 
-		m_sprites.clear();
+	void SpriteBatch::flushInstanced(int numSprites)
+	{
+		if (m_instanceBuffer == nullptr)
+		{
+			m_instanceBuffer = new DynamicVertexBuffer(m_device, m_instanceDeclaration, MAX_BATCH_SIZE, BufferUsage::WriteOnly);
+		}
+		else if (m_instanceBuffer->GetVertexCount() < numSprites)
+		{
+			delete m_instanceBuffer;
+			m_instanceBuffer = new DynamicVertexBuffer(m_device, m_instanceDeclaration, numSprites * 2, BufferUsage::WriteOnly);
+		}
+
+		int maxTextures = m_device->GetCaps()->MaxTextureUnits;
+		if (maxTextures > MAX_INSTANCED_TEXTURES)
+			maxTextures = MAX_INSTANCED_TEXTURES;
+
+		SpriteInstance* instances = (SpriteInstance*)NxnaTempMemoryPool::GetMemory(sizeof(SpriteInstance) * numSprites);
+
+		// sprites only need to be split into separate draws once they use
+		// more textures than there are texture slots in the effect
+		m_instancedBatches.clear();
+		InstancedBatch* batch = nullptr;
+		for (int i = 0; i < numSprites; i++)
+		{
+			Texture2D* texture = m_sprites[i].Texture;
+
+			int slot = -1;
+			if (batch != nullptr)
+			{
+				for (int j = 0; j < batch->NumTextures; j++)
+				{
+					if (batch->Textures[j] == texture)
+					{
+						slot = j;
+						break;
+					}
+				}
+			}
+
+			if (slot == -1)
+			{
+				if (batch == nullptr || batch->NumTextures == maxTextures)
+				{
+					InstancedBatch newBatch;
+					newBatch.Start = i;
+					newBatch.NumTextures = 0;
+					m_instancedBatches.push_back(newBatch);
+
+					batch = &m_instancedBatches.back();
+				}
+
+				slot = batch->NumTextures++;
+				batch->Textures[slot] = texture;
+			}
+
+			instances[i].TextureIndex = (float)slot;
+		}
+
+		Utils::Jobs::ParallelFor(numSprites, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				copyIntoInstance(m_sprites[i], &instances[i]);
+		}, 1024);
+
+		m_instanceBuffer->SetData(instances, numSprites);
+
+		Nxna::NxnaTempMemoryPool::ReleaseMemory();
+
+		Matrix final;
+		calcTransform(final);
+		m_instancedEffect->GetParameter("ModelViewProjection")->SetValue(final);
+
+		for (int i = 0; i < maxTextures; i++)
+			m_device->GetSamplerStates().Set(i, SamplerState::GetLinearClamp());
+
+		// stream 0 holds the 4 corners of the quad, stream 1 holds the sprites
+		VertexBufferBinding bindings[] = {
+			VertexBufferBinding(m_cornerBuffer, 0, 0),
+			VertexBufferBinding(m_instanceBuffer, 0, 1)
+		};
+
+		m_device->SetIndices(m_indexBuffer);
+
+		for (std::vector<InstancedBatch>::size_type i = 0; i < m_instancedBatches.size(); i++)
+		{
+			const InstancedBatch& b = m_instancedBatches[i];
+			int batchEnd = i + 1 < m_instancedBatches.size() ? m_instancedBatches[i + 1].Start : numSprites;
+
+			// the shader never reads the unused slots, but they still need a valid texture
+			for (int j = 0; j < MAX_INSTANCED_TEXTURES; j++)
+				m_instancedTextures[j]->SetValue(b.Textures[j < b.NumTextures ? j : 0]);
+
+			m_instancedEffect->GetCurrentTechnique()->Apply();
+
+			bindings[1].VertexOffset = b.Start;
+			m_device->SetVertexBuffers(bindings, 2);
+			m_device->DrawInstancedPrimitives(PrimitiveType::TriangleList, 0, 0, 4, 0, 2, batchEnd - b.Start);
+		}
+	}
+
+	void SpriteBatch::calcTransform(Matrix& result)
+	{
+		Viewport vp = m_device->GetViewport();
+		float n1 = vp.Width > 0 ? (1.0f / (float)vp.Width) : 0;
+		float n2 = vp.Height > 0 ? (-1.0f / (float)vp.Height) : 0;
+
+		Matrix transform;
+		Matrix::GetIdentity(transform);
+		transform.M11 = n1 * 2.0f;
+		transform.M22 = n2 * 2.0f;
+		transform.M41 = -1.0f;// - n1; // these are pixel offsets (I think)
+		transform.M42 = 1.0f;// - n2;
+
+		Matrix::Multiply(m_customTransform, transform, result);
 	}
 
 	void SpriteBatch::copyIntoVerts(const Sprite& s, float* verts)
@@ -730,6 +870,86 @@ namespace Graphics
 
 	}
 
+	void SpriteBatch::copyIntoInstance(const Sprite& s, SpriteInstance* instance)
+	{
+		instance->Destination[0] = s.Destination.X;
+		instance->Destination[1] = s.Destination.Y;
+		instance->Destination[2] = s.Destination.Z;
+		instance->Destination[3] = s.Destination.W;
+
+		instance->OriginRotationDepth[0] = s.Origin.X / s.Source.Z;
+		instance->OriginRotationDepth[1] = s.Origin.Y / s.Source.W;
+		instance->OriginRotationDepth[2] = s.Rotation;
+		instance->OriginRotationDepth[3] = s.Depth;
+
+		// same as copyIntoVerts(), the size used is the Texture2D's (which is the full size even when
+		// a streamed texture doesn't have all its levels loaded)
+		float inverseTextureWidth = 1.0f / (float)s.Texture->GetWidth();
+		float inverseTextureHeight = 1.0f / (float)s.Texture->GetHeight();
+
+		float left = s.Source.X * inverseTextureWidth;
+		float top = s.Source.Y * inverseTextureHeight;
+		float right = (s.Source.X + s.Source.Z) * inverseTextureWidth;
+		float bottom = (s.Source.Y + s.Source.W) * inverseTextureHeight;
+
+		if ((s.Effects & (int)SpriteEffects::FlipHorizontally) != 0)
+		{
+			float tmp = left;
+			left = right;
+			right = tmp;
+		}
+
+		if ((s.Effects & (int)SpriteEffects::FlipVertically) != 0)
+		{
+			float tmp = top;
+			top = bottom;
+			bottom = tmp;
+		}
+
+		instance->Source[0] = left;
+		instance->Source[1] = top;
+		instance->Source[2] = right;
+		instance->Source[3] = bottom;
+
+		instance->PackedColor = s.SpriteColor.GetPackedValue();
+	}
+
+	void SpriteBatch::createInstancingResources()
+	{
+		VertexElement instanceElements[] = {
+			{ 0, VertexElementFormat::Vector4, VertexElementUsage::Position, 0 },
+			{ sizeof(float) * 4, VertexElementFormat::Vector4, VertexElementUsage::TextureCoordinate, 1 },
+			{ sizeof(float) * 8, VertexElementFormat::Vector4, VertexElementUsage::TextureCoordinate, 0 },
+			{ sizeof(float) * 12, VertexElementFormat::Color, VertexElementUsage::Color, 0 },
+			{ sizeof(float) * 13, VertexElementFormat::Single, VertexElementUsage::TextureCoordinate, 3 }
+		};
+		m_instanceDeclaration = new VertexDeclaration(instanceElements, 5);
+
+		VertexElement cornerElements[] = {
+			{ 0, VertexElementFormat::Vector2, VertexElementUsage::TextureCoordinate, 2 }
+		};
+		m_cornerDeclaration = new VertexDeclaration(cornerElements, 1);
+
+		// same order as the corners in copyIntoVerts() so that the index buffer can be shared
+		float corners[] = {
+			0, 0,
+			1.0f, 0,
+			1.0f, 1.0f,
+			0, 1.0f
+		};
+		m_cornerBuffer = new VertexBuffer(m_device, m_cornerDeclaration, 4, BufferUsage::WriteOnly);
+		m_cornerBuffer->SetData(corners, 4);
+
+		m_instancedEffect = new Effect(m_device, (byte*)SpriteInstancedEffect_bytecode, sizeof(SpriteInstancedEffect_bytecode));
+
+		const char* textureNames[MAX_INSTANCED_TEXTURES] = {
+			"Diffuse0", "Diffuse1", "Diffuse2", "Diffuse3",
+			"Diffuse4", "Diffuse5", "Diffuse6", "Diffuse7"
+		};
+		for (int i = 0; i < MAX_INSTANCED_TEXTURES; i++)
+			m_instancedTextures[i] = m_instancedEffect->GetParameter(textureNames[i]);
+	}
+
 	void SpriteBatch::createIndexBuffer()
 	{
 		short indices[MAX_BATCH_SIZE * 6];
@@ -764,6 +984,11 @@ namespace Graphics
 		if (m_indexBuffer != nullptr) delete m_indexBuffer;
 		if (m_vertexBuffer != nullptr) delete m_vertexBuffer;
 		if (m_effect != nullptr) delete m_effect;
+		if (m_instanceDeclaration != nullptr) delete m_instanceDeclaration;
+		if (m_cornerDeclaration != nullptr) delete m_cornerDeclaration;
+		if (m_instanceBuffer != nullptr) delete m_instanceBuffer;
+		if (m_cornerBuffer != nullptr) delete m_cornerBuffer;
+		if (m_instancedEffect != nullptr) delete m_instancedEffect;
 	}
 }
 }
@@ -30,10 +30,20 @@ namespace Graphics
 	class Effect;
 	class SpriteFont;
 	class SpriteEffect;
-
+	class EffectParameter;
+	class AtlasRegion;
+	class TextLayout;
+
+	// Draw() and DrawString() can be called from job workers (see Utils::Jobs) between
+	// Begin() and End(), as long as every job that draws has finished before End() is called.
+	// The sprites from different threads are drawn in thread order unless the sort mode
+	// sorts them, so use BackToFront or FrontToBack when the order between threads matters.
 	class SpriteBatch
 	{
+		friend class TextLayout;
+
 		static const int MAX_BATCH_SIZE = 2048;
+		static const int MAX_INSTANCED_TEXTURES = 8;
 
 		GraphicsDevice* m_device;
 		Effect* m_customEffect;
@@ -55,13 +65,51 @@ namespace Graphics
 			SpriteEffects Effects;
 		};
 
+		// Each thread records into its own stream so that Draw() can be called from
+		// job workers without any locking. Stream 0 is the main thread's.
+		struct SpriteStream
+		{
+			std::vector<Sprite> Sprites;
+			std::vector<int> GlyphIndices;
+		};
+
+		std::vector<SpriteStream> m_streams;
+
+		// all the streams merged together and sorted, ready to draw
 		std::vector<Sprite> m_sprites;
 
+		// the per-sprite data used by the instanced path. The quad is expanded by the vertex shader.
+		struct SpriteInstance
+		{
+			float Destination[4];
+			float OriginRotationDepth[4];
+			float Source[4];
+			unsigned int PackedColor;
+			float TextureIndex;
+		};
+
+		// a single instanced draw. Each sprite in it picks one of the textures with its TextureIndex.
+		struct InstancedBatch
+		{
+			int Start;
+			int NumTextures;
+			Texture2D* Textures[MAX_INSTANCED_TEXTURES];
+		};
+
+		std::vector<InstancedBatch> m_instancedBatches;
+
 		static SpriteEffect* m_effect;
 		static VertexDeclaration* m_declaration;
 		static DynamicVertexBuffer* m_vertexBuffer;
 		static IndexBuffer* m_indexBuffer;
 
+		static Effect* m_instancedEffect;
+		static VertexDeclaration* m_instanceDeclaration;
+		static VertexDeclaration* m_cornerDeclaration;
+		static DynamicVertexBuffer* m_instanceBuffer;
+		static VertexBuffer* m_cornerBuffer;
+		static EffectParameter* m_instancedTextures[MAX_INSTANCED_TEXTURES];
+
 	public:
 		SpriteBatch(GraphicsDevice* device);
 
@@ -88,6 +136,12 @@ namespace Graphics
 		void Draw(Texture2D* texture, const Vector2& position, const Rectangle* sourceRectangle, Color color,
 			float rotation, const Vector2& origin, const Vector2& scale, SpriteEffects effects, float layerDepth);
 
+		// these aren't in XNA. They draw a region of a TextureAtlas.
+		void Draw(AtlasRegion* region, const Vector2& position, Color color);
+		void Draw(AtlasRegion* region, const Rectangle& destinationRectangle, Color color);
+		void Draw(AtlasRegion* region, const Vector2& position, Color color,
+			float rotation, const Vector2& origin, const Vector2& scale, SpriteEffects effects, float layerDepth);
+
 		void DrawString(SpriteFont* spriteFont, const wchar_t* text, const Vector2& position, Color color);
 		void DrawString(SpriteFont* spriteFont, const wchar_t* text, const Vector2& position, Color color,
 			float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth);
@@ -104,6 +158,11 @@ namespace Graphics
 		void DrawStringUTF8(SpriteFont* spriteFont, const char* text, const Vector2& position, Color color,
 			float rotation, const Vector2& origin, float scale, SpriteEffects effects, float layerDepth); 
 
+		// these aren't in XNA. The layout is only transformed again when one of the arguments changes.
+		void DrawString(TextLayout* layout, const Vector2& position, Color color);
+		void DrawString(TextLayout* layout, const Vector2& position, Color color,
+			float rotation, const Vector2& origin, SpriteEffects effects, float layerDepth);
+
 
 		void End();
 
@@ -114,9 +173,20 @@ namespace Graphics
 		void addSprite(Texture2D* texture, const Vector4& position, const Vector4& source, Color color, 
 			float rotation, const Vector2& origin, SpriteEffects effects, float layerDepth);
 
+		void addGlyphs(SpriteFont* spriteFont, const std::vector<int>& glyphIndices, bool addSpacing, const Vector2& position, Color color,
+			float rotation, const Vector2& origin, const Vector2& scale, SpriteEffects effects, float layerDepth);
+
+		SpriteStream& getStream();
+		void mergeStreams();
+		void sortSprites();
 		void flush();
+		void flushVertices(int numSprites);
+		void flushInstanced(int numSprites);
+		void calcTransform(Matrix& result);
 		void copyIntoVerts(const Sprite& s, float* verts);
+		void copyIntoInstance(const Sprite& s, SpriteInstance* instance);
 		void createIndexBuffer();
+		void createInstancingResources();
 		void setRenderStates();
 	};
 }
@@ -4,6 +4,7 @@
 #include "Texture2D.h"
 #include "../Content/FileStream.h"
 #include "../Content/XnbReader.h"
+#include "../Content/BinaryReader.h"
 #include "../Rectangle.h"
 #include "../Vector3.h"
 #include "../Utils.h"
@@ -45,6 +46,9 @@ namespace Graphics
 
 		m_lineHeight = lineSpacing;
 		m_spacing = spacing;
+
+		m_directIndices = nullptr;
+		buildLookupTables();
 	}
 
 	SpriteFont::~SpriteFont()
@@ -54,55 +58,30 @@ namespace Graphics
 		delete[] m_cropping;
 		delete[] m_kerning;
 		delete[] m_characters;
+		delete[] m_directIndices;
 	}
 
 	Nxna::Vector2 SpriteFont::MeasureString(const char* text)
 	{
-		Nxna::Vector2 size(0, 0);
-
-		size_t len = strlen(text);
-		for (size_t i = 0; i < len; i++)
-		{
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			GetCharacterInfo(text[i], &glyph, &cropping, &kerning);
-
-			size.X += kerning.X;
-
-			size.X += kerning.Y + kerning.Z;
-
-			if (size.Y < glyph.Height)
-			{
-				size.Y = (float)glyph.Height;
-			}
-		}
-
-		return size;
+		return MeasureString(text, strlen(text));
 	}
 
 	Nxna::Vector2 SpriteFont::MeasureString(const char* text, size_t numChars)
 	{
 		Nxna::Vector2 size(0, 0);
 
-		size_t len = strlen(text);
-
-		len = len < numChars ? len : numChars;
-
-		for (size_t i = 0; i < len; i++)
+		for (size_t i = 0; i < numChars && text[i] != 0; i++)
 		{
-			Rectangle glyph, cropping;
-			Vector3 kerning;
+			int index = getCharacterIndex((unsigned char)text[i]);
+			if (index < 0)
+				continue;
 
-			GetCharacterInfo(text[i], &glyph, &cropping, &kerning);
+			size.X += m_kerning[index * 3 + 0];
+			size.X += m_kerning[index * 3 + 1] + m_kerning[index * 3 + 2];
 
-			size.X += kerning.X;
-
-			size.X += kerning.Y + kerning.Z;
-
-			if (size.Y < glyph.Height)
+			if (size.Y < m_glyphs[index].Height)
 			{
-				size.Y = (float)glyph.Height;
+				size.Y = (float)m_glyphs[index].Height;
 			}
 		}
 
@@ -111,56 +90,31 @@ namespace Graphics
 
 	Nxna::Vector2 SpriteFont::MeasureString(const wchar_t* text)
 	{
-		Nxna::Vector2 size(0, 0);
 #if defined NXNA_PLATFORM_ANDROID
 		size_t len = wcslen(text);
 #else
 		size_t len = wcsnlen(text, 10000);
 #endif
 
-		for (size_t i = 0; i < len; i++)
-		{
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			GetCharacterInfo(text[i], &glyph, &cropping, &kerning);
-
-			size.X += kerning.X;
-			size.X += kerning.Y + kerning.Z;
-
-			if (size.Y < cropping.Height)
-			{
-				size.Y = (float)cropping.Height;
-			}
-		}
-
-		return size;
+		return MeasureString(text, len);
 	}
 
 	Nxna::Vector2 SpriteFont::MeasureString(const wchar_t* text, size_t numChars)
 	{
 		Nxna::Vector2 size(0, 0);
-#if defined NXNA_PLATFORM_ANDROID
-		size_t len = wcslen(text);
-#else
-		size_t len = wcsnlen(text, 10000);
-#endif
-
-		len = len < numChars ? len : numChars;
 
-		for (size_t i = 0; i < len; i++)
+		for (size_t i = 0; i < numChars && text[i] != 0; i++)
 		{
-			Rectangle glyph, cropping;
-			Vector3 kerning;
+			int index = getCharacterIndex((unsigned int)text[i]);
+			if (index < 0)
+				continue;
 
-			GetCharacterInfo(text[i], &glyph, &cropping, &kerning);
+			size.X += m_kerning[index * 3 + 0];
+			size.X += m_kerning[index * 3 + 1] + m_kerning[index * 3 + 2];
 
-			size.X += kerning.X;
-			size.X += kerning.Y + kerning.Z;
-
-			if (size.Y < cropping.Height)
+			if (size.Y < m_cropping[index].Height)
 			{
-				size.Y = (float)cropping.Height;
+				size.Y = (float)m_cropping[index].Height;
 			}
 		}
 
@@ -169,31 +123,7 @@ namespace Graphics
 
 	Nxna::Vector2 SpriteFont::MeasureStringUTF8(const char* text)
 	{
-		Nxna::Vector2 size(0, 0);
-
-		int pos = 0;
-		int bytesRead;
-		unsigned int c;
-		while ((bytesRead = Utils::GetUTF8Character(text, pos, &c)) != 0)
-		{
-			pos += bytesRead;
-
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			GetCharacterInfo(c, &glyph, &cropping, &kerning);
-
-			size.X += kerning.X;
-
-			size.X += kerning.Y + kerning.Z;
-
-			if (size.Y < glyph.Height)
-			{
-				size.Y = (float)glyph.Height;
-			}
-		}
-
-		return size;
+		return MeasureStringUTF8(text, (size_t)-1);
 	}
 
 	Nxna::Vector2 SpriteFont::MeasureStringUTF8(const char* text, size_t numChars)
@@ -204,23 +134,21 @@ namespace Graphics
 		int bytesRead;
 		size_t charsRead = 0;
 		unsigned int c;
-		while ((bytesRead = Utils::GetUTF8Character(text, pos, &c)) != 0 && charsRead < numChars)
+		while (charsRead < numChars && (bytesRead = Utils::GetUTF8Character(text, pos, &c)) != 0)
 		{
 			pos += bytesRead;
 			charsRead++;
 
-			Rectangle glyph, cropping;
-			Vector3 kerning;
-
-			GetCharacterInfo(c, &glyph, &cropping, &kerning);
-
-			size.X += kerning.X;
+			int index = getCharacterIndex(c);
+			if (index < 0)
+				continue;
 
-			size.X += kerning.Y + kerning.Z;
+			size.X += m_kerning[index * 3 + 0];
+			size.X += m_kerning[index * 3 + 1] + m_kerning[index * 3 + 2];
 
-			if (size.Y < glyph.Height)
+			if (size.Y < m_glyphs[index].Height)
 			{
-				size.Y = (float)glyph.Height;
+				size.Y = (float)m_glyphs[index].Height;
 			}
 		}
 
@@ -235,97 +163,134 @@ namespace Graphics
 
 		result->m_texture = Texture2D::LoadFrom(stream);
 
-		typeID = stream->ReadTypeID();
-		result->m_numCharacters = stream->GetStream()->ReadInt32();
+		// everything else is small values, so read it without going through the stream each time
+		Content::BinaryReader binary(stream->GetStream());
+
+		typeID = binary.Read7BitEncodedInt();
+		result->m_numCharacters = binary.ReadInt32();
+		if (result->m_numCharacters < 0 || result->m_numCharacters > binary.Remaining() / (int)sizeof(Rectangle))
+			throw Content::ContentException("Invalid SpriteFont data found");
+
 		result->m_characters = new unsigned int[result->m_numCharacters];
 		result->m_glyphs = new Rectangle[result->m_numCharacters];
+		binary.ReadArray(result->m_glyphs, result->m_numCharacters);
 
-		for (int i = 0; i < result->m_numCharacters; i++)
-		{
-			result->m_glyphs[i].X = stream->GetStream()->ReadInt32();
-			result->m_glyphs[i].Y = stream->GetStream()->ReadInt32();
-			result->m_glyphs[i].Width = stream->GetStream()->ReadInt32();
-			result->m_glyphs[i].Height = stream->GetStream()->ReadInt32();
-		}
-
-		typeID = stream->ReadTypeID();
-		int numCropping = stream->GetStream()->ReadInt32();
+		typeID = binary.Read7BitEncodedInt();
+		int numCropping = binary.ReadInt32();
 		if (numCropping != result->m_numCharacters)
 			throw Content::ContentException("Invalid SpriteFont data found");
 		result->m_cropping = new Rectangle[result->m_numCharacters];
+		binary.ReadArray(result->m_cropping, result->m_numCharacters);
 
-		for (int i = 0; i < result->m_numCharacters; i++)
-		{
-			result->m_cropping[i].X = stream->GetStream()->ReadInt32();
-			result->m_cropping[i].Y = stream->GetStream()->ReadInt32();
-			result->m_cropping[i].Width = stream->GetStream()->ReadInt32();
-			result->m_cropping[i].Height = stream->GetStream()->ReadInt32();
-		}
-
-		typeID = stream->ReadTypeID();
-		int numCharacters = stream->GetStream()->ReadInt32();
+		typeID = binary.Read7BitEncodedInt();
+		int numCharacters = binary.ReadInt32();
 		if (numCharacters != result->m_numCharacters)
 			throw Content::ContentException("Invalid SpriteFont data found");
 
 		for (int i = 0; i < numCharacters; i++)
 		{
-			unsigned short c = stream->GetStream()->ReadByte();
+			unsigned short c = binary.ReadByte();
 			if ((c & 0xE0) == 0xC0)
 			{
 				// this is a 2-byte unicode character, so read the next byte
-				byte b2 = stream->GetStream()->ReadByte();
+				byte b2 = binary.ReadByte();
 
 				c = ((c & 0x1F) << 6) + (b2 & 0x3F);
 			}
 			result->m_characters[i] = c;
 		}
 
-		result->m_lineHeight = stream->GetStream()->ReadInt32();
-		result->m_spacing = stream->GetStream()->ReadFloat();
+		result->m_lineHeight = binary.ReadInt32();
+		result->m_spacing = binary.ReadFloat();
 
-		typeID = stream->ReadTypeID();
-		int numKerning = stream->GetStream()->ReadInt32();
+		typeID = binary.Read7BitEncodedInt();
+		int numKerning = binary.ReadInt32();
 		if (numKerning != result->m_numCharacters)
 			throw Content::ContentException("Invalid SpriteFont data found");
 
 		result->m_kerning = new float[result->m_numCharacters * 3];
-		for (int i = 0; i < result->m_numCharacters; i++)
-		{
-			result->m_kerning[i * 3 + 0] = stream->GetStream()->ReadFloat();
-			result->m_kerning[i * 3 + 1] = stream->GetStream()->ReadFloat();
-			result->m_kerning[i * 3 + 2] = stream->GetStream()->ReadFloat();
-		}
+		binary.ReadArray(result->m_kerning, result->m_numCharacters * 3);
+
+		binary.Finish();
+
+		result->buildLookupTables();
 
 		return result;
 	}
 
 	bool SpriteFont::GetCharacterInfo(unsigned int c, Rectangle* glyph, Rectangle* cropping, Vector3* kerning)
 	{
-		// find the character by doing a binary search
-		int searchLength = m_numCharacters - 1;
-		int i = 0;
-		while (i <= searchLength)
+		int index = getCharacterIndex(c);
+		if (index < 0)
+			return false;
+
+		*glyph = m_glyphs[index];
+		*cropping = m_cropping[index];
+		*kerning = Vector3(m_kerning[index * 3 + 0], m_kerning[index * 3 + 1], m_kerning[index * 3 + 2]);
+
+		return true;
+	}
+
+	void SpriteFont::buildLookupTables()
+	{
+		delete[] m_directIndices;
+		m_indexMap.clear();
+
+		// the direct table only needs to go up to the biggest character in the BMP
+		unsigned int largest = 0;
+		for (int i = 0; i < m_numCharacters; i++)
 		{
-			int currentIndex = i + (searchLength - i) / 2;
-			unsigned int character = m_characters[currentIndex];
+			if (m_characters[i] < 0x10000 && m_characters[i] >= largest)
+				largest = m_characters[i] + 1;
+		}
 
-			if (character == c)
-			{
-				// we found it!
-				*glyph = m_glyphs[currentIndex];
-				*cropping = m_cropping[currentIndex];
-				*kerning = Vector3(m_kerning[currentIndex * 3 + 0], m_kerning[currentIndex * 3 + 1], m_kerning[currentIndex * 3 + 2]);
+		// NoCharacter can't be a valid index
+		if (m_numCharacters >= NoCharacter)
+			largest = 0;
 
-				return true;
-			}
+		m_numDirectIndices = largest;
+		m_directIndices = new unsigned short[m_numDirectIndices];
+		for (unsigned int i = 0; i < m_numDirectIndices; i++)
+			m_directIndices[i] = NoCharacter;
 
-			if (character < c)
-				i = currentIndex + 1;
+		for (int i = 0; i < m_numCharacters; i++)
+		{
+			if (m_characters[i] < m_numDirectIndices)
+				m_directIndices[m_characters[i]] = (unsigned short)i;
 			else
-				searchLength = currentIndex - 1;
+				m_indexMap.insert(std::unordered_map<unsigned int, int>::value_type(m_characters[i], i));
 		}
+	}
+
+	void SpriteFont::getCharacterIndices(const char* text, size_t numChars, std::vector<int>& result)
+	{
+		result.clear();
+
+		for (size_t i = 0; i < numChars && text[i] != 0; i++)
+			result.push_back(getCharacterIndex((unsigned char)text[i]));
+	}
+
+	void SpriteFont::getCharacterIndices(const wchar_t* text, size_t numChars, std::vector<int>& result)
+	{
+		result.clear();
 
-		return false;
+		for (size_t i = 0; i < numChars && text[i] != 0; i++)
+			result.push_back(getCharacterIndex((unsigned int)text[i]));
+	}
+
+	void SpriteFont::getCharacterIndicesUTF8(const char* text, size_t numChars, std::vector<int>& result)
+	{
+		result.clear();
+
+		int pos = 0;
+		int bytesRead;
+		unsigned int c;
+		while (result.size() < numChars && (bytesRead = Utils::GetUTF8Character(text, pos, &c)) != 0)
+		{
+			pos += bytesRead;
+
+			result.push_back(getCharacterIndex(c));
+		}
 	}
 }
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef GRAPHICS_SPRITEFONT_H
 #define GRAPHICS_SPRITEFONT_H
 
+#include <vector>
+#include <unordered_map>
 #include "../NxnaConfig.h"
 #include "../Vector2.h"
 #include "../Content/ContentManager.h"
@@ -25,6 +27,9 @@ namespace Graphics
 	class SpriteFont
 	{
 		friend class SpriteBatch;
+		friend class TextLayout;
+
+		static const unsigned short NoCharacter = 0xffff;
 
 		Texture2D* m_texture;
 
@@ -35,10 +40,20 @@ namespace Graphics
 		Rectangle* m_cropping;
 		float* m_kerning;
 
+		// characters in the BMP are looked up directly in m_directIndices.
+		// Everything else goes through m_indexMap.
+		unsigned short* m_directIndices;
+		unsigned int m_numDirectIndices;
+		std::unordered_map<unsigned int, int> m_indexMap;
+
 		int m_lineHeight;
 		float m_spacing;
 
-		SpriteFont() { }
+		SpriteFont()
+		{
+			m_directIndices = nullptr;
+			m_numDirectIndices = 0;
+		}
 
 	public:
 		// In XNA the constructor is hidden, but here it isn't, for I am kind.
@@ -67,6 +82,32 @@ namespace Graphics
 	private:
 		static int convertUTF8Character(const char* string, unsigned short* result);
 
+		void buildLookupTables();
+
+		// returns the index of the character's glyph, or -1 if the font doesn't have it
+		int getCharacterIndex(unsigned int c)
+		{
+			if (c < m_numDirectIndices)
+			{
+				unsigned short index = m_directIndices[c];
+				return index == NoCharacter ? -1 : index;
+			}
+
+			if (m_indexMap.empty())
+				return -1;
+
+			std::unordered_map<unsigned int, int>::iterator itr = m_indexMap.find(c);
+			if (itr == m_indexMap.end())
+				return -1;
+
+			return (*itr).second;
+		}
+
+		// these convert text into glyph indices for SpriteBatch and TextLayout
+		void getCharacterIndices(const char* text, size_t numChars, std::vector<int>& result);
+		void getCharacterIndices(const wchar_t* text, size_t numChars, std::vector<int>& result);
+		void getCharacterIndicesUTF8(const char* text, size_t numChars, std::vector<int>& result);
+
 	};
 
 	class SpriteFontLoader : public Content::IContentReader
@@ -4,6 +4,7 @@
 #include "GraphicsDevice.h"
 #include "../Content/XnbReader.h"
 #include "../Content/FileStream.h"
+#include "../Content/BinaryReader.h"
 
 namespace Nxna
 {
@@ -12,7 +13,7 @@ namespace Graphics
 	void* SpriteSheet::Read(Content::XnbReader* reader)
 	{
 		assert(reader != nullptr);
-		Content::Stream* stream = reader->GetStream();
+		Content::MemoryStream* stream = reader->GetStream();
 
 		SpriteSheet* newSheet = new SpriteSheet();
 
@@ -21,18 +22,27 @@ namespace Graphics
 		// read the textures
 		newSheet->m_texture = Texture2D::LoadFrom(stream);
 
-		// read the rects
-		int num = stream->ReadInt32();
-
-		for (int i = 0; i < num; i++)
+		try
 		{
-			Rectangle r;
-			r.X = stream->ReadInt32();
-			r.Y = stream->ReadInt32();
-			r.Width = stream->ReadInt32();
-			r.Height = stream->ReadInt32();
+			// read the rects. They're stored exactly like Rectangle, so they can be copied all at once.
+			static_assert(sizeof(Rectangle) == sizeof(int) * 4, "Rectangle is unexpected size");
+
+			Content::BinaryReader binary(stream);
+			int num = binary.ReadInt32();
+			if (num < 0 || num > binary.Remaining() / (int)sizeof(Rectangle))
+				throw Content::ContentException("Invalid SpriteSheet data found");
+
+			newSheet->m_spriteRectangles.resize(num);
+			if (num > 0)
+				binary.ReadArray(&newSheet->m_spriteRectangles[0], num);
 
-			newSheet->m_spriteRectangles.push_back(r);
+			binary.Finish();
+		}
+		catch (...)
+		{
+			delete newSheet->m_texture;
+			delete newSheet;
+			throw;
 		}
 
 		return newSheet;
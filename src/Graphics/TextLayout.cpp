@@ -0,0 +1,142 @@
+#include <cassert>
+#include <cstring>
+#include <cwchar>
+#include <cmath>
+#include "TextLayout.h"
+#include "SpriteFont.h"
+#include "../Rectangle.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	TextLayout::TextLayout()
+	{
+		m_font = nullptr;
+		m_addSpacing = false;
+		m_spritesDirty = true;
+		m_rotation = 0;
+		m_effects = SpriteEffects::None;
+		m_layerDepth = 0;
+	}
+
+	void TextLayout::SetText(SpriteFont* font, const char* text, const Vector2& scale)
+	{
+		assert(font != nullptr);
+
+		font->getCharacterIndices(text, strlen(text), m_newGlyphIndices);
+		layout(font, scale, false);
+	}
+
+	void TextLayout::SetText(SpriteFont* font, const wchar_t* text, const Vector2& scale)
+	{
+		assert(font != nullptr);
+
+		font->getCharacterIndices(text, wcslen(text), m_newGlyphIndices);
+		layout(font, scale, true);
+	}
+
+	void TextLayout::SetTextUTF8(SpriteFont* font, const char* text, const Vector2& scale)
+	{
+		assert(font != nullptr);
+
+		font->getCharacterIndicesUTF8(text, (size_t)-1, m_newGlyphIndices);
+		layout(font, scale, false);
+	}
+
+	void TextLayout::layout(SpriteFont* font, const Vector2& scale, bool addSpacing)
+	{
+		if (font == m_font && scale.X == m_scale.X && scale.Y == m_scale.Y &&
+			addSpacing == m_addSpacing && m_newGlyphIndices == m_glyphIndices)
+			return;
+
+		m_glyphIndices.swap(m_newGlyphIndices);
+		m_font = font;
+		m_scale = scale;
+		m_addSpacing = addSpacing;
+
+		// this needs to match SpriteBatch::addGlyphs()
+		m_glyphs.clear();
+		m_size = Vector2(0, 0);
+
+		float cursor = 0;
+		bool ignoreSpacing = true;
+		for (std::vector<int>::size_type i = 0; i < m_glyphIndices.size(); i++)
+		{
+			int index = m_glyphIndices[i];
+			if (index < 0)
+				continue;
+
+			const Rectangle& glyph = font->m_glyphs[index];
+			const Rectangle& cropping = font->m_cropping[index];
+			const float* kerning = &font->m_kerning[index * 3];
+
+			if (addSpacing && !ignoreSpacing)
+				cursor += font->GetSpacing() * scale.X;
+
+			cursor += kerning[0] * scale.X;
+
+			Glyph g;
+			g.Position.X = cursor + cropping.X * scale.X;
+			g.Position.Y = cropping.Y * scale.Y;
+			g.Source.X = (float)glyph.X;
+			g.Source.Y = (float)glyph.Y;
+			g.Source.Z = (float)glyph.Width;
+			g.Source.W = (float)glyph.Height;
+			m_glyphs.push_back(g);
+
+			cursor += (kerning[1] + kerning[2]) * scale.X;
+
+			if (m_size.Y < cropping.Height * scale.Y)
+				m_size.Y = cropping.Height * scale.Y;
+
+			ignoreSpacing = false;
+		}
+
+		m_size.X = cursor;
+		m_spritesDirty = true;
+	}
+
+	void TextLayout::updateSprites(const Vector2& position, Color color, float rotation, const Vector2& origin, SpriteEffects effects, float layerDepth)
+	{
+		if (m_spritesDirty == false && position.X == m_position.X && position.Y == m_position.Y &&
+			color == m_color && rotation == m_rotation && origin.X == m_origin.X && origin.Y == m_origin.Y &&
+			effects == m_effects && layerDepth == m_layerDepth)
+			return;
+
+		m_position = position;
+		m_color = color;
+		m_rotation = rotation;
+		m_origin = origin;
+		m_effects = effects;
+		m_layerDepth = layerDepth;
+		m_spritesDirty = false;
+
+		float cosine = cos(rotation);
+		float sine = sin(rotation);
+
+		SpriteBatch::Sprite s;
+		s.Texture = m_font != nullptr ? m_font->m_texture : nullptr;
+		s.SpriteColor = color;
+		s.Origin = Vector2(0, 0);
+		s.Rotation = rotation;
+		s.Depth = layerDepth;
+		s.Effects = effects;
+
+		m_sprites.resize(m_glyphs.size());
+		for (std::vector<Glyph>::size_type i = 0; i < m_glyphs.size(); i++)
+		{
+			float x = m_glyphs[i].Position.X - origin.X * m_scale.X;
+			float y = m_glyphs[i].Position.Y - origin.Y * m_scale.Y;
+
+			s.Destination.X = position.X + x * cosine - y * sine;
+			s.Destination.Y = position.Y + x * sine + y * cosine;
+			s.Destination.Z = m_glyphs[i].Source.Z * m_scale.X;
+			s.Destination.W = m_glyphs[i].Source.W * m_scale.Y;
+			s.Source = m_glyphs[i].Source;
+
+			m_sprites[i] = s;
+		}
+	}
+}
+}
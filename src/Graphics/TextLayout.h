@@ -0,0 +1,69 @@
+#ifndef NXNA_GRAPHICS_TEXTLAYOUT_H
+#define NXNA_GRAPHICS_TEXTLAYOUT_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Vector2.h"
+#include "../Vector4.h"
+#include "../Color.h"
+#include "SpriteBatch.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class SpriteFont;
+
+	// this class doesn't exist in XNA!
+	// Holds a string that has already been laid out, so drawing text that doesn't
+	// change every frame (HUDs, menus, etc) just copies the glyphs into the SpriteBatch.
+	// Use SpriteBatch::DrawString() to draw it.
+	class TextLayout
+	{
+		friend class SpriteBatch;
+
+		struct Glyph
+		{
+			Vector2 Position;
+			Vector4 Source;
+		};
+
+		SpriteFont* m_font;
+		Vector2 m_scale;
+		bool m_addSpacing;
+		Vector2 m_size;
+		std::vector<int> m_glyphIndices;
+		std::vector<int> m_newGlyphIndices;
+		std::vector<Glyph> m_glyphs;
+
+		// the glyphs as they were last drawn
+		std::vector<SpriteBatch::Sprite> m_sprites;
+		bool m_spritesDirty;
+		Vector2 m_position;
+		Color m_color;
+		float m_rotation;
+		Vector2 m_origin;
+		SpriteEffects m_effects;
+		float m_layerDepth;
+
+	public:
+		TextLayout();
+
+		// These only redo the layout when the font, text, or scale has changed,
+		// so it's fine to call them every frame.
+		void SetText(SpriteFont* font, const char* text, const Vector2& scale);
+		void SetText(SpriteFont* font, const wchar_t* text, const Vector2& scale);
+		void SetTextUTF8(SpriteFont* font, const char* text, const Vector2& scale);
+
+		SpriteFont* GetFont() { return m_font; }
+		const Vector2& GetSize() { return m_size; }
+		int GetNumGlyphs() { return (int)m_glyphs.size(); }
+
+	private:
+		void layout(SpriteFont* font, const Vector2& scale, bool addSpacing);
+		void updateSprites(const Vector2& position, Color color, float rotation, const Vector2& origin, SpriteEffects effects, float layerDepth);
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_TEXTLAYOUT_H
@@ -2,21 +2,63 @@
 #include <cstring>
 #include "Texture2D.h"
 #include "ITexture2DPimpl.h"
+#include "ImageDecoder.h"
+#include "MipmapGenerator.h"
+#include "TextureStreamer.h"
+#include "GraphicsDeviceCapabilities.h"
 #include "GraphicsDevice.h"
 #include "../Content/FileStream.h"
 #include "../Content/ContentManager.h"
 #include "../Content/XnbReader.h"
+#include "../Content/BinaryReader.h"
 #include "../MemoryAllocator.h"
+#include "../Exception.h"
 
 namespace Nxna
 {
 namespace Graphics
 {
+	// how the pixels of a DDS or KTX file need to be changed before they can be uploaded.
+	// RawBgr565 matches the XNB format code, so convert() handles all of them.
+	static const int RawInPlace = 0;
+	static const int RawBgr565 = 1;
+	static const int RawBgra = 2;
+	static const int RawBgrx = 3;
+	static const int RawRgbx = 4;
+
 	void* Texture2DLoader::Read(Content::XnbReader* stream)
 	{
+		TextureStreamer* streamer = stream->GetContentManager()->GetTextureStreamer();
+		if (streamer != nullptr)
+		{
+			Texture2D* texture = streamer->Load(stream);
+			if (texture != nullptr)
+				return texture;
+		}
+
 		return Texture2D::LoadFrom(stream);
 	}
 
+	void* Texture2DLoader::ReadRaw(Content::MemoryStream* stream, bool* keepStreamOpen)
+	{
+		*keepStreamOpen = false;
+
+		Texture2D* texture = Texture2D::LoadFromDds(stream);
+		if (texture == nullptr)
+			texture = Texture2D::LoadFromKtx(stream);
+		if (texture == nullptr)
+			texture = Texture2D::LoadFromPng(stream, true);
+
+		// TGA files don't have a signature, so they're tried last
+		if (texture == nullptr)
+			texture = Texture2D::LoadFromTga(stream, true);
+
+		if (texture == nullptr)
+			throw Content::ContentException("Unsupported texture file format");
+
+		return texture;
+	}
+
 	void Texture2DLoader::Destroy(void* resource)
 	{
 		delete static_cast<Texture2D*>(resource);
@@ -34,12 +76,124 @@ namespace Graphics
 
 	Texture2D::~Texture2D()
 	{
+		if (m_streamer != nullptr)
+			m_streamer->remove(this);
+
 		delete m_pimpl;
 	}
 
 	void Texture2D::SetData(int level, byte* pixels, int length)
 	{
+		if (m_streamer != nullptr)
+			throw InvalidOperationException("Streamed textures can't be changed");
+
 		m_pimpl->SetData(level, pixels, length);
+		keepLevel0(level, nullptr, pixels, length);
+	}
+
+	void Texture2D::SetData(int level, const Rectangle* rect, byte* pixels, int length)
+	{
+		if (m_streamer != nullptr)
+			throw InvalidOperationException("Streamed textures can't be changed");
+
+		if (rect == nullptr)
+		{
+			m_pimpl->SetData(level, pixels, length);
+			keepLevel0(level, nullptr, pixels, length);
+			return;
+		}
+
+		if (m_format != SurfaceFormat::Color)
+			throw InvalidOperationException("Only uncompressed textures can be partially updated");
+
+		int mipWidth = m_width >> level;
+		int mipHeight = m_height >> level;
+		if (rect->X < 0 || rect->Y < 0 || rect->Width <= 0 || rect->Height <= 0 ||
+			rect->X + rect->Width > mipWidth || rect->Y + rect->Height > mipHeight)
+			throw ArgumentException("rect");
+
+		if (length < rect->Width * rect->Height * 4)
+			throw ArgumentException("length");
+
+		m_pimpl->SetData(level, *rect, pixels, length);
+		keepLevel0(level, rect, pixels, length);
+	}
+
+	void Texture2D::GenerateMipmaps()
+	{
+		if (m_streamer != nullptr)
+			throw InvalidOperationException("Streamed textures can't be changed");
+		if (m_format != SurfaceFormat::Color)
+			throw InvalidOperationException("Only Color textures can have mipmaps generated");
+		if (m_device->GetCaps()->SupportsNonPowerOfTwoMipmaps == false && isPowerOfTwo() == false)
+			throw InvalidOperationException("The graphics device can't have mipmaps on textures whose size isn't a power of 2");
+
+		if (m_device->GetCaps()->SupportsGenerateMipmaps == false)
+		{
+			if (m_level0.empty())
+				throw InvalidOperationException("The graphics device can't generate mipmaps, and the texture didn't keep level 0 to build them on the CPU");
+
+			setMipChain(m_level0.data(), MipmapOptions());
+			return;
+		}
+
+		m_pimpl->GenerateMipmaps();
+	}
+
+	void Texture2D::SetDataWithMipmaps(byte* pixels, int length, const MipmapOptions& options)
+	{
+		if (m_streamer != nullptr)
+			throw InvalidOperationException("Streamed textures can't be changed");
+		if (m_format != SurfaceFormat::Color)
+			throw InvalidOperationException("Only Color textures can have mipmaps generated");
+		if (length < m_width * m_height * 4)
+			throw ArgumentException("length");
+
+		m_pimpl->SetData(0, pixels, length);
+		keepLevel0(0, nullptr, pixels, length);
+
+		// the mipmaps wouldn't be used anyway, and they'd make the texture incomplete
+		if (m_device->GetCaps()->SupportsNonPowerOfTwoMipmaps == false && isPowerOfTwo() == false)
+			return;
+
+		if (m_device->GetCaps()->SupportsGenerateMipmaps &&
+			options.Filter == MipmapFilter::Box && options.Srgb == false && options.PreserveAlphaCoverage == false)
+		{
+			m_pimpl->GenerateMipmaps();
+			return;
+		}
+
+		setMipChain(pixels, options);
+	}
+
+	void Texture2D::setMipChain(const byte* pixels, const MipmapOptions& options)
+	{
+		// pixels could be temp pool memory (the image loaders do that) so the chain gets its own
+		byte* chain = new byte[MipmapGenerator::GetChainLength(m_width, m_height)];
+
+		try
+		{
+			MipmapGenerator::Generate(pixels, m_width, m_height, options, chain);
+
+			byte* level = chain;
+			int mipWidth = m_width;
+			int mipHeight = m_height;
+			for (int i = 1; mipWidth > 1 || mipHeight > 1; i++)
+			{
+				mipWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+				mipHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+
+				m_pimpl->SetData(i, level, mipWidth * mipHeight * 4);
+				level += mipWidth * mipHeight * 4;
+			}
+		}
+		catch(...)
+		{
+			delete[] chain;
+			throw;
+		}
+
+		delete[] chain;
 	}
 
 	Texture2D* Texture2D::LoadFrom(Content::XnbReader* stream)
@@ -85,49 +239,422 @@ namespace Graphics
 		else
 			texture = new Texture2D(GraphicsDevice::GetDevice(), width, height, mipCount > 1, SurfaceFormat::Color);
 
+		// XNBs are usually mapped (or at least already in memory), so the pixels can be uploaded
+		// from where they are instead of being copied out first. SetData() doesn't modify them.
+		Content::MemoryStream* memory = dynamic_cast<Content::MemoryStream*>(stream);
+
 		byte* pixels = nullptr;
 		int imageSize;
 		for (int i = 0; i < mipCount; i++)
 		{
 			int size = stream->ReadInt32();
 
-			if (format == FormatBGR565)
-				pixels = (byte*)NxnaTempMemoryPool::GetMemory(size + size * 2);
+			const byte* source = memory != nullptr ? memory->ReadInPlace(size) : nullptr;
+			bool usingTempMemory = source == nullptr || format == FormatBGR565;
+
+			if (source == nullptr)
+			{
+				if (format == FormatBGR565)
+					pixels = (byte*)NxnaTempMemoryPool::GetMemory(size + size * 2);
+				else
+					pixels = (byte*)NxnaTempMemoryPool::GetMemory(size);
+
+				if (stream->Read(pixels, size) != size)
+				{
+					NxnaTempMemoryPool::ReleaseMemory();
+					delete texture;
+					throw Content::ContentException("Unexpected end of texture data");
+				}
+
+				source = pixels;
+				if (format == FormatBGR565)
+					pixels += size;
+			}
+			else if (format == FormatBGR565)
+			{
+				pixels = (byte*)NxnaTempMemoryPool::GetMemory(size * 2);
+			}
 			else
-				pixels = (byte*)NxnaTempMemoryPool::GetMemory(size);
+			{
+				pixels = const_cast<byte*>(source);
+			}
 
-			stream->Read(pixels, size);
 			imageSize = size;
 
 			if (format == FormatBGR565)
+				convert(const_cast<byte*>(source), size / 2, format, pixels);
+
+			texture->SetData(i, pixels, imageSize);
+
+			if (usingTempMemory)
+				NxnaTempMemoryPool::ReleaseMemory();
+		}
+
+		return texture;
+	}
+
+	Texture2D* Texture2D::LoadFromDds(Content::MemoryStream* stream)
+	{
+		const int DdsMagic = 0x20534444; // "DDS "
+		const int FourCCDxt1 = 0x31545844;
+		const int FourCCDxt3 = 0x33545844;
+		const int FourCCDxt5 = 0x35545844;
+		const int FourCCDx10 = 0x30315844;
+
+		Content::BinaryReader reader(stream);
+		if (reader.Remaining() < 128 || reader.ReadInt32() != DdsMagic)
+			return nullptr;
+
+		reader.Skip(4); // header size
+		int flags = reader.ReadInt32();
+		int height = reader.ReadInt32();
+		int width = reader.ReadInt32();
+		reader.Skip(8); // pitch and depth
+		int mipCount = reader.ReadInt32();
+		reader.Skip(44 + 4); // reserved, pixel format size
+		int pixelFlags = reader.ReadInt32();
+		int fourCC = reader.ReadInt32();
+		int bitCount = reader.ReadInt32();
+		unsigned int redMask = (unsigned int)reader.ReadInt32();
+		unsigned int greenMask = (unsigned int)reader.ReadInt32();
+		unsigned int blueMask = (unsigned int)reader.ReadInt32();
+		unsigned int alphaMask = (unsigned int)reader.ReadInt32();
+		reader.Skip(4); // caps
+		int caps2 = reader.ReadInt32();
+		reader.Skip(12);
+
+		if (width <= 0 || height <= 0)
+			throw Content::ContentException("Invalid DDS dimensions");
+		if (caps2 & (0x200 | 0x200000))
+			throw Content::ContentException("DDS cube maps and volume textures aren't supported");
+
+		// the mip count is only valid with DDSD_MIPMAPCOUNT
+		if ((flags & 0x20000) == 0 || mipCount < 1)
+			mipCount = 1;
+
+		SurfaceFormat format = SurfaceFormat::Color;
+		int layout = RawInPlace;
+
+		if (pixelFlags & 0x4) // DDPF_FOURCC
+		{
+			if (fourCC == FourCCDxt1)
+				format = SurfaceFormat::Dxt1;
+			else if (fourCC == FourCCDxt3)
+				format = SurfaceFormat::Dxt3;
+			else if (fourCC == FourCCDxt5)
+				format = SurfaceFormat::Dxt5;
+			else if (fourCC == FourCCDx10)
 			{
-				byte* convertedPixels = pixels + size;
-				convert(pixels, size / 2, format, convertedPixels);
-				pixels = convertedPixels;
+				int dxgiFormat = reader.ReadInt32();
+				int dimension = reader.ReadInt32();
+				int miscFlags = reader.ReadInt32();
+				int arraySize = reader.ReadInt32();
+				reader.Skip(4);
+
+				if (dimension != 3 || (miscFlags & 0x4) || arraySize > 1)
+					throw Content::ContentException("Only 2D DDS textures are supported");
+
+				switch(dxgiFormat)
+				{
+				case 71: case 72: // BC1
+					format = SurfaceFormat::Dxt1; break;
+				case 74: case 75: // BC2
+					format = SurfaceFormat::Dxt3; break;
+				case 77: case 78: // BC3
+					format = SurfaceFormat::Dxt5; break;
+				case 28: case 29: // R8G8B8A8
+					break;
+				case 87: case 91: // B8G8R8A8
+					layout = RawBgra; break;
+				case 88: case 93: // B8G8R8X8
+					layout = RawBgrx; break;
+				case 85: // B5G6R5
+					layout = RawBgr565; break;
+				default:
+					throw Content::ContentException("Unsupported DDS format");
+				}
 			}
+			else
+				throw Content::ContentException("Unsupported DDS format");
+		}
+		else if ((pixelFlags & 0x40) && bitCount == 32) // DDPF_RGB
+		{
+			bool hasAlpha = (pixelFlags & 0x1) && alphaMask == 0xff000000;
 
-			texture->SetData(i, pixels, imageSize);
+			if (redMask == 0x000000ff && greenMask == 0x0000ff00 && blueMask == 0x00ff0000)
+				layout = hasAlpha ? RawInPlace : RawRgbx;
+			else if (redMask == 0x00ff0000 && greenMask == 0x0000ff00 && blueMask == 0x000000ff)
+				layout = hasAlpha ? RawBgra : RawBgrx;
+			else
+				throw Content::ContentException("Unsupported DDS format");
+		}
+		else if ((pixelFlags & 0x40) && bitCount == 16 && redMask == 0xf800 && greenMask == 0x07e0 && blueMask == 0x001f)
+			layout = RawBgr565;
+		else
+			throw Content::ContentException("Unsupported DDS format");
+
+		reader.Finish();
 
+		Texture2D* texture = new Texture2D(GraphicsDevice::GetDevice(), width, height, mipCount > 1, format);
+		loadMips(texture, stream, mipCount, layout, false);
+
+		return texture;
+	}
+
+	Texture2D* Texture2D::LoadFromKtx(Content::MemoryStream* stream)
+	{
+		static const byte identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		Content::BinaryReader reader(stream);
+		if (reader.Remaining() < 64 || memcmp(reader.ReadInPlace(12), identifier, 12) != 0)
+			return nullptr;
+
+		if (reader.ReadInt32() != 0x04030201)
+			throw Content::ContentException("Big-endian KTX files aren't supported");
+
+		int glType = reader.ReadInt32();
+		reader.Skip(4); // glTypeSize
+		int glFormat = reader.ReadInt32();
+		int glInternalFormat = reader.ReadInt32();
+		reader.Skip(4); // glBaseInternalFormat
+		int width = reader.ReadInt32();
+		int height = reader.ReadInt32();
+		int depth = reader.ReadInt32();
+		int arrayElements = reader.ReadInt32();
+		int faces = reader.ReadInt32();
+		int mipCount = reader.ReadInt32();
+		int keyValueBytes = reader.ReadInt32();
+
+		if (width <= 0 || height <= 0 || depth != 0 || arrayElements != 0 || faces != 1)
+			throw Content::ContentException("Only 2D KTX textures are supported");
+
+		// 0 means the mips should be generated at load time, which we don't do
+		if (mipCount < 1)
+			mipCount = 1;
+
+		reader.Skip(keyValueBytes);
+
+		SurfaceFormat format;
+		switch(glInternalFormat)
+		{
+		case 0x8D64: // GL_ETC1_RGB8_OES
+			format = SurfaceFormat::Etc1; break;
+		case 0x9274: // GL_COMPRESSED_RGB8_ETC2
+			format = SurfaceFormat::Etc2Rgb; break;
+		case 0x9278: // GL_COMPRESSED_RGBA8_ETC2_EAC
+			format = SurfaceFormat::Etc2Rgba; break;
+		case 0x83F0: case 0x83F1: // GL_COMPRESSED_RGB(A)_S3TC_DXT1_EXT
+			format = SurfaceFormat::Dxt1; break;
+		case 0x83F2: // GL_COMPRESSED_RGBA_S3TC_DXT3_EXT
+			format = SurfaceFormat::Dxt3; break;
+		case 0x83F3: // GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+			format = SurfaceFormat::Dxt5; break;
+		case 0x8058: case 0x1908: // GL_RGBA8, GL_RGBA
+			if (glType != 0x1401 || glFormat != 0x1908) // GL_UNSIGNED_BYTE, GL_RGBA
+				throw Content::ContentException("Unsupported KTX format");
+			format = SurfaceFormat::Color; break;
+		default:
+			throw Content::ContentException("Unsupported KTX format");
+		}
+
+		reader.Finish();
+
+		Texture2D* texture = new Texture2D(GraphicsDevice::GetDevice(), width, height, mipCount > 1, format);
+		loadMips(texture, stream, mipCount, RawInPlace, true);
+
+		return texture;
+	}
+
+	Texture2D* Texture2D::LoadFromPng(Content::MemoryStream* stream, bool premultiplyAlpha, bool generateMipmaps)
+	{
+		int width, height;
+		byte* pixels = ImageDecoder::DecodePng(stream->GetBuffer() + stream->Position(), stream->Length() - stream->Position(), premultiplyAlpha, &width, &height);
+		if (pixels == nullptr)
+			return nullptr;
+
+		return createFromDecodedPixels(stream, pixels, width, height, generateMipmaps);
+	}
+
+	Texture2D* Texture2D::LoadFromTga(Content::MemoryStream* stream, bool premultiplyAlpha, bool generateMipmaps)
+	{
+		int width, height;
+		byte* pixels = ImageDecoder::DecodeTga(stream->GetBuffer() + stream->Position(), stream->Length() - stream->Position(), premultiplyAlpha, &width, &height);
+		if (pixels == nullptr)
+			return nullptr;
+
+		return createFromDecodedPixels(stream, pixels, width, height, generateMipmaps);
+	}
+
+	Texture2D* Texture2D::createFromDecodedPixels(Content::MemoryStream* stream, byte* pixels, int width, int height, bool generateMipmaps)
+	{
+		// the pixels are in temp memory, which has to be released no matter what
+		Texture2D* texture = nullptr;
+		try
+		{
+			texture = new Texture2D(GraphicsDevice::GetDevice(), width, height, generateMipmaps, SurfaceFormat::Color);
+
+			if (generateMipmaps)
+				texture->SetDataWithMipmaps(pixels, width * height * 4, MipmapOptions());
+			else
+				texture->SetData(0, pixels, width * height * 4);
+		}
+		catch(...)
+		{
 			NxnaTempMemoryPool::ReleaseMemory();
+			delete texture;
+			throw;
 		}
 
+		NxnaTempMemoryPool::ReleaseMemory();
+		stream->Seek(0, Content::SeekOrigin::End);
+
 		return texture;
 	}
 
+	void Texture2D::loadMips(Texture2D* texture, Content::MemoryStream* stream, int mipCount, int layout, bool sizePrefixed)
+	{
+		int blockSize = 0;
+		if (texture->m_format == SurfaceFormat::Dxt1 || texture->m_format == SurfaceFormat::Etc1 || texture->m_format == SurfaceFormat::Etc2Rgb)
+			blockSize = 8;
+		else if (texture->m_format == SurfaceFormat::Dxt3 || texture->m_format == SurfaceFormat::Dxt5 || texture->m_format == SurfaceFormat::Etc2Rgba)
+			blockSize = 16;
+
+		Content::BinaryReader reader(stream);
+
+		try
+		{
+			for (int i = 0; i < mipCount; i++)
+			{
+				int mipWidth = texture->m_width >> i;
+				int mipHeight = texture->m_height >> i;
+				if (mipWidth < 1) mipWidth = 1;
+				if (mipHeight < 1) mipHeight = 1;
+
+				int size;
+				if (blockSize > 0)
+					size = ((mipWidth + 3) / 4) * ((mipHeight + 3) / 4) * blockSize;
+				else
+					size = mipWidth * mipHeight * (layout == RawBgr565 ? 2 : 4);
+
+				// KTX puts the size before each mip, and pads the data to 4 bytes
+				int storedSize = size;
+				if (sizePrefixed)
+				{
+					storedSize = reader.ReadInt32();
+					if (storedSize < size)
+						throw Content::ContentException("Invalid mip size");
+				}
+
+				const byte* source = reader.ReadInPlace(size);
+				if (sizePrefixed)
+					reader.Skip(storedSize - size + (3 - (storedSize + 3) % 4));
+
+				// the mapped file can go straight to the GPU. Anything else needs converting first.
+				if (layout == RawInPlace)
+					texture->SetData(i, const_cast<byte*>(source), size);
+				else
+				{
+					byte* pixels = (byte*)NxnaTempMemoryPool::GetMemory(mipWidth * mipHeight * 4);
+					convert(const_cast<byte*>(source), mipWidth * mipHeight, layout, pixels);
+					texture->SetData(i, pixels, mipWidth * mipHeight * 4);
+					NxnaTempMemoryPool::ReleaseMemory();
+				}
+			}
+		}
+		catch(...)
+		{
+			delete texture;
+			throw;
+		}
+
+		reader.Finish();
+	}
+
 	Texture2D::Texture2D(GraphicsDevice* device, int width, int height, bool mipMap, SurfaceFormat format, bool isRenderTarget)
 	{
 		init(device, width, height, mipMap, format, isRenderTarget);
 	}
 
+	Texture2D::Texture2D(GraphicsDevice* device, int width, int height, SurfaceFormat format, TextureStreamer* streamer)
+	{
+		m_device = device;
+		m_width = width;
+		m_height = height;
+		m_format = format;
+		m_streamer = streamer;
+		m_frameRequest = NoMipRequest;
+		m_keepLevel0 = false;
+		m_pimpl = nullptr;
+	}
+
 	void Texture2D::init(GraphicsDevice* device, int width, int height, bool mipMap, SurfaceFormat format, bool isRenderTarget)
 	{
 		m_device = device;
 		m_width = width;
 		m_height = height;
+		m_format = format;
+		m_streamer = nullptr;
+		m_frameRequest = NoMipRequest;
+		m_keepLevel0 = mipMap && format == SurfaceFormat::Color && isRenderTarget == false &&
+			device->GetCaps()->SupportsGenerateMipmaps == false;
 
 		m_pimpl = device->CreateTexture2DPimpl(width, height, mipMap, format, isRenderTarget);
 	}
 
+	void Texture2D::keepLevel0(int level, const Rectangle* rect, const byte* pixels, int length)
+	{
+		if (m_keepLevel0 == false)
+			return;
+
+		if (level != 0)
+		{
+			// the caller has its own chain, so there's no need to build one
+			m_keepLevel0 = false;
+			std::vector<byte>().swap(m_level0);
+			return;
+		}
+
+		if (rect == nullptr)
+		{
+			if (length < m_width * m_height * 4)
+				m_level0.clear();
+			else
+				m_level0.assign(pixels, pixels + m_width * m_height * 4);
+			return;
+		}
+
+		if (m_level0.empty())
+			m_level0.resize(m_width * m_height * 4, 0);
+
+		for (int y = 0; y < rect->Height; y++)
+			memcpy(&m_level0[((rect->Y + y) * m_width + rect->X) * 4], pixels + y * rect->Width * 4, rect->Width * 4);
+	}
+
+	void Texture2D::setStreamedLevels(int firstLevel, int numLevels, const byte* const* levels, const int* sizes)
+	{
+		int width = m_width >> firstLevel;
+		int height = m_height >> firstLevel;
+		if (width < 1) width = 1;
+		if (height < 1) height = 1;
+
+		// the new levels go into a new pimpl so the old one can be drawn with until it's replaced
+		Pvt::ITexture2DPimpl* pimpl = m_device->CreateTexture2DPimpl(width, height, numLevels > 1, m_format, false);
+
+		try
+		{
+			for (int i = 0; i < numLevels; i++)
+				pimpl->SetData(i, const_cast<byte*>(levels[i]), sizes[i]);
+		}
+		catch(...)
+		{
+			delete pimpl;
+			throw;
+		}
+
+		delete m_pimpl;
+		m_pimpl = pimpl;
+	}
+
 	void Texture2D::convert(byte* pixels, int length, int format, byte* destination)
 	{
 		if (format == 1)
@@ -146,6 +673,26 @@ namespace Graphics
 				destination[i * 4 + 3] = 255;
 			}
 		}
+		else if (format == RawBgra || format == RawBgrx)
+		{
+			for (int i = 0; i < length; i++)
+			{
+				destination[i * 4 + 0] = pixels[i * 4 + 2];
+				destination[i * 4 + 1] = pixels[i * 4 + 1];
+				destination[i * 4 + 2] = pixels[i * 4 + 0];
+				destination[i * 4 + 3] = format == RawBgra ? pixels[i * 4 + 3] : 255;
+			}
+		}
+		else if (format == RawRgbx)
+		{
+			for (int i = 0; i < length; i++)
+			{
+				destination[i * 4 + 0] = pixels[i * 4 + 0];
+				destination[i * 4 + 1] = pixels[i * 4 + 1];
+				destination[i * 4 + 2] = pixels[i * 4 + 2];
+				destination[i * 4 + 3] = 255;
+			}
+		}
 	}
 
 	void Texture2D::convert565(unsigned short pixel, byte* r, byte* g, byte* b)
@@ -1,6 +1,7 @@
 #ifndef GRAPHICS_TEXTURE2D_H
 #define GRAPHICS_TEXTURE2D_H
 
+#include <vector>
 #include "../NxnaConfig.h"
 #include "../Content/ContentManager.h"
 #include "../Rectangle.h"
@@ -27,12 +28,20 @@ namespace Graphics
 
 		// the following are not supported by XNA. These are our own
 		// extensions so that iOS devices can have compressed textures too.
-		Pvrtc4
+		Pvrtc4,
+
+		// and these are so Android and other GLES devices can.
+		// ETC2 decoders can read ETC1 too.
+		Etc1,
+		Etc2Rgb,
+		Etc2Rgba
 	END_NXNA_ENUM(SurfaceFormat)
 
 	class GraphicsDevice;
 	class SamplerState;
+	struct MipmapOptions;
 	class RenderTarget2D;
+	class TextureStreamer;
 
 	namespace Pvt
 	{
@@ -42,6 +51,9 @@ namespace Graphics
 	class Texture2D 
 	{
 		friend class RenderTarget2D;
+		friend class TextureStreamer;
+
+		static const int NoMipRequest = 0x7fffffff;
 
 	protected:
 		int m_width;
@@ -49,6 +61,13 @@ namespace Graphics
 		SurfaceFormat m_format;
 		GraphicsDevice* m_device;
 		Pvt::ITexture2DPimpl* m_pimpl;
+		TextureStreamer* m_streamer;
+		int m_frameRequest;
+
+		// A copy of level 0, so GenerateMipmaps() can build the chain on the CPU when the device can't.
+		// Only mipmapped Color textures on those devices keep it, and only until another level is set.
+		bool m_keepLevel0;
+		std::vector<byte> m_level0;
 
 	public:
 
@@ -73,6 +92,26 @@ namespace Graphics
 
 		void SetData(int level, byte* pixels, int length);
 
+		// Updates part of the texture. The pixels need to be tightly packed.
+		// Only supported by uncompressed textures.
+		void SetData(int level, const Rectangle* rect, byte* pixels, int length);
+
+		// These aren't part of XNA. GenerateMipmaps() fills in the rest of the mip chain from level 0, on
+		// the GPU when GetCaps()->SupportsGenerateMipmaps is true and with a box filter on the CPU when
+		// it isn't. The CPU path only works on textures created with mipMap set that have only had
+		// level 0 set, since that's the only level that's kept around for it.
+		// SetDataWithMipmaps() sets level 0 and the rest of the chain built from it. The GPU is used when
+		// it can do what the options ask for (a plain box filter), otherwise the chain is built on the CPU.
+		// Both only work with SurfaceFormat::Color.
+		void GenerateMipmaps();
+		void SetDataWithMipmaps(byte* pixels, int length, const MipmapOptions& options);
+
+		// These aren't part of XNA. Textures loaded through a TextureStreamer only keep the mip levels
+		// that have been asked for on the GPU. RequestMipLevel() asks for the level needed this frame
+		// (the smallest one asked for wins), and does nothing to textures that aren't streamed.
+		bool IsStreamed() { return m_streamer != nullptr; }
+		void RequestMipLevel(int level) { if (level < m_frameRequest) m_frameRequest = level; }
+
 		// HACK: this is NOT how XNA works! we need to find a better way to do this.
 		//virtual void SetSamplerState(const SamplerState* state) = 0;
 
@@ -81,13 +120,32 @@ namespace Graphics
 		static Texture2D* LoadFrom(Content::Stream* stream);
 		static Texture2D* LoadFrom(Content::XnbReader* stream);
 
+		// These aren't part of XNA. They load DDS and KTX files, including their mip chains.
+		// Return nullptr if the data isn't that kind of file, and throw if it's a kind that isn't supported.
+		static Texture2D* LoadFromDds(Content::MemoryStream* stream);
+		static Texture2D* LoadFromKtx(Content::MemoryStream* stream);
+
+		// These aren't part of XNA either. They decode PNG and TGA files and return nullptr if the
+		// data isn't that kind of file. XNA's content pipeline premultiplies alpha by default.
+		static Texture2D* LoadFromPng(Content::MemoryStream* stream, bool premultiplyAlpha, bool generateMipmaps = false);
+		static Texture2D* LoadFromTga(Content::MemoryStream* stream, bool premultiplyAlpha, bool generateMipmaps = false);
+
 	private:
 		
 		// special constructor used by the RenderTarget2D
 		Texture2D(GraphicsDevice* device, int width, int height, bool mipMap, SurfaceFormat format, bool isRenderTarget);
 
+		// special constructor used by the TextureStreamer. There's no pimpl until setStreamedLevels().
+		Texture2D(GraphicsDevice* device, int width, int height, SurfaceFormat format, TextureStreamer* streamer);
+
 		void init(GraphicsDevice* device, int width, int height, bool mipMap, SurfaceFormat format, bool isRenderTarget);
+		void setStreamedLevels(int firstLevel, int numLevels, const byte* const* levels, const int* sizes);
+		void keepLevel0(int level, const Rectangle* rect, const byte* pixels, int length);
+		void setMipChain(const byte* pixels, const MipmapOptions& options);
+		bool isPowerOfTwo() { return (m_width & (m_width - 1)) == 0 && (m_height & (m_height - 1)) == 0; }
 
+		static void loadMips(Texture2D* texture, Content::MemoryStream* stream, int mipCount, int layout, bool sizePrefixed);
+		static Texture2D* createFromDecodedPixels(Content::MemoryStream* stream, byte* pixels, int width, int height, bool generateMipmaps);
 		static void convert(byte* pixels, int length, int format, byte* destination);
 		static void convert565(unsigned short pixel, byte* r, byte* g, byte* b);
 	};
@@ -97,6 +155,7 @@ namespace Graphics
 	public:
 		virtual const char* GetTypeName() override { return typeid(Texture2D).name(); }
 		virtual void* Read(Content::XnbReader* stream) override;
+		virtual void* ReadRaw(Content::MemoryStream* stream, bool* keepStreamOpen) override;
 		virtual void Destroy(void* resource) override;
 	};
 }
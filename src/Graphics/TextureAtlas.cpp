@@ -0,0 +1,347 @@
+#include <cassert>
+#include <cstring>
+#include <climits>
+#include "TextureAtlas.h"
+#include "Texture2D.h"
+#include "GraphicsDevice.h"
+#include "../Content/XnbReader.h"
+#include "../Content/FileStream.h"
+#include "../MemoryAllocator.h"
+#include "../MathHelper.h"
+#include "../Exception.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	TextureAtlas::TextureAtlas(GraphicsDevice* device, int pageWidth, int pageHeight, int padding)
+	{
+		assert(device != nullptr);
+
+		if (pageWidth <= 0 || pageHeight <= 0)
+			throw ArgumentException("Page size must be greater than 0", "pageWidth");
+		if (padding < 0)
+			throw ArgumentException("padding");
+
+		m_device = device;
+		m_pageWidth = pageWidth;
+		m_pageHeight = pageHeight;
+		m_padding = padding;
+	}
+
+	TextureAtlas::~TextureAtlas()
+	{
+		Clear();
+	}
+
+	AtlasRegion* TextureAtlas::Add(int width, int height, const byte* pixels)
+	{
+		assert(pixels != nullptr);
+
+		if (width <= 0 || height <= 0)
+			throw ArgumentException("width");
+
+		int paddedWidth = width + m_padding * 2;
+		int paddedHeight = height + m_padding * 2;
+		if (paddedWidth > m_pageWidth || paddedHeight > m_pageHeight)
+			throw ArgumentException("Image is too large for the atlas pages", "width");
+
+		int x, y, nodeIndex;
+		int pageIndex = -1;
+		for (std::vector<Page>::size_type i = 0; i < m_pages.size(); i++)
+		{
+			if (findPosition(m_pages[i], paddedWidth, paddedHeight, &x, &y, &nodeIndex))
+			{
+				pageIndex = (int)i;
+				break;
+			}
+		}
+
+		if (pageIndex == -1)
+		{
+			createPage();
+			pageIndex = (int)m_pages.size() - 1;
+
+			// an empty page always has room since the size was checked above
+			findPosition(m_pages[pageIndex], paddedWidth, paddedHeight, &x, &y, &nodeIndex);
+		}
+
+		Page& page = m_pages[pageIndex];
+		addSkylineLevel(page, nodeIndex, x, y, paddedWidth, paddedHeight);
+		upload(page, x, y, width, height, pixels);
+
+		page.UsedArea += width * height;
+		page.NumRegions++;
+
+		AtlasRegion* region = new AtlasRegion();
+		region->m_atlas = this;
+		region->m_texture = page.Texture;
+		region->m_source = Rectangle(x + m_padding, y + m_padding, width, height);
+		region->m_page = pageIndex;
+		m_regions.push_back(region);
+
+		return region;
+	}
+
+	void TextureAtlas::Remove(AtlasRegion* region)
+	{
+		assert(region != nullptr);
+
+		for (std::vector<AtlasRegion*>::iterator itr = m_regions.begin(); itr != m_regions.end(); ++itr)
+		{
+			if ((*itr) == region)
+			{
+				m_regions.erase(itr);
+
+				Page& page = m_pages[region->m_page];
+				page.UsedArea -= region->m_source.Width * region->m_source.Height;
+				page.NumRegions--;
+
+				// the skyline can't free individual rectangles, but it can start over
+				if (page.NumRegions == 0)
+					resetPage(page);
+
+				delete region;
+				return;
+			}
+		}
+
+		throw ArgumentException("The region doesn't belong to this atlas", "region");
+	}
+
+	void TextureAtlas::EvictPage(int index)
+	{
+		if (index < 0 || index >= (int)m_pages.size())
+			throw ArgumentException("index");
+
+		for (std::vector<AtlasRegion*>::size_type i = 0; i < m_regions.size();)
+		{
+			if (m_regions[i]->m_page == index)
+			{
+				delete m_regions[i];
+				m_regions.erase(m_regions.begin() + i);
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		resetPage(m_pages[index]);
+	}
+
+	void TextureAtlas::Clear()
+	{
+		for (std::vector<AtlasRegion*>::size_type i = 0; i < m_regions.size(); i++)
+			delete m_regions[i];
+		m_regions.clear();
+
+		for (std::vector<Page>::size_type i = 0; i < m_pages.size(); i++)
+			delete m_pages[i].Texture;
+		m_pages.clear();
+	}
+
+	float TextureAtlas::GetPackingEfficiency()
+	{
+		if (m_pages.empty())
+			return 0;
+
+		int usedArea = 0;
+		for (std::vector<Page>::size_type i = 0; i < m_pages.size(); i++)
+			usedArea += m_pages[i].UsedArea;
+
+		return (float)usedArea / ((float)m_pageWidth * m_pageHeight * m_pages.size());
+	}
+
+	void TextureAtlas::createPage()
+	{
+		Page page;
+		page.Texture = new Texture2D(m_device, m_pageWidth, m_pageHeight, false, SurfaceFormat::Color);
+		resetPage(page);
+
+		// start with a clear page so that nothing undefined ends up in the padding
+		int size = m_pageWidth * m_pageHeight * 4;
+		byte* pixels = (byte*)NxnaTempMemoryPool::GetMemory(size);
+		memset(pixels, 0, size);
+		page.Texture->SetData(pixels, size);
+		NxnaTempMemoryPool::ReleaseMemory();
+
+		m_pages.push_back(page);
+	}
+
+	void TextureAtlas::resetPage(Page& page)
+	{
+		SkylineNode node;
+		node.X = 0;
+		node.Y = 0;
+		node.Width = m_pageWidth;
+
+		page.Skyline.clear();
+		page.Skyline.push_back(node);
+		page.UsedArea = 0;
+		page.NumRegions = 0;
+	}
+
+	bool TextureAtlas::findPosition(Page& page, int width, int height, int* x, int* y, int* nodeIndex)
+	{
+		// bottom-left rule: pick the spot that leaves the top of the image lowest,
+		// and if there's a tie, the narrowest level (to leave the wide ones for wide images)
+		int bestBottom = INT_MAX;
+		int bestWidth = INT_MAX;
+		int bestIndex = -1;
+
+		for (std::vector<SkylineNode>::size_type i = 0; i < page.Skyline.size(); i++)
+		{
+			int top = fit(page, (int)i, width, height);
+			if (top < 0)
+				continue;
+
+			if (top + height < bestBottom || (top + height == bestBottom && page.Skyline[i].Width < bestWidth))
+			{
+				bestBottom = top + height;
+				bestWidth = page.Skyline[i].Width;
+				bestIndex = (int)i;
+				*x = page.Skyline[i].X;
+				*y = top;
+			}
+		}
+
+		*nodeIndex = bestIndex;
+		return bestIndex != -1;
+	}
+
+	int TextureAtlas::fit(Page& page, int nodeIndex, int width, int height)
+	{
+		int x = page.Skyline[nodeIndex].X;
+		if (x + width > m_pageWidth)
+			return -1;
+
+		// the image rests on the highest level it spans
+		int y = page.Skyline[nodeIndex].Y;
+		int widthLeft = width;
+		for (std::vector<SkylineNode>::size_type i = nodeIndex; widthLeft > 0; i++)
+		{
+			if (i >= page.Skyline.size())
+				return -1;
+
+			y = Math::Max(y, page.Skyline[i].Y);
+			if (y + height > m_pageHeight)
+				return -1;
+
+			widthLeft -= page.Skyline[i].Width;
+		}
+
+		return y;
+	}
+
+	void TextureAtlas::addSkylineLevel(Page& page, int nodeIndex, int x, int y, int width, int height)
+	{
+		SkylineNode node;
+		node.X = x;
+		node.Y = y + height;
+		node.Width = width;
+		page.Skyline.insert(page.Skyline.begin() + nodeIndex, node);
+
+		// shrink or remove the levels that are now underneath the new one
+		for (std::vector<SkylineNode>::size_type i = nodeIndex + 1; i < page.Skyline.size();)
+		{
+			SkylineNode& previous = page.Skyline[i - 1];
+			SkylineNode& current = page.Skyline[i];
+
+			if (current.X >= previous.X + previous.Width)
+				break;
+
+			int shrink = previous.X + previous.Width - current.X;
+			current.X += shrink;
+			current.Width -= shrink;
+
+			if (current.Width > 0)
+				break;
+
+			page.Skyline.erase(page.Skyline.begin() + i);
+		}
+
+		// merge neighbors at the same height
+		for (std::vector<SkylineNode>::size_type i = 0; i + 1 < page.Skyline.size();)
+		{
+			if (page.Skyline[i].Y == page.Skyline[i + 1].Y)
+			{
+				page.Skyline[i].Width += page.Skyline[i + 1].Width;
+				page.Skyline.erase(page.Skyline.begin() + i + 1);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	void TextureAtlas::upload(Page& page, int x, int y, int width, int height, const byte* pixels)
+	{
+		int paddedWidth = width + m_padding * 2;
+		int paddedHeight = height + m_padding * 2;
+		int size = paddedWidth * paddedHeight * 4;
+
+		byte* buffer = (byte*)NxnaTempMemoryPool::GetMemory(size);
+
+		// copy the image into the middle and repeat its edges out into the padding
+		for (int row = 0; row < paddedHeight; row++)
+		{
+			int sourceRow = MathHelper::Clampi(row - m_padding, 0, height - 1);
+			const byte* source = pixels + sourceRow * width * 4;
+			byte* destination = buffer + row * paddedWidth * 4;
+
+			for (int i = 0; i < m_padding; i++)
+			{
+				memcpy(destination + i * 4, source, 4);
+				memcpy(destination + (m_padding + width + i) * 4, source + (width - 1) * 4, 4);
+			}
+
+			memcpy(destination + m_padding * 4, source, width * 4);
+		}
+
+		Rectangle rect(x, y, paddedWidth, paddedHeight);
+		page.Texture->SetData(0, &rect, buffer, size);
+
+		NxnaTempMemoryPool::ReleaseMemory();
+	}
+
+	void* AtlasRegionLoader::Read(Content::XnbReader* reader)
+	{
+		assert(reader != nullptr);
+
+		TextureAtlas* atlas = reader->GetContentManager()->GetTextureAtlas();
+		if (atlas == nullptr)
+			throw Content::ContentException("The ContentManager doesn't have a TextureAtlas");
+
+		reader->ReadTypeID();
+		Content::Stream* stream = reader->GetStream();
+
+		const int FormatColor = 0;
+
+		int format = stream->ReadInt32();
+		if (format != FormatColor)
+			throw Content::ContentException("Only uncompressed textures can be added to a texture atlas");
+
+		int width = stream->ReadInt32();
+		int height = stream->ReadInt32();
+		stream->ReadInt32(); // mip count. The atlas only uses the top level.
+
+		int size = stream->ReadInt32();
+		if (size != width * height * 4)
+			throw Content::ContentException("Invalid texture size");
+
+		// Add() uses the temp memory pool, so the pixels can't be kept there
+		std::vector<byte> pixels(size);
+		stream->Read(&pixels[0], size);
+
+		return atlas->Add(width, height, &pixels[0]);
+	}
+
+	void AtlasRegionLoader::Destroy(void* resource)
+	{
+		AtlasRegion* region = static_cast<AtlasRegion*>(resource);
+		region->GetAtlas()->Remove(region);
+	}
+}
+}
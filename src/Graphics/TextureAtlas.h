@@ -0,0 +1,114 @@
+#ifndef NXNA_GRAPHICS_TEXTUREATLAS_H
+#define NXNA_GRAPHICS_TEXTUREATLAS_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Rectangle.h"
+#include "../Content/ContentManager.h"
+
+NXNA_DISABLE_OVERRIDE_WARNING
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class GraphicsDevice;
+	class Texture2D;
+	class TextureAtlas;
+
+	// this class doesn't exist in XNA!
+	// A piece of one of the atlas' pages. SpriteBatch::Draw() accepts these directly.
+	class AtlasRegion
+	{
+		friend class TextureAtlas;
+
+		TextureAtlas* m_atlas;
+		Texture2D* m_texture;
+		Rectangle m_source;
+		int m_page;
+
+	public:
+		TextureAtlas* GetAtlas() { return m_atlas; }
+		Texture2D* GetTexture() { return m_texture; }
+		const Rectangle& GetSourceRectangle() { return m_source; }
+		int GetWidth() { return m_source.Width; }
+		int GetHeight() { return m_source.Height; }
+	};
+
+	// this class doesn't exist in XNA!
+	// Packs lots of small images into a few big textures ("pages") so that
+	// SpriteBatch doesn't have to switch textures between them.
+	// Images can be added at any time, and they're uploaded to the page right away.
+	class TextureAtlas
+	{
+		// the skyline is the top edge of everything packed into the page so far
+		struct SkylineNode
+		{
+			int X, Y, Width;
+		};
+
+		struct Page
+		{
+			Texture2D* Texture;
+			std::vector<SkylineNode> Skyline;
+			int UsedArea;
+			int NumRegions;
+		};
+
+		GraphicsDevice* m_device;
+		int m_pageWidth;
+		int m_pageHeight;
+		int m_padding;
+		std::vector<Page> m_pages;
+		std::vector<AtlasRegion*> m_regions;
+
+	public:
+
+		// padding is the number of pixels around each image. The border pixels of the
+		// image are copied into the padding so that filtering doesn't bleed in the neighbors.
+		TextureAtlas(GraphicsDevice* device, int pageWidth, int pageHeight, int padding);
+		~TextureAtlas();
+
+		// Copies the image into the atlas. The pixels must be in SurfaceFormat::Color.
+		// A new page is created when the image doesn't fit anywhere else.
+		AtlasRegion* Add(int width, int height, const byte* pixels);
+
+		// Frees the region. Once a page is empty its space is reused.
+		void Remove(AtlasRegion* region);
+
+		// Removes every region on the page. Any pointers to those regions are no longer valid!
+		void EvictPage(int index);
+
+		void Clear();
+
+		int GetNumPages() { return (int)m_pages.size(); }
+		Texture2D* GetPage(int index) { return m_pages[index].Texture; }
+		int GetNumRegions() { return (int)m_regions.size(); }
+
+		// the fraction of the pages covered by images (not counting padding)
+		float GetPackingEfficiency();
+
+	private:
+		void createPage();
+		void resetPage(Page& page);
+		bool findPosition(Page& page, int width, int height, int* x, int* y, int* nodeIndex);
+		int fit(Page& page, int nodeIndex, int width, int height);
+		void addSkylineLevel(Page& page, int nodeIndex, int x, int y, int width, int height);
+		void upload(Page& page, int x, int y, int width, int height, const byte* pixels);
+	};
+
+	// Loads a texture into the ContentManager's TextureAtlas instead of its own Texture2D.
+	// Use ContentManager::Load<AtlasRegion>() to load textures this way.
+	class AtlasRegionLoader : public Content::IContentReader
+	{
+	public:
+		virtual const char* GetTypeName() override { return typeid(AtlasRegion).name(); }
+		virtual void* Read(Content::XnbReader* stream) override;
+		virtual void Destroy(void* resource) override;
+	};
+}
+}
+
+NXNA_ENABLE_OVERRIDE_WARNING
+
+#endif // NXNA_GRAPHICS_TEXTUREATLAS_H
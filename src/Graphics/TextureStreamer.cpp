@@ -0,0 +1,317 @@
+#include <algorithm>
+#include "TextureStreamer.h"
+#include "Texture2D.h"
+#include "GraphicsDevice.h"
+#include "../Content/ContentManager.h"
+#include "../Content/BinaryReader.h"
+#include "../Content/XnbReader.h"
+#include "../Content/MappedFileStream.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	TextureStreamer::TextureStreamer(unsigned int budgetBytes)
+	{
+		m_budget = budgetBytes;
+		m_maxUploadPerFrame = 4 * 1024 * 1024;
+		m_initialSize = 64;
+		m_frame = 0;
+		m_residentBytes = 0;
+
+		m_stats.NumTextures = 0;
+		m_stats.NumPending = 0;
+		m_stats.ResidentBytes = 0;
+		m_stats.RequestedBytes = 0;
+		m_stats.BudgetBytes = budgetBytes;
+		m_stats.UploadedBytes = 0;
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// the textures keep whatever levels they have now, but they can't change anymore
+		for (std::vector<Entry*>::size_type i = 0; i < m_entries.size(); i++)
+		{
+			Utils::Jobs::Wait(&m_entries[i]->Prefetch);
+
+			m_entries[i]->Texture->m_streamer = nullptr;
+			delete m_entries[i]->Source;
+			delete m_entries[i];
+		}
+	}
+
+	Texture2D* TextureStreamer::Load(Content::XnbReader* reader)
+	{
+		// only mapped files are sure to stay around
+		Content::MappedFileStream* stream = dynamic_cast<Content::MappedFileStream*>(reader->GetStream());
+		if (stream == nullptr || reader->IsCompressed())
+			return nullptr;
+
+		// these match the ones in Texture2D::LoadFrom()
+		const int FormatColor = 0;
+		const int FormatDXT1 = 4;
+		const int FormatDXT3 = 5;
+		const int FormatDXT5 = 6;
+		const int FormatPVRTC4 = 100;
+
+		Content::BinaryReader binary(stream);
+		binary.Read7BitEncodedInt(); // type ID
+		int format = binary.ReadInt32();
+		int width = binary.ReadInt32();
+		int height = binary.ReadInt32();
+		int mipCount = binary.ReadInt32();
+
+		// BGR565 has to be converted before it's uploaded, so it isn't streamed
+		SurfaceFormat surfaceFormat;
+		if (format == FormatColor)
+			surfaceFormat = SurfaceFormat::Color;
+		else if (format == FormatDXT1)
+			surfaceFormat = SurfaceFormat::Dxt1;
+		else if (format == FormatDXT3)
+			surfaceFormat = SurfaceFormat::Dxt3;
+		else if (format == FormatDXT5)
+			surfaceFormat = SurfaceFormat::Dxt5;
+		else if (format == FormatPVRTC4)
+			surfaceFormat = SurfaceFormat::Pvrtc4;
+		else
+			return nullptr;
+
+		if (mipCount < 2 || (width <= m_initialSize && height <= m_initialSize))
+			return nullptr;
+
+		Entry* entry = new Entry();
+		entry->Levels.resize(mipCount);
+		entry->LevelSizes.resize(mipCount);
+
+		try
+		{
+			for (int i = 0; i < mipCount; i++)
+			{
+				entry->LevelSizes[i] = binary.ReadInt32();
+				entry->Levels[i] = binary.ReadInPlace(entry->LevelSizes[i]);
+			}
+		}
+		catch(...)
+		{
+			delete entry;
+			throw;
+		}
+
+		binary.Finish();
+
+		// start with the levels that are InitialSize or smaller
+		int level = 0;
+		while (level < mipCount - 1 && ((width >> level) > m_initialSize || (height >> level) > m_initialSize))
+			level++;
+
+		// the texture only gets a pimpl for the levels that are resident, in setResidentLevel()
+		Texture2D* texture = new Texture2D(GraphicsDevice::GetDevice(), width, height, surfaceFormat, this);
+
+		entry->Texture = texture;
+		entry->Source = reader->DetachStream();
+		entry->ResidentLevel = mipCount;
+		entry->RequestedLevel = level;
+		entry->MinimumLevel = level;
+		entry->LastUsedFrame = m_frame;
+		entry->PrefetchedLevel = mipCount;
+		entry->Prefetching = false;
+
+		m_entries.push_back(entry);
+
+		setResidentLevel(entry, level);
+
+		return texture;
+	}
+
+	int TextureStreamer::GetLevelForScale(float texelsPerPixel)
+	{
+		int level = 0;
+		while (texelsPerPixel >= 2.0f)
+		{
+			texelsPerPixel *= 0.5f;
+			level++;
+		}
+
+		return level;
+	}
+
+	void TextureStreamer::Update()
+	{
+		m_frame++;
+		m_stats.UploadedBytes = 0;
+
+		// pick up this frame's requests
+		std::vector<Entry*> wanted;
+		unsigned int requestedBytes = 0;
+		int numPending = 0;
+
+		for (std::vector<Entry*>::size_type i = 0; i < m_entries.size(); i++)
+		{
+			Entry* entry = m_entries[i];
+			Texture2D* texture = entry->Texture;
+
+			if (texture->m_frameRequest != Texture2D::NoMipRequest)
+			{
+				entry->RequestedLevel = std::max(0, std::min(texture->m_frameRequest, entry->MinimumLevel));
+				entry->LastUsedFrame = m_frame;
+				texture->m_frameRequest = Texture2D::NoMipRequest;
+			}
+
+			if (entry->RequestedLevel < entry->ResidentLevel)
+				wanted.push_back(entry);
+			if (entry->Prefetching)
+				numPending++;
+
+			requestedBytes += getBytes(entry, entry->RequestedLevel);
+		}
+
+		// the budget may have been lowered
+		if (m_residentBytes > m_budget)
+			evict(m_residentBytes - m_budget, m_frame + 1, nullptr);
+
+		// the most recently used textures go first
+		std::sort(wanted.begin(), wanted.end(), [](const Entry* a, const Entry* b) { return a->LastUsedFrame > b->LastUsedFrame; });
+
+		for (std::vector<Entry*>::size_type i = 0; i < wanted.size(); i++)
+		{
+			Entry* entry = wanted[i];
+
+			// page the data in on a worker first, so the upload doesn't stall on the disk
+			if (entry->Prefetching == false && entry->PrefetchedLevel > entry->RequestedLevel)
+			{
+				startPrefetch(entry);
+				numPending++;
+				continue;
+			}
+
+			if (entry->Prefetching)
+			{
+				if (entry->Prefetch.IsDone() == false)
+					continue;
+
+				entry->Prefetching = false;
+				numPending--;
+			}
+
+			// take as many of the wanted levels as fit in the budget, making room if needed
+			int level = std::max(entry->RequestedLevel, entry->PrefetchedLevel);
+			unsigned int extra = getBytes(entry, level) - getBytes(entry, entry->ResidentLevel);
+			if (m_residentBytes + extra > m_budget)
+				evict(m_residentBytes + extra - m_budget, entry->LastUsedFrame, entry);
+
+			while (level < entry->ResidentLevel && m_residentBytes + getBytes(entry, level) - getBytes(entry, entry->ResidentLevel) > m_budget)
+				level++;
+
+			if (level >= entry->ResidentLevel)
+				continue;
+
+			extra = getBytes(entry, level) - getBytes(entry, entry->ResidentLevel);
+			if (m_stats.UploadedBytes > 0 && m_stats.UploadedBytes + extra > m_maxUploadPerFrame)
+				break;
+
+			setResidentLevel(entry, level);
+			m_stats.UploadedBytes += getBytes(entry, level);
+		}
+
+		m_stats.NumTextures = (int)m_entries.size();
+		m_stats.NumPending = numPending;
+		m_stats.ResidentBytes = m_residentBytes;
+		m_stats.RequestedBytes = requestedBytes;
+		m_stats.BudgetBytes = m_budget;
+	}
+
+	void TextureStreamer::remove(Texture2D* texture)
+	{
+		for (std::vector<Entry*>::size_type i = 0; i < m_entries.size(); i++)
+		{
+			Entry* entry = m_entries[i];
+			if (entry->Texture == texture)
+			{
+				Utils::Jobs::Wait(&entry->Prefetch);
+
+				m_residentBytes -= getBytes(entry, entry->ResidentLevel);
+
+				delete entry->Source;
+				delete entry;
+
+				m_entries[i] = m_entries.back();
+				m_entries.pop_back();
+
+				return;
+			}
+		}
+	}
+
+	void TextureStreamer::setResidentLevel(Entry* entry, int level)
+	{
+		// GL can't free single levels, so the texture is recreated with just the levels it keeps.
+		// The smaller levels get uploaded again, but they're only a third the size of the new one.
+		int numLevels = (int)entry->Levels.size() - level;
+		entry->Texture->setStreamedLevels(level, numLevels, &entry->Levels[level], &entry->LevelSizes[level]);
+
+		m_residentBytes -= getBytes(entry, entry->ResidentLevel);
+		m_residentBytes += getBytes(entry, level);
+		entry->ResidentLevel = level;
+	}
+
+	void TextureStreamer::startPrefetch(Entry* entry)
+	{
+		entry->Prefetching = true;
+		entry->PrefetchedLevel = entry->RequestedLevel;
+
+		const byte* data = entry->Levels[entry->RequestedLevel];
+		const byte* end = entry->Levels[entry->ResidentLevel - 1] + entry->LevelSizes[entry->ResidentLevel - 1];
+
+		// the levels are stored biggest first, so the ones that are missing are all together
+		Utils::Jobs::Run([data, end]()
+		{
+			// touching a byte of each page is enough to get the whole page read in
+			volatile byte sum = 0;
+			for (const byte* p = data; p < end; p += 4096)
+				sum += *p;
+		}, &entry->Prefetch);
+	}
+
+	void TextureStreamer::evict(unsigned int bytesNeeded, unsigned int olderThanFrame, Entry* except)
+	{
+		std::vector<Entry*> victims;
+		for (std::vector<Entry*>::size_type i = 0; i < m_entries.size(); i++)
+		{
+			Entry* entry = m_entries[i];
+			if (entry != except && entry->LastUsedFrame < olderThanFrame && entry->ResidentLevel < entry->MinimumLevel)
+				victims.push_back(entry);
+		}
+
+		// least recently used first
+		std::sort(victims.begin(), victims.end(), [](const Entry* a, const Entry* b) { return a->LastUsedFrame < b->LastUsedFrame; });
+
+		unsigned int freed = 0;
+		for (std::vector<Entry*>::size_type i = 0; i < victims.size() && freed < bytesNeeded; i++)
+		{
+			Entry* victim = victims[i];
+
+			int level = victim->ResidentLevel;
+			while (level < victim->MinimumLevel && freed < bytesNeeded)
+			{
+				freed += (unsigned int)victim->LevelSizes[level];
+				level++;
+			}
+
+			setResidentLevel(victim, level);
+
+			// it'll ask again the next time it's used
+			victim->RequestedLevel = std::max(victim->RequestedLevel, level);
+			victim->PrefetchedLevel = std::max(victim->PrefetchedLevel, level);
+		}
+	}
+
+	unsigned int TextureStreamer::getBytes(Entry* entry, int firstLevel)
+	{
+		unsigned int bytes = 0;
+		for (int i = firstLevel; i < (int)entry->LevelSizes.size(); i++)
+			bytes += (unsigned int)entry->LevelSizes[i];
+
+		return bytes;
+	}
+}
+}
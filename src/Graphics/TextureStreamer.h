@@ -0,0 +1,125 @@
+#ifndef NXNA_GRAPHICS_TEXTURESTREAMER_H
+#define NXNA_GRAPHICS_TEXTURESTREAMER_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Utils/Jobs.h"
+
+namespace Nxna
+{
+namespace Content
+{
+	class MemoryStream;
+	class XnbReader;
+}
+
+namespace Graphics
+{
+	class Texture2D;
+
+	// this struct doesn't exist in XNA!
+	struct TextureStreamingStats
+	{
+		int NumTextures;
+
+		// textures waiting for their mip data to be paged in
+		int NumPending;
+
+		// what's on the GPU right now, and what would be if every request was met
+		unsigned int ResidentBytes;
+		unsigned int RequestedBytes;
+		unsigned int BudgetBytes;
+
+		// uploaded by the last Update()
+		unsigned int UploadedBytes;
+	};
+
+	// this class doesn't exist in XNA!
+	// Keeps the XNBs of mipmapped textures mapped and only puts the mip levels that are
+	// actually needed on the GPU. Hand it to ContentManager::SetTextureStreamer() and textures
+	// loaded after that will start out with just their small mips (InitialSize and down).
+	//
+	// Each frame, textures ask for the level they need through Texture2D::RequestMipLevel()
+	// (SpriteBatch does this for everything it draws). Update() then pages in the levels that are
+	// missing on a worker thread, and uploads them once they're ready. When that would go over the
+	// budget, levels are dropped from the textures that were used longest ago.
+	//
+	// A streamed texture's pimpl is only ever created with its resident levels, so its level 0 is
+	// smaller than the Texture2D says it is whenever the big levels aren't loaded. Shaders mustn't
+	// go from texels to texture coordinates with the GPU texture's size (like textureSize()), it
+	// has to be done with Texture2D::GetWidth() and GetHeight() (SpriteBatch does it on the CPU).
+	// Streamed textures can't be changed with SetData().
+	class TextureStreamer
+	{
+		friend class Texture2D;
+
+		struct Entry
+		{
+			Texture2D* Texture;
+			Content::MemoryStream* Source;
+
+			// the data of each level, pointing into Source
+			std::vector<const byte*> Levels;
+			std::vector<int> LevelSizes;
+
+			// the first level on the GPU, the one that's wanted, and the one that's always there
+			int ResidentLevel;
+			int RequestedLevel;
+			int MinimumLevel;
+
+			unsigned int LastUsedFrame;
+
+			// the first level whose data has been paged in (or is being paged in, if Prefetching)
+			int PrefetchedLevel;
+			bool Prefetching;
+			Utils::JobCounter Prefetch;
+		};
+
+		std::vector<Entry*> m_entries;
+		unsigned int m_budget;
+		unsigned int m_maxUploadPerFrame;
+		int m_initialSize;
+		unsigned int m_frame;
+		unsigned int m_residentBytes;
+		TextureStreamingStats m_stats;
+
+	public:
+		TextureStreamer(unsigned int budgetBytes);
+		~TextureStreamer();
+
+		unsigned int GetBudget() { return m_budget; }
+		void SetBudget(unsigned int bytes) { m_budget = bytes; }
+
+		// Uploading a big mip can take a while, so Update() stops once it's uploaded this much
+		// (unless it hasn't uploaded anything yet). Defaults to 4 MB.
+		unsigned int GetMaxUploadPerFrame() { return m_maxUploadPerFrame; }
+		void SetMaxUploadPerFrame(unsigned int bytes) { m_maxUploadPerFrame = bytes; }
+
+		// textures are loaded with the levels that are this size or smaller. Defaults to 64.
+		int GetInitialSize() { return m_initialSize; }
+		void SetInitialSize(int size) { m_initialSize = size; }
+
+		// Call this once a frame on the main thread, after drawing.
+		void Update();
+
+		const TextureStreamingStats& GetStats() { return m_stats; }
+
+		// Called by the Texture2D loader. Returns nullptr if the texture can't be streamed
+		// (it isn't mapped, doesn't have mips, or is in a format that needs converting), in which
+		// case it should be loaded normally. The reader's stream isn't moved when that happens.
+		Texture2D* Load(Content::XnbReader* reader);
+
+		// the level a texture needs when this many texels cover a pixel
+		static int GetLevelForScale(float texelsPerPixel);
+
+	private:
+		void remove(Texture2D* texture);
+		void setResidentLevel(Entry* entry, int level);
+		void startPrefetch(Entry* entry);
+		void evict(unsigned int bytesNeeded, unsigned int olderThanFrame, Entry* except);
+		unsigned int getBytes(Entry* entry, int firstLevel);
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_TEXTURESTREAMER_H
@@ -0,0 +1,473 @@
+#include <cassert>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "TileMap.h"
+#include "GraphicsDevice.h"
+#include "Texture2D.h"
+#include "VertexBuffer.h"
+#include "IndexBuffer.h"
+#include "VertexDeclaration.h"
+#include "SpriteEffect.h"
+#include "../Matrix.h"
+#include "../MemoryAllocator.h"
+#include "../Exception.h"
+#include "../Utils/Profiler.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	// same layout as the SpriteBatch vertices, so the SpriteEffect can draw them
+	static const int FloatsPerVertex = 6;
+	static const int VertexStride = sizeof(float) * FloatsPerVertex;
+	static const int FloatsPerQuad = FloatsPerVertex * 4;
+
+	TileMap::TileMap(GraphicsDevice* device, Texture2D* tileset, int tileWidth, int tileHeight, int width, int height, int numLayers)
+	{
+		assert(device != nullptr);
+		assert(tileset != nullptr);
+
+		if (tileWidth <= 0 || tileHeight <= 0)
+			throw ArgumentException("Tile size must be greater than 0", "tileWidth");
+		if (width <= 0 || height <= 0)
+			throw ArgumentException("Map size must be greater than 0", "width");
+		if (numLayers <= 0)
+			throw ArgumentException("numLayers");
+
+		m_device = device;
+		m_tileset = tileset;
+		m_tileWidth = tileWidth;
+		m_tileHeight = tileHeight;
+		m_width = width;
+		m_height = height;
+		m_numLayers = numLayers;
+		m_chunksX = (width + ChunkSize - 1) / ChunkSize;
+		m_chunksY = (height + ChunkSize - 1) / ChunkSize;
+		m_tilesetColumns = tileset->GetWidth() / tileWidth;
+
+		int numTiles = m_tilesetColumns * (tileset->GetHeight() / tileHeight);
+		if (numTiles <= 0)
+			throw ArgumentException("The tileset is smaller than a tile", "tileset");
+		if (numTiles > 32767)
+			throw ArgumentException("The tileset has too many tiles", "tileset");
+
+		m_tiles.resize((size_t)width * height * numLayers, (short)NoTile);
+		m_tileAnimations.resize(numTiles, -1);
+
+		Chunk chunk;
+		chunk.Vertices = nullptr;
+		chunk.NumQuads = 0;
+		chunk.NumStaticQuads = 0;
+		chunk.Dirty = true;
+		chunk.AnimationFrame = 0;
+		chunk.LastDrawn = 0;
+		m_chunks.resize(m_chunksX * m_chunksY * numLayers, chunk);
+
+		// enough for a 1080p screen full of chunks on every layer, plus the ones partly on screen
+		// at the edges, twice over so scrolling back and forth doesn't rebuild them
+		int screenChunksX = 1920 / (ChunkSize * tileWidth) + 2;
+		int screenChunksY = 1080 / (ChunkSize * tileHeight) + 2;
+		m_maxResidentChunks = screenChunksX * screenChunksY * numLayers * 2;
+		m_drawCount = 0;
+
+		m_animationTime = 0;
+		m_animationFrame = 0;
+
+		VertexElement elements[] = {
+			{ 0, VertexElementFormat::Vector3, VertexElementUsage::Position, 0 },
+			{ sizeof(float) * 3, VertexElementFormat::Vector2, VertexElementUsage::TextureCoordinate, 0},
+			{ sizeof(float) * 5, VertexElementFormat::Color, VertexElementUsage::Color, 0}
+		};
+		m_declaration = new VertexDeclaration(elements, 3);
+
+		createIndexBuffer();
+
+		m_effect = new SpriteEffect(device);
+	}
+
+	TileMap::~TileMap()
+	{
+		for (std::vector<Chunk>::size_type i = 0; i < m_chunks.size(); i++)
+			delete m_chunks[i].Vertices;
+
+		delete m_effect;
+		delete m_indexBuffer;
+		delete m_declaration;
+	}
+
+	int TileMap::GetTile(int layer, int x, int y)
+	{
+		assert(layer >= 0 && layer < m_numLayers);
+		assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+
+		return m_tiles[((size_t)layer * m_height + y) * m_width + x];
+	}
+
+	void TileMap::SetTile(int layer, int x, int y, int tile)
+	{
+		assert(layer >= 0 && layer < m_numLayers);
+		assert(x >= 0 && x < m_width && y >= 0 && y < m_height);
+		assert(tile >= NoTile && tile < (int)m_tileAnimations.size());
+
+		short& cell = m_tiles[((size_t)layer * m_height + y) * m_width + x];
+		if (cell == tile)
+			return;
+
+		cell = (short)tile;
+		getChunk(layer, x / ChunkSize, y / ChunkSize).Dirty = true;
+	}
+
+	void TileMap::SetTiles(int layer, const int* tiles)
+	{
+		assert(layer >= 0 && layer < m_numLayers);
+		assert(tiles != nullptr);
+
+		short* cells = &m_tiles[(size_t)layer * m_height * m_width];
+		for (int i = 0; i < m_width * m_height; i++)
+		{
+			assert(tiles[i] >= NoTile && tiles[i] < (int)m_tileAnimations.size());
+			cells[i] = (short)tiles[i];
+		}
+
+		for (int y = 0; y < m_chunksY; y++)
+			for (int x = 0; x < m_chunksX; x++)
+				getChunk(layer, x, y).Dirty = true;
+	}
+
+	void TileMap::SetAnimation(int tile, const int* frames, int numFrames, float frameDuration)
+	{
+		if (tile < 0 || tile >= (int)m_tileAnimations.size())
+			throw ArgumentException("tile");
+		if (frames == nullptr || numFrames <= 0)
+			throw ArgumentException("An animation needs at least one frame", "frames");
+		if (frameDuration <= 0)
+			throw ArgumentException("frameDuration");
+
+		Animation animation;
+		for (int i = 0; i < numFrames; i++)
+		{
+			if (frames[i] < 0 || frames[i] >= (int)m_tileAnimations.size())
+				throw ArgumentException("frames");
+
+			animation.Frames.push_back((short)frames[i]);
+		}
+		animation.FrameDuration = frameDuration;
+		animation.CurrentFrame = 0;
+
+		if (m_tileAnimations[tile] == -1)
+		{
+			m_tileAnimations[tile] = (short)m_animations.size();
+			m_animations.push_back(animation);
+		}
+		else
+		{
+			m_animations[m_tileAnimations[tile]] = animation;
+		}
+
+		// the chunks that use the tile need to move it in with the animated tiles
+		for (std::vector<Chunk>::size_type i = 0; i < m_chunks.size(); i++)
+			m_chunks[i].Dirty = true;
+	}
+
+	void TileMap::Update(float elapsedSeconds)
+	{
+		m_animationTime += elapsedSeconds;
+
+		bool changed = false;
+		for (std::vector<Animation>::size_type i = 0; i < m_animations.size(); i++)
+		{
+			Animation& animation = m_animations[i];
+
+			int frame = (int)(m_animationTime / animation.FrameDuration) % (int)animation.Frames.size();
+			if (frame != animation.CurrentFrame)
+			{
+				animation.CurrentFrame = frame;
+				changed = true;
+			}
+		}
+
+		// chunks compare this with the frame they were last updated on
+		if (changed)
+			m_animationFrame++;
+	}
+
+	void TileMap::Draw(const Rectangle& view)
+	{
+		setRenderStates(view);
+
+		for (int i = 0; i < m_numLayers; i++)
+			drawLayer(i, view);
+
+		evictChunks();
+	}
+
+	void TileMap::Draw(int layer, const Rectangle& view)
+	{
+		assert(layer >= 0 && layer < m_numLayers);
+
+		setRenderStates(view);
+		drawLayer(layer, view);
+		evictChunks();
+	}
+
+	void TileMap::setRenderStates(const Rectangle& view)
+	{
+		assert(view.Width > 0 && view.Height > 0);
+
+		m_device->SetBlendState(BlendState::GetAlphaBlend());
+		m_device->SetRasterizerState(RasterizerState::GetCullCounterClockwise());
+		m_device->SetDepthStencilState(DepthStencilState::GetNone());
+
+		// point sampling so the neighboring tiles in the tileset don't bleed in
+		m_device->GetSamplerStates().Set(0, SamplerState::GetPointClamp());
+
+		// maps the view to the whole viewport, with y going down like SpriteBatch
+		Matrix projection;
+		Matrix::GetIdentity(projection);
+		projection.M11 = 2.0f / view.Width;
+		projection.M22 = -2.0f / view.Height;
+		projection.M41 = -1.0f - view.X * projection.M11;
+		projection.M42 = 1.0f - view.Y * projection.M22;
+
+		m_effect->GetParameter("ModelViewProjection")->SetValue(projection);
+		m_effect->GetParameter("Diffuse")->SetValue(m_tileset);
+		m_effect->GetCurrentTechnique()->Apply();
+
+		m_device->SetIndices(m_indexBuffer);
+	}
+
+	void TileMap::drawLayer(int layer, const Rectangle& view)
+	{
+		NXNA_PROFILE_SCOPE("TileMap::drawLayer");
+
+		m_drawCount++;
+
+		// only the chunks that overlap the view
+		int chunkWidth = ChunkSize * m_tileWidth;
+		int chunkHeight = ChunkSize * m_tileHeight;
+		int minX = std::max(0, (int)floor((float)view.X / chunkWidth));
+		int minY = std::max(0, (int)floor((float)view.Y / chunkHeight));
+		int maxX = std::min(m_chunksX - 1, (int)floor((float)(view.X + view.Width - 1) / chunkWidth));
+		int maxY = std::min(m_chunksY - 1, (int)floor((float)(view.Y + view.Height - 1) / chunkHeight));
+
+		for (int y = minY; y <= maxY; y++)
+		{
+			for (int x = minX; x <= maxX; x++)
+			{
+				Chunk& chunk = getChunk(layer, x, y);
+
+				if (chunk.Dirty)
+					buildChunk(chunk, layer, x, y);
+				else if (chunk.AnimationFrame != m_animationFrame && chunk.AnimatedTiles.empty() == false)
+					updateAnimatedTiles(chunk, x, y);
+
+				if (chunk.NumQuads == 0)
+					continue;
+
+				chunk.LastDrawn = m_drawCount;
+
+				m_device->SetVertexBuffer(chunk.Vertices);
+				m_device->DrawIndexedPrimitives(PrimitiveType::TriangleList, 0, 0, chunk.NumQuads * 4, 0, chunk.NumQuads * 2);
+			}
+		}
+	}
+
+	void TileMap::buildChunk(Chunk& chunk, int layer, int chunkX, int chunkY)
+	{
+		NXNA_PROFILE_SCOPE("TileMap::buildChunk");
+
+		int startX = chunkX * ChunkSize;
+		int startY = chunkY * ChunkSize;
+		int endX = std::min(startX + ChunkSize, m_width);
+		int endY = std::min(startY + ChunkSize, m_height);
+
+		chunk.Dirty = false;
+		chunk.AnimationFrame = m_animationFrame;
+		chunk.AnimatedTiles.clear();
+		chunk.NumStaticQuads = 0;
+
+		for (int y = startY; y < endY; y++)
+		{
+			const short* row = &m_tiles[((size_t)layer * m_height + y) * m_width];
+			for (int x = startX; x < endX; x++)
+			{
+				if (row[x] == NoTile)
+					continue;
+
+				short animation = m_tileAnimations[row[x]];
+				if (animation == -1)
+				{
+					chunk.NumStaticQuads++;
+				}
+				else
+				{
+					AnimatedTile tile;
+					tile.X = (short)(x - startX);
+					tile.Y = (short)(y - startY);
+					tile.Animation = animation;
+					chunk.AnimatedTiles.push_back(tile);
+				}
+			}
+		}
+
+		chunk.NumQuads = chunk.NumStaticQuads + (int)chunk.AnimatedTiles.size();
+
+		if (chunk.NumQuads == 0)
+		{
+			if (chunk.Vertices != nullptr)
+			{
+				delete chunk.Vertices;
+				chunk.Vertices = nullptr;
+
+				int index = (int)(&chunk - &m_chunks[0]);
+				m_residentChunks.erase(std::find(m_residentChunks.begin(), m_residentChunks.end(), index));
+			}
+
+			return;
+		}
+
+		if (chunk.Vertices == nullptr)
+		{
+			m_residentChunks.push_back((int)(&chunk - &m_chunks[0]));
+		}
+		else if (chunk.Vertices->GetVertexCount() < chunk.NumQuads * 4)
+		{
+			delete chunk.Vertices;
+			chunk.Vertices = nullptr;
+		}
+
+		if (chunk.Vertices == nullptr)
+			chunk.Vertices = new VertexBuffer(m_device, m_declaration, chunk.NumQuads * 4, BufferUsage::WriteOnly);
+
+		float* verts = (float*)NxnaTempMemoryPool::GetMemory(chunk.NumQuads * FloatsPerQuad * sizeof(float));
+
+		float* quad = verts;
+		for (int y = startY; y < endY; y++)
+		{
+			const short* row = &m_tiles[((size_t)layer * m_height + y) * m_width];
+			for (int x = startX; x < endX; x++)
+			{
+				if (row[x] != NoTile && m_tileAnimations[row[x]] == -1)
+				{
+					writeQuad(quad, x, y, row[x]);
+					quad += FloatsPerQuad;
+				}
+			}
+		}
+
+		for (std::vector<AnimatedTile>::size_type i = 0; i < chunk.AnimatedTiles.size(); i++)
+		{
+			const AnimatedTile& tile = chunk.AnimatedTiles[i];
+			const Animation& animation = m_animations[tile.Animation];
+
+			writeQuad(quad, startX + tile.X, startY + tile.Y, animation.Frames[animation.CurrentFrame]);
+			quad += FloatsPerQuad;
+		}
+
+		chunk.Vertices->SetData(verts, chunk.NumQuads * 4);
+
+		NxnaTempMemoryPool::ReleaseMemory();
+	}
+
+	void TileMap::updateAnimatedTiles(Chunk& chunk, int chunkX, int chunkY)
+	{
+		chunk.AnimationFrame = m_animationFrame;
+
+		int numAnimated = (int)chunk.AnimatedTiles.size();
+		float* verts = (float*)NxnaTempMemoryPool::GetMemory(numAnimated * FloatsPerQuad * sizeof(float));
+
+		for (int i = 0; i < numAnimated; i++)
+		{
+			const AnimatedTile& tile = chunk.AnimatedTiles[i];
+			const Animation& animation = m_animations[tile.Animation];
+
+			writeQuad(verts + i * FloatsPerQuad, chunkX * ChunkSize + tile.X, chunkY * ChunkSize + tile.Y, animation.Frames[animation.CurrentFrame]);
+		}
+
+		chunk.Vertices->SetData(chunk.NumStaticQuads * 4 * VertexStride, verts, numAnimated * 4, VertexStride, VertexStride);
+
+		NxnaTempMemoryPool::ReleaseMemory();
+	}
+
+	void TileMap::writeQuad(float* verts, int x, int y, int tile)
+	{
+		float left = (float)(x * m_tileWidth);
+		float top = (float)(y * m_tileHeight);
+		float right = left + m_tileWidth;
+		float bottom = top + m_tileHeight;
+
+		float inverseTextureWidth = 1.0f / m_tileset->GetWidth();
+		float inverseTextureHeight = 1.0f / m_tileset->GetHeight();
+		float u1 = (tile % m_tilesetColumns) * m_tileWidth * inverseTextureWidth;
+		float v1 = (tile / m_tilesetColumns) * m_tileHeight * inverseTextureHeight;
+		float u2 = u1 + m_tileWidth * inverseTextureWidth;
+		float v2 = v1 + m_tileHeight * inverseTextureHeight;
+
+		unsigned int white = 0xffffffff;
+
+		// same corner order as SpriteBatch so the index buffer looks the same
+		const float corners[4][4] = {
+			{ left, top, u1, v1 },
+			{ right, top, u2, v1 },
+			{ right, bottom, u2, v2 },
+			{ left, bottom, u1, v2 }
+		};
+
+		for (int i = 0; i < 4; i++)
+		{
+			float* v = verts + i * FloatsPerVertex;
+			v[0] = corners[i][0];
+			v[1] = corners[i][1];
+			v[2] = 0;
+			v[3] = corners[i][2];
+			v[4] = corners[i][3];
+			memcpy(&v[5], &white, sizeof(unsigned int));
+		}
+	}
+
+	void TileMap::evictChunks()
+	{
+		if ((int)m_residentChunks.size() <= m_maxResidentChunks)
+			return;
+
+		// free the ones that were drawn longest ago, but never anything from the last Draw()
+		std::sort(m_residentChunks.begin(), m_residentChunks.end(), [this](int a, int b) {
+			return m_chunks[a].LastDrawn > m_chunks[b].LastDrawn;
+		});
+
+		while ((int)m_residentChunks.size() > m_maxResidentChunks)
+		{
+			Chunk& chunk = m_chunks[m_residentChunks.back()];
+			if (m_drawCount - chunk.LastDrawn < m_numLayers)
+				break;
+
+			delete chunk.Vertices;
+			chunk.Vertices = nullptr;
+			chunk.NumQuads = 0;
+			chunk.Dirty = true;
+
+			m_residentChunks.pop_back();
+		}
+	}
+
+	void TileMap::createIndexBuffer()
+	{
+		const int maxQuads = ChunkSize * ChunkSize;
+
+		std::vector<short> indices(maxQuads * 6);
+		for (int i = 0; i < maxQuads; i++)
+		{
+			indices[i * 6 + 0] = (short)(i * 4);
+			indices[i * 6 + 1] = (short)(i * 4 + 1);
+			indices[i * 6 + 2] = (short)(i * 4 + 2);
+			indices[i * 6 + 3] = (short)(i * 4);
+			indices[i * 6 + 4] = (short)(i * 4 + 2);
+			indices[i * 6 + 5] = (short)(i * 4 + 3);
+		}
+
+		m_indexBuffer = new IndexBuffer(m_device, IndexElementSize::SixteenBits);
+		m_indexBuffer->SetData(&indices[0], maxQuads * 6);
+	}
+}
+}
@@ -0,0 +1,127 @@
+#ifndef NXNA_GRAPHICS_TILEMAP_H
+#define NXNA_GRAPHICS_TILEMAP_H
+
+#include <vector>
+#include "../NxnaConfig.h"
+#include "../Rectangle.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	class GraphicsDevice;
+	class Texture2D;
+	class VertexBuffer;
+	class VertexDeclaration;
+	class IndexBuffer;
+	class SpriteEffect;
+
+	// this class doesn't exist in XNA!
+	// Draws big grids of tiles. The map is split into chunks of ChunkSize x ChunkSize tiles,
+	// and each chunk keeps its vertices in a static vertex buffer, so drawing a layer is
+	// one draw call per visible chunk and nothing is uploaded unless a tile changed.
+	// The tiles are numbered left to right, top to bottom across the tileset texture.
+	class TileMap
+	{
+	public:
+		static const int ChunkSize = 32;
+		static const int NoTile = -1;
+
+	private:
+		struct AnimatedTile
+		{
+			short X, Y; // within the chunk
+			short Animation;
+		};
+
+		struct Chunk
+		{
+			VertexBuffer* Vertices;
+			int NumQuads;
+			int NumStaticQuads;
+			bool Dirty;
+			int AnimationFrame;
+			int LastDrawn;
+
+			// Animated tiles are kept together at the end of the vertex buffer,
+			// so changing frames only has to upload that part.
+			std::vector<AnimatedTile> AnimatedTiles;
+		};
+
+		struct Animation
+		{
+			std::vector<short> Frames;
+			float FrameDuration;
+			int CurrentFrame;
+		};
+
+		GraphicsDevice* m_device;
+		Texture2D* m_tileset;
+		int m_tileWidth, m_tileHeight;
+		int m_width, m_height;
+		int m_numLayers;
+		int m_chunksX, m_chunksY;
+		int m_tilesetColumns;
+
+		std::vector<short> m_tiles;
+		std::vector<Chunk> m_chunks;
+		std::vector<int> m_residentChunks;
+		int m_maxResidentChunks;
+		int m_drawCount;
+
+		std::vector<Animation> m_animations;
+		std::vector<short> m_tileAnimations;
+		float m_animationTime;
+		int m_animationFrame;
+
+		VertexDeclaration* m_declaration;
+		IndexBuffer* m_indexBuffer;
+		SpriteEffect* m_effect;
+
+	public:
+		// width and height are in tiles
+		TileMap(GraphicsDevice* device, Texture2D* tileset, int tileWidth, int tileHeight, int width, int height, int numLayers);
+		~TileMap();
+
+		int GetWidth() { return m_width; }
+		int GetHeight() { return m_height; }
+		int GetNumLayers() { return m_numLayers; }
+		int GetTileWidth() { return m_tileWidth; }
+		int GetTileHeight() { return m_tileHeight; }
+		Texture2D* GetTileset() { return m_tileset; }
+
+		int GetTile(int layer, int x, int y);
+		void SetTile(int layer, int x, int y, int tile);
+
+		// sets the whole layer at once. tiles must have GetWidth() * GetHeight() entries.
+		void SetTiles(int layer, const int* tiles);
+
+		// Every cell that's set to tile will cycle through frames instead.
+		// Only the vertices of the animated tiles are uploaded when the frame changes.
+		void SetAnimation(int tile, const int* frames, int numFrames, float frameDuration);
+		void Update(float elapsedSeconds);
+
+		// Chunks are only uploaded once they're drawn. When more than this many chunks are
+		// on the GPU the ones that haven't been drawn for the longest are freed.
+		void SetMaxResidentChunks(int maxChunks) { m_maxResidentChunks = maxChunks; }
+		int GetNumResidentChunks() { return (int)m_residentChunks.size(); }
+
+		// view is the part of the map (in pixels) that should fill the viewport.
+		// Chunks outside of it are skipped.
+		void Draw(const Rectangle& view);
+		void Draw(int layer, const Rectangle& view);
+
+	private:
+		Chunk& getChunk(int layer, int chunkX, int chunkY) { return m_chunks[(layer * m_chunksY + chunkY) * m_chunksX + chunkX]; }
+		void setRenderStates(const Rectangle& view);
+		void drawLayer(int layer, const Rectangle& view);
+		void buildChunk(Chunk& chunk, int layer, int chunkX, int chunkY);
+		void updateAnimatedTiles(Chunk& chunk, int chunkX, int chunkY);
+		void writeQuad(float* verts, int x, int y, int tile);
+		void evictChunks();
+		void createIndexBuffer();
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_TILEMAP_H
@@ -60,6 +60,30 @@ namespace Graphics
 		DynamicVertexBuffer(GraphicsDevice* device, const VertexDeclaration* vertexDeclaration, int vertexCount, BufferUsage usage);
 		virtual ~DynamicVertexBuffer();
 	};
+
+	struct VertexBufferBinding
+	{
+		VertexBufferBinding()
+		{
+			Buffer = nullptr;
+			VertexOffset = 0;
+			InstanceFrequency = 0;
+		}
+
+		VertexBufferBinding(const VertexBuffer* buffer, int vertexOffset, int instanceFrequency)
+		{
+			Buffer = buffer;
+			VertexOffset = vertexOffset;
+			InstanceFrequency = instanceFrequency;
+		}
+
+		const VertexBuffer* Buffer;
+		int VertexOffset;
+
+		// 0 means the buffer advances once per vertex. Anything else
+		// means it advances once per that many instances.
+		int InstanceFrequency;
+	};
 }
 }
 
@@ -14,14 +14,19 @@ namespace Graphics
 		Vector3,
 		Vector4,
 
-		Color
+		Color,
+		Short2,
+		Short4,
+		Byte4
 	END_NXNA_ENUM(VertexElementFormat)
 
 	NXNA_ENUM(VertexElementUsage)
 		Position,
 		Normal,
 		TextureCoordinate,
-		Color
+		Color,
+		BlendIndices,
+		BlendWeight
 	END_NXNA_ENUM(VertexElementUsage)
 
 	struct VertexElement
@@ -46,11 +51,7 @@ namespace Graphics
 			m_numElements = numElements;
 			memcpy(m_elements, elements, sizeof(VertexElement) * numElements);
 
-			int sizeOfFinalElement = 0;
-			if (elements[numElements - 1].ElementFormat == VertexElementFormat::Color)
-				sizeOfFinalElement = 4;
-			else
-				sizeOfFinalElement = (int)elements[numElements - 1].ElementFormat * sizeof(float);
+			int sizeOfFinalElement = GetElementSize(elements[numElements - 1].ElementFormat);
 
 			m_stride = elements[numElements - 1].Offset + sizeOfFinalElement;
 
@@ -63,6 +64,20 @@ namespace Graphics
 
 		unsigned int GetHash() const { return m_hash; }
 
+		static int GetElementSize(VertexElementFormat format)
+		{
+			if (format == VertexElementFormat::Color)
+				return 4;
+			if (format == VertexElementFormat::Short2)
+				return sizeof(short) * 2;
+			if (format == VertexElementFormat::Short4)
+				return sizeof(short) * 4;
+			if (format == VertexElementFormat::Byte4)
+				return 4;
+
+			return (int)format * sizeof(float);
+		}
+
 	private:
 		unsigned int calcHash();
 	};
@@ -0,0 +1,27 @@
+#include <memory>
+#include "VertexPositionColor.h"
+
+
+namespace Nxna
+{
+namespace Graphics
+{
+	std::unique_ptr<VertexDeclaration> VertexPositionColor::m_declaration;
+
+	const VertexDeclaration* VertexPositionColor::GetVertexDeclaration()
+	{
+		if (m_declaration.get() == nullptr)
+		{
+			VertexElement elements[] = 
+			{
+				{0, VertexElementFormat::Vector3, VertexElementUsage::Position, 0},
+				{sizeof(float) * 3, VertexElementFormat::Color, VertexElementUsage::Color, 0}
+			};
+
+			m_declaration.reset(new VertexDeclaration(elements, 2));
+		}
+
+		return m_declaration.get();
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,27 @@
+#ifndef NXNA_GRAPHICS_VERTEXPOSITIONCOLOR_H
+#define NXNA_GRAPHICS_VERTEXPOSITIONCOLOR_H
+
+#include <memory>
+#include "VertexDeclaration.h"
+#include "../Vector3.h"
+#include "../Color.h"
+
+namespace Nxna
+{
+namespace Graphics
+{
+	struct VertexPositionColor
+	{
+	private:
+		static std::unique_ptr<VertexDeclaration> m_declaration;
+
+	public:
+		Vector3 Position;
+		Nxna::Color Color;
+
+		static const VertexDeclaration* GetVertexDeclaration();
+	};
+}
+}
+
+#endif // NXNA_GRAPHICS_VERTEXPOSITIONCOLOR_H
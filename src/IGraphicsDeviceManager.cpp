@@ -7,5 +7,6 @@ namespace Nxna
 	{
 		game->m_graphicsDeviceManager = this;
 		m_device = nullptr;
+		m_synchronizeWithVerticalRetrace = true;
 	}
 }
\ No newline at end of file
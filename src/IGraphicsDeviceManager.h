@@ -25,6 +25,7 @@ namespace Nxna
 		int m_backBufferWidth;
 		int m_backBufferHeight;
 		bool m_fullscreen;
+		bool m_synchronizeWithVerticalRetrace;
 
 	protected:
 		Graphics::GraphicsDevice* m_device;
@@ -43,6 +44,10 @@ namespace Nxna
 		bool IsFullscreen() { return m_fullscreen; }
 		void IsFullscreen(bool fullscreen) { m_fullscreen = fullscreen; }
 
+		// call ApplyChanges() after changing this if the window has already been created
+		bool SynchronizeWithVerticalRetrace() { return m_synchronizeWithVerticalRetrace; }
+		void SynchronizeWithVerticalRetrace(bool sync) { m_synchronizeWithVerticalRetrace = sync; }
+
 		virtual void ApplyChanges() = 0;
 
 		virtual void ShowWindow() = 0;
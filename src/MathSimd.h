@@ -0,0 +1,183 @@
+#ifndef NXNA_MATHSIMD_H
+#define NXNA_MATHSIMD_H
+
+#include "NxnaConfig.h"
+#include "Matrix.h"
+
+// This is only meant to be used inside the engine (the math classes, particles, etc).
+// None of the math types are aligned, so everything is loaded and stored unaligned.
+
+#if defined NXNA_SIMD_SSE2
+#include <emmintrin.h>
+#elif defined NXNA_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace Nxna
+{
+namespace Simd
+{
+#if defined NXNA_SIMD_SSE2
+
+	typedef __m128 Float4;
+
+	inline void LoadRows(const Matrix& m, Float4* rows)
+	{
+		rows[0] = _mm_loadu_ps(&m.C[0]);
+		rows[1] = _mm_loadu_ps(&m.C[4]);
+		rows[2] = _mm_loadu_ps(&m.C[8]);
+		rows[3] = _mm_loadu_ps(&m.C[12]);
+	}
+
+	// (x, y, z, w) * matrix, where the matrix is stored as 4 rows
+	inline Float4 Transform(float x, float y, float z, float w, const Float4* rows)
+	{
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), rows[0]), _mm_mul_ps(_mm_set1_ps(y), rows[1])),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(z), rows[2]), _mm_mul_ps(_mm_set1_ps(w), rows[3])));
+	}
+
+	// same as Transform() with w = 1
+	inline Float4 TransformPoint(float x, float y, float z, const Float4* rows)
+	{
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), rows[0]), _mm_mul_ps(_mm_set1_ps(y), rows[1])),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(z), rows[2]), rows[3]));
+	}
+
+	// same as Transform() with w = 0
+	inline Float4 TransformNormal(float x, float y, float z, const Float4* rows)
+	{
+		return _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), rows[0]), _mm_mul_ps(_mm_set1_ps(y), rows[1])),
+			_mm_mul_ps(_mm_set1_ps(z), rows[2]));
+	}
+
+	inline void Store2(Float4 v, float* destination)
+	{
+		_mm_storel_pi((__m64*)destination, v);
+	}
+
+	inline void Store3(Float4 v, float* destination)
+	{
+		_mm_storel_pi((__m64*)destination, v);
+		_mm_store_ss(destination + 2, _mm_movehl_ps(v, v));
+	}
+
+	inline void Store4(Float4 v, float* destination)
+	{
+		_mm_storeu_ps(destination, v);
+	}
+
+	// one bit per lane of a comparison result
+	inline unsigned int MoveMask(Float4 mask)
+	{
+		return (unsigned int)_mm_movemask_ps(mask);
+	}
+
+	// element-wise helpers for structure-of-arrays loops
+	inline Float4 Load(const float* source) { return _mm_loadu_ps(source); }
+	inline void Store(Float4 v, float* destination) { _mm_storeu_ps(destination, v); }
+	inline Float4 Splat(float f) { return _mm_set1_ps(f); }
+	inline Float4 Add(Float4 a, Float4 b) { return _mm_add_ps(a, b); }
+	inline Float4 Subtract(Float4 a, Float4 b) { return _mm_sub_ps(a, b); }
+	inline Float4 Multiply(Float4 a, Float4 b) { return _mm_mul_ps(a, b); }
+	inline Float4 MultiplyAdd(Float4 a, Float4 b, Float4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+
+	// the estimate plus one Newton-Raphson step, which is good to about 22 bits
+	inline Float4 ReciprocalSqrt(Float4 v)
+	{
+		Float4 estimate = _mm_rsqrt_ps(v);
+		Float4 muls = _mm_mul_ps(_mm_mul_ps(v, estimate), estimate);
+		return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), estimate), _mm_sub_ps(_mm_set1_ps(3.0f), muls));
+	}
+
+	// v with its sign flipped in the lanes where s is negative
+	inline Float4 MultiplySign(Float4 v, Float4 s)
+	{
+		return _mm_xor_ps(v, _mm_and_ps(s, _mm_set1_ps(-0.0f)));
+	}
+
+#elif defined NXNA_SIMD_NEON
+
+	typedef float32x4_t Float4;
+
+	inline void LoadRows(const Matrix& m, Float4* rows)
+	{
+		rows[0] = vld1q_f32(&m.C[0]);
+		rows[1] = vld1q_f32(&m.C[4]);
+		rows[2] = vld1q_f32(&m.C[8]);
+		rows[3] = vld1q_f32(&m.C[12]);
+	}
+
+	inline Float4 Transform(float x, float y, float z, float w, const Float4* rows)
+	{
+		Float4 result = vmulq_n_f32(rows[0], x);
+		result = vmlaq_n_f32(result, rows[1], y);
+		result = vmlaq_n_f32(result, rows[2], z);
+		return vmlaq_n_f32(result, rows[3], w);
+	}
+
+	inline Float4 TransformPoint(float x, float y, float z, const Float4* rows)
+	{
+		Float4 result = vmlaq_n_f32(rows[3], rows[0], x);
+		result = vmlaq_n_f32(result, rows[1], y);
+		return vmlaq_n_f32(result, rows[2], z);
+	}
+
+	inline Float4 TransformNormal(float x, float y, float z, const Float4* rows)
+	{
+		Float4 result = vmulq_n_f32(rows[0], x);
+		result = vmlaq_n_f32(result, rows[1], y);
+		return vmlaq_n_f32(result, rows[2], z);
+	}
+
+	inline void Store2(Float4 v, float* destination)
+	{
+		vst1_f32(destination, vget_low_f32(v));
+	}
+
+	inline void Store3(Float4 v, float* destination)
+	{
+		vst1_f32(destination, vget_low_f32(v));
+		vst1q_lane_f32(destination + 2, v, 2);
+	}
+
+	inline void Store4(Float4 v, float* destination)
+	{
+		vst1q_f32(destination, v);
+	}
+
+	inline unsigned int MoveMask(uint32x4_t mask)
+	{
+		static const uint32_t bits[4] = { 1, 2, 4, 8 };
+		uint32x4_t masked = vandq_u32(mask, vld1q_u32(bits));
+		uint32x2_t sum = vadd_u32(vget_low_u32(masked), vget_high_u32(masked));
+		return vget_lane_u32(vpadd_u32(sum, sum), 0);
+	}
+
+	inline Float4 Load(const float* source) { return vld1q_f32(source); }
+	inline void Store(Float4 v, float* destination) { vst1q_f32(destination, v); }
+	inline Float4 Splat(float f) { return vdupq_n_f32(f); }
+	inline Float4 Add(Float4 a, Float4 b) { return vaddq_f32(a, b); }
+	inline Float4 Subtract(Float4 a, Float4 b) { return vsubq_f32(a, b); }
+	inline Float4 Multiply(Float4 a, Float4 b) { return vmulq_f32(a, b); }
+	inline Float4 MultiplyAdd(Float4 a, Float4 b, Float4 c) { return vmlaq_f32(c, a, b); }
+
+	inline Float4 ReciprocalSqrt(Float4 v)
+	{
+		Float4 estimate = vrsqrteq_f32(v);
+		return vmulq_f32(estimate, vrsqrtsq_f32(vmulq_f32(v, estimate), estimate));
+	}
+
+	inline Float4 MultiplySign(Float4 v, Float4 s)
+	{
+		uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(s), vdupq_n_u32(0x80000000));
+		return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(v), sign));
+	}
+
+#endif
+}
+}
+
+#endif // NXNA_MATHSIMD_H
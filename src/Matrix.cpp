@@ -1,6 +1,7 @@
 #include <cmath>
 #include <cstring>
 #include "Matrix.h"
+#include "MathSimd.h"
 
 namespace Nxna
 {
@@ -320,6 +321,85 @@ namespace Nxna
 
 	void Matrix::Invert(const Matrix& matrix, Matrix& result)
 	{
+#if defined NXNA_SIMD_SSE2
+		// Cramer's rule, based on Intel's "Streaming SIMD Extensions - Inverse of 4x4 Matrix".
+		// The matrix is transposed while it's loaded, so the cofactors come out already in the right places.
+		__m128 tmp = _mm_setzero_ps();
+		__m128 row0, row1, row2, row3;
+		__m128 minor0, minor1, minor2, minor3;
+
+		tmp = _mm_loadh_pi(_mm_loadl_pi(tmp, (const __m64*)&matrix.C[0]), (const __m64*)&matrix.C[4]);
+		row1 = _mm_loadh_pi(_mm_loadl_pi(tmp, (const __m64*)&matrix.C[8]), (const __m64*)&matrix.C[12]);
+		row0 = _mm_shuffle_ps(tmp, row1, 0x88);
+		row1 = _mm_shuffle_ps(row1, tmp, 0xDD);
+		tmp = _mm_loadh_pi(_mm_loadl_pi(tmp, (const __m64*)&matrix.C[2]), (const __m64*)&matrix.C[6]);
+		row3 = _mm_loadh_pi(_mm_loadl_pi(tmp, (const __m64*)&matrix.C[10]), (const __m64*)&matrix.C[14]);
+		row2 = _mm_shuffle_ps(tmp, row3, 0x88);
+		row3 = _mm_shuffle_ps(row3, tmp, 0xDD);
+
+		tmp = _mm_mul_ps(row2, row3);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+		minor0 = _mm_mul_ps(row1, tmp);
+		minor1 = _mm_mul_ps(row0, tmp);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+		minor0 = _mm_sub_ps(_mm_mul_ps(row1, tmp), minor0);
+		minor1 = _mm_sub_ps(_mm_mul_ps(row0, tmp), minor1);
+		minor1 = _mm_shuffle_ps(minor1, minor1, 0x4E);
+
+		tmp = _mm_mul_ps(row1, row2);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+		minor0 = _mm_add_ps(_mm_mul_ps(row3, tmp), minor0);
+		minor3 = _mm_mul_ps(row0, tmp);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row3, tmp));
+		minor3 = _mm_sub_ps(_mm_mul_ps(row0, tmp), minor3);
+		minor3 = _mm_shuffle_ps(minor3, minor3, 0x4E);
+
+		tmp = _mm_mul_ps(_mm_shuffle_ps(row1, row1, 0x4E), row3);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+		row2 = _mm_shuffle_ps(row2, row2, 0x4E);
+		minor0 = _mm_add_ps(_mm_mul_ps(row2, tmp), minor0);
+		minor2 = _mm_mul_ps(row0, tmp);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+		minor0 = _mm_sub_ps(minor0, _mm_mul_ps(row2, tmp));
+		minor2 = _mm_sub_ps(_mm_mul_ps(row0, tmp), minor2);
+		minor2 = _mm_shuffle_ps(minor2, minor2, 0x4E);
+
+		tmp = _mm_mul_ps(row0, row1);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+		minor2 = _mm_add_ps(_mm_mul_ps(row3, tmp), minor2);
+		minor3 = _mm_sub_ps(_mm_mul_ps(row2, tmp), minor3);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+		minor2 = _mm_sub_ps(_mm_mul_ps(row3, tmp), minor2);
+		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row2, tmp));
+
+		tmp = _mm_mul_ps(row0, row3);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row2, tmp));
+		minor2 = _mm_add_ps(_mm_mul_ps(row1, tmp), minor2);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+		minor1 = _mm_add_ps(_mm_mul_ps(row2, tmp), minor1);
+		minor2 = _mm_sub_ps(minor2, _mm_mul_ps(row1, tmp));
+
+		tmp = _mm_mul_ps(row0, row2);
+		tmp = _mm_shuffle_ps(tmp, tmp, 0xB1);
+		minor1 = _mm_add_ps(_mm_mul_ps(row3, tmp), minor1);
+		minor3 = _mm_sub_ps(minor3, _mm_mul_ps(row1, tmp));
+		tmp = _mm_shuffle_ps(tmp, tmp, 0x4E);
+		minor1 = _mm_sub_ps(minor1, _mm_mul_ps(row3, tmp));
+		minor3 = _mm_add_ps(_mm_mul_ps(row1, tmp), minor3);
+
+		__m128 det = _mm_mul_ps(row0, minor0);
+		det = _mm_add_ps(_mm_shuffle_ps(det, det, 0x4E), det);
+		det = _mm_add_ss(_mm_shuffle_ps(det, det, 0xB1), det);
+		det = _mm_div_ss(_mm_set_ss(1.0f), det);
+		det = _mm_shuffle_ps(det, det, 0x00);
+
+		_mm_storeu_ps(&result.C[0], _mm_mul_ps(det, minor0));
+		_mm_storeu_ps(&result.C[4], _mm_mul_ps(det, minor1));
+		_mm_storeu_ps(&result.C[8], _mm_mul_ps(det, minor2));
+		_mm_storeu_ps(&result.C[12], _mm_mul_ps(det, minor3));
+#else
 		// this is heavily based on the Mono Xna implementation
         // http://code.google.com/p/monoxna/
 
@@ -357,6 +437,7 @@ namespace Nxna
         result.M42 = (matrix.M11 * det10 - matrix.M12 * det8 + matrix.M13 * det7) * invDetMatrix;
         result.M43 = (-matrix.M41 * det4 + matrix.M42 * det2 - matrix.M43 * det1) * invDetMatrix;
         result.M44 = (matrix.M31 * det4 - matrix.M32 * det2 + matrix.M33 * det1) * invDetMatrix;
+#endif
 	}
 
 	void Matrix::Transpose(const Matrix& matrix, Matrix& result)
@@ -384,6 +465,29 @@ namespace Nxna
 
 	void Matrix::Multiply(const Matrix& matrix1, const Matrix& matrix2, Matrix& result)
 	{
+#if defined NXNA_SIMD_SSE2
+		// each row of the result is a row of matrix1 times matrix2.
+		// All 4 are done before storing anything in case result is also one of the inputs.
+		Simd::Float4 rows[4], r[4];
+		Simd::LoadRows(matrix2, rows);
+		for (int i = 0; i < 4; i++)
+			r[i] = Simd::Transform(matrix1.C[i * 4 + 0], matrix1.C[i * 4 + 1], matrix1.C[i * 4 + 2], matrix1.C[i * 4 + 3], rows);
+		for (int i = 0; i < 4; i++)
+			Simd::Store4(r[i], &result.C[i * 4]);
+#elif defined NXNA_SIMD_NEON
+		Simd::Float4 rows[4], r[4];
+		Simd::LoadRows(matrix2, rows);
+		for (int i = 0; i < 4; i++)
+		{
+			float32x4_t a = vld1q_f32(&matrix1.C[i * 4]);
+			r[i] = vmulq_lane_f32(rows[0], vget_low_f32(a), 0);
+			r[i] = vmlaq_lane_f32(r[i], rows[1], vget_low_f32(a), 1);
+			r[i] = vmlaq_lane_f32(r[i], rows[2], vget_high_f32(a), 0);
+			r[i] = vmlaq_lane_f32(r[i], rows[3], vget_high_f32(a), 1);
+		}
+		for (int i = 0; i < 4; i++)
+			Simd::Store4(r[i], &result.C[i * 4]);
+#else
 		result.M11 = matrix1.M11 * matrix2.M11 + matrix1.M12 * matrix2.M21 + matrix1.M13 * matrix2.M31 + matrix1.M14 * matrix2.M41;
         result.M12 = matrix1.M11 * matrix2.M12 + matrix1.M12 * matrix2.M22 + matrix1.M13 * matrix2.M32 + matrix1.M14 * matrix2.M42;
         result.M13 = matrix1.M11 * matrix2.M13 + matrix1.M12 * matrix2.M23 + matrix1.M13 * matrix2.M33 + matrix1.M14 * matrix2.M43;
@@ -400,5 +504,6 @@ namespace Nxna
         result.M42 = matrix1.M41 * matrix2.M12 + matrix1.M42 * matrix2.M22 + matrix1.M43 * matrix2.M32 + matrix1.M44 * matrix2.M42;
         result.M43 = matrix1.M41 * matrix2.M13 + matrix1.M42 * matrix2.M23 + matrix1.M43 * matrix2.M33 + matrix1.M44 * matrix2.M43;
         result.M44 = matrix1.M41 * matrix2.M14 + matrix1.M42 * matrix2.M24 + matrix1.M43 * matrix2.M34 + matrix1.M44 * matrix2.M44;
+#endif
 	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "Song.h"
 #include "../Content/MappedFileStream.h"
 #include "../Audio/OggVorbis/OggVorbisDecoder.h"
+#include "../Utils/Profiler.h"
 #include <cassert>
 
 #ifdef NXNA_AUDIOENGINE_OPENAL
@@ -95,6 +96,8 @@ namespace Media
 
 	void OggMediaPlayer::Tick(void* handle)
 	{
+		NXNA_PROFILE_SCOPE("OggMediaPlayer::Tick");
+
 #ifndef NXNA_DISABLE_OGG
 #ifdef NXNA_AUDIOENGINE_OPENAL
 		int processed;
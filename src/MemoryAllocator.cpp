@@ -1,3 +1,4 @@
+#include <cstdint>
 #include "MemoryAllocator.h"
 
 #ifdef NXNA_DEBUG_TEMPMEMORYPOOL
@@ -27,8 +28,18 @@ namespace Nxna
 #else
 		if (amount > m_memorySize)
 		{
-			m_memorySize = amount * 2;
-			m_memory = (char*)realloc(m_memory, m_memorySize);
+			// leave room to grow, unless that's what makes it fail
+			size_t size = amount <= SIZE_MAX / 2 ? amount * 2 : amount;
+			char* memory = (char*)realloc(m_memory, size);
+			if (memory == nullptr && size != amount)
+				memory = (char*)realloc(m_memory, size = amount);
+
+			// the old memory is still good, so leave it alone
+			if (memory == nullptr)
+				return nullptr;
+
+			m_memory = memory;
+			m_memorySize = size;
 		}
 
 		return m_memory;
@@ -15,6 +15,7 @@ namespace Nxna
 #endif
 
 	public:
+		// returns null if there isn't enough memory
 		static void* GetMemory(size_t amount);
 
 #ifdef NXNA_DEBUG_TEMPMEMORYPOOL
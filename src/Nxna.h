@@ -26,6 +26,11 @@ namespace Nxna
 #include "Vector4.h"
 #include "Matrix.h"
 #include "Quaternion.h"
+#include "Plane.h"
+#include "Ray.h"
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+#include "BoundingFrustum.h"
 #include "IGraphicsDeviceManager.h"
 #include "Graphics/GraphicsDevice.h"
 #include "Graphics/GraphicsAdapter.h"
@@ -36,6 +41,7 @@ namespace Nxna
 #include "Graphics/BasicEffect.h"
 #include "Graphics/DualTextureEffect.h"
 #include "Graphics/AlphaTestEffect.h"
+#include "Graphics/SkinnedEffect.h"
 #include "Graphics/SpriteFont.h"
 #include "Graphics/SamplerState.h"
 #include "Input/Mouse.h"
@@ -41,6 +41,13 @@ __pragma(warning(disable:4481))
 #define NXNA_ENABLE_OVERRIDE_WARNING
 #endif
 
+// thread local storage (the C++11 keyword isn't supported everywhere yet)
+#ifdef _MSC_VER
+#define NXNA_THREAD_LOCAL __declspec(thread)
+#else
+#define NXNA_THREAD_LOCAL __thread
+#endif
+
 // create some macros to disable constant warnings about "nameless struct/union"
 #ifdef _MSC_VER
 #define NXNA_DISABLE_NAMELESS_STRUCT_WARNING __pragma(warning(push)) \
@@ -84,6 +91,21 @@ __pragma(warning(disable:4201))
 #define NXNA_DISABLE_D3D11
 #endif
 
+// if you want the math code to stick to plain C++ then uncomment the following line
+//#define NXNA_DISABLE_SIMD
+
+// which SIMD instructions can the math code use?
+#if !defined NXNA_DISABLE_SIMD && !defined NXNA_PLATFORM_NACL
+#if defined _M_X64 || defined __x86_64__ || (defined _M_IX86_FP && _M_IX86_FP >= 2) || defined __SSE2__
+#define NXNA_SIMD_SSE2
+#elif defined __ARM_NEON__ || defined __ARM_NEON
+#define NXNA_SIMD_NEON
+#endif
+#endif
+
+// uncomment the following line to have the SDL game loop print a histogram of frame times when it exits
+//#define NXNA_LOG_FRAME_PACING
+
 
 // determine whether this is 32-bit or 64-bit
 #ifdef NXNA_PLATFORM_WIN32
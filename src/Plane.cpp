@@ -0,0 +1,55 @@
+#include "Plane.h"
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+
+namespace Nxna
+{
+	Plane::Plane(const Vector3& point1, const Vector3& point2, const Vector3& point3)
+	{
+		Vector3::Cross(point2 - point1, point3 - point1, Normal);
+		Normal.Normalize();
+		D = -Vector3::Dot(Normal, point1);
+	}
+
+	void Plane::Normalize()
+	{
+		float length = Normal.Length();
+		if (length == 0)
+			return;
+
+		float inv = 1.0f / length;
+		Normal *= inv;
+		D *= inv;
+	}
+
+	PlaneIntersectionType Plane::Intersects(const BoundingBox& box) const
+	{
+		// only the corners nearest and farthest along the normal matter
+		Vector3 nearest, farthest;
+		farthest.X = Normal.X >= 0 ? box.Max.X : box.Min.X;
+		farthest.Y = Normal.Y >= 0 ? box.Max.Y : box.Min.Y;
+		farthest.Z = Normal.Z >= 0 ? box.Max.Z : box.Min.Z;
+		nearest.X = Normal.X >= 0 ? box.Min.X : box.Max.X;
+		nearest.Y = Normal.Y >= 0 ? box.Min.Y : box.Max.Y;
+		nearest.Z = Normal.Z >= 0 ? box.Min.Z : box.Max.Z;
+
+		if (DotCoordinate(nearest) > 0)
+			return PlaneIntersectionType::Front;
+		if (DotCoordinate(farthest) < 0)
+			return PlaneIntersectionType::Back;
+
+		return PlaneIntersectionType::Intersecting;
+	}
+
+	PlaneIntersectionType Plane::Intersects(const BoundingSphere& sphere) const
+	{
+		float distance = DotCoordinate(sphere.Center);
+
+		if (distance > sphere.Radius)
+			return PlaneIntersectionType::Front;
+		if (distance < -sphere.Radius)
+			return PlaneIntersectionType::Back;
+
+		return PlaneIntersectionType::Intersecting;
+	}
+}
@@ -0,0 +1,70 @@
+#ifndef NXNA_PLANE_H
+#define NXNA_PLANE_H
+
+#include "NxnaConfig.h"
+#include "Vector3.h"
+#include "Vector4.h"
+
+namespace Nxna
+{
+	struct BoundingBox;
+	struct BoundingSphere;
+
+	NXNA_ENUM(PlaneIntersectionType)
+		Front,
+		Back,
+		Intersecting
+	END_NXNA_ENUM(PlaneIntersectionType)
+
+	// the plane is every point p where Dot(Normal, p) + D == 0
+	struct Plane
+	{
+		Vector3 Normal;
+		float D;
+
+		Plane()
+		{
+			D = 0;
+		}
+
+		Plane(const Vector3& normal, float d)
+			: Normal(normal), D(d)
+		{
+		}
+
+		Plane(float a, float b, float c, float d)
+			: Normal(a, b, c), D(d)
+		{
+		}
+
+		Plane(const Vector4& v)
+			: Normal(v.X, v.Y, v.Z), D(v.W)
+		{
+		}
+
+		Plane(const Vector3& point1, const Vector3& point2, const Vector3& point3);
+
+		float Dot(const Vector4& v) const
+		{
+			return Normal.X * v.X + Normal.Y * v.Y + Normal.Z * v.Z + D * v.W;
+		}
+
+		float DotCoordinate(const Vector3& v) const
+		{
+			return Normal.X * v.X + Normal.Y * v.Y + Normal.Z * v.Z + D;
+		}
+
+		float DotNormal(const Vector3& v) const
+		{
+			return Normal.X * v.X + Normal.Y * v.Y + Normal.Z * v.Z;
+		}
+
+		void Normalize();
+		static Plane Normalize(const Plane& plane) { Plane p = plane; p.Normalize(); return p; }
+
+		PlaneIntersectionType Intersects(const BoundingBox& box) const;
+		PlaneIntersectionType Intersects(const BoundingSphere& sphere) const;
+	};
+}
+
+#endif // NXNA_PLANE_H
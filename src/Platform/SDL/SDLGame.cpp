@@ -1,3 +1,5 @@
+#include <thread>
+#include <algorithm>
 #include "SDLGame.h"
 #if defined NXNA_PLATFORM_APPLE
 #include <SDL2/SDL.h>
@@ -6,6 +8,9 @@
 #endif
 #include "../../Audio/AudioManager.h"
 #include "../../Utils/StopWatch.h"
+#include "../../Utils/Profiler.h"
+#include "../../Utils/Jobs.h"
+#include "../../Logger.h"
 
 namespace Nxna
 {
@@ -13,13 +18,18 @@ namespace Platform
 {
 namespace SDL
 {
+	// same as XNA's Game.MaxElapsedTime. Anything longer (a breakpoint, dragging the window, etc) is ignored.
+	static const double MaxElapsedTime = 0.5;
+
+	// the most Update() calls to make in one frame before giving up on catching up
+	static const int MaxUpdatesPerFrame = 5;
+
 	SDLGame::SDLGame(Game* game)
 	{
 		m_game = game;
 		m_active = true;
 		m_quitReceived = false;
-		m_targetElapsedTime = 1.0f / 60.0f;
-		m_isFixedTimeStep = true;
+		m_startTicks = 0;
 
 		SDL_Init(SDL_INIT_VIDEO);
 	}
@@ -35,6 +45,9 @@ namespace SDL
 
 		Audio::AudioManager::Init();
 
+		// start the workers before Initialize() so LoadContent() can use them
+		Utils::Jobs::Start();
+
 		m_game->Initialize();
 
 		// see if the client called Exit() during initialization
@@ -47,62 +60,102 @@ namespace SDL
 
 	void SDLGame::Run()
 	{
-		double accumulatedElapsedTime = 0;
+		// everything is timed in performance counter ticks, since SDL_GetTicks() is only good to the millisecond
+		const uint64_t frequency = SDL_GetPerformanceFrequency();
+		const uint64_t maxElapsedTicks = (uint64_t)(MaxElapsedTime * frequency);
 
+		uint64_t accumulatedTicks = 0;
+		uint64_t prevTicks = SDL_GetPerformanceCounter();
 		float timeAtLastDraw = 0;
-		double targetElapsedTime = m_targetElapsedTime * 1000.0f;
 
-		double freq = 1000.0 / (double)SDL_GetPerformanceFrequency();
-		uint64_t prevTimeNow = SDL_GetPerformanceCounter();
+		m_startTicks = prevTicks;
 
 		while(m_quitReceived == false)
 		{
-			uint64_t timeNow = SDL_GetPerformanceCounter();
-			accumulatedElapsedTime += (timeNow - prevTimeNow) * freq;
-			prevTimeNow = timeNow;
-		
+			// the game can change these at any time
+			bool isFixedTimeStep = m_game->m_isFixedTimeStep;
+			float targetElapsedTime = m_game->m_targetElapsedTime;
+			uint64_t targetTicks = (uint64_t)((double)targetElapsedTime * frequency);
+			if (targetTicks == 0)
+				targetTicks = 1;
+
+			uint64_t ticksNow = SDL_GetPerformanceCounter();
+			uint64_t elapsedTicks = std::min(ticksNow - prevTicks, maxElapsedTicks);
+			prevTicks = ticksNow;
+
 			bool needToDraw = false;
 
-			if (m_isFixedTimeStep)
+			if (isFixedTimeStep)
 			{
-				if (accumulatedElapsedTime < targetElapsedTime)
-				{
-					unsigned int timeRemainder = (unsigned int)(targetElapsedTime - accumulatedElapsedTime);
-					if (timeRemainder > 0)
-						SDL_Delay(timeRemainder);
+				if (m_game->m_graphicsDeviceManager != nullptr && m_game->m_graphicsDeviceManager->SynchronizeWithVerticalRetrace())
+					elapsedTicks = snapToVsync(elapsedTicks, targetTicks);
 
+				accumulatedTicks += elapsedTicks;
+
+				if (accumulatedTicks < targetTicks)
+				{
+					waitUntil(ticksNow + (targetTicks - accumulatedTicks));
 					continue;
 				}
 
-				m_gameTime.ElapsedGameTime = m_targetElapsedTime;
+				Utils::Profiler::BeginFrame();
 
-				handleEvents();
-				updateTime();
+				m_gameTime.ElapsedGameTime = targetElapsedTime;
+
+				{
+					NXNA_PROFILE_SCOPE("SDLGame::HandleEvents");
+					handleEvents();
+					updateTime();
+				}
+
+				Utils::Jobs::RunMainThreadJobs();
 
 				Media::MediaPlayer::Tick();
 
-				while (accumulatedElapsedTime >= targetElapsedTime)
+				NXNA_PROFILE_SCOPE("SDLGame::Update");
+				int numUpdates = 0;
+				while (accumulatedTicks >= targetTicks && numUpdates < MaxUpdatesPerFrame)
 				{
-					accumulatedElapsedTime -= targetElapsedTime;
+					accumulatedTicks -= targetTicks;
 
-					m_gameTime.TotalGameTime += m_targetElapsedTime;
+					m_gameTime.TotalGameTime += targetElapsedTime;
+					m_gameTime.IsRunningSlowly = numUpdates > 0;
 					m_game->Update(m_gameTime);
 
+					numUpdates++;
 					needToDraw = true;
 				}
+
+				// Update() is taking longer than the target time, so stop trying to catch
+				// up or each frame will need even more updates than the last.
+				if (accumulatedTicks >= targetTicks)
+					accumulatedTicks %= targetTicks;
+
+				m_gameTime.IsRunningSlowly = numUpdates > 1;
 			}
 			else
 			{
-				handleEvents();
-				updateTime();
+				accumulatedTicks = 0;
+
+				Utils::Profiler::BeginFrame();
+
+				{
+					NXNA_PROFILE_SCOPE("SDLGame::HandleEvents");
+					handleEvents();
+					updateTime();
+				}
+
+				Utils::Jobs::RunMainThreadJobs();
 
 				Media::MediaPlayer::Tick();
 
-				float elapsedtime = MathHelper::Min(0.1f, m_gameTime.ElapsedGameTime);
+				float elapsedtime = MathHelper::Min(0.1f, (float)((double)elapsedTicks / frequency));
 
 				m_gameTime.TotalGameTime += elapsedtime;
 				m_gameTime.ElapsedGameTime = elapsedtime;
+				m_gameTime.IsRunningSlowly = false;
 
+				NXNA_PROFILE_SCOPE("SDLGame::Update");
 				m_game->Update(m_gameTime);
 
 				needToDraw = true;
@@ -113,14 +166,32 @@ namespace SDL
 				GameTime time;
 				time.TotalGameTime = m_gameTime.TotalGameTime;
 				time.ElapsedGameTime = m_realTime.TotalGameTime - timeAtLastDraw;
+				time.IsRunningSlowly = m_gameTime.IsRunningSlowly;
+
+				{
+					NXNA_PROFILE_SCOPE("SDLGame::Draw");
+					NXNA_PROFILE_GPU_SCOPE("Draw");
+
+					m_game->m_graphicsDeviceManager->BeginDraw();
+					m_game->Draw(time);
+				}
 
-				m_game->m_graphicsDeviceManager->BeginDraw();
-				m_game->Draw(time);
-				m_game->m_graphicsDeviceManager->EndDraw();
+				{
+					NXNA_PROFILE_SCOPE("SDLGame::Present");
+					m_game->m_graphicsDeviceManager->EndDraw();
+				}
+
+#ifdef NXNA_LOG_FRAME_PACING
+				m_frameIntervals.push_back(time.ElapsedGameTime * 1000.0f);
+#endif
 
 				timeAtLastDraw = m_realTime.TotalGameTime;
 			}
+
+			Utils::Profiler::EndFrame();
 		}
+
+		logFramePacing();
 	}
 
 	void SDLGame::Exit()
@@ -255,12 +326,82 @@ namespace SDL
 
 	void SDLGame::updateTime()
 	{
-		unsigned int time = SDL_GetTicks();
-		float currentTime = time / 1000.0f;
+		uint64_t ticks = SDL_GetPerformanceCounter() - m_startTicks;
+		float currentTime = (float)((double)ticks / SDL_GetPerformanceFrequency());
 
 		m_realTime.ElapsedGameTime = currentTime - m_realTime.TotalGameTime;
 		m_realTime.TotalGameTime = currentTime;
 	}
+
+	void SDLGame::waitUntil(uint64_t ticks)
+	{
+		// SDL_Delay() often oversleeps by a millisecond or two, so only sleep
+		// until shortly before the deadline and then yield the rest of the way
+		const uint64_t frequency = SDL_GetPerformanceFrequency();
+		const uint64_t spinTicks = frequency * 2 / 1000;
+
+		uint64_t now = SDL_GetPerformanceCounter();
+		if (now + spinTicks < ticks)
+		{
+			Uint32 milliseconds = (Uint32)((ticks - now - spinTicks) * 1000 / frequency);
+			if (milliseconds > 0)
+				SDL_Delay(milliseconds);
+		}
+
+		while (SDL_GetPerformanceCounter() < ticks)
+			std::this_thread::yield();
+	}
+
+	uint64_t SDLGame::snapToVsync(uint64_t elapsedTicks, uint64_t targetTicks)
+	{
+		// When presenting is synced to the display the time between frames still wobbles
+		// a little around the refresh interval. If the target time matches the refresh rate
+		// that wobble means some frames get 0 updates and some get 2, so anything close
+		// enough to a whole number of frames gets rounded to it.
+		const uint64_t tolerance = targetTicks / 50;
+
+		for (int i = 1; i <= MaxUpdatesPerFrame; i++)
+		{
+			uint64_t frames = targetTicks * i;
+			if (elapsedTicks + tolerance >= frames && elapsedTicks <= frames + tolerance)
+				return frames;
+		}
+
+		return elapsedTicks;
+	}
+
+	void SDLGame::logFramePacing()
+	{
+#ifdef NXNA_LOG_FRAME_PACING
+		if (m_frameIntervals.empty())
+			return;
+
+		std::vector<float> sorted(m_frameIntervals);
+		std::sort(sorted.begin(), sorted.end());
+
+		float target = m_game->m_targetElapsedTime * 1000.0f;
+		float jitter = 0;
+		for (size_t i = 0; i < m_frameIntervals.size(); i++)
+			jitter += fabs(m_frameIntervals[i] - target);
+		jitter /= m_frameIntervals.size();
+
+		NXNA_LOG_DEBUG("Frame pacing: %u frames, target %.2f ms, mean jitter %.3f ms\n", (unsigned int)sorted.size(), target, jitter);
+		NXNA_LOG_DEBUG("  p50 %.2f ms  p95 %.2f ms  p99 %.2f ms  max %.2f ms\n",
+			sorted[sorted.size() / 2], sorted[sorted.size() * 95 / 100], sorted[sorted.size() * 99 / 100], sorted.back());
+
+		// 1 ms buckets, with everything over 40 ms in the last one
+		const int numBuckets = 41;
+		unsigned int buckets[numBuckets] = {};
+		for (size_t i = 0; i < sorted.size(); i++)
+			buckets[std::min((int)sorted[i], numBuckets - 1)]++;
+
+		for (int i = 0; i < numBuckets; i++)
+		{
+			if (buckets[i] > 0)
+				NXNA_LOG_DEBUG("  %2d%s ms: %u\n", i, i == numBuckets - 1 ? "+" : " ", buckets[i]);
+		}
+#endif
+	}
 }
 }
 }
@@ -1,6 +1,8 @@
 #ifndef NXNA_PLATFORM_SDL_SDLGAME_H
 #define NXNA_PLATFORM_SDL_SDLGAME_H
 
+#include <cstdint>
+#include <vector>
 #include "../../Nxna.h"
 
 namespace Nxna
@@ -15,10 +17,13 @@ namespace SDL
 		bool m_quitReceived;
 		GameTime m_gameTime;
 		GameTime m_realTime;
-		bool m_isFixedTimeStep;
-		float m_targetElapsedTime;
+		uint64_t m_startTicks;
 		Game* m_game;
 
+#ifdef NXNA_LOG_FRAME_PACING
+		std::vector<float> m_frameIntervals;
+#endif
+
 	public:
 		SDLGame(Game* game);
 		void Init(int argc, char* argv[]);
@@ -31,6 +36,9 @@ namespace SDL
 	private:
 		void handleEvents();
 		void updateTime();
+		void waitUntil(uint64_t ticks);
+		uint64_t snapToVsync(uint64_t elapsedTicks, uint64_t targetTicks);
+		void logFramePacing();
 	};
 }
 }
@@ -18,6 +18,8 @@ namespace SDL
 	SDLOpenGlWindow::SDLOpenGlWindow(Nxna::Game* game)
 		: Nxna::GraphicsDeviceManager(game)
 	{
+		m_window = nullptr;
+		m_glContext = nullptr;
 	}
 
 	Nxna::Graphics::GraphicsDevice* SDLOpenGlWindow::CreateDevice()
@@ -33,11 +35,14 @@ namespace SDL
 
 	void SDLOpenGlWindow::EndDraw()
 	{
+		m_device->Present();
 		SDL_GL_SwapWindow((SDL_Window*)m_window);
 	}
 
 	void SDLOpenGlWindow::ApplyChanges()
 	{
+		if (m_glContext != nullptr)
+			SDL_GL_SetSwapInterval(SynchronizeWithVerticalRetrace() ? 1 : 0);
 	}
 
 	void SDLOpenGlWindow::ShowWindow()
@@ -150,6 +155,8 @@ namespace SDL
         
 		m_glContext = SDL_GL_CreateContext((SDL_Window*)m_window);
 
+		SDL_GL_SetSwapInterval(SynchronizeWithVerticalRetrace() ? 1 : 0);
+
 		static_cast<Nxna::Graphics::OpenGl::OpenGlDevice*>(m_device)->OnContextCreated();
 
 		Graphics::PresentationParameters newParams = pp;
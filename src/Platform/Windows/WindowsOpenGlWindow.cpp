@@ -38,6 +38,7 @@ namespace Windows
 
 	void WindowsOpenGlWindow::EndDraw()
 	{
+		m_device->Present();
 		SwapBuffers((HDC)m_hdc);
 	}
 
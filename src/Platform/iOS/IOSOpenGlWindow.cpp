@@ -28,6 +28,7 @@ namespace iOS
 
 	void IOSOpenGlWindow::EndDraw()
 	{
+		m_device->Present();
 	}
 
 	void IOSOpenGlWindow::ApplyChanges()
@@ -0,0 +1,88 @@
+#include <cmath>
+#include <cfloat>
+#include "Ray.h"
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+#include "Plane.h"
+
+namespace Nxna
+{
+	bool Ray::Intersects(const BoundingBox& box, float& distance) const
+	{
+		// clip the ray against each pair of box faces ("slabs")
+		float nearest = -FLT_MAX;
+		float farthest = FLT_MAX;
+
+		for (int i = 0; i < 3; i++)
+		{
+			if (fabs(Direction.C[i]) < 1e-6f)
+			{
+				if (Position.C[i] < box.Min.C[i] || Position.C[i] > box.Max.C[i])
+					return false;
+			}
+			else
+			{
+				float inv = 1.0f / Direction.C[i];
+				float t1 = (box.Min.C[i] - Position.C[i]) * inv;
+				float t2 = (box.Max.C[i] - Position.C[i]) * inv;
+
+				if (t1 > t2)
+				{
+					float temp = t1;
+					t1 = t2;
+					t2 = temp;
+				}
+
+				if (t1 > nearest) nearest = t1;
+				if (t2 < farthest) farthest = t2;
+
+				if (nearest > farthest || farthest < 0)
+					return false;
+			}
+		}
+
+		// the ray starts inside the box
+		distance = nearest < 0 ? 0 : nearest;
+		return true;
+	}
+
+	bool Ray::Intersects(const BoundingSphere& sphere, float& distance) const
+	{
+		Vector3 offset = sphere.Center - Position;
+		float lengthSquared = offset.LengthSquared();
+		float radiusSquared = sphere.Radius * sphere.Radius;
+
+		if (lengthSquared <= radiusSquared)
+		{
+			distance = 0;
+			return true;
+		}
+
+		float directionLengthSquared = Direction.LengthSquared();
+		float projection = Vector3::Dot(offset, Direction);
+		if (projection < 0 || directionLengthSquared == 0)
+			return false;
+
+		// squared distance between the sphere center and the closest point on the ray
+		float closestSquared = lengthSquared - projection * projection / directionLengthSquared;
+		if (closestSquared > radiusSquared)
+			return false;
+
+		distance = (projection - sqrt(radiusSquared - closestSquared) * sqrt(directionLengthSquared)) / directionLengthSquared;
+		return true;
+	}
+
+	bool Ray::Intersects(const Plane& plane, float& distance) const
+	{
+		float denominator = plane.DotNormal(Direction);
+		if (fabs(denominator) < 1e-6f)
+			return false;
+
+		float t = -plane.DotCoordinate(Position) / denominator;
+		if (t < 0)
+			return false;
+
+		distance = t;
+		return true;
+	}
+}
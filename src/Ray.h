@@ -0,0 +1,35 @@
+#ifndef NXNA_RAY_H
+#define NXNA_RAY_H
+
+#include "Vector3.h"
+
+namespace Nxna
+{
+	struct BoundingBox;
+	struct BoundingSphere;
+	struct Plane;
+
+	struct Ray
+	{
+		Vector3 Position;
+		Vector3 Direction;
+
+		Ray()
+		{
+		}
+
+		Ray(const Vector3& position, const Vector3& direction)
+			: Position(position), Direction(direction)
+		{
+		}
+
+		// These return false if there's no intersection. Otherwise distance is set to
+		// how far along the ray the intersection is, in multiples of Direction.
+		// (XNA returns a Nullable<float> instead)
+		bool Intersects(const BoundingBox& box, float& distance) const;
+		bool Intersects(const BoundingSphere& sphere, float& distance) const;
+		bool Intersects(const Plane& plane, float& distance) const;
+	};
+}
+
+#endif // NXNA_RAY_H
@@ -0,0 +1,363 @@
+#include <cassert>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include "../NxnaConfig.h"
+#include "Jobs.h"
+
+namespace Nxna
+{
+namespace Utils
+{
+	struct Job
+	{
+		Jobs::JobFunction Function;
+		JobCounter* Counter;
+		bool MainThreadOnly;
+	};
+
+	struct JobQueue
+	{
+		std::mutex Lock;
+		std::deque<Job*> Items;
+	};
+
+	// Queue 0 is shared by the main thread and any other thread that isn't a worker.
+	// Workers use the rest.
+	static JobQueue* g_queues = nullptr;
+	static int g_numQueues = 0;
+	static JobQueue g_mainThreadQueue;
+	static std::vector<std::thread> g_workers;
+	static bool g_running = false;
+	static std::thread::id g_mainThreadID;
+
+	static std::atomic<int> g_numQueuedJobs(0);
+	static std::atomic<int> g_numSleeping(0);
+	static std::atomic<bool> g_quit(false);
+	static std::mutex g_sleepLock;
+	static std::condition_variable g_wakeUp;
+
+	static NXNA_THREAD_LOCAL int t_queueIndex = 0;
+
+	static void push(Job* job)
+	{
+		if (job->MainThreadOnly)
+		{
+			std::lock_guard<std::mutex> lock(g_mainThreadQueue.Lock);
+			g_mainThreadQueue.Items.push_back(job);
+			return;
+		}
+
+		JobQueue& queue = g_queues[t_queueIndex];
+		{
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			queue.Items.push_back(job);
+		}
+
+		g_numQueuedJobs.fetch_add(1);
+
+		if (g_numSleeping.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(g_sleepLock);
+			g_wakeUp.notify_one();
+		}
+	}
+
+	static Job* findJob()
+	{
+		// the newest job in our own queue is the most likely to still be in the cache...
+		{
+			JobQueue& queue = g_queues[t_queueIndex];
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			if (queue.Items.empty() == false)
+			{
+				Job* job = queue.Items.back();
+				queue.Items.pop_back();
+				g_numQueuedJobs.fetch_sub(1);
+				return job;
+			}
+		}
+
+		// ...and the oldest job in someone else's queue is the least likely to be in theirs
+		for (int i = 1; i < g_numQueues; i++)
+		{
+			JobQueue& queue = g_queues[(t_queueIndex + i) % g_numQueues];
+			std::lock_guard<std::mutex> lock(queue.Lock);
+			if (queue.Items.empty() == false)
+			{
+				Job* job = queue.Items.front();
+				queue.Items.pop_front();
+				g_numQueuedJobs.fetch_sub(1);
+				return job;
+			}
+		}
+
+		return nullptr;
+	}
+
+	static Job* findMainThreadJob()
+	{
+		std::lock_guard<std::mutex> lock(g_mainThreadQueue.Lock);
+		if (g_mainThreadQueue.Items.empty())
+			return nullptr;
+
+		Job* job = g_mainThreadQueue.Items.front();
+		g_mainThreadQueue.Items.pop_front();
+		return job;
+	}
+
+	void Jobs::finish(JobCounter* counter, std::vector<Job*>& released)
+	{
+		if (counter == nullptr)
+			return;
+
+		// Wait() takes the lock before returning, so the counter can't be destroyed while this is still using it
+		std::lock_guard<std::mutex> lock(counter->m_lock);
+
+		// if that was the last one then anything waiting on the counter can go now
+		if (counter->m_count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			released.swap(counter->m_waitingJobs);
+	}
+
+	void Jobs::execute(Job* job)
+	{
+		job->Function();
+
+		std::vector<Job*> released;
+		finish(job->Counter, released);
+		delete job;
+
+		for (size_t i = 0; i < released.size(); i++)
+			push(released[i]);
+	}
+
+	void Jobs::schedule(const JobFunction& function, JobCounter* counter, JobCounter* dependency, bool mainThreadOnly)
+	{
+		if (counter != nullptr)
+			counter->m_count.fetch_add(1, std::memory_order_acq_rel);
+
+		Job* job = new Job();
+		job->Function = function;
+		job->Counter = counter;
+		job->MainThreadOnly = mainThreadOnly;
+
+		if (dependency != nullptr)
+		{
+			std::lock_guard<std::mutex> lock(dependency->m_lock);
+			if (dependency->IsDone() == false)
+			{
+				dependency->m_waitingJobs.push_back(job);
+				return;
+			}
+		}
+
+		push(job);
+	}
+
+	void Jobs::workerMain(int queueIndex)
+	{
+		t_queueIndex = queueIndex;
+
+		while (true)
+		{
+			Job* job = findJob();
+			if (job != nullptr)
+			{
+				execute(job);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(g_sleepLock);
+			g_numSleeping.fetch_add(1);
+			g_wakeUp.wait(lock, [] { return g_numQueuedJobs.load() > 0 || g_quit.load(); });
+			g_numSleeping.fetch_sub(1);
+
+			if (g_quit.load() && g_numQueuedJobs.load() == 0)
+				return;
+		}
+	}
+
+	void Jobs::Start(int numWorkers)
+	{
+		if (g_running)
+			return;
+
+		if (numWorkers <= 0)
+		{
+			int cores = (int)std::thread::hardware_concurrency();
+			numWorkers = cores > 1 ? cores - 1 : 1;
+		}
+
+		g_mainThreadID = std::this_thread::get_id();
+		g_numQueues = numWorkers + 1;
+		g_queues = new JobQueue[g_numQueues];
+		g_quit.store(false);
+		t_queueIndex = 0;
+
+		for (int i = 0; i < numWorkers; i++)
+			g_workers.push_back(std::thread(workerMain, i + 1));
+
+		g_running = true;
+	}
+
+	void Jobs::Shutdown()
+	{
+		if (g_running == false)
+			return;
+
+		assert(IsMainThread());
+
+		// help finish whatever's left
+		while (true)
+		{
+			Job* job = findJob();
+			if (job == nullptr)
+				job = findMainThreadJob();
+			if (job == nullptr)
+				break;
+
+			execute(job);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(g_sleepLock);
+			g_quit.store(true);
+		}
+		g_wakeUp.notify_all();
+
+		for (size_t i = 0; i < g_workers.size(); i++)
+			g_workers[i].join();
+		g_workers.clear();
+
+		// the workers may have queued more main thread jobs on their way out
+		RunMainThreadJobs();
+
+		delete[] g_queues;
+		g_queues = nullptr;
+		g_numQueues = 0;
+		g_running = false;
+	}
+
+	bool Jobs::IsRunning()
+	{
+		return g_running;
+	}
+
+	int Jobs::GetNumWorkers()
+	{
+		return (int)g_workers.size();
+	}
+
+	bool Jobs::IsMainThread()
+	{
+		return g_running == false || std::this_thread::get_id() == g_mainThreadID;
+	}
+
+	int Jobs::GetThreadIndex()
+	{
+		return t_queueIndex;
+	}
+
+	void Jobs::Run(const JobFunction& job, JobCounter* counter, JobCounter* dependency)
+	{
+		if (g_running == false)
+		{
+			if (dependency != nullptr)
+				assert(dependency->IsDone());
+
+			job();
+			return;
+		}
+
+		schedule(job, counter, dependency, false);
+	}
+
+	void Jobs::RunOnMainThread(const JobFunction& job, JobCounter* counter, JobCounter* dependency)
+	{
+		if (g_running == false)
+		{
+			if (dependency != nullptr)
+				assert(dependency->IsDone());
+
+			job();
+			return;
+		}
+
+		schedule(job, counter, dependency, true);
+	}
+
+	void Jobs::RunMainThreadJobs()
+	{
+		if (g_running == false)
+			return;
+
+		assert(IsMainThread());
+
+		Job* job;
+		while ((job = findMainThreadJob()) != nullptr)
+			execute(job);
+	}
+
+	void Jobs::Wait(JobCounter* counter)
+	{
+		wait(counter, true);
+	}
+
+	void Jobs::wait(JobCounter* counter, bool runMainThreadJobs)
+	{
+		assert(counter != nullptr);
+
+		bool mainThread = runMainThreadJobs && IsMainThread();
+		while (counter->IsDone() == false)
+		{
+			Job* job = nullptr;
+			if (g_running)
+			{
+				job = findJob();
+				if (job == nullptr && mainThread)
+					job = findMainThreadJob();
+			}
+
+			if (job != nullptr)
+				execute(job);
+			else
+				std::this_thread::yield();
+		}
+
+		// make sure whoever finished the last job is done with the counter
+		std::lock_guard<std::mutex> lock(counter->m_lock);
+	}
+
+	void Jobs::ParallelFor(size_t count, const RangeFunction& function, size_t minChunkSize)
+	{
+		if (count == 0)
+			return;
+		if (minChunkSize == 0)
+			minChunkSize = 1;
+
+		if (g_running == false || count <= minChunkSize)
+		{
+			function(0, count);
+			return;
+		}
+
+		// about 4 chunks per thread
+		size_t numThreads = g_workers.size() + 1;
+		size_t chunkSize = (count + numThreads * 4 - 1) / (numThreads * 4);
+		if (chunkSize < minChunkSize)
+			chunkSize = minChunkSize;
+
+		JobCounter counter;
+		for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+		{
+			size_t end = begin + chunkSize < count ? begin + chunkSize : count;
+			schedule([&function, begin, end] { function(begin, end); }, &counter, nullptr, false);
+		}
+
+		// do the first chunk here instead of just waiting
+		function(0, chunkSize < count ? chunkSize : count);
+
+		wait(&counter, false);
+	}
+}
+}
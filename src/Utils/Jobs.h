@@ -0,0 +1,91 @@
+#ifndef NXNA_UTILS_JOBS_H
+#define NXNA_UTILS_JOBS_H
+
+#include <cstddef>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <functional>
+
+namespace Nxna
+{
+namespace Utils
+{
+	struct Job;
+
+	// Counts how many jobs haven't finished yet. Jobs can be told not to start until a
+	// counter reaches 0, and any thread can wait for one with Jobs::Wait().
+	// A counter must outlive the jobs that use it, so use Wait() rather than
+	// polling IsDone() before destroying one.
+	class JobCounter
+	{
+		friend class Jobs;
+
+		std::atomic<int> m_count;
+		std::mutex m_lock;
+		std::vector<Job*> m_waitingJobs;
+
+		JobCounter(const JobCounter&);
+		JobCounter& operator=(const JobCounter&);
+
+	public:
+		JobCounter() : m_count(0) { }
+
+		bool IsDone() { return m_count.load(std::memory_order_acquire) == 0; }
+	};
+
+	// this class doesn't exist in XNA!
+	// Runs jobs on a pool of worker threads, one per core. Each worker has its own queue
+	// and takes the newest job from it, and when it runs out it steals the oldest job
+	// from one of the other queues.
+	// If the scheduler hasn't been started then jobs just run immediately on the calling thread.
+	class Jobs
+	{
+	public:
+		typedef std::function<void()> JobFunction;
+		typedef std::function<void(size_t begin, size_t end)> RangeFunction;
+
+		// numWorkers is the number of threads to create. 0 means one less than the number of cores.
+		// The game loop calls this during startup, so most games don't need to.
+		static void Start(int numWorkers = 0);
+
+		// finishes any queued jobs and then stops the workers
+		static void Shutdown();
+
+		static bool IsRunning();
+		static int GetNumWorkers();
+		static bool IsMainThread();
+
+		// 0 for the main thread (and any thread that isn't a worker), 1 to GetNumWorkers() for the workers.
+		// Handy for giving each thread its own buffers so they don't need locks.
+		static int GetThreadIndex();
+
+		// counter (if not null) is incremented now and decremented once the job is finished.
+		// The job won't start until dependency (if not null) is done.
+		static void Run(const JobFunction& job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+		// For jobs that must run on the main thread, like anything that uses the graphics device.
+		// These run whenever the main thread is in Wait(), and once per frame in the game loop.
+		static void RunOnMainThread(const JobFunction& job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+		static void RunMainThreadJobs();
+
+		// runs other jobs until the counter is done
+		static void Wait(JobCounter* counter);
+
+		// Splits [0, count) into chunks and calls function(begin, end) for each of them in parallel.
+		// The chunks are sized so each thread gets a few (so a slow chunk doesn't hold everyone up),
+		// but never smaller than minChunkSize. Returns once every chunk is finished.
+		// Main thread jobs aren't run while it waits, so it's safe to use in the middle of drawing.
+		static void ParallelFor(size_t count, const RangeFunction& function, size_t minChunkSize = 1);
+
+	private:
+		static void schedule(const JobFunction& function, JobCounter* counter, JobCounter* dependency, bool mainThreadOnly);
+		static void finish(JobCounter* counter, std::vector<Job*>& released);
+		static void wait(JobCounter* counter, bool runMainThreadJobs);
+		static void execute(Job* job);
+		static void workerMain(int queueIndex);
+	};
+}
+}
+
+#endif // NXNA_UTILS_JOBS_H
@@ -0,0 +1,350 @@
+#include <atomic>
+#include <algorithm>
+#include <cstdio>
+#include "../NxnaConfig.h"
+#include "Profiler.h"
+#include "StopWatch.h"
+#include "../Exception.h"
+
+#ifdef NXNA_PLATFORM_WIN32
+#define NXNA_PROFILER_SNPRINTF _snprintf_s
+#else
+#define NXNA_PROFILER_SNPRINTF snprintf
+#endif
+
+namespace Nxna
+{
+namespace Utils
+{
+	// Each thread gets one of these. Only the owning thread writes events and only the thread
+	// calling EndFrame() reads them. There are two halves: the thread writes into one while
+	// EndFrame() swaps it for the other and reads what was written, so the half being read is
+	// never written to. State has the half being written in the top bit and how many events
+	// have been started in it in the rest. Events that don't fit are dropped.
+	struct ProfilerThreadBuffer
+	{
+		static const unsigned int Capacity = 4096;
+		static const unsigned int HalfBit = 0x80000000;
+
+		ProfileEvent Events[2][Capacity];
+		std::atomic<unsigned int> State;
+
+		// how many events have been finished in each half
+		std::atomic<unsigned int> Written[2];
+
+		unsigned short Depth;
+		unsigned short ThreadIndex;
+		ProfilerThreadBuffer* Next;
+	};
+
+	static const unsigned int MaxCaptureEvents = 1024 * 1024;
+	static const int GpuThreadIndex = 1000;
+
+	static std::atomic<ProfilerThreadBuffer*> g_threadBuffers(nullptr);
+	static std::atomic<unsigned int> g_numThreadBuffers(0);
+	static NXNA_THREAD_LOCAL ProfilerThreadBuffer* t_threadBuffer = nullptr;
+
+	std::atomic<bool> Profiler::m_enabled(false);
+	bool Profiler::m_capturing = false;
+	unsigned int Profiler::m_frameNumber = 0;
+	uint64_t Profiler::m_frameStart = 0;
+	uint64_t Profiler::m_frameEnd = 0;
+	uint64_t Profiler::m_captureStart = 0;
+	IGpuTimer* Profiler::m_gpuTimer = nullptr;
+	int Profiler::m_gpuScopeDepth = 0;
+	std::vector<ProfileEvent> Profiler::m_frameEvents;
+	std::vector<GpuProfileEvent> Profiler::m_gpuEvents;
+	std::vector<ProfileEvent> Profiler::m_captureEvents;
+	std::vector<GpuProfileEvent> Profiler::m_captureGpuEvents;
+
+	static ProfilerThreadBuffer* getThreadBuffer()
+	{
+		ProfilerThreadBuffer* buffer = t_threadBuffer;
+		if (buffer == nullptr)
+		{
+			buffer = new ProfilerThreadBuffer();
+			buffer->State.store(0);
+			buffer->Written[0].store(0);
+			buffer->Written[1].store(0);
+			buffer->Depth = 0;
+			buffer->ThreadIndex = (unsigned short)g_numThreadBuffers.fetch_add(1);
+
+			// push the new buffer onto the front of the list
+			buffer->Next = g_threadBuffers.load();
+			while (g_threadBuffers.compare_exchange_weak(buffer->Next, buffer) == false) { }
+
+			t_threadBuffer = buffer;
+		}
+
+		return buffer;
+	}
+
+	static double ticksToMilliseconds(uint64_t ticks)
+	{
+		return StopWatch::TicksToMicroseconds(ticks) / 1000.0;
+	}
+
+	static void writeEscaped(FILE* fp, const char* name)
+	{
+		for (const char* c = name; *c != 0; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				fputc('\\', fp);
+			fputc(*c, fp);
+		}
+	}
+
+	static bool compareEvents(const ProfileEvent& a, const ProfileEvent& b)
+	{
+		if (a.ThreadIndex != b.ThreadIndex)
+			return a.ThreadIndex < b.ThreadIndex;
+		if (a.Start != b.Start)
+			return a.Start < b.Start;
+
+		return a.Depth < b.Depth;
+	}
+
+	void Profiler::SetEnabled(bool enabled)
+	{
+		m_enabled.store(enabled);
+	}
+
+	void Profiler::BeginFrame()
+	{
+		m_frameStart = StopWatch::GetCurrentTicks();
+	}
+
+	void Profiler::EndFrame()
+	{
+		m_frameEnd = StopWatch::GetCurrentTicks();
+
+		m_frameEvents.clear();
+		for (ProfilerThreadBuffer* buffer = g_threadBuffers.load(std::memory_order_acquire); buffer != nullptr; buffer = buffer->Next)
+		{
+			// point the thread at the other (empty) half, and take the one it was writing
+			unsigned int state = buffer->State.load(std::memory_order_relaxed);
+			unsigned int half = state & ProfilerThreadBuffer::HalfBit;
+			state = buffer->State.exchange(half ^ ProfilerThreadBuffer::HalfBit, std::memory_order_acq_rel);
+
+			int index = half != 0 ? 1 : 0;
+			unsigned int count = std::min(state & ~ProfilerThreadBuffer::HalfBit, ProfilerThreadBuffer::Capacity);
+
+			// a scope that started writing before the swap might not be done yet, but it's only a few stores away
+			while (buffer->Written[index].load(std::memory_order_acquire) < count) { }
+
+			m_frameEvents.insert(m_frameEvents.end(), buffer->Events[index], buffer->Events[index] + count);
+			buffer->Written[index].store(0, std::memory_order_relaxed);
+		}
+
+		m_gpuEvents.clear();
+		if (m_gpuTimer != nullptr)
+			m_gpuTimer->EndFrame(m_frameNumber, m_gpuEvents);
+
+		if (m_capturing)
+		{
+			if (m_captureEvents.size() + m_frameEvents.size() > MaxCaptureEvents)
+				m_capturing = false;
+			else
+			{
+				m_captureEvents.insert(m_captureEvents.end(), m_frameEvents.begin(), m_frameEvents.end());
+				m_captureGpuEvents.insert(m_captureGpuEvents.end(), m_gpuEvents.begin(), m_gpuEvents.end());
+			}
+		}
+
+		m_frameNumber++;
+	}
+
+	void Profiler::BeginScope()
+	{
+		getThreadBuffer()->Depth++;
+	}
+
+	void Profiler::EndScope(const char* name, uint64_t start)
+	{
+		uint64_t end = StopWatch::GetCurrentTicks();
+
+		ProfilerThreadBuffer* buffer = getThreadBuffer();
+		buffer->Depth--;
+
+		// claim a slot in whichever half EndFrame() hasn't taken
+		unsigned int state = buffer->State.fetch_add(1, std::memory_order_acquire);
+		int half = (state & ProfilerThreadBuffer::HalfBit) != 0 ? 1 : 0;
+		unsigned int index = state & ~ProfilerThreadBuffer::HalfBit;
+		if (index >= ProfilerThreadBuffer::Capacity)
+			return;
+
+		ProfileEvent& e = buffer->Events[half][index];
+		e.Name = name;
+		e.Start = start;
+		e.End = end;
+		e.Depth = buffer->Depth;
+		e.ThreadIndex = buffer->ThreadIndex;
+
+		buffer->Written[half].fetch_add(1, std::memory_order_release);
+	}
+
+	bool Profiler::BeginGpuScope(const char* name)
+	{
+		if (IsEnabled() == false || m_gpuTimer == nullptr)
+			return false;
+
+		if (m_gpuTimer->Begin(name, StopWatch::GetCurrentTicks()) == false)
+			return false;
+
+		m_gpuScopeDepth++;
+		return true;
+	}
+
+	void Profiler::EndGpuScope()
+	{
+		// the timer could have been replaced since the scope began
+		if (m_gpuTimer != nullptr && m_gpuScopeDepth > 0)
+		{
+			m_gpuTimer->End();
+			m_gpuScopeDepth--;
+		}
+	}
+
+	void Profiler::SetGpuTimer(IGpuTimer* timer)
+	{
+		m_gpuTimer = timer;
+		m_gpuScopeDepth = 0;
+	}
+
+	std::string Profiler::GetLastFrameReport()
+	{
+		std::vector<ProfileEvent> events(m_frameEvents);
+		std::sort(events.begin(), events.end(), compareEvents);
+
+		std::string report;
+		char line[256];
+
+		NXNA_PROFILER_SNPRINTF(line, 256, "Frame %u: %.3f ms\n", m_frameNumber - 1, ticksToMilliseconds(m_frameEnd - m_frameStart));
+		report += line;
+
+		int currentThread = -1;
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			if (events[i].ThreadIndex != currentThread)
+			{
+				currentThread = events[i].ThreadIndex;
+				NXNA_PROFILER_SNPRINTF(line, 256, "Thread %d\n", currentThread);
+				report += line;
+			}
+
+			NXNA_PROFILER_SNPRINTF(line, 256, "%*s%-40s %8.3f ms\n", (events[i].Depth + 1) * 2, "", events[i].Name, ticksToMilliseconds(events[i].End - events[i].Start));
+			report += line;
+		}
+
+		for (size_t i = 0; i < m_gpuEvents.size(); i++)
+		{
+			NXNA_PROFILER_SNPRINTF(line, 256, "GPU (frame %u)  %-40s %8.3f ms\n", m_gpuEvents[i].FrameNumber, m_gpuEvents[i].Name, m_gpuEvents[i].Nanoseconds / 1000000.0);
+			report += line;
+		}
+
+		return report;
+	}
+
+	void Profiler::StartCapture()
+	{
+		m_captureEvents.clear();
+		m_captureGpuEvents.clear();
+		m_captureStart = StopWatch::GetCurrentTicks();
+		m_capturing = true;
+	}
+
+	void Profiler::StopCapture()
+	{
+		m_capturing = false;
+	}
+
+	void Profiler::ExportChromeTrace(const char* filename)
+	{
+		FILE* fp = fopen(filename, "w");
+		if (fp == nullptr)
+			throw Exception("Unable to open trace file for writing", __FILE__, __LINE__);
+
+		fputs("{\"traceEvents\":[\n", fp);
+		fprintf(fp, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", GpuThreadIndex);
+
+		for (size_t i = 0; i < m_captureEvents.size(); i++)
+		{
+			const ProfileEvent& e = m_captureEvents[i];
+			uint64_t start = e.Start > m_captureStart ? e.Start - m_captureStart : 0;
+
+			fputs(",\n{\"name\":\"", fp);
+			writeEscaped(fp, e.Name);
+			fprintf(fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%llu}", (int)e.ThreadIndex,
+				(unsigned long long)StopWatch::TicksToMicroseconds(start),
+				(unsigned long long)StopWatch::TicksToMicroseconds(e.End - e.Start));
+		}
+
+		// The GPU's clock doesn't line up with the CPU's, so each frame's first GPU event is placed
+		// at the moment its query was issued, and the rest of that frame goes by the GPU timestamps.
+		// That keeps nested scopes inside their parents.
+		uint64_t frameTicks = 0, frameNanoseconds = 0;
+		for (size_t i = 0; i < m_captureGpuEvents.size(); i++)
+		{
+			const GpuProfileEvent& e = m_captureGpuEvents[i];
+
+			if (i == 0 || e.FrameNumber != m_captureGpuEvents[i - 1].FrameNumber || e.StartNanoseconds < frameNanoseconds)
+			{
+				frameTicks = e.IssueTicks > m_captureStart ? e.IssueTicks - m_captureStart : 0;
+				frameNanoseconds = e.StartNanoseconds;
+			}
+
+			uint64_t start = StopWatch::TicksToMicroseconds(frameTicks) + (e.StartNanoseconds - frameNanoseconds) / 1000;
+
+			fputs(",\n{\"name\":\"", fp);
+			writeEscaped(fp, e.Name);
+			fprintf(fp, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%llu,\"dur\":%llu}", GpuThreadIndex,
+				(unsigned long long)start,
+				(unsigned long long)(e.Nanoseconds / 1000));
+		}
+
+		fputs("\n]}\n", fp);
+		fclose(fp);
+	}
+
+	void Profiler::Shutdown()
+	{
+		m_enabled.store(false);
+		m_capturing = false;
+		m_gpuTimer = nullptr;
+
+		// any threads that used the profiler should be finished by now
+		ProfilerThreadBuffer* buffer = g_threadBuffers.exchange(nullptr);
+		while (buffer != nullptr)
+		{
+			ProfilerThreadBuffer* next = buffer->Next;
+			delete buffer;
+			buffer = next;
+		}
+		t_threadBuffer = nullptr;
+
+		m_frameEvents.clear();
+		m_gpuEvents.clear();
+		m_captureEvents.clear();
+		m_captureGpuEvents.clear();
+	}
+
+	ProfileScope::ProfileScope(const char* name)
+	{
+		if (Profiler::IsEnabled() == false)
+		{
+			m_name = nullptr;
+			return;
+		}
+
+		m_name = name;
+		Profiler::BeginScope();
+		m_start = StopWatch::GetCurrentTicks();
+	}
+
+	ProfileScope::~ProfileScope()
+	{
+		if (m_name != nullptr)
+			Profiler::EndScope(m_name, m_start);
+	}
+}
+}
@@ -0,0 +1,139 @@
+#ifndef NXNA_UTILS_PROFILER_H
+#define NXNA_UTILS_PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Nxna
+{
+namespace Utils
+{
+	struct ProfileEvent
+	{
+		const char* Name;
+		uint64_t Start;
+		uint64_t End;
+		unsigned short Depth;
+		unsigned short ThreadIndex;
+	};
+
+	struct GpuProfileEvent
+	{
+		const char* Name;
+		uint64_t IssueTicks;
+
+		// on the GPU's clock, which doesn't match the CPU's
+		uint64_t StartNanoseconds;
+		uint64_t Nanoseconds;
+		unsigned int FrameNumber;
+	};
+
+	// Implemented by the graphics device when it supports timer queries.
+	// GPU scopes can be nested, and End() always ends the innermost one.
+	class IGpuTimer
+	{
+	public:
+		virtual ~IGpuTimer() { }
+		virtual bool Begin(const char* name, uint64_t issueTicks) = 0;
+		virtual void End() = 0;
+
+		// Called once per frame. Adds the results of any frames the GPU has finished.
+		virtual void EndFrame(unsigned int frameNumber, std::vector<GpuProfileEvent>& results) = 0;
+	};
+
+	// Collects named CPU (and optionally GPU) timings every frame.
+	// Scopes can be opened on any thread. Each thread writes to its own buffer,
+	// and the buffers are only read by the thread that calls EndFrame().
+	class Profiler
+	{
+		static std::atomic<bool> m_enabled;
+		static bool m_capturing;
+		static unsigned int m_frameNumber;
+		static uint64_t m_frameStart;
+		static uint64_t m_frameEnd;
+		static uint64_t m_captureStart;
+		static IGpuTimer* m_gpuTimer;
+		static int m_gpuScopeDepth;
+
+		static std::vector<ProfileEvent> m_frameEvents;
+		static std::vector<GpuProfileEvent> m_gpuEvents;
+		static std::vector<ProfileEvent> m_captureEvents;
+		static std::vector<GpuProfileEvent> m_captureGpuEvents;
+
+	public:
+		static void SetEnabled(bool enabled);
+		static bool IsEnabled() { return m_enabled.load(std::memory_order_relaxed); }
+
+		static void BeginFrame();
+		static void EndFrame();
+
+		static void BeginScope();
+		static void EndScope(const char* name, uint64_t start);
+
+		static bool BeginGpuScope(const char* name);
+		static void EndGpuScope();
+
+		// the profiler does not own the timer
+		static void SetGpuTimer(IGpuTimer* timer);
+
+		static unsigned int GetFrameNumber() { return m_frameNumber; }
+		static const std::vector<ProfileEvent>& GetLastFrameEvents() { return m_frameEvents; }
+		static const std::vector<GpuProfileEvent>& GetLastGpuEvents() { return m_gpuEvents; }
+
+		// Builds an indented, per-thread report of the last completed frame
+		static std::string GetLastFrameReport();
+
+		// Keeps every event from every frame until the capture is stopped
+		static void StartCapture();
+		static void StopCapture();
+		static bool IsCapturing() { return m_capturing; }
+
+		// Writes the captured events in the Chrome trace format (open with chrome://tracing)
+		static void ExportChromeTrace(const char* filename);
+
+		static void Shutdown();
+	};
+
+	class ProfileScope
+	{
+		const char* m_name;
+		uint64_t m_start;
+
+	public:
+		ProfileScope(const char* name);
+		~ProfileScope();
+	};
+
+	class GpuProfileScope
+	{
+		bool m_active;
+
+	public:
+		GpuProfileScope(const char* name)
+		{
+			m_active = Profiler::BeginGpuScope(name);
+		}
+
+		~GpuProfileScope()
+		{
+			if (m_active)
+				Profiler::EndGpuScope();
+		}
+	};
+}
+}
+
+#define NXNA_PROFILE_CONCAT2(a, b) a ## b
+#define NXNA_PROFILE_CONCAT(a, b) NXNA_PROFILE_CONCAT2(a, b)
+
+#ifdef NXNA_DISABLE_PROFILER
+#define NXNA_PROFILE_SCOPE(name)
+#define NXNA_PROFILE_GPU_SCOPE(name)
+#else
+#define NXNA_PROFILE_SCOPE(name) Nxna::Utils::ProfileScope NXNA_PROFILE_CONCAT(nxnaProfileScope, __LINE__)(name)
+#define NXNA_PROFILE_GPU_SCOPE(name) Nxna::Utils::GpuProfileScope NXNA_PROFILE_CONCAT(nxnaGpuProfileScope, __LINE__)(name)
+#endif
+
+#endif // NXNA_UTILS_PROFILER_H
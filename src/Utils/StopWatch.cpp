@@ -35,25 +35,27 @@ namespace Utils
 #endif
 	}
 
-	StopWatch::StopWatch()
+	uint64_t StopWatch::TicksToMicroseconds(uint64_t ticks)
 	{
-		m_running = false;
-		m_timeElapsed = 0;
+		getFrequency();
 
 #ifdef _WIN32
-		if (m_frequency == 0)
-		{
-			LARGE_INTEGER frequency;
-			QueryPerformanceFrequency(&frequency);
-			m_frequency = frequency.QuadPart;
-		}
+		return ticks * 1000000 / m_frequency;
 #elif defined NXNA_PLATFORM_APPLE
-		if (m_info.denom == 0 ) {
-			mach_timebase_info(&m_info);
-		}
+		return ticks * m_info.numer / m_info.denom / 1000;
+#else
+		return ticks / 1000;
 #endif
 	}
 
+	StopWatch::StopWatch()
+	{
+		m_running = false;
+		m_timeElapsed = 0;
+
+		getFrequency();
+	}
+
 	void StopWatch::Start()
 	{
 		if (m_running == false)
@@ -105,6 +107,22 @@ namespace Utils
 		return (unsigned int)(GetElapsedTicks() * m_info.numer / m_info.denom / 1000000);
 #else
 		return (unsigned int)(GetElapsedTicks() / 1000000);
+#endif
+	}
+
+	void StopWatch::getFrequency()
+	{
+#ifdef _WIN32
+		if (m_frequency == 0)
+		{
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			m_frequency = frequency.QuadPart;
+		}
+#elif defined NXNA_PLATFORM_APPLE
+		if (m_info.denom == 0 ) {
+			mach_timebase_info(&m_info);
+		}
 #endif
 	}
 }
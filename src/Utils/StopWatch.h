@@ -17,6 +17,7 @@ namespace Utils
 
 	public:
 		static uint64_t GetCurrentTicks();
+		static uint64_t TicksToMicroseconds(uint64_t ticks);
 
 		StopWatch();
 		void Start();
@@ -28,7 +29,7 @@ namespace Utils
 		unsigned int GetElapsedMilliseconds32();
 
 	private:
-		void getFrequency();
+		static void getFrequency();
 	};
 }
 }
@@ -1,5 +1,6 @@
 #include "Vector2.h"
 #include "Matrix.h"
+#include "MathSimd.h"
 
 namespace Nxna
 {
@@ -42,6 +43,20 @@ namespace Nxna
 		result.Y = y;
 	}
 
+	void Vector2::Transform(const Vector2* source, Vector2* destination, size_t count, const Matrix& m)
+	{
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 rows[4];
+		Simd::LoadRows(m, rows);
+
+		for (size_t i = 0; i < count; i++)
+			Simd::Store2(Simd::TransformPoint(source[i].X, source[i].Y, 0, rows), &destination[i].X);
+#else
+		for (size_t i = 0; i < count; i++)
+			Transform(source[i], m, destination[i]);
+#endif
+	}
+
 	float Vector2::Distance(const Vector2& v1, const Vector2& v2)
 	{
 		return sqrt((v1.X - v2.X) * (v1.X - v2.X) + (v1.Y - v2.Y) * (v1.Y - v2.Y));
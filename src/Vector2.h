@@ -2,6 +2,7 @@
 #define MATH_VECTOR2_H
 
 #include <cmath>
+#include <cstddef>
 
 namespace Nxna
 {
@@ -131,6 +132,9 @@ namespace Nxna
 
 		static Vector2 Normalize(const Vector2& v);
 		static void Transform(const Vector2& v, const Matrix& m, Vector2& result);
+
+		// transforms count vectors at once. source and destination can be the same array.
+		static void Transform(const Vector2* source, Vector2* destination, size_t count, const Matrix& m);
 		static float Distance(const Vector2& v1, const Vector2& v2);
 		static float DistanceSquared(const Vector2& v1, const Vector2& v2);
 		static void DistanceSquared(const Vector2& v1, const Vector2& v2, float& result);
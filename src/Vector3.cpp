@@ -1,6 +1,7 @@
 #include "Vector3.h"
 #include "Quaternion.h"
 #include "Matrix.h"
+#include "MathSimd.h"
 
 namespace Nxna
 {
@@ -98,6 +99,34 @@ namespace Nxna
 		 result.Z = z;
 	 }
 
+	 void Vector3::Transform(const Vector3* source, Vector3* destination, size_t count, const Matrix& matrix)
+	 {
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		 Simd::Float4 rows[4];
+		 Simd::LoadRows(matrix, rows);
+
+		 for (size_t i = 0; i < count; i++)
+			 Simd::Store3(Simd::TransformPoint(source[i].X, source[i].Y, source[i].Z, rows), &destination[i].X);
+#else
+		 for (size_t i = 0; i < count; i++)
+			 Transform(source[i], matrix, destination[i]);
+#endif
+	 }
+
+	 void Vector3::TransformNormal(const Vector3* source, Vector3* destination, size_t count, const Matrix& matrix)
+	 {
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		 Simd::Float4 rows[4];
+		 Simd::LoadRows(matrix, rows);
+
+		 for (size_t i = 0; i < count; i++)
+			 Simd::Store3(Simd::TransformNormal(source[i].X, source[i].Y, source[i].Z, rows), &destination[i].X);
+#else
+		 for (size_t i = 0; i < count; i++)
+			 TransformNormal(source[i], matrix, destination[i]);
+#endif
+	 }
+
 	 float Vector3::Distance(const Vector3& v1, const Vector3& v2)
 	 {
 		 return sqrt((v1.X - v2.X) * (v1.X - v2.X) + (v1.Y - v2.Y) * (v1.Y - v2.Y) + (v1.Z - v2.Z) * (v1.Z - v2.Z));
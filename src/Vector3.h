@@ -2,6 +2,7 @@
 #define MATH_VECTOR3_H
 
 #include <cmath>
+#include <cstddef>
 #include "NxnaConfig.h"
 
 NXNA_DISABLE_NAMELESS_STRUCT_WARNING
@@ -130,6 +131,10 @@ namespace Nxna
 		static Vector3 TransformNormal(const Vector3& normal, const Matrix& matrix) { Vector3 v; TransformNormal(normal, matrix, v); return v; }
 		static void TransformNormal(const Vector3& normal, const Matrix& matrix, Vector3& result);
 
+		// these transform count vectors at once. source and destination can be the same array.
+		static void Transform(const Vector3* source, Vector3* destination, size_t count, const Matrix& matrix);
+		static void TransformNormal(const Vector3* source, Vector3* destination, size_t count, const Matrix& matrix);
+
 		static float Distance(const Vector3& v1, const Vector3& v2);
 		static float DistanceSquared(const Vector3& v1, const Vector3& v2);
 	};
@@ -1,10 +1,16 @@
 #include "Vector4.h"
 #include "Matrix.h"
+#include "MathSimd.h"
 
 namespace Nxna
 {
 	void Vector4::Transform(const Vector4& v, const Matrix& matrix, Vector4& result)
 	{
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 rows[4];
+		Simd::LoadRows(matrix, rows);
+		Simd::Store4(Simd::Transform(v.X, v.Y, v.Z, v.W, rows), &result.X);
+#else
 		float x = v.X * matrix.M11 + v.Y * matrix.M21 + v.Z * matrix.M31 + v.W * matrix.M41;
         float y = v.X * matrix.M12 + v.Y * matrix.M22 + v.Z * matrix.M32 + v.W * matrix.M42;
         float z = v.X * matrix.M13 + v.Y * matrix.M23 + v.Z * matrix.M33 + v.W * matrix.M43;
@@ -14,5 +20,20 @@ namespace Nxna
 		result.Y = y;
 		result.Z = z;
 		result.W = w;
+#endif
+	}
+
+	void Vector4::Transform(const Vector4* source, Vector4* destination, size_t count, const Matrix& matrix)
+	{
+#if defined NXNA_SIMD_SSE2 || defined NXNA_SIMD_NEON
+		Simd::Float4 rows[4];
+		Simd::LoadRows(matrix, rows);
+
+		for (size_t i = 0; i < count; i++)
+			Simd::Store4(Simd::Transform(source[i].X, source[i].Y, source[i].Z, source[i].W, rows), &destination[i].X);
+#else
+		for (size_t i = 0; i < count; i++)
+			Transform(source[i], matrix, destination[i]);
+#endif
 	}
 }
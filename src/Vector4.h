@@ -1,6 +1,8 @@
 #ifndef MATH_VECTOR4_H
 #define MATH_VECTOR4_H
 
+#include <cstddef>
+
 namespace Nxna
 {
 	struct Matrix;
@@ -30,6 +32,9 @@ namespace Nxna
 		}
 
 		static void Transform(const Vector4& v, const Matrix& matrix, Vector4& result);
+
+		// transforms count vectors at once. source and destination can be the same array.
+		static void Transform(const Vector4* source, Vector4* destination, size_t count, const Matrix& matrix);
 	};
 }
 
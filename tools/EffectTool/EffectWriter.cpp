@@ -15,7 +15,7 @@ void EffectWriter::Write(const EffectXml& effect, ResizableBuffer* stream)
 	stream->Write(header, 4);
 
 	// write version
-	stream->WriteByte(1);
+	stream->WriteByte(2);
 
 	auto& techniques = effect.GetTechniques();
 	auto& cbuffers = effect.GetCBuffers();
@@ -59,6 +59,7 @@ void EffectWriter::Write(const EffectXml& effect, ResizableBuffer* stream)
 			stream->Write((*itr2).Name.c_str(), (*itr2).Name.length());
 			stream->WriteByte((*itr2).Type);
 			stream->WriteByte((*itr2).NumElements);
+			stream->WriteByte((*itr2).Count);
 		}
 	}
 
@@ -182,6 +182,11 @@ EffectXml::EffectXml(const std::string& xml)
 				constantXml.Name = constant->Attribute("name");
 				constantXml.Type = ElementType::Parse(constant->Attribute("type"));
 				constantXml.NumElements = constant->IntAttribute("numElements");
+				constantXml.Count = 1;
+				constant->QueryIntAttribute("count", &constantXml.Count);
+
+				if (constantXml.Count < 1 || constantXml.NumElements % constantXml.Count != 0)
+					throw EffectToolException("Constant's 'numElements' must be a multiple of its 'count'");
 
 				cbufferXml.Constants.push_back(constantXml);
 
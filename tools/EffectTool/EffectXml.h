@@ -105,7 +105,8 @@ struct ConstantXml
 {
 	std::string Name;
 	ElementType::eElementType Type;
-	int NumElements;
+	int NumElements; // for the whole array
+	int Count; // the length of the array, or 1 if it isn't one
 };
 
 struct CBufferXml